@@ -62,10 +62,11 @@ IDrawContext::IDrawContext(const QString& name, CCanvas::redraw_e maskRedraw, CC
 {
     setObjectName(name);
     // setup map parameters and connect to canvas
-    pjsrc = pj_init_plus("+proj=merc +a=6378137.0000 +b=6356752.3142 +towgs84=0,0,0,0,0,0,0,0 +units=m  +no_defs");
+    pjsrc = nullptr;
     pjtar = pj_init_plus("+proj=longlat +a=6378137.0000 +b=6356752.3142 +towgs84=0,0,0,0,0,0,0,0 +units=m  +no_defs");
 
     setScales(CCanvas::eScalesDefault);
+    setProjection("+proj=merc +a=6378137.0000 +b=6356752.3142 +towgs84=0,0,0,0,0,0,0,0 +units=m  +no_defs");
 
     zoom(5);
 
@@ -77,7 +78,10 @@ IDrawContext::IDrawContext(const QString& name, CCanvas::redraw_e maskRedraw, CC
 IDrawContext::~IDrawContext()
 {
     pj_free(pjtar);
-    pj_free(pjsrc);
+    if(pjsrc != nullptr)
+    {
+        pj_free(pjsrc);
+    }
 }
 
 void IDrawContext::emitSigCanvasUpdate()
@@ -116,21 +120,20 @@ bool IDrawContext::resize(const QSize& size)
     buffer[1].image = QImage(bufWidth, bufHeight, QImage::Format_ARGB32);
     buffer[1].image.fill(Qt::transparent);
 
+    publishTransform();
+
     return true;
 }
 
 QString IDrawContext::getProjection() const
 {
-    if(pjsrc == nullptr)
+    std::shared_ptr<const transform_t> t = getTransform();
+    if(t->projection.isEmpty())
     {
         return QString::Null();
     }
 
-    char *p = pj_get_def(pjsrc, 0);
-    QString str(p);
-    free(p);
-
-    return str;
+    return QString::fromLatin1(t->projection);
 }
 
 void IDrawContext::setProjection(const QString& proj)
@@ -141,6 +144,25 @@ void IDrawContext::setProjection(const QString& proj)
     }
 
     pjsrc = pj_init_plus(proj.toLatin1());
+
+    // worker threads create projection objects of their own from the normalized definition
+    std::shared_ptr<transform_t> t = std::make_shared<transform_t>();
+    if(pjsrc != nullptr)
+    {
+        char *p = pj_get_def(pjsrc, 0);
+        t->projection = p;
+        free(p);
+    }
+
+    QMutexLocker lock(&mutex);
+    t->generation   = ++projGeneration;
+    t->scale        = scale * zoomFactor;
+    t->center       = center;
+
+    focusM = focus;
+    convertRad2M(pjsrc, pjtar, &focusM, 1);
+    t->focusM       = focusM;
+    std::atomic_store(&transform, std::shared_ptr<const transform_t>(t));
 }
 
 void IDrawContext::setScales(const CCanvas::scales_type_e type)
@@ -226,161 +248,200 @@ void IDrawContext::zoom(int idx)
         zoomFactor.rx() = scales[idx];
         zoomFactor.ry() = scales[idx];
         intNeedsRedraw  = true;
+        publishTransform();
 
         emit sigScaleChanged(scale*zoomFactor);
     }
     mutex.unlock(); // --------- stop serialize with thread
 }
 
-void IDrawContext::convertRad2M(QPointF &p) const
+IDrawContext::proj_t::~proj_t()
 {
-    if(pjsrc == nullptr)
+    if(pjsrc != nullptr)
     {
-        return;
+        pj_free(pjsrc);
     }
+    if(pjtar != nullptr)
+    {
+        pj_free(pjtar);
+    }
+    if(ctx != nullptr)
+    {
+        pj_ctx_free(ctx);
+    }
+}
 
-    qreal y = p.y();
-    /*
-        Proj4 makes a wrap around for values outside the
-        range of -180..180°. But the draw context has no
-        turnaround. It exceeds the values. We have to
-        apply fixes in that case.
-     */
-    bool fixWest = p.x() < (-180 * DEG_TO_RAD);
-    bool fixEast = p.x() > ( 180 * DEG_TO_RAD);
-
-    pj_transform(pjtar, pjsrc, 1, 0, &p.rx(), &p.ry(), 0);
+const IDrawContext::proj_t& IDrawContext::getProj(const transform_t& t) const
+{
+    if(!projections.hasLocalData())
+    {
+        proj_t * proj   = new proj_t();
+        proj->ctx       = pj_ctx_alloc();
+        proj->pjtar     = pj_init_plus_ctx(proj->ctx, "+proj=longlat +a=6378137.0000 +b=6356752.3142 +towgs84=0,0,0,0,0,0,0,0 +units=m  +no_defs");
+        projections.setLocalData(proj);
+    }
 
-    /*
-        The idea of the fix is to calculate a point
-        at the boundary with the same latitude and use it
-        as offset.
-     */
-    if(fixWest)
+    proj_t * proj = projections.localData();
+    if(proj->generation != t.generation)
     {
-        QPointF o(-180 * DEG_TO_RAD, y);
-        convertRad2M(o);
-        p.rx() = 2 * o.x() + p.x();
+        if(proj->pjsrc != nullptr)
+        {
+            pj_free(proj->pjsrc);
+        }
+        proj->pjsrc         = t.projection.isEmpty() ? nullptr : pj_init_plus_ctx(proj->ctx, t.projection.constData());
+        proj->generation    = t.generation;
     }
+    return *proj;
+}
 
-    if(fixEast)
+void IDrawContext::publishTransform()
+{
+    std::shared_ptr<transform_t> t = std::make_shared<transform_t>();
+    t->focusM       = focusM;
+    t->scale        = scale * zoomFactor;
+    t->center       = center;
+    if(transform)
     {
-        QPointF o(180 * DEG_TO_RAD, y);
-        convertRad2M(o);
-        p.rx() = 2 * o.x() + p.x();
+        t->projection   = transform->projection;
+        t->generation   = transform->generation;
     }
+    std::atomic_store(&transform, std::shared_ptr<const transform_t>(t));
+}
+
+void IDrawContext::convertRad2M(QPointF &p) const
+{
+    std::shared_ptr<const transform_t> t = getTransform();
+    const proj_t& proj = getProj(*t);
+    convertRad2M(proj.pjsrc, proj.pjtar, &p, 1);
 }
 
 void IDrawContext::convertM2Rad(QPointF &p) const
 {
-    if(pjsrc == nullptr)
+    std::shared_ptr<const transform_t> t = getTransform();
+    const proj_t& proj = getProj(*t);
+    if(proj.pjsrc == nullptr)
     {
         return;
     }
 
-    pj_transform(pjsrc, pjtar, 1, 0, &p.rx(), &p.ry(), 0);
+    pj_transform(proj.pjsrc, proj.pjtar, 1, 0, &p.rx(), &p.ry(), 0);
 }
 
 void IDrawContext::convertPx2Rad(QPointF &p) const
 {
-    mutex.lock(); // --------- start serialize with thread
-
-    QPointF f = focus;
-    convertRad2M(f);
+    std::shared_ptr<const transform_t> t = getTransform();
+    const proj_t& proj = getProj(*t);
+    if(proj.pjsrc == nullptr)
+    {
+        return;
+    }
 
-    p = f + (p - center) * scale * zoomFactor;
+    p = t->focusM + (p - t->center) * t->scale;
 
-    convertM2Rad(p);
+    pj_transform(proj.pjsrc, proj.pjtar, 1, 0, &p.rx(), &p.ry(), 0);
+}
 
-    mutex.unlock(); // --------- stop serialize with thread
+QRectF IDrawContext::getViewport() const
+{
+    QPointF pt1(0, 0);
+    QPointF pt2(viewWidth, 0);
+    QPointF pt3(viewWidth, viewHeight);
+    QPointF pt4(0, viewHeight);
+
+    convertPx2Rad(pt1);
+    convertPx2Rad(pt2);
+    convertPx2Rad(pt3);
+    convertPx2Rad(pt4);
+
+    // the viewport might be rotated by the projection, take the outer bounds
+    const qreal left   = qMin(pt1.x(), pt4.x());
+    const qreal right  = qMax(pt2.x(), pt3.x());
+    const qreal top    = qMax(pt1.y(), pt2.y());
+    const qreal bottom = qMin(pt3.y(), pt4.y());
+
+    return QRectF(QPointF(left, top), QPointF(right, bottom));
 }
 
 void IDrawContext::convertRad2Px(QPointF &p) const
 {
-    mutex.lock(); // --------- start serialize with thread
-
-    QPointF f = focus;
-    convertRad2M(f);
-    convertRad2M(p);
-
-    p = (p - f) / (scale * zoomFactor) + center;
-
-    mutex.unlock(); // --------- stop serialize with thread
+    convertRad2Px(&p, 1);
 }
 
 
 void IDrawContext::convertRad2Px(QPolygonF& poly) const
 {
-    if(pjsrc == nullptr)
+    convertRad2Px(poly.data(), poly.size());
+}
+
+void IDrawContext::convertRad2Px(QPointF * pts, int N) const
+{
+    std::shared_ptr<const transform_t> t = getTransform();
+    const proj_t& proj = getProj(*t);
+    if((proj.pjsrc == nullptr) || (N <= 0))
     {
         return;
     }
 
-    mutex.lock(); // --------- start serialize with thread
-
-    QPointF f = focus;
-    convertRad2M(f);
+    convertRad2M(proj.pjsrc, proj.pjtar, pts, N);
 
-    const int N = poly.size();
-
-    struct p_t
+    const QPointF f = t->focusM;
+    const QPointF s = t->scale;
+    const QPointF c = t->center;
+    for(int i = 0; i < N; ++i)
     {
-        qreal fixWest;
-        qreal fixEast;
-    };
-
-    QVector<p_t> fixes(N, {NOFLOAT, NOFLOAT});
+        pts[i] = (pts[i] - f) / s + c;
+    }
+}
 
-    qreal * pY  = &poly.data()->ry();
-    p_t * pFix  = fixes.data();
+void IDrawContext::convertRad2M(projPJ pjsrc, projPJ pjtar, QPointF * pts, int N)
+{
+    if((pjsrc == nullptr) || (N <= 0))
+    {
+        return;
+    }
 
     /*
         Proj4 makes a wrap around for values outside the
         range of -180..180°. But the draw context has no
         turnaround. It exceeds the values. We have to
-        apply fixes in that case.
+        apply fixes in that case. As this is rare, the
+        original points are only copied if needed at all.
      */
-    for(int i = 0; i < N; ++i, ++pFix, pY += 2)
+    QPolygonF orig;
+    for(int i = 0; i < N; ++i)
     {
-        if(*pY < (-180 * DEG_TO_RAD))
-        {
-            pFix->fixWest = *pY;
-        }
-        if(*pY > ( 180 * DEG_TO_RAD))
+        const qreal x = pts[i].x();
+        if((x < (-180 * DEG_TO_RAD)) || (x > (180 * DEG_TO_RAD)))
         {
-            pFix->fixEast = *pY;
+            orig.resize(N);
+            std::copy(pts, pts + N, orig.begin());
+            break;
         }
     }
 
-    pj_transform(pjtar, pjsrc, N, 2, &poly.data()->rx(), &poly.data()->ry(), 0);
-
+    pj_transform(pjtar, pjsrc, N, 2, &pts->rx(), &pts->ry(), 0);
 
-    QPointF * pPt = poly.data();
-    pFix          = fixes.data();
-    for(int i = 0; i < N; ++i, ++pFix, ++pPt)
+    for(int i = 0; i < orig.size(); ++i)
     {
         /*
             The idea of the fix is to calculate a point
             at the boundary with the same latitude and use it
             as offset.
          */
-        if(pFix->fixWest != NOFLOAT)
+        const QPointF& pt = orig[i];
+        if(pt.x() < (-180 * DEG_TO_RAD))
         {
-            QPointF o(-180 * DEG_TO_RAD, pFix->fixWest);
-            convertRad2M(o);
-            pPt->rx() = 2 * o.x() + pPt->x();
+            QPointF o(-180 * DEG_TO_RAD, pt.y());
+            pj_transform(pjtar, pjsrc, 1, 0, &o.rx(), &o.ry(), 0);
+            pts[i].rx() = 2 * o.x() + pts[i].x();
         }
-        if(pFix->fixEast != NOFLOAT)
+        else if(pt.x() > (180 * DEG_TO_RAD))
         {
-            QPointF o(180 * DEG_TO_RAD, pFix->fixEast);
-            convertRad2M(o);
-            pPt->rx() = 2 * o.x() + pPt->x();
+            QPointF o(180 * DEG_TO_RAD, pt.y());
+            pj_transform(pjtar, pjsrc, 1, 0, &o.rx(), &o.ry(), 0);
+            pts[i].rx() = 2 * o.x() + pts[i].x();
         }
-
-        *pPt = (*pPt - f) / (scale * zoomFactor) + center;
     }
-
-    mutex.unlock(); // --------- stop serialize with thread
 }
 
 
@@ -392,14 +453,15 @@ void IDrawContext::draw(QPainter& p, CCanvas::redraw_e needsRedraw, const QPoint
     }
 
     // convert global coordinate of focus into point of map
-    focus = f;
-
-    QPointF f1 = focus;
+    QPointF f1 = f;
     convertRad2M(f1);
 
     QPointF bufferScale = scale * zoomFactor;
 
     mutex.lock(); // --------- start serialize with thread
+    focus  = f;
+    focusM = f1;
+    publishTransform();
 
     // derive references for all corners coordinate of map buffer
     ref1 = f1 + QPointF(-bufWidth / 2, -bufHeight / 2) * bufferScale;
@@ -20,11 +20,13 @@
 #define IDRAWCONTEXT_H
 
 
+#include <memory>
 #include <proj_api.h>
 #include <QImage>
 #include <QMutex>
 #include <QPointF>
 #include <QThread>
+#include <QThreadStorage>
 
 
 #include "canvas/CCanvas.h"
@@ -99,6 +101,36 @@ public:
      */
     void convertRad2Px(QPointF& p) const;
     void convertRad2Px(QPolygonF& poly) const;
+    /**
+       @brief Convert an array of geo coordinates in [rad] to pixel coordinates of the viewport
+
+       This is by far faster than converting each point on it's own. All points are
+       projected by a single call to pj_transform().
+
+       @param pts           pointer to the first point
+       @param N             the number of points
+     */
+    void convertRad2Px(QPointF * pts, int N) const;
+
+    /**
+       @brief Project an array of geo coordinates in [rad] from pjtar to pjsrc
+
+       All points are projected by a single call to pj_transform(). Points beyond
+       +/-180° are fixed up afterwards, as the draw context has no wrap around.
+       This is the worker of all conversions into the projection of the draw context.
+
+       @param pjsrc         the projection of the draw context
+       @param pjtar         WGS84 long/lat
+       @param pts           pointer to the first point
+       @param N             the number of points
+     */
+    static void convertRad2M(projPJ pjsrc, projPJ pjtar, QPointF * pts, int N);
+
+    /**
+       @brief Get the area covered by the viewport
+       @return A rectangle of the top left and bottom right corner in [rad]
+     */
+    QRectF getViewport() const;
 
     /**
        @brief Check if the internal needs redraw flag is set
@@ -196,8 +228,10 @@ protected:
 
     QPointF center; /// the center of the viewport
 
-    projPJ pjsrc; //< source projection should be the same for all maps
-    projPJ pjtar; //< target projection is always WGS84
+    /// source projection should be the same for all maps, @note only for the thread that owns the draw context
+    projPJ pjsrc;
+    /// target projection is always WGS84, @note only for the thread that owns the draw context
+    projPJ pjtar;
 
     /// index into scales table
     int zoomIndex = 0;
@@ -216,6 +250,53 @@ private:
     QPointF zoomFactor;
 
     QPointF focus; //< the next point of focus that will be displayed right in the middle of the viewport
+    QPointF focusM; //< focus projected by pjsrc, updated together with focus
+
+    /**
+       @brief Everything needed to convert between geo and pixel coordinates
+
+       A transform is never changed once it is published. Each change of the
+       view creates a new one. Thus any thread can read it without a lock.
+     */
+    struct transform_t
+    {
+        QPointF focusM;         //< the point of focus projected into the projection
+        QPointF scale;          //< scale * zoomFactor
+        QPointF center;         //< the center of the viewport [px]
+        QByteArray projection;  //< the proj4 string of the projection, empty if there is none
+        quint32 generation = 0; //< changed with each change of the projection
+    };
+
+    /// the current transform, access it by std::atomic_load() and std::atomic_store() only
+    std::shared_ptr<const transform_t> transform;
+    /// the generation of the current projection
+    quint32 projGeneration = 0;
+
+    /// get the current transform without locking
+    std::shared_ptr<const transform_t> getTransform() const
+    {
+        return std::atomic_load(&transform);
+    }
+
+    /// create and publish a new transform from the current view, call it with mutex locked
+    void publishTransform();
+
+    /// PROJ4 objects are not reentrant. Each thread has a context and projection objects of its own.
+    struct proj_t
+    {
+        ~proj_t();
+
+        projCtx ctx     = nullptr;
+        projPJ pjsrc    = nullptr;
+        projPJ pjtar    = nullptr;
+        /// the generation of the transform the projection was created for
+        quint32 generation = 0;
+    };
+
+    mutable QThreadStorage<proj_t*> projections;
+
+    /// get the projection objects of the calling thread matching the transform t
+    const proj_t& getProj(const transform_t& t) const;
 
     QPointF ref1; //< top left corner of next buffer
     QPointF ref2; //< top right corner of next buffer
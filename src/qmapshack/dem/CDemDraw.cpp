@@ -333,18 +333,59 @@ qreal CDemDraw::getSlopeAt(const QPointF& pos, bool checkScale)
 
 void CDemDraw::getElevationAt(const QPolygonF& pos, QPolygonF& ele)
 {
-    for(int i = 0; i < pos.size(); i++)
+    for(QPointF& pt : ele)
     {
-        qreal tmp = getElevationAt(pos[i]);
-        ele[i].ry() = (tmp == NOFLOAT) ? NOFLOAT : tmp;
+        pt.ry() = NOFLOAT;
+    }
+
+    if(CDemItem::mutexActiveDems.tryLock())
+    {
+        if(demList)
+        {
+            for(int i = 0; i < demList->count(); i++)
+            {
+                CDemItem * item = demList->item(i);
+
+                if(!item || item->demfile.isNull())
+                {
+                    // as all active maps have to be at the top of the list
+                    // it is ok to break as soon as the first map with no
+                    // active files is hit.
+                    break;
+                }
+
+                // each DEM file fills the gaps left by the previous ones
+                item->demfile->getElevationAt(pos, ele, false);
+            }
+        }
+        CDemItem::mutexActiveDems.unlock();
     }
 }
 
 void CDemDraw::getSlopeAt(const QPolygonF& pos, QPolygonF& slope)
 {
-    for(int i = 0; i < pos.size(); i++)
+    for(QPointF& pt : slope)
+    {
+        pt.ry() = NOFLOAT;
+    }
+
+    if(CDemItem::mutexActiveDems.tryLock())
     {
-        slope[i].ry() = getSlopeAt(pos[i]);
+        if(demList)
+        {
+            for(int i = 0; i < demList->count(); i++)
+            {
+                CDemItem * item = demList->item(i);
+
+                if(!item || item->demfile.isNull())
+                {
+                    break;
+                }
+
+                item->demfile->getSlopeAt(pos, slope, false);
+            }
+        }
+        CDemItem::mutexActiveDems.unlock();
     }
 }
 
@@ -22,6 +22,7 @@
 #include "dem/CDemVRT.h"
 #include "GeoMath.h"
 #include "helpers/CDraw.h"
+#include "helpers/CFunctionJob.h"
 #include "units/IUnit.h"
 
 #include <gdal_priv.h>
@@ -31,6 +32,10 @@
 #define TILELIMIT 30000
 #define TILESIZEX 64
 #define TILESIZEY 64
+/// edge length of the blocks used for elevation and slope queries [px]
+#define BLOCKSIZE 256
+/// memory budget for all blocks in kByte
+#define BLOCKBUDGET (32 * 1024)
 
 CDemVRT::CDemVRT(const QString &filename, CDemDraw *parent)
     : IDem(parent)
@@ -39,6 +44,8 @@ CDemVRT::CDemVRT(const QString &filename, CDemDraw *parent)
     qDebug() << "------------------------------";
     qDebug() << "VRT: try to open" << filename;
 
+    blocks.setMaxCost(BLOCKBUDGET);
+
     dataset = (GDALDataset*)GDALOpen(filename.toUtf8(), GA_ReadOnly);
     if(nullptr == dataset)
     {
@@ -140,88 +147,214 @@ CDemVRT::~CDemVRT()
 
 qreal CDemVRT::getElevationAt(const QPointF& pos, bool checkScale)
 {
-    if(pjsrc == 0 || (checkScale && outOfScale))
+    QPolygonF pts(1);
+    pts[0] = pos;
+
+    QPolygonF ele(1);
+    ele[0].ry() = NOFLOAT;
+    getElevationAt(pts, ele, checkScale);
+    return ele[0].y();
+}
+
+qreal CDemVRT::getSlopeAt(const QPointF& pos, bool checkScale)
+{
+    QPolygonF pts(1);
+    pts[0] = pos;
+
+    QPolygonF slope(1);
+    slope[0].ry() = NOFLOAT;
+    getSlopeAt(pts, slope, checkScale);
+    return slope[0].y();
+}
+
+void CDemVRT::locateSamples(const QPolygonF& pos, const QPolygonF& values, QVector<sample_t>& samples)
+{
+    QPolygonF pts;
+    QVector<qint32> idx;
+    for(int i = 0; i < pos.size(); i++)
     {
-        return NOFLOAT;
+        if(values[i].y() == NOFLOAT)
+        {
+            pts << pos[i];
+            idx << i;
+        }
     }
 
-    qint16 e[4];
-    QPointF pt = pos;
+    const int N = pts.size();
+    if(N == 0)
+    {
+        return;
+    }
 
-    pj_transform(pjtar, pjsrc, 1, 0, &pt.rx(), &pt.ry(), 0);
+    // reproject all points at once
+    pj_transform(pjtar, pjsrc, N, 2, &pts.data()->rx(), &pts.data()->ry(), 0);
 
-    if(!boundingBox.contains(pt))
+    samples.reserve(N);
+    for(int i = 0; i < N; i++)
     {
-        return NOFLOAT;
+        if(!boundingBox.contains(pts[i]))
+        {
+            continue;
+        }
+
+        const QPointF& px = trInv.map(pts[i]);
+
+        sample_t sample;
+        sample.idx   = idx[i];
+        sample.x     = px.x();
+        sample.y     = px.y();
+        sample.block = (quint64(qFloor(px.y()) / BLOCKSIZE) << 32) | quint32(qFloor(px.x()) / BLOCKSIZE);
+        samples << sample;
     }
 
-    pt = trInv.map(pt);
+    // group the samples by block to read each block only once
+    std::sort(samples.begin(), samples.end(), [](const sample_t& s1, const sample_t& s2){return s1.block < s2.block; });
+}
 
-    qreal x    = pt.x() - qFloor(pt.x());
-    qreal y    = pt.y() - qFloor(pt.y());
+bool CDemVRT::getBlock(quint64 key, block_t& block)
+{
+    QMutexLocker lock(&mutex);
 
-    mutex.lock();
-    CPLErr err = dataset->RasterIO(GF_Read, qFloor(pt.x()), qFloor(pt.y()), 2, 2, &e, 2, 2, GDT_Int16, 1, 0, 0, 0, 0);
-    mutex.unlock();
-    if(err == CE_Failure)
+    const block_t * cached = blocks.object(key);
+    if(cached != nullptr)
     {
-        return NOFLOAT;
+        block = *cached;
+        return true;
     }
 
-    if(hasNoData && ((e[0] == noData) || (e[1] == noData) || (e[2] == noData) || (e[3] == noData)))
+    const qint32 bx = key & 0xFFFFFFFF;
+    const qint32 by = key >> 32;
+
+    block_t * newBlock = new block_t();
+    newBlock->x0 = qMax(0, bx * BLOCKSIZE - 1);
+    newBlock->y0 = qMax(0, by * BLOCKSIZE - 1);
+    newBlock->w  = qMin(qint32(xsize_px), bx * BLOCKSIZE + BLOCKSIZE + 2) - newBlock->x0;
+    newBlock->h  = qMin(qint32(ysize_px), by * BLOCKSIZE + BLOCKSIZE + 2) - newBlock->y0;
+
+    if(newBlock->w < 2 || newBlock->h < 2)
     {
-        return NOFLOAT;
+        delete newBlock;
+        return false;
     }
 
-    qreal b1 = e[0];
-    qreal b2 = e[1] - e[0];
-    qreal b3 = e[2] - e[0];
-    qreal b4 = e[0] - e[1] - e[2] + e[3];
-
-    qreal ele = b1 + b2 * x + b3 * y + b4 * x * y;
+    newBlock->data.resize(newBlock->w * newBlock->h);
+    CPLErr err = dataset->RasterIO(GF_Read, newBlock->x0, newBlock->y0, newBlock->w, newBlock->h, newBlock->data.data(), newBlock->w, newBlock->h, GDT_Int16, 1, 0, 0, 0, 0);
+    if(err == CE_Failure)
+    {
+        delete newBlock;
+        return false;
+    }
 
-    return ele;
+    block = *newBlock;
+    blocks.insert(key, newBlock, qMax(1, (newBlock->w * newBlock->h * qint32(sizeof(qint16))) >> 10));
+    return true;
 }
 
-qreal CDemVRT::getSlopeAt(const QPointF& pos, bool checkScale)
+void CDemVRT::getElevationAt(const QPolygonF& pos, QPolygonF& ele, bool checkScale)
 {
     if(pjsrc == 0 || (checkScale && outOfScale))
     {
-        return NOFLOAT;
+        return;
     }
 
-    QPointF pt = pos;
-
-    pj_transform(pjtar, pjsrc, 1, 0, &pt.rx(), &pt.ry(), 0);
+    QVector<sample_t> samples;
+    locateSamples(pos, ele, samples);
 
-    if(!boundingBox.contains(pt))
+    block_t block;
+    bool isValid = false;
+    quint64 key  = ~0ULL;
+    for(const sample_t &sample : samples)
     {
-        return NOFLOAT;
-    }
+        if(sample.block != key)
+        {
+            key     = sample.block;
+            isValid = getBlock(key, block);
+        }
 
-    pt = trInv.map(pt);
+        if(!isValid)
+        {
+            continue;
+        }
+
+        const qint32 ix = qFloor(sample.x) - block.x0;
+        const qint32 iy = qFloor(sample.y) - block.y0;
+        if(ix < 0 || iy < 0 || (ix + 1) >= block.w || (iy + 1) >= block.h)
+        {
+            continue;
+        }
 
-    qreal x    = pt.x() - qFloor(pt.x());
-    qreal y    = pt.y() - qFloor(pt.y());
+        const qint16 * row0 = block.data.constData() + iy * block.w + ix;
+        const qint16 * row1 = row0 + block.w;
+        const qint16 e[4] = {row0[0], row0[1], row1[0], row1[1]};
 
-    qint16 win[eWinsize4x4];
-    mutex.lock();
-    CPLErr err = dataset->RasterIO(GF_Read, qFloor(pt.x()) - 1, qFloor(pt.y()) - 1, 4, 4, &win, 4, 4, GDT_Int16, 1, 0, 0, 0, 0);
-    mutex.unlock();
-    if(err == CE_Failure)
+        if(hasNoData && ((e[0] == noData) || (e[1] == noData) || (e[2] == noData) || (e[3] == noData)))
+        {
+            continue;
+        }
+
+        const qreal x  = sample.x - qFloor(sample.x);
+        const qreal y  = sample.y - qFloor(sample.y);
+        const qreal b1 = e[0];
+        const qreal b2 = e[1] - e[0];
+        const qreal b3 = e[2] - e[0];
+        const qreal b4 = e[0] - e[1] - e[2] + e[3];
+
+        ele[sample.idx].ry() = b1 + b2 * x + b3 * y + b4 * x * y;
+    }
+}
+
+void CDemVRT::getSlopeAt(const QPolygonF& pos, QPolygonF& slope, bool checkScale)
+{
+    if(pjsrc == 0 || (checkScale && outOfScale))
     {
-        return NOFLOAT;
+        return;
     }
-    for(int i = 0; i < eWinsize4x4; i++)
+
+    QVector<sample_t> samples;
+    locateSamples(pos, slope, samples);
+
+    block_t block;
+    bool isValid = false;
+    quint64 key  = ~0ULL;
+    for(const sample_t &sample : samples)
     {
-        if(hasNoData && win[i] == noData)
+        if(sample.block != key)
         {
-            return NOFLOAT;
+            key     = sample.block;
+            isValid = getBlock(key, block);
+        }
+
+        if(!isValid)
+        {
+            continue;
         }
-    }
 
-    qreal slope = slopeOfWindowInterp(win, eWinsize4x4, x, y);
-    return slope;
+        const qint32 ix = qFloor(sample.x) - block.x0;
+        const qint32 iy = qFloor(sample.y) - block.y0;
+        if(ix < 1 || iy < 1 || (ix + 2) >= block.w || (iy + 2) >= block.h)
+        {
+            continue;
+        }
+
+        qint16 win[eWinsize4x4];
+        bool hasGap = false;
+        for(int r = 0; r < 4; r++)
+        {
+            const qint16 * row = block.data.constData() + (iy - 1 + r) * block.w + ix - 1;
+            for(int c = 0; c < 4; c++)
+            {
+                win[r * 4 + c] = row[c];
+                hasGap |= hasNoData && (row[c] == noData);
+            }
+        }
+
+        if(hasGap)
+        {
+            continue;
+        }
+
+        slope[sample.idx].ry() = slopeOfWindowInterp(win, eWinsize4x4, sample.x - qFloor(sample.x), sample.y - qFloor(sample.y));
+    }
 }
 
 
@@ -334,6 +467,8 @@ void CDemVRT::draw(IDrawContext::buffer_t& buf)
                 break;
             }
 
+            // read all tiles of a row first
+            QVector<tile_t> tiles;
             for(qreal x = left - 1; x < right; x += w)
             {
                 if(dem->needsRedraw())
@@ -368,9 +503,12 @@ void CDemVRT::draw(IDrawContext::buffer_t& buf)
                     }
                 }
 
-                QVector<qint16> data(wp2_used * hp2_used);
+                tile_t tile;
+                tile.w = w_used;
+                tile.h = h_used;
+                tile.data.resize(wp2_used * hp2_used);
                 mutex.lock();
-                err = dataset->RasterIO(GF_Read, x, y, wp2_used, hp2_used, data.data(), wp2_used, hp2_used, GDT_Int16, 1, 0, 0, 0, 0);
+                err = dataset->RasterIO(GF_Read, x, y, wp2_used, hp2_used, tile.data.data(), wp2_used, hp2_used, GDT_Int16, 1, 0, 0, 0, 0);
                 mutex.unlock();
 
                 if(err)
@@ -378,55 +516,48 @@ void CDemVRT::draw(IDrawContext::buffer_t& buf)
                     continue;
                 }
 
-
-                QPolygonF l(4);
+                QPolygonF& l = tile.l;
+                l.resize(4);
                 l[0] = QPointF(x + 1, y + 1);
                 l[1] = QPointF(x + 1 + w_used, y + 1);
                 l[2] = QPointF(x + 1 + w_used, y + 1 + h_used);
                 l[3] = QPointF(x + 1, y + 1 + h_used);
                 l = trFwd.map(l);
-                pj_transform(pjsrc, pjtar, 1, 0, &l[0].rx(), &l[0].ry(), 0);
-                pj_transform(pjsrc, pjtar, 1, 0, &l[1].rx(), &l[1].ry(), 0);
-                pj_transform(pjsrc, pjtar, 1, 0, &l[2].rx(), &l[2].ry(), 0);
-                pj_transform(pjsrc, pjtar, 1, 0, &l[3].rx(), &l[3].ry(), 0);
-
-                if(doHillshading())
-                {
-                    QPolygonF r = l;
+                pj_transform(pjsrc, pjtar, 4, 2, &l[0].rx(), &l[0].ry(), 0);
 
-                    QImage img(w_used, h_used, QImage::Format_Indexed8);
-                    img.setColorTable(graytable);
+                tiles << tile;
+            }
 
-                    hillshading(data, w_used, h_used, img);
+            // render the tiles of the row in parallel, the global pool is shared with
+            // other jobs, thus wait for the tiles only
+            QSemaphore done;
+            for(tile_t &tile : tiles)
+            {
+                QThreadPool::globalInstance()->start(new CFunctionJob([this, &tile, &done](){renderTile(tile); done.release(); }));
+            }
+            done.acquire(tiles.size());
 
-                    drawTile(img, r, p);
+            for(tile_t &tile : tiles)
+            {
+                if(!tile.imgHillshading.isNull())
+                {
+                    QPolygonF r = tile.l;
+                    drawTile(tile.imgHillshading, r, p);
                 }
 
-                if(doSlopeColor())
+                if(!tile.imgSlopeColor.isNull())
                 {
-                    QPolygonF r = l;
-
-                    QImage img(w_used, h_used, QImage::Format_Indexed8);
-                    img.setColorTable(slopetable);
-
-                    slopecolor(data, w_used, h_used, img);
-
+                    QPolygonF r = tile.l;
                     p.setOpacity(o2);
-                    drawTile(img, r, p);
+                    drawTile(tile.imgSlopeColor, r, p);
                     p.setOpacity(o1);
                 }
 
-                if(doElevationLimit())
+                if(!tile.imgElevationLimit.isNull())
                 {
-                    QPolygonF r = l;
-
-                    QImage img(w_used, h_used, QImage::Format_Indexed8);
-                    img.setColorTable(elevationtable);
-
-                    elevationLimit(data, w_used, h_used, img);
-
+                    QPolygonF r = tile.l;
                     p.setOpacity(o2);
-                    drawTile(img, r, p);
+                    drawTile(tile.imgElevationLimit, r, p);
                     p.setOpacity(o1);
                 }
             }
@@ -434,4 +565,26 @@ void CDemVRT::draw(IDrawContext::buffer_t& buf)
     }
 }
 
+void CDemVRT::renderTile(tile_t& tile)
+{
+    if(doHillshading())
+    {
+        tile.imgHillshading = QImage(tile.w, tile.h, QImage::Format_Indexed8);
+        tile.imgHillshading.setColorTable(graytable);
+        hillshading(tile.data, tile.w, tile.h, tile.imgHillshading);
+    }
 
+    if(doSlopeColor())
+    {
+        tile.imgSlopeColor = QImage(tile.w, tile.h, QImage::Format_Indexed8);
+        tile.imgSlopeColor.setColorTable(slopetable);
+        slopecolor(tile.data, tile.w, tile.h, tile.imgSlopeColor);
+    }
+
+    if(doElevationLimit())
+    {
+        tile.imgElevationLimit = QImage(tile.w, tile.h, QImage::Format_Indexed8);
+        tile.imgElevationLimit.setColorTable(elevationtable);
+        elevationLimit(tile.data, tile.w, tile.h, tile.imgElevationLimit);
+    }
+}
@@ -21,7 +21,9 @@
 
 #include "dem/IDem.h"
 
+#include <QCache>
 #include <QMutex>
+#include <QPolygonF>
 
 class CDemDraw;
 class GDALDataset;
@@ -38,9 +40,53 @@ public:
     qreal getElevationAt(const QPointF& pos, bool checkScale) override;
     qreal getSlopeAt(const QPointF& pos, bool checkScale) override;
 
+    void getElevationAt(const QPolygonF& pos, QPolygonF& ele, bool checkScale) override;
+    void getSlopeAt(const QPolygonF& pos, QPolygonF& slope, bool checkScale) override;
+
 private:
+    /// a block of raw elevation data with a margin of 1 px to the left and top and 2 px to the right and bottom
+    struct block_t
+    {
+        qint32 x0 = 0;
+        qint32 y0 = 0;
+        qint32 w  = 0;
+        qint32 h  = 0;
+        QVector<qint16> data;
+    };
+
+    /// a position to sample in pixel coordinates of the dataset
+    struct sample_t
+    {
+        quint64 block;
+        qint32 idx;
+        qreal x;
+        qreal y;
+    };
+
+    /// the data and the rendered images of a tile
+    struct tile_t
+    {
+        qint32 w = 0;
+        qint32 h = 0;
+        /// the tile's elevation data with a border of 1 px
+        QVector<qint16> data;
+        /// the tile's corners [rad]
+        QPolygonF l;
+        QImage imgHillshading;
+        QImage imgSlopeColor;
+        QImage imgElevationLimit;
+    };
+
+    void renderTile(tile_t& tile);
+    void locateSamples(const QPolygonF& pos, const QPolygonF& values, QVector<sample_t>& samples);
+    bool getBlock(quint64 key, block_t& block);
+
+    /// protects dataset and blocks
     QMutex mutex;
 
+    /// recently used blocks for elevation and slope queries, the cost is in kByte
+    QCache<quint64, block_t> blocks;
+
     QString filename;
     /// instance of GDAL dataset
     GDALDataset * dataset;
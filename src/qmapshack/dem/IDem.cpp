@@ -22,48 +22,12 @@
 #include "dem/IDem.h"
 
 
+#include <limits>
 #include <QtWidgets>
 
-inline qint16 getValue(QVector<qint16>& data, int x, int y, int dx)
-{
-    return data[x + y * dx];
-}
-
-inline void fillWindow(QVector<qint16>& data, int x, int y, int dx, qint16 * w)
-{
-    w[0] = getValue(data, x - 1, y - 1, dx);
-    w[1] = getValue(data, x, y - 1, dx);
-    w[2] = getValue(data, x + 1, y - 1, dx);
-    w[3] = getValue(data, x - 1, y, dx);
-    w[4] = getValue(data, x, y, dx);
-    w[5] = getValue(data, x + 1, y, dx);
-    w[6] = getValue(data, x - 1, y + 1, dx);
-    w[7] = getValue(data, x, y + 1, dx);
-    w[8] = getValue(data, x + 1, y + 1, dx);
-}
-
-inline void fillWindow4x4(QVector<qint16>& data, qreal x, qreal y, int dx, qint16* w)
-{
-    x = qFloor(x);
-    y = qFloor(y);
-
-    w[0]  = getValue(data, x - 1, y - 1, dx);
-    w[1]  = getValue(data, x, y - 1, dx);
-    w[2]  = getValue(data, x + 1, y - 1, dx);
-    w[3]  = getValue(data, x + 2, y - 1, dx);
-    w[4]  = getValue(data, x - 1, y, dx);
-    w[5]  = getValue(data, x, y, dx);
-    w[6]  = getValue(data, x + 1, y, dx);
-    w[7]  = getValue(data, x + 2, y, dx);
-    w[8]  = getValue(data, x - 1, y + 1, dx);
-    w[9]  = getValue(data, x, y + 1, dx);
-    w[10] = getValue(data, x + 1, y + 1, dx);
-    w[11] = getValue(data, x + 2, y + 1, dx);
-    w[12] = getValue(data, x - 1, y + 2, dx);
-    w[13] = getValue(data, x, y + 2, dx);
-    w[14] = getValue(data, x + 1, y + 2, dx);
-    w[15] = getValue(data, x + 2, y + 2, dx);
-}
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 const struct SlopePresets IDem::slopePresets[7]
 {
@@ -109,6 +73,28 @@ IDem::~IDem()
     pj_free(pjsrc);
 }
 
+void IDem::getElevationAt(const QPolygonF& pos, QPolygonF& ele, bool checkScale)
+{
+    for(int i = 0; i < pos.size(); i++)
+    {
+        if(ele[i].y() == NOFLOAT)
+        {
+            ele[i].ry() = getElevationAt(pos[i], checkScale);
+        }
+    }
+}
+
+void IDem::getSlopeAt(const QPolygonF& pos, QPolygonF& slope, bool checkScale)
+{
+    for(int i = 0; i < pos.size(); i++)
+    {
+        if(slope[i].y() == NOFLOAT)
+        {
+            slope[i].ry() = getSlopeAt(pos[i], checkScale);
+        }
+    }
+}
+
 void IDem::saveConfig(QSettings& cfg)
 {
     IDrawObject::saveConfig(cfg);
@@ -219,43 +205,82 @@ int IDem::getFactorHillshading()
 
 void IDem::hillshading(QVector<qint16>& data, qreal w, qreal h, QImage& img)
 {
-    int wp2 = w + 2;
+    const int wp2 = w + 2;
 
 #define ZFACT           0.125
 #define ZFACT_BY_ZFACT  (ZFACT * ZFACT)
 #define SIN_ALT         (qSin(45 * DEG_TO_RAD))
 #define ZFACT_COS_ALT   (ZFACT * qCos(45 * DEG_TO_RAD))
 #define AZ              (315 * DEG_TO_RAD)
-    for(unsigned int m = 1; m <= h; m++)
+
+    /*
+        With aspect = atan2(dy, dx) the term sqrt(dx² + dy²) * sin(aspect - AZ)
+        is the same as dy * cos(AZ) - dx * sin(AZ). Thus all trigonometric
+        functions are constants and there is a single sqrt() left per pixel.
+     */
+    const qreal sinAlt = SIN_ALT;
+    const qreal cy     = ZFACT_COS_ALT * qCos(AZ);
+    const qreal cx     = ZFACT_COS_ALT * qSin(AZ);
+    const qreal fx     = 1.0 / (xscale * factorHillshading);
+    const qreal fy     = 1.0 / (yscale * factorHillshading);
+
+    for(int m = 1; m <= h; m++)
     {
-        unsigned char* scan = img.scanLine(m - 1);
-        for(unsigned int n = 1; n <= w; n++)
+        // the three rows of the 3x3 window
+        const qint16 * r0 = data.constData() + (m - 1) * wp2;
+        const qint16 * r1 = r0 + wp2;
+        const qint16 * r2 = r1 + wp2;
+        uchar * scan = img.scanLine(m - 1);
+
+        // the gradient of the window around pixel n, without scale
+        auto gradX = [r0, r1, r2](int n){return (r0[n - 1] + 2 * r1[n - 1] + r2[n - 1]) - (r0[n + 1] + 2 * r1[n + 1] + r2[n + 1]); };
+        auto gradY = [r0, r2](int n){return (r2[n - 1] + 2 * r2[n] + r2[n + 1]) - (r0[n - 1] + 2 * r0[n] + r0[n + 1]); };
+        auto store = [&](int n, qreal cang)
         {
-            qint16 win[eWinsize3x3];
-            fillWindow(data, n, m, wp2, win);
-
-            if(hasNoData && win[4] == noData)
+            if(hasNoData && r1[n] == noData)
             {
                 scan[n - 1] = 255;
-                continue;
-            }
-
-            qreal dx         = ((win[0] + win[3] + win[3] + win[6]) - (win[2] + win[5] + win[5] + win[8])) / (xscale * factorHillshading);
-            qreal dy         = ((win[6] + win[7] + win[7] + win[8]) - (win[0] + win[1] + win[1] + win[2])) / (yscale * factorHillshading);
-            qreal aspect     = qAtan2(dy, dx);
-            qreal xx_plus_yy = dx * dx + dy * dy;
-            qreal cang       = (SIN_ALT - ZFACT_COS_ALT * qSqrt(xx_plus_yy) * qSin(aspect - AZ)) / qSqrt(1 + ZFACT_BY_ZFACT * xx_plus_yy);
-
-            if (cang <= 0.0)
-            {
-                cang = 1.0;
             }
             else
             {
-                cang = 1.0 + (254.0 * cang);
+                scan[n - 1] = (cang <= 0.0) ? 1 : uchar(1.0 + 254.0 * cang);
             }
+        };
+
+        int n = 1;
+#if defined(__SSE2__)
+        /*
+            Two pixels at once. The operations are the same as in the
+            scalar loop below and in the same order. Thus the result is
+            exactly the same.
+         */
+        const __m128d vSinAlt = _mm_set1_pd(sinAlt);
+        const __m128d vCy     = _mm_set1_pd(cy);
+        const __m128d vCx     = _mm_set1_pd(cx);
+        const __m128d vFx     = _mm_set1_pd(fx);
+        const __m128d vFy     = _mm_set1_pd(fy);
+        const __m128d vZ      = _mm_set1_pd(ZFACT_BY_ZFACT);
+        const __m128d vOne    = _mm_set1_pd(1.0);
+        for(; n + 1 <= w; n += 2)
+        {
+            const __m128d dx  = _mm_mul_pd(_mm_set_pd(gradX(n + 1), gradX(n)), vFx);
+            const __m128d dy  = _mm_mul_pd(_mm_set_pd(gradY(n + 1), gradY(n)), vFy);
+            const __m128d num = _mm_sub_pd(vSinAlt, _mm_sub_pd(_mm_mul_pd(vCy, dy), _mm_mul_pd(vCx, dx)));
+            const __m128d den = _mm_sqrt_pd(_mm_add_pd(vOne, _mm_mul_pd(vZ, _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)))));
+
+            double cang[2];
+            _mm_storeu_pd(cang, _mm_div_pd(num, den));
+            store(n, cang[0]);
+            store(n + 1, cang[1]);
+        }
+#endif
+        for(; n <= w; n++)
+        {
+            const qreal dx   = gradX(n) * fx;
+            const qreal dy   = gradY(n) * fy;
+            const qreal cang = (sinAlt - (cy * dy - cx * dx)) / qSqrt(1 + ZFACT_BY_ZFACT * (dx * dx + dy * dy));
 
-            scan[n - 1] = cang;
+            store(n, cang);
         }
     }
 }
@@ -308,81 +333,101 @@ qreal IDem::slopeOfWindowInterp(qint16* win2, winsize_e size, qreal x, qreal y)
 
 void IDem::slopecolor(QVector<qint16>& data, qreal w, qreal h, QImage &img)
 {
-    int wp2 = w + 2;
-
-    for(unsigned int m = 1; m <= h; m++)
+    const int wp2 = w + 2;
+
+    /*
+        slope = atan(sqrt(dx² + dy²) / 8), thus a slope is larger than a step
+        if dx² + dy² is larger than (8 * tan(step))². Comparing the squared
+        gradient against these limits avoids atan() and sqrt() per pixel.
+     */
+    const qreal * steps = getCurrentSlopeStepTable();
+    qreal limits[5];
+    for(int i = 0; i < 5; i++)
     {
-        unsigned char* scan = img.scanLine(m - 1);
-        for(unsigned int n = 1; n <= w; n++)
+        if(steps[i] < 0)
+        {
+            limits[i] = -1;
+        }
+        else if(steps[i] >= 90)
+        {
+            limits[i] = std::numeric_limits<qreal>::max();
+        }
+        else
         {
-            qint16 win[eWinsize3x3];
-            fillWindow(data, n, m, wp2, win);
-            qreal slope = slopeOfWindowInterp(win, eWinsize3x3, 0, 0);
+            const qreal t = 8 * qTan(steps[i] * DEG_TO_RAD);
+            limits[i] = t * t;
+        }
+    }
+
+    const qreal fx = 1.0 / xscale;
+    const qreal fy = 1.0 / yscale;
 
-            const qreal *currentSlopeStepTable = getCurrentSlopeStepTable();
+    for(int m = 1; m <= h; m++)
+    {
+        const qint16 * r0 = data.constData() + (m - 1) * wp2;
+        const qint16 * r1 = r0 + wp2;
+        const qint16 * r2 = r1 + wp2;
+        uchar * scan = img.scanLine(m - 1);
 
-            if(slope > currentSlopeStepTable[4])
+        for(int n = 1; n <= w; n++)
+        {
+            if(hasNoData
+               && (r0[n - 1] == noData || r0[n] == noData || r0[n + 1] == noData
+                   || r1[n - 1] == noData || r1[n] == noData || r1[n + 1] == noData
+                   || r2[n - 1] == noData || r2[n] == noData || r2[n + 1] == noData))
             {
+                // same as an invalid slope
                 scan[n - 1] = 5;
+                continue;
             }
-            else if(slope > currentSlopeStepTable[3])
-            {
-                scan[n - 1] = 4;
-            }
-            else if(slope > currentSlopeStepTable[2])
-            {
-                scan[n - 1] = 3;
-            }
-            else if(slope > currentSlopeStepTable[1])
-            {
-                scan[n - 1] = 2;
-            }
-            else if(slope > currentSlopeStepTable[0])
-            {
-                scan[n - 1] = 1;
-            }
-            else
-            {
-                scan[n - 1] = 0;
-            }
+
+            const qreal dx = ((r0[n - 1] + 2 * r1[n - 1] + r2[n - 1]) - (r0[n + 1] + 2 * r1[n + 1] + r2[n + 1])) * fx;
+            const qreal dy = ((r2[n - 1] + 2 * r2[n] + r2[n + 1]) - (r0[n - 1] + 2 * r0[n] + r0[n + 1])) * fy;
+            const qreal k  = dx * dx + dy * dy;
+
+            scan[n - 1] = k > limits[4] ? 5
+                          : k > limits[3] ? 4
+                          : k > limits[2] ? 3
+                          : k > limits[1] ? 2
+                          : k > limits[0] ? 1
+                          : 0;
         }
     }
 }
 
 void IDem::elevationLimit(QVector<qint16>& data, qreal w, qreal h, QImage &img)
 {
-    int wp2 = w + 2;
+    const int wp2 = w + 2;
 
-    for(unsigned int m = 1; m <= h; m++)
+    // the conversion to the user's unit is linear, thus get the factor once
+    qreal factor; // elevation in the units set by the user for 1 m
+    QString unit; // result not used
+    IUnit::self().meter2elevation(1.0, factor, unit);
+    const qreal limit = getElevationLimit();
+
+    for(int m = 1; m <= h; m++)
     {
-        unsigned char* scan = img.scanLine(m - 1);
-        for(unsigned int n = 1; n <= w; n++)
-        {
-            qint16 win[eWinsize3x3];
-            fillWindow(data, n, m, wp2, win);
+        const qint16 * r0 = data.constData() + (m - 1) * wp2;
+        const qint16 * r1 = r0 + wp2;
+        const qint16 * r2 = r1 + wp2;
+        uchar * scan = img.scanLine(m - 1);
 
+        for(int n = 1; n <= w; n++)
+        {
             // get maximum of window (_not_ mean)
-            //
             qreal meters = -2.0;
-            for(unsigned int i = 0; i < eWinsize3x3; i++)
+            for(const qint16 * row : {r0, r1, r2})
             {
-                if(win[i] != noData && win[i] > meters)
+                for(int i = n - 1; i <= n + 1; i++)
                 {
-                    meters = win[i];
+                    if(row[i] != noData && row[i] > meters)
+                    {
+                        meters = row[i];
+                    }
                 }
             }
 
-            qreal elevation; // elevation in the units set by the user
-            QString unit; // result not used
-            IUnit::self().meter2elevation(meters, elevation, unit);
-            if(elevation >= getElevationLimit())
-            {
-                scan[n - 1] = 1;
-            }
-            else
-            {
-                scan[n - 1] = 0;
-            }
+            scan[n - 1] = (meters * factor >= limit) ? 1 : 0;
         }
     }
 }
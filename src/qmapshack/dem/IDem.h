@@ -54,6 +54,21 @@ public:
     virtual qreal getElevationAt(const QPointF& pos, bool checkScale) = 0;
     virtual qreal getSlopeAt(const QPointF& pos, bool checkScale) = 0;
 
+    /**
+       @brief Get the elevation for a list of positions
+
+       Only entries of ele with a y value of NOFLOAT are looked up. Thus several
+       DEM files can be asked one after the other to fill the gaps. The default
+       implementation calls getElevationAt() for each point.
+
+       @param pos           the positions in [rad]
+       @param ele           y will be set to the elevation, must have the same size as pos
+       @param checkScale    return no data if the DEM is out of scale
+     */
+    virtual void getElevationAt(const QPolygonF& pos, QPolygonF& ele, bool checkScale);
+    /// same as getElevationAt() for the slope
+    virtual void getSlopeAt(const QPolygonF& pos, QPolygonF& slope, bool checkScale);
+
     bool activated()
     {
         return isActivated;
@@ -56,6 +56,7 @@
 #include "gis/tcx/CTcxProject.h"
 #include "gis/trk/CGisItemTrk.h"
 #include "gis/wpt/CGisItemWpt.h"
+#include "helpers/CFunctionJob.h"
 #include "helpers/CProgressDialog.h"
 #include "helpers/CSelectCopyAction.h"
 #include "helpers/CSelectProjectDialog.h"
@@ -180,7 +181,7 @@ CGisListWks::CGisListWks(QWidget *parent)
     actionRteFromWpt    = addAction(QIcon("://icons/32x32/Route.png"), tr("Create Route..."), this, SLOT(slotRteFromWpt()));
     actionEditPrxWpt =  addAction(QIcon("://icons/32x32/WptEditProx.png"), tr("Change Proximity..."), this, SLOT(slotEditPrxWpt()));
 
-    connect(qApp, &QApplication::aboutToQuit, this, &CGisListWks::slotSaveWorkspace);
+    connect(qApp, &QApplication::aboutToQuit, this, &CGisListWks::slotSaveWorkspaceOnExit);
     connect(this, &CGisListWks::customContextMenuRequested, this, &CGisListWks::slotContextMenu);
     connect(this, &CGisListWks::itemDoubleClicked,          this, &CGisListWks::slotItemDoubleClicked);
     connect(this, &CGisListWks::itemChanged,                this, &CGisListWks::slotItemChanged);
@@ -216,6 +217,7 @@ CGisListWks::CGisListWks(QWidget *parent)
 
 CGisListWks::~CGisListWks()
 {
+    poolSave.waitForDone();
 }
 
 void CGisListWks::configDB()
@@ -778,196 +780,396 @@ CDBProject * CGisListWks::getProjectById(quint64 id, const QString& db)
 
 void CGisListWks::slotSaveWorkspace()
 {
-    CGisListWksEditLock lock(true, IGisItem::mutexItems);
+    if(!saveOnExit)
+    {
+        return;
+    }
+
+    // skip this turn if the last save has not been written yet
+    if(!saveInProgress)
+    {
+        CGisListWksEditLock lock(true, IGisItem::mutexItems);
+        QList<wks_project_t> projects = getChangedProjects();
+
+        qDebug() << "slotSaveWorkspace()" << projects.size() << "changed projects";
+
+        // serialize the snapshots by a worker thread and write them back in the GUI thread
+        saveInProgress = true;
+        poolSave.start(new CFunctionJob([this, projects]() mutable
+        {
+            serializeProjects(projects);
 
+            QMutexLocker lock(&mutexSave);
+            projectsSerialized = projects;
+            QMetaObject::invokeMethod(this, "slotWriteWorkspace", Qt::QueuedConnection);
+        }));
+    }
+
+    if(saveEvery)
+    {
+        QTimer::singleShot(saveEvery * 60000, this, SLOT(slotSaveWorkspace()));
+    }
+}
+
+void CGisListWks::slotSaveWorkspaceOnExit()
+{
     if(!saveOnExit)
     {
         return;
     }
 
-    QSqlQuery query(db);
-    QUERY_RUN("DELETE FROM workspace", return )
+    // finish a pending save first
+    poolSave.waitForDone();
+    slotWriteWorkspace();
 
-    qDebug() << "slotSaveWorkspace()";
+    CGisListWksEditLock lock(true, IGisItem::mutexItems);
+    QList<wks_project_t> projects = getChangedProjects();
+    serializeProjects(projects);
+    writeWorkspace(projects);
+}
 
-    const int total = topLevelItemCount();
-    PROGRESS_SETUP(tr("Saving workspace. Please wait."), 0, total, this);
+void CGisListWks::slotWriteWorkspace()
+{
+    QList<wks_project_t> projects;
+    {
+        QMutexLocker lock(&mutexSave);
+        projects.swap(projectsSerialized);
+    }
 
-    for(int i = 0; i < total; i++)
+    if(saveInProgress)
     {
-        PROGRESS(i, return );
+        writeWorkspace(projects);
+        saveInProgress = false;
+    }
+}
 
+QList<CGisListWks::wks_project_t> CGisListWks::getChangedProjects()
+{
+    QList<wks_project_t> projects;
+
+    const int N = topLevelItemCount();
+    for(int i = 0; i < N; i++)
+    {
         IGisProject * project = dynamic_cast<IGisProject*>(topLevelItem(i));
         if(nullptr == project)
         {
             continue;
         }
 
-        QByteArray data;
-        QDataStream stream(&data, QIODevice::WriteOnly);
-        stream.setVersion(QDataStream::Qt_5_2);
-        stream.setByteOrder(QDataStream::LittleEndian);
-
-        project->IGisProject::operator>>(stream);
-
-        query.prepare("INSERT INTO workspace (type, keyqms, name, changed, visible, data) VALUES (:type, :keyqms, :name, :changed, :visible, :data)");
-        query.bindValue(":type",    project->getType());
-        query.bindValue(":keyqms",  project->getKey());
-        query.bindValue(":name",    project->getName());
-        query.bindValue(":changed", project->isChanged());
+        wks_project_t prj;
+        prj.key         = project->getKey();
+        prj.type        = project->getType();
+        prj.name        = project->getName();
+        prj.changed     = project->isChanged();
+        prj.visible     = (project->checkState(CGisListDB::eColumnCheckbox) == Qt::Checked);
+        prj.snapshot    = project->getSnapshot();
+        prj.fingerprint = getFingerprint(prj);
 
-        bool visible = (project->checkState(CGisListDB::eColumnCheckbox) == Qt::Checked);
-        query.bindValue(":visible", visible);
-        query.bindValue(":data",    data);
-        QUERY_EXEC(continue);
+        if(wksRows.value(prj.key).fingerprint != prj.fingerprint)
+        {
+            projects << prj;
+        }
     }
 
-    query.prepare( "UPDATE userfocus set focus=:focus");
-    query.bindValue(":focus", IGisProject::getUserFocus());
-    QUERY_EXEC();
+    return projects;
+}
 
-    if(saveEvery)
+void CGisListWks::serializeProjects(QList<wks_project_t>& projects)
+{
+    for(wks_project_t& project : projects)
     {
-        QTimer::singleShot(saveEvery * 60000, this, SLOT(slotSaveWorkspace()));
+        QDataStream stream(&project.data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_2);
+        stream.setByteOrder(QDataStream::LittleEndian);
+
+        IGisProject::writeSnapshot(stream, project.snapshot);
     }
 }
 
-void CGisListWks::slotLoadWorkspace()
+void CGisListWks::writeWorkspace(const QList<wks_project_t>& projects)
 {
-    CGisListWksEditLock lock(true, IGisItem::mutexItems);
-
     QSqlQuery query(db);
+    QUERY_RUN("BEGIN TRANSACTION", return )
 
-    QUERY_RUN("SELECT type, keyqms, name, changed, visible, data FROM workspace", return )
+    // the row IDs and fingerprints are valid only if the transaction is committed
+    const QHash<QString, wks_row_t> wksRowsCommitted = wksRows;
 
-    { // open context for progress dialog
-        const int total = query.size();
-        PROGRESS_SETUP(tr("Loading workspace. Please wait."), 0, total, this);
-        quint32 progCnt = 0;
+    try
+    {
+        QSqlQuery queryInsert(db);
+        queryInsert.prepare("INSERT INTO workspace (type, keyqms, name, changed, visible, data) VALUES (:type, :keyqms, :name, :changed, :visible, :data)");
+        QSqlQuery queryUpdate(db);
+        queryUpdate.prepare("UPDATE workspace SET type=:type, name=:name, changed=:changed, visible=:visible, data=:data WHERE id=:id");
 
-        while(query.next())
+        for(const wks_project_t& project : projects)
         {
-            PROGRESS(progCnt++, return );
+            wks_row_t& row  = wksRows[project.key];
+            QSqlQuery& q    = row.id ? queryUpdate : queryInsert;
 
-            int type               = query.value(0).toInt();
-            QString name           = query.value(2).toString();
-            bool changed           = query.value(3).toBool();
-            Qt::CheckState visible = query.value(4).toBool() ? Qt::Checked : Qt::Unchecked;
-            QByteArray data        = query.value(5).toByteArray();
-
-            QDataStream stream(&data, QIODevice::ReadOnly);
-            stream.setVersion(QDataStream::Qt_5_2);
-            stream.setByteOrder(QDataStream::LittleEndian);
-
-            IGisProject *project = nullptr;
-            switch(type)
-            {
-            case IGisProject::eTypeQms:
+            q.bindValue(":type",    project.type);
+            q.bindValue(":name",    project.name);
+            q.bindValue(":changed", project.changed);
+            q.bindValue(":visible", project.visible);
+            q.bindValue(":data",    project.data);
+            if(row.id)
             {
-                project = new CQmsProject(name, this);
-                project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1a)
-                *project << stream;
-                break;
+                q.bindValue(":id", row.id);
             }
-
-            case IGisProject::eTypeQlb:
+            else
             {
-                project = new CQlbProject(name, this);
-                project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1a)
-                *project << stream;
-                break;
+                q.bindValue(":keyqms", project.key);
             }
 
-            case IGisProject::eTypeGpx:
+            if(!q.exec())
             {
-                project = new CGpxProject(name, this);
-                project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1b)
-                *project << stream;
-                break;
+                qWarning() << q.lastQuery();
+                qWarning() << q.lastError();
+                throw -1;
             }
 
-            case IGisProject::eTypeDb:
+            if(row.id == 0)
             {
-                CDBProject * dbProject;
-                project = dbProject = new CDBProject(this);
-                project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1c)
-
-                project->IGisProject::operator<<(stream);
-                dbProject->restoreDBLink();
-
-                if(!project->isValid())
-                {
-                    delete project;
-                    project = nullptr;
-                }
-                else
-                {
-                    dbProject->postStatus(false);
-                }
-                break;
+                row.id = q.lastInsertId().toULongLong();
             }
+            row.fingerprint = project.fingerprint;
+        }
 
-            case IGisProject::eTypeSlf:
+        // remove the rows of all projects closed in the meantime
+        QSet<QString> keys;
+        const int N = topLevelItemCount();
+        for(int i = 0; i < N; i++)
+        {
+            IGisProject * project = dynamic_cast<IGisProject*>(topLevelItem(i));
+            if(nullptr != project)
             {
-                project = new CSlfProject(name, false);
-                project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1d)
-                *project << stream;
-
-                // the CSlfProject does not - as the other C*Project - register itself in the list
-                // of currently opened projects. This is done manually here.
-                addProject(project);
-                break;
+                keys << project->getKey();
             }
+        }
 
-            case IGisProject::eTypeFit:
+        for(const QString& key : wksRows.keys())
+        {
+            if(keys.contains(key))
             {
-                project = new CFitProject(name, this);
-                project->setCheckState(CGisListDB::eColumnCheckbox, visible);
-                *project << stream;
-                break;
+                continue;
             }
 
-            case IGisProject::eTypeTcx:
-            {
-                project = new CTcxProject(name, this);
-                project->setCheckState(CGisListDB::eColumnCheckbox, visible);
-                *project << stream;
-                break;
-            }
+            query.prepare("DELETE FROM workspace WHERE id=:id");
+            query.bindValue(":id", wksRows.take(key).id);
+            QUERY_EXEC(throw -1);
+        }
 
-            case IGisProject::eTypeSml:
-            {
-                project = new CSmlProject(name, this);
-                project->setCheckState(CGisListDB::eColumnCheckbox, visible);
-                *project << stream;
-                break;
-            }
+        query.prepare( "UPDATE userfocus set focus=:focus");
+        query.bindValue(":focus", IGisProject::getUserFocus());
+        QUERY_EXEC(throw -1);
 
-            case IGisProject::eTypeLog:
-            {
-                project = new CSmlProject(name, this);
-                project->setCheckState(CGisListDB::eColumnCheckbox, visible);
-                *project << stream;
-                break;
-            }
-            }
+        QUERY_RUN("COMMIT", throw -1)
+    }
+    catch(int i)
+    {
+        if(i == -1)
+        {
+            // all changes are written again by the next save
+            wksRows = wksRowsCommitted;
+            QUERY_RUN("ROLLBACK", return )
+        }
+    }
+}
+
+QByteArray CGisListWks::getFingerprint(const wks_project_t& project)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << project.type << project.name << project.changed << project.visible;
+    stream << project.snapshot.fingerprint();
+
+    return QCryptographicHash::hash(data, QCryptographicHash::Md5);
+}
+
+void CGisListWks::slotLoadWorkspace()
+{
+    QSqlQuery query(db);
+
+    QUERY_RUN("SELECT id FROM workspace ORDER BY id", return )
+    while(query.next())
+    {
+        wksRowsToLoad << query.value(0).toULongLong();
+    }
+
+    // restore the projects one by one to keep the GUI responsive
+    slotLoadWorkspaceProject();
+}
+
+void CGisListWks::slotLoadWorkspaceProject()
+{
+    if(wksRowsToLoad.isEmpty())
+    {
+        finishLoadWorkspace();
+        return;
+    }
+
+    const quint64 id = wksRowsToLoad.takeFirst();
+
+    {
+        CGisListWksEditLock lock(true, IGisItem::mutexItems);
 
+        QSqlQuery query(db);
+        query.prepare("SELECT type, name, changed, visible, data FROM workspace WHERE id=:id");
+        query.bindValue(":id", id);
+        QUERY_EXEC(return );
+
+        if(query.next())
+        {
+            qint32 type            = query.value(0).toInt();
+            QString name           = query.value(1).toString();
+            bool changed           = query.value(2).toBool();
+            Qt::CheckState visible = query.value(3).toBool() ? Qt::Checked : Qt::Unchecked;
+            QByteArray data        = query.value(4).toByteArray();
+
+            IGisProject * project = restoreProject(type, name, visible, data);
             if(nullptr != project)
             {
-                // Hiding the individual projects from the map (1a, 1b, 1c) could be done here within a single statement,
-                // but this results in a visible `the checkbox is being unchecked`, especially in case the project
-                // is large and takes some time to load.
-                // When done directly after construction there is no `blinking` of the check mark
-
                 project->setToolTip(eColumnName, project->getInfo());
                 if(changed)
                 {
                     project->setChanged();
                 }
+
+                // the row is up to date as long as the project does not change
+                wks_project_t prj;
+                prj.type        = type;
+                prj.name        = project->getName();
+                prj.changed     = project->isChanged();
+                prj.visible     = (visible == Qt::Checked);
+                prj.snapshot    = project->getSnapshot();
+
+                wks_row_t& row  = wksRows[project->getKey()];
+                row.id          = id;
+                row.fingerprint = getFingerprint(prj);
+            }
+            else
+            {
+                query.prepare("DELETE FROM workspace WHERE id=:id");
+                query.bindValue(":id", id);
+                QUERY_EXEC();
             }
         }
-    } // close context for progress dialog
+    }
+
+    emit sigChanged();
 
+    QTimer::singleShot(0, this, SLOT(slotLoadWorkspaceProject()));
+}
+
+IGisProject * CGisListWks::restoreProject(qint32 type, const QString& name, Qt::CheckState visible, QByteArray& data)
+{
+    QDataStream stream(&data, QIODevice::ReadOnly);
+    stream.setVersion(QDataStream::Qt_5_2);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    IGisProject *project = nullptr;
+    switch(type)
+    {
+    case IGisProject::eTypeQms:
+    {
+        project = new CQmsProject(name, this);
+        project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1a)
+        *project << stream;
+        break;
+    }
+
+    case IGisProject::eTypeQlb:
+    {
+        project = new CQlbProject(name, this);
+        project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1a)
+        *project << stream;
+        break;
+    }
+
+    case IGisProject::eTypeGpx:
+    {
+        project = new CGpxProject(name, this);
+        project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1b)
+        *project << stream;
+        break;
+    }
+
+    case IGisProject::eTypeDb:
+    {
+        CDBProject * dbProject;
+        project = dbProject = new CDBProject(this);
+        project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1c)
+
+        project->IGisProject::operator<<(stream);
+        dbProject->restoreDBLink();
+
+        if(!project->isValid())
+        {
+            delete project;
+            project = nullptr;
+        }
+        else
+        {
+            dbProject->postStatus(false);
+        }
+        break;
+    }
+
+    case IGisProject::eTypeSlf:
+    {
+        project = new CSlfProject(name, false);
+        project->setCheckState(CGisListDB::eColumnCheckbox, visible); // (1d)
+        *project << stream;
+
+        // the CSlfProject does not - as the other C*Project - register itself in the list
+        // of currently opened projects. This is done manually here.
+        addProject(project);
+        break;
+    }
+
+    case IGisProject::eTypeFit:
+    {
+        project = new CFitProject(name, this);
+        project->setCheckState(CGisListDB::eColumnCheckbox, visible);
+        *project << stream;
+        break;
+    }
+
+    case IGisProject::eTypeTcx:
+    {
+        project = new CTcxProject(name, this);
+        project->setCheckState(CGisListDB::eColumnCheckbox, visible);
+        *project << stream;
+        break;
+    }
+
+    case IGisProject::eTypeSml:
+    {
+        project = new CSmlProject(name, this);
+        project->setCheckState(CGisListDB::eColumnCheckbox, visible);
+        *project << stream;
+        break;
+    }
+
+    case IGisProject::eTypeLog:
+    {
+        project = new CSmlProject(name, this);
+        project->setCheckState(CGisListDB::eColumnCheckbox, visible);
+        *project << stream;
+        break;
+    }
+    }
+
+
+    // Hiding the individual projects from the map (1a, 1b, 1c) could be done here within a single statement,
+    // but this results in a visible `the checkbox is being unchecked`, especially in case the project
+    // is large and takes some time to load.
+    // When done directly after construction there is no `blinking` of the check mark
+
+    return project;
+}
+
+void CGisListWks::finishLoadWorkspace()
+{
     slotGeoSearch(static_cast<QAction*>(CMainWindow::self().findChild<QAction*>("actionGeoSearch"))->isChecked());
 
     for(const QString &filename : qlOpts->arguments)
@@ -975,6 +1177,7 @@ void CGisListWks::slotLoadWorkspace()
         CGisWorkspace::self().loadGisProject(filename);
     }
 
+    QSqlQuery query(db);
     QUERY_RUN("SELECT focus FROM userfocus", );
     if(query.next())
     {
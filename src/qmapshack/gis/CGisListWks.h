@@ -23,8 +23,10 @@
 #include "gis/prj/IGisProject.h"
 #include "gis/trk/CTrackData.h"
 
+#include <QMutex>
 #include <QPointer>
 #include <QSqlDatabase>
+#include <QThreadPool>
 #include <QTreeWidget>
 
 struct action_t;
@@ -77,6 +79,9 @@ protected:
 
 private slots:
     void slotSaveWorkspace();
+    void slotSaveWorkspaceOnExit();
+    void slotWriteWorkspace();
+    void slotLoadWorkspaceProject();
     void slotContextMenu(const QPoint& point);
     void slotSaveProject();
     void slotSaveAsProject();
@@ -137,6 +142,44 @@ private:
     void migrateDB1to2();
     void migrateDB2to3();
     void migrateDB3to4();
+
+    /// a project as it is written to the workspace database
+    struct wks_project_t
+    {
+        QString key;
+        qint32 type = 0;
+        QString name;
+        bool changed = false;
+        bool visible = false;
+        IGisProject::snapshot_t snapshot;
+        QByteArray fingerprint;
+        /// the serialized snapshot, set by serializeProjects()
+        QByteArray data;
+    };
+
+    /// a project's row in the workspace database
+    struct wks_row_t
+    {
+        quint64 id = 0;
+        /// the fingerprint of the project's data in the row
+        QByteArray fingerprint;
+    };
+
+    /**
+       @brief Take a snapshot of all projects changed since they have been written the last time
+
+       This has to be called by the GUI thread with the item mutex locked.
+     */
+    QList<wks_project_t> getChangedProjects();
+    /// serialize the snapshots, this is thread safe
+    static void serializeProjects(QList<wks_project_t>& projects);
+    /// write the projects and remove closed projects in a single transaction
+    void writeWorkspace(const QList<wks_project_t>& projects);
+    static QByteArray getFingerprint(const wks_project_t& project);
+
+    IGisProject * restoreProject(qint32 type, const QString& name, Qt::CheckState visible, QByteArray& data);
+    void finishLoadWorkspace();
+
     void setVisibilityOnMap(bool visible);
     QAction * addSortAction(QObject *parent, QActionGroup *actionGroup, const QString& icon, const QString& text, IGisProject::sorting_folder_e mode);
     QAction * addAction(const QIcon& icon, const QString& name, QObject * parent, const char * slot);
@@ -225,6 +268,18 @@ private:
     bool saveOnExit = true;
     qint32 saveEvery = 5;
 
+    /// all rows in the workspace database by project key, as far as they are known to be up to date
+    QHash<QString, wks_row_t> wksRows;
+    /// the IDs of rows not restored yet by slotLoadWorkspaceProject()
+    QList<quint64> wksRowsToLoad;
+    /// a single thread to serialize the project snapshots
+    QThreadPool poolSave;
+    /// protects projectsSerialized
+    QMutex mutexSave;
+    /// the result of the last serialization, to be written by slotWriteWorkspace()
+    QList<wks_project_t> projectsSerialized;
+    bool saveInProgress = false;
+
     IDeviceWatcher * deviceWatcher = nullptr;
 
     bool blockSorting = false;
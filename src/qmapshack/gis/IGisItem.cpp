@@ -31,6 +31,7 @@
 #include "gis/trk/CGisItemTrk.h"
 #include "gis/wpt/CGisItemWpt.h"
 #include "GeoMath.h"
+#include "helpers/CFunctionJob.h"
 #include "helpers/CDraw.h"
 #include "helpers/CSettings.h"
 #include "misc.h"
@@ -40,6 +41,11 @@
 #include <QtWidgets>
 #include <QtXml>
 
+/// every Nth history event keeps complete data to limit the length of delta chains
+#define HISTORY_KEYFRAME_INTERVAL   8
+/// the number of items decoded by a single job
+#define DB_DECODE_BATCH             32
+
 QMutex IGisItem::mutexItems(QMutex::Recursive);
 
 const QString IGisItem::noKey;
@@ -243,6 +249,14 @@ void IGisItem::genKey() const
     }
 }
 
+static void decodeDbData(const QByteArray& data, IGisItem::history_t& history)
+{
+    QDataStream in(data);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setVersion(QDataStream::Qt_5_2);
+    in >> history;
+}
+
 void IGisItem::loadFromDb(quint64 id, QSqlDatabase& db)
 {
     QSqlQuery query(db);
@@ -251,33 +265,109 @@ void IGisItem::loadFromDb(quint64 id, QSqlDatabase& db)
     QUERY_EXEC(return );
     if(query.next())
     {
-        QByteArray data(query.value(0).toByteArray());
-        QDataStream in(&data, QIODevice::ReadOnly);
-        in.setByteOrder(QDataStream::LittleEndian);
-        in.setVersion(QDataStream::Qt_5_2);
-        in >> history;
+        dbitem_t dbItem;
+        dbItem.id       = id;
+        dbItem.type     = type();
+        dbItem.keyqms   = query.value(1).toString();
+        dbItem.hash     = query.value(2).toString();
+        decodeDbData(query.value(0).toByteArray(), dbItem.history);
+
+        loadFromDb(dbItem);
+    }
+}
+
+void IGisItem::loadFromDb(const dbitem_t& dbItem)
+{
+    history = dbItem.history;
+    if(dbItem.data.isEmpty())
+    {
         loadHistory(history.histIdxCurrent);
+    }
+    else
+    {
+        loadHistory(history.histIdxCurrent, dbItem.data);
+    }
+
+    if(key.item.isEmpty())
+    {
+        /*[Issue #72] Database/Workspace inconsistency in QMS 1.4.0
+
+           The root cause is a missing key in the serialized data. This is fixed by calling getKey() in setupHistory().
 
-        if(key.item.isEmpty())
+           As the database has a valid key the complete history data has to be fixed with that key.
+         */
+        const int N = history.events.size();
+        for(int i = 0; i < N; i++)
         {
-            QString keyFromDB = query.value(1).toString();
-            /*[Issue #72] Database/Workspace inconsistency in QMS 1.4.0
+            loadHistory(i);
+            key.item = dbItem.keyqms;
+            updateHistory();
+        }
+    }
 
-               The root cause is a missing key in the serialized data. This is fixed by calling getKey() in setupHistory().
+    lastDatabaseHash = dbItem.hash;
+}
 
-               As the database has a valid key the complete history data has to be fixed with that key.
-             */
-            const int N = history.events.size();
-            for(int i = 0; i < N; i++)
-            {
-                loadHistory(i);
-                key.item = keyFromDB;
-                updateHistory();
-            }
+QVector<IGisItem::dbitem_t> IGisItem::readFromDb(const QList<quint64>& ids, QSqlDatabase& db)
+{
+    QVector<dbitem_t> items;
+    QVector<QByteArray> data;
+    items.reserve(ids.size());
+    data.reserve(ids.size());
+
+    // the queries have to be done by the thread owning the connection
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    for(int i = 0; i < ids.size(); i += DB_BATCH_SIZE)
+    {
+        const QList<quint64>& batch = ids.mid(i, DB_BATCH_SIZE);
+
+        QStringList placeholders;
+        for(int n = 0; n < batch.size(); n++)
+        {
+            placeholders << "?";
         }
 
-        lastDatabaseHash = query.value(2).toString();
+        query.prepare("SELECT id, type, data, keyqms, hash FROM items WHERE id IN (" + placeholders.join(",") + ")");
+        for(quint64 id : batch)
+        {
+            query.addBindValue(id);
+        }
+        QUERY_EXEC(continue);
+
+        while(query.next())
+        {
+            dbitem_t item;
+            item.id     = query.value(0).toULongLong();
+            item.type   = query.value(1).toUInt();
+            item.keyqms = query.value(3).toString();
+            item.hash   = query.value(4).toString();
+            items << item;
+            data << query.value(2).toByteArray();
+        }
+    }
+
+    // decoding the history of large items is expensive, do it in parallel
+    QThreadPool pool;
+    dbitem_t * pItems = items.data();
+    const QByteArray * pData = data.constData();
+    const int N = items.size();
+    for(int i = 0; i < N; i += DB_DECODE_BATCH)
+    {
+        const int end = qMin(i + DB_DECODE_BATCH, N);
+        pool.start(new CFunctionJob([pItems, pData, i, end]()
+        {
+            for(int n = i; n < end; n++)
+            {
+                dbitem_t& item = pItems[n];
+                decodeDbData(pData[n], item.history);
+                item.data = item.history.getData(item.history.histIdxCurrent);
+            }
+        }));
     }
+    pool.waitForDone();
+
+    return items;
 }
 
 void IGisItem::updateFromDB(quint64 id, QSqlDatabase& db)
@@ -402,6 +492,195 @@ void IGisItem::updateDecoration(quint32 enable, quint32 disable)
 }
 
 
+/*
+    All items are serialized as a magic string, a version and a compressed
+    buffer. A small change of the item changes most of the compressed buffer.
+    Thus deltas are calculated between the uncompressed buffers. Compressing
+    is deterministic. Thus compressing the reconstructed buffer gives the
+    original data again.
+ */
+static bool expandHistoryData(const QByteArray& data, QByteArray& expanded)
+{
+    if(data.size() <= IGisItem::sizeSerializedHeader)
+    {
+        return false;
+    }
+
+    QDataStream in(data);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setVersion(QDataStream::Qt_5_2);
+    in.skipRawData(IGisItem::sizeSerializedHeader);
+
+    QByteArray buffer;
+    in >> buffer;
+    if((in.status() != QDataStream::Ok) || !in.atEnd())
+    {
+        return false;
+    }
+
+    buffer = qUncompress(buffer);
+    if(buffer.isEmpty())
+    {
+        return false;
+    }
+
+    expanded = data.left(IGisItem::sizeSerializedHeader) + buffer;
+    return true;
+}
+
+static QByteArray compressHistoryData(const QByteArray& expanded, int level)
+{
+    QByteArray data = expanded.left(IGisItem::sizeSerializedHeader);
+    QDataStream out(&data, QIODevice::WriteOnly | QIODevice::Append);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setVersion(QDataStream::Qt_5_2);
+    out << qCompress(expanded.mid(IGisItem::sizeSerializedHeader), level);
+    return data;
+}
+
+/// the delta is the length of the common prefix and suffix and the bytes in between
+static QByteArray createHistoryDelta(const QByteArray& base, const QByteArray& target)
+{
+    const int N = qMin(base.size(), target.size());
+
+    quint32 prefix = 0;
+    while(int(prefix) < N && base[prefix] == target[prefix])
+    {
+        ++prefix;
+    }
+
+    quint32 suffix = 0;
+    while(int(prefix + suffix) < N && base[base.size() - 1 - suffix] == target[target.size() - 1 - suffix])
+    {
+        ++suffix;
+    }
+
+    QByteArray delta;
+    QDataStream out(&delta, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setVersion(QDataStream::Qt_5_2);
+    out << prefix << suffix << target.mid(prefix, target.size() - prefix - suffix);
+    return delta;
+}
+
+static QByteArray applyHistoryDelta(const QByteArray& base, const QByteArray& delta)
+{
+    QDataStream in(delta);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setVersion(QDataStream::Qt_5_2);
+
+    quint32 prefix;
+    quint32 suffix;
+    QByteArray middle;
+    in >> prefix >> suffix >> middle;
+
+    return base.left(prefix) + middle + base.right(suffix);
+}
+
+QByteArray IGisItem::history_t::getData(qint32 idx, bool exact) const
+{
+    if((idx < 0) || (idx >= events.size()))
+    {
+        return QByteArray();
+    }
+
+    if(!events[idx].isDelta)
+    {
+        return events[idx].data;
+    }
+
+    // the last event never is a delta
+    qint32 idxFull = idx + 1;
+    while(events[idxFull].isDelta)
+    {
+        ++idxFull;
+    }
+
+    QByteArray expanded;
+    if(!expandHistoryData(events[idxFull].data, expanded))
+    {
+        return QByteArray();
+    }
+
+    for(qint32 i = idxFull - 1; i >= idx; i--)
+    {
+        expanded = applyHistoryDelta(expanded, events[i].data);
+    }
+
+    // level 0 just frames the payload. It is as fast as a copy, and so is uncompressing it.
+    return compressHistoryData(expanded, exact ? 9 : 0);
+}
+
+void IGisItem::history_t::setFull(qint32 idx)
+{
+    if((idx < 0) || (idx >= events.size()) || !events[idx].isDelta)
+    {
+        return;
+    }
+
+    events[idx].data    = getData(idx);
+    events[idx].isDelta = false;
+}
+
+void IGisItem::history_t::setDelta(qint32 idx)
+{
+    if((idx < 0) || (idx + 1 >= events.size()) || (idx % HISTORY_KEYFRAME_INTERVAL == 0))
+    {
+        return;
+    }
+
+    history_event_t& event = events[idx];
+    if(event.isDelta || event.data.isEmpty())
+    {
+        return;
+    }
+
+    QSharedPointer<history_delta_t> pending(new history_delta_t());
+    pending->hash       = event.hash;
+    pending->hashBase   = events[idx + 1].hash;
+    event.pendingDelta  = pending;
+
+    const QByteArray& base   = getData(idx + 1);
+    const QByteArray& target = event.data;
+    QThreadPool::globalInstance()->start(new CFunctionJob([pending, base, target]()
+    {
+        QByteArray expandedBase;
+        QByteArray expandedTarget;
+        if(expandHistoryData(base, expandedBase) && expandHistoryData(target, expandedTarget))
+        {
+            // The data might have been compressed by another zlib version, e.g. if it was
+            // loaded from a file. Use the delta only if it gives back the very same bytes.
+            const QByteArray& delta = createHistoryDelta(expandedBase, expandedTarget);
+            if((delta.size() < target.size()) && (compressHistoryData(expandedTarget, 9) == target))
+            {
+                pending->delta = delta;
+            }
+        }
+        pending->done.storeRelease(1);
+    }));
+}
+
+void IGisItem::history_t::applyDeltas()
+{
+    for(int i = 0; i + 1 < events.size(); i++)
+    {
+        history_event_t& event = events[i];
+        if(event.pendingDelta.isNull() || !event.pendingDelta->done.loadAcquire())
+        {
+            continue;
+        }
+
+        // the events might have changed while the delta was calculated
+        const history_delta_t& pending = *event.pendingDelta;
+        if(!event.isDelta && !pending.delta.isEmpty() && (pending.hash == event.hash) && (pending.hashBase == events[i + 1].hash))
+        {
+            event.data      = pending.delta;
+            event.isDelta   = true;
+        }
+        event.pendingDelta.clear();
+    }
+}
+
 void IGisItem::changed(const QString &what, const QString &icon)
 {
     /*
@@ -415,6 +694,8 @@ void IGisItem::changed(const QString &what, const QString &icon)
     }
 
     // forget all history entries after the current entry
+    history.applyDeltas();
+    history.setFull(history.histIdxCurrent);
     for(int i = history.events.size() - 1; i > history.histIdxCurrent; i--)
     {
         history.events.pop_back();
@@ -440,6 +721,9 @@ void IGisItem::changed(const QString &what, const QString &icon)
 
     history.histIdxCurrent = history.events.size() - 1;
 
+    // the previous entry is kept as delta to the new one
+    history.setDelta(history.histIdxCurrent - 1);
+
     updateDecoration(eMarkChanged, eMarkNone);
 }
 
@@ -450,8 +734,13 @@ void IGisItem::updateHistory()
         return;
     }
 
+    // the previous entry might be a delta to the data replaced now
+    history.applyDeltas();
+    history.setFull(history.histIdxCurrent - 1);
+
     history_event_t& event = history.events[history.histIdxCurrent];
     event.data.clear();
+    event.isDelta = false;
 
     QDataStream stream(&event.data, QIODevice::WriteOnly);
     stream.setByteOrder(QDataStream::LittleEndian);
@@ -521,16 +810,19 @@ void IGisItem::loadHistory(int idx)
         return;
     }
 
-    history_event_t& event = history.events[idx];
+    loadHistory(idx, history.getData(idx, false));
+}
 
+void IGisItem::loadHistory(int idx, const QByteArray& data)
+{
     // test for no data
-    if(event.data.isEmpty())
+    if(data.isEmpty())
     {
         return;
     }
 
     // restore item from history entry
-    QDataStream stream(&event.data, QIODevice::ReadOnly);
+    QDataStream stream(data);
     stream.setByteOrder(QDataStream::LittleEndian);
     stream.setVersion(QDataStream::Qt_5_2);
     *this << stream;
@@ -540,6 +832,7 @@ void IGisItem::loadHistory(int idx)
 
 void IGisItem::cutHistoryAfter()
 {
+    history.setFull(history.histIdxCurrent);
     while(history.events.size() > (history.histIdxCurrent + 1))
     {
         history.events.pop_back();
@@ -551,6 +844,8 @@ void IGisItem::cutHistoryBefore()
     for (int i = 0; i < history.histIdxCurrent; i++)
     {
         history.events[i].data.clear();
+        history.events[i].isDelta = false;
+        history.events[i].pendingDelta.clear();
     }
 }
 
@@ -1059,6 +1354,35 @@ IGisItem * IGisItem::newGisItem(quint32 type, quint64 id, QSqlDatabase& db, IGis
     return item;
 }
 
+IGisItem * IGisItem::newGisItem(const dbitem_t& dbItem, IGisProject * project)
+{
+    IGisItem *item = nullptr;
+
+    switch(dbItem.type)
+    {
+    case IGisItem::eTypeWpt:
+        item = new CGisItemWpt(dbItem, project);
+        break;
+
+    case IGisItem::eTypeTrk:
+        item = new CGisItemTrk(dbItem, project);
+        break;
+
+    case IGisItem::eTypeRte:
+        item = new CGisItemRte(dbItem, project);
+        break;
+
+    case IGisItem::eTypeOvl:
+        item = new CGisItemOvlArea(dbItem, project);
+        break;
+
+    default:
+        ;
+    }
+
+    return item;
+}
+
 qreal IGisItem::getRating() const
 {
     return rating;
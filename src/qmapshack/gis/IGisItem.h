@@ -22,6 +22,7 @@
 
 #include <QTreeWidgetItem>
 
+#include <QAtomicInt>
 #include <QColor>
 #include <QCoreApplication>
 #include <QDateTime>
@@ -29,6 +30,7 @@
 #include <QMap>
 #include <QMutex>
 #include <QPainter>
+#include <QSharedPointer>
 #include <QString>
 #include <QStringList>
 #include <QUrl>
@@ -48,6 +50,19 @@ class IGisItem : public QTreeWidgetItem
 {
     Q_DECLARE_TR_FUNCTIONS(IGisItem)
 public:
+    /// the result of a history delta calculated by a background job, see history_t::setDelta()
+    struct history_delta_t
+    {
+        /// set to 1 by the job when it is done
+        QAtomicInt done;
+        /// the hash of the event the delta is for
+        QString hash;
+        /// the hash of the next event the delta is based on
+        QString hashBase;
+        /// the delta, empty if it is not smaller than the data or does not reproduce it exactly
+        QByteArray delta;
+    };
+
     struct history_event_t
     {
         QDateTime time;
@@ -55,7 +70,12 @@ public:
         QString who = "QMapShack";
         QString icon;
         QString comment;
+        /// the serialized item, use history_t::getData() to read it
         QByteArray data;
+        /// if true data is a delta to the data of the next event
+        bool isDelta = false;
+        /// a delta of data still calculated or not applied yet
+        QSharedPointer<history_delta_t> pendingDelta;
     };
 
     struct history_t
@@ -71,11 +91,59 @@ public:
             events.clear();
         }
 
+        /**
+           @brief Get the complete serialized item of an event
+
+           Events older than the last one can be stored as delta to the
+           next event. In that case the data is reconstructed from the
+           next event with complete data.
+
+           The data of a delta event is compressed again to give the exact
+           bytes it had. If the data is just loaded into an item, this is a
+           waste of time. In that case pass exact = false to get the data
+           with uncompressed payload.
+
+           @param idx   the event's index
+           @param exact false to skip compressing a reconstructed payload
+           @return The serialized item or an empty array if there is no data.
+         */
+        QByteArray getData(qint32 idx, bool exact = true) const;
+
+        /// make sure the event at idx holds the complete data
+        void setFull(qint32 idx);
+
+        /**
+           @brief Store the data of the event at idx as delta to the next event
+
+           The delta is calculated by a background job. It is used by
+           applyDeltas() if it is smaller than the data and if it reproduces
+           the data byte by byte.
+         */
+        void setDelta(qint32 idx);
+
+        /// replace the data of events by the deltas of all finished background jobs that still fit
+        void applyDeltas();
+
         qint32 histIdxInitial;
         qint32 histIdxCurrent;
         QList<history_event_t> events;
     };
 
+    /// the size of the magic string and the version in front of the compressed payload of a serialized item
+    static const int sizeSerializedHeader;
+
+    /// an item read from the database but not instantiated yet
+    struct dbitem_t
+    {
+        quint64 id = 0;
+        quint32 type = 0;
+        QString keyqms;
+        QString hash;
+        history_t history;
+        /// the serialized item of the current history entry, resolved by readFromDb()
+        QByteArray data;
+    };
+
 
     struct link_t
     {
@@ -570,6 +638,23 @@ public:
 
 
     static IGisItem * newGisItem(quint32 type, quint64 id, QSqlDatabase& db, IGisProject * project);
+    static IGisItem * newGisItem(const dbitem_t& dbItem, IGisProject * project);
+
+    /**
+       @brief Read a list of items from the database
+
+       Instead of a query per item the items are read by a few queries for
+       a batch of IDs each. The history of each item is decoded by a thread
+       pool, including the data of the current entry that might be stored as
+       delta. Use newGisItem() to create the items from the result. This has to
+       be done by the GUI thread, as the items are part of the workspace's tree
+       widget. Thus uncompressing and parsing the item data is not parallel.
+
+       @param ids       the items' IDs in the database
+       @param db        the database itself
+       @return The items found in the database, in no particular order.
+     */
+    static QVector<dbitem_t> readFromDb(const QList<quint64>& ids, QSqlDatabase& db);
 
 
     /// a no key value that can be used to nullify references.
@@ -624,6 +709,9 @@ protected:
     virtual void changed(const QString& what, const QString& icon);
 
     void loadFromDb(quint64 id, QSqlDatabase& db);
+    void loadFromDb(const dbitem_t& dbItem);
+    /// restore the item from the serialized data of the history entry idx
+    void loadHistory(int idx, const QByteArray& data);
     bool isVisible(const QRectF& rect, const QPolygonF& viewport, CGisDraw * gis);
     bool isVisible(const QPointF& point, const QPolygonF& viewport, CGisDraw * gis);
     bool isWithin(const QRectF& area, selflags_t flags, const QPolygonF& points);
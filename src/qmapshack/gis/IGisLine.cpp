@@ -43,17 +43,32 @@ SGisLine::SGisLine(const QPolygonF& line)
 
 void SGisLine::updateElevation(CDemDraw * dem)
 {
+    // query all points and subpoints at once
+    QPolygonF line;
+    for(const IGisLine::point_t& pt : *this)
+    {
+        line << pt.coord;
+        for(const IGisLine::subpt_t& sub : pt.subpts)
+        {
+            line << sub.coord;
+        }
+    }
+
+    QPolygonF ele(line.size());
+    dem->getElevationAt(line, ele);
+
+    int cnt = 0;
     for(int i = 0; i < size(); i++)
     {
         IGisLine::point_t& pt = (*this)[i];
-        qreal ele = dem->getElevationAt(pt.coord);
-        pt.ele = (ele == NOFLOAT) ? NOINT : qRound(ele);
+        qreal e = ele[cnt++].y();
+        pt.ele = (e == NOFLOAT) ? NOINT : qRound(e);
 
         for(int n = 0; n < pt.subpts.size(); n++)
         {
             IGisLine::subpt_t& sub = pt.subpts[n];
-            qreal ele = dem->getElevationAt(sub.coord);
-            sub.ele = (ele == NOFLOAT) ? NOINT : qRound(ele);
+            qreal e = ele[cnt++].y();
+            sub.ele = (e == NOFLOAT) ? NOINT : qRound(e);
         }
     }
 }
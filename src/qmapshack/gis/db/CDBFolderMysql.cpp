@@ -20,6 +20,7 @@
 #include "gis/db/CDBFolderMysql.h"
 #include "gis/db/macros.h"
 
+#include <proj_api.h>
 #include <QtSql>
 
 CDBFolderMysql::CDBFolderMysql(const QString &server, const QString &port, const QString &user, const QString & passwd, bool noPasswd, const QString &name, QTreeWidget *parent)
@@ -91,6 +92,45 @@ bool CDBFolderMysql::search(const QString& str, QSqlQuery &query)
     return true;
 }
 
+bool CDBFolderMysql::search(const QRectF& area, const QDateTime& start, const QDateTime& end, QSqlQuery& query)
+{
+    QString sql = "SELECT id FROM items WHERE 1";
+    if(!area.isNull())
+    {
+        sql += " AND id IN (SELECT id FROM spatialindex "
+               "WHERE MBRIntersects(bbox, ST_Envelope(LineString(Point(:lon1, :lat1), Point(:lon2, :lat2)))))";
+    }
+    if(start.isValid())
+    {
+        sql += " AND time_end>=:start";
+    }
+    if(end.isValid())
+    {
+        sql += " AND time_start<=:end";
+    }
+
+    query.prepare(sql);
+    if(!area.isNull())
+    {
+        const QRectF& rect = area.normalized();
+        query.bindValue(":lon1", rect.left()   * RAD_TO_DEG);
+        query.bindValue(":lat1", rect.top()    * RAD_TO_DEG);
+        query.bindValue(":lon2", rect.right()  * RAD_TO_DEG);
+        query.bindValue(":lat2", rect.bottom() * RAD_TO_DEG);
+    }
+    if(start.isValid())
+    {
+        query.bindValue(":start", start.toSecsSinceEpoch());
+    }
+    if(end.isValid())
+    {
+        query.bindValue(":end", end.toSecsSinceEpoch());
+    }
+    QUERY_EXEC(return false);
+
+    return true;
+}
+
 void CDBFolderMysql::copyFolder(quint64 child, quint64 parent) //override;
 {
     QSqlQuery query(IDB::db);
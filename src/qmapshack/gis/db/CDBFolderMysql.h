@@ -42,6 +42,7 @@ public:
     QString getDBInfo() const;
 
     bool search(const QString& str, QSqlQuery& query) override;
+    bool search(const QRectF& area, const QDateTime& start, const QDateTime& end, QSqlQuery& query) override;
 
     void copyFolder(quint64 child, quint64 parent) override;
 
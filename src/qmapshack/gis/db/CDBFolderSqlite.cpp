@@ -20,6 +20,7 @@
 #include "gis/db/CDBFolderSqlite.h"
 #include "gis/db/macros.h"
 
+#include <proj_api.h>
 #include <QtSql>
 #include <QtWidgets>
 
@@ -78,6 +79,45 @@ bool CDBFolderSqlite::search(const QString& str, QSqlQuery& query)
     return true;
 }
 
+bool CDBFolderSqlite::search(const QRectF& area, const QDateTime& start, const QDateTime& end, QSqlQuery& query)
+{
+    QString sql = "SELECT id FROM items WHERE 1";
+    if(!area.isNull())
+    {
+        sql += " AND id IN (SELECT id FROM spatialindex "
+               "WHERE lon_max>=:lon1 AND lon_min<=:lon2 AND lat_max>=:lat1 AND lat_min<=:lat2)";
+    }
+    if(start.isValid())
+    {
+        sql += " AND time_end>=:start";
+    }
+    if(end.isValid())
+    {
+        sql += " AND time_start<=:end";
+    }
+
+    query.prepare(sql);
+    if(!area.isNull())
+    {
+        const QRectF& rect = area.normalized();
+        query.bindValue(":lon1", rect.left()   * RAD_TO_DEG);
+        query.bindValue(":lat1", rect.top()    * RAD_TO_DEG);
+        query.bindValue(":lon2", rect.right()  * RAD_TO_DEG);
+        query.bindValue(":lat2", rect.bottom() * RAD_TO_DEG);
+    }
+    if(start.isValid())
+    {
+        query.bindValue(":start", start.toSecsSinceEpoch());
+    }
+    if(end.isValid())
+    {
+        query.bindValue(":end", end.toSecsSinceEpoch());
+    }
+    QUERY_EXEC(return false);
+
+    return true;
+}
+
 void CDBFolderSqlite::copyFolder(quint64 child, quint64 parent) //override;
 {
     QSqlQuery query(IDB::db);
@@ -331,7 +331,8 @@ void CDBProject::updateItem(IGisItem *&item, quint64 idItem, action_e& action2Fo
 
     QString hashInDb = item->getLastDatabaseHash();
 
-    query.prepare("UPDATE items SET type=:type, keyqms=:keyqms, icon=:icon, name=:name, date=:date, comment=:comment, data=:data, hash=:hash WHERE id=:id AND hash=:oldhash");
+    query.prepare("UPDATE items SET type=:type, keyqms=:keyqms, icon=:icon, name=:name, date=:date, comment=:comment, data=:data, hash=:hash, "
+                  "lon_min=:lon_min, lat_min=:lat_min, lon_max=:lon_max, lat_max=:lat_max, time_start=:time_start, time_end=:time_end WHERE id=:id AND hash=:oldhash");
     query.bindValue(":type",    item->type());
     query.bindValue(":keyqms",  item->getKey().item);
     query.bindValue(":icon",    buffer.data());
@@ -340,6 +341,7 @@ void CDBProject::updateItem(IGisItem *&item, quint64 idItem, action_e& action2Fo
     query.bindValue(":comment", item->getInfo(IGisItem::eFeatureShowName | IGisItem::eFeatureShowFullText));
     query.bindValue(":data",    data);
     query.bindValue(":hash",    item->getHash());
+    IDB::bindExtent(query, *item);
     query.bindValue(":id",      idItem);
     query.bindValue(":oldhash", hashInDb);
     QUERY_EXEC(throw eReasonQueryFail);
@@ -379,7 +381,8 @@ void CDBProject::updateItem(IGisItem *&item, quint64 idItem, action_e& action2Fo
         {
             // hashInDb has been updated by checkForAction2() by the one stored in the database
             // therefore the update should succeed now.
-            query.prepare("UPDATE items SET type=:type, keyqms=:keyqms, icon=:icon, name=:name, date=:date, comment=:comment, data=:data, hash=:hash WHERE id=:id AND hash=:oldhash");
+            query.prepare("UPDATE items SET type=:type, keyqms=:keyqms, icon=:icon, name=:name, date=:date, comment=:comment, data=:data, hash=:hash, "
+                          "lon_min=:lon_min, lat_min=:lat_min, lon_max=:lon_max, lat_max=:lat_max, time_start=:time_start, time_end=:time_end WHERE id=:id AND hash=:oldhash");
             query.bindValue(":type",    item->type());
             query.bindValue(":keyqms",  item->getKey().item);
             query.bindValue(":icon",    buffer.data());
@@ -388,6 +391,7 @@ void CDBProject::updateItem(IGisItem *&item, quint64 idItem, action_e& action2Fo
             query.bindValue(":comment", item->getInfo(IGisItem::eFeatureShowName | IGisItem::eFeatureShowFullText));
             query.bindValue(":data",    data);
             query.bindValue(":hash",    item->getHash());
+            IDB::bindExtent(query, *item);
             query.bindValue(":id",      idItem);
             query.bindValue(":oldhash", hashInDb);
             QUERY_EXEC(throw eReasonQueryFail);
@@ -432,7 +436,8 @@ quint64 CDBProject::insertItem(IGisItem * item, QSqlQuery &query)
     pixmap.save(&buffer, "PNG");
     buffer.seek(0);
 
-    query.prepare("INSERT INTO items (type, keyqms, icon, name, date, comment, data, hash) VALUES (:type, :keyqms, :icon, :name, :date, :comment, :data, :hash)");
+    query.prepare("INSERT INTO items (type, keyqms, icon, name, date, comment, data, hash, lon_min, lat_min, lon_max, lat_max, time_start, time_end) "
+                  "VALUES (:type, :keyqms, :icon, :name, :date, :comment, :data, :hash, :lon_min, :lat_min, :lon_max, :lat_max, :time_start, :time_end)");
     query.bindValue(":type",    item->type());
     query.bindValue(":keyqms",  item->getKey().item);
     query.bindValue(":icon",    buffer.data());
@@ -441,6 +446,7 @@ quint64 CDBProject::insertItem(IGisItem * item, QSqlQuery &query)
     query.bindValue(":comment", item->getInfo(IGisItem::eFeatureShowName | IGisItem::eFeatureShowFullText));
     query.bindValue(":data",    data);
     query.bindValue(":hash",    item->getHash());
+    IDB::bindExtent(query, *item);
     QUERY_EXEC(throw eReasonQueryFail);
 
     if(query.numRowsAffected())
@@ -691,9 +697,35 @@ void CDBProject::showItems(CEvtD2WShowItems * evt, action_e action2ForAll)
         qDeleteAll(takeChildren());
     }
 
+    // read all items at once instead of a query per item
+    QList<quint64> ids;
     for(const evt_item_t &item : evt->items)
     {
-        IGisItem * gisItem = IGisItem::newGisItem(item.type, item.id, db, this);
+        ids << item.id;
+    }
+
+    const QVector<IGisItem::dbitem_t>& dbItems = IGisItem::readFromDb(ids, db);
+    QHash<quint64, int> id2idx;
+    for(int i = 0; i < dbItems.size(); i++)
+    {
+        id2idx[dbItems[i].id] = i;
+    }
+
+    // do not repaint the workspace for each new item
+    QTreeWidget * tree = treeWidget();
+    if(tree != nullptr)
+    {
+        tree->setUpdatesEnabled(false);
+    }
+
+    for(const evt_item_t &item : evt->items)
+    {
+        if(!id2idx.contains(item.id))
+        {
+            continue;
+        }
+
+        IGisItem * gisItem = IGisItem::newGisItem(dbItems[id2idx[item.id]], this);
 
         /* [Issue #72] Database/Workspace inconsistency in QMS 1.4.0
 
@@ -722,6 +754,11 @@ void CDBProject::showItems(CEvtD2WShowItems * evt, action_e action2ForAll)
         }
     }
 
+    if(tree != nullptr)
+    {
+        tree->setUpdatesEnabled(true);
+    }
+
     sortItems();
     postStatus(false);
     setToolTip(CGisListWks::eColumnName, getInfo());
@@ -819,34 +856,64 @@ void CDBProject::update()
     }
     else
     {
-        // Iterate over all children and update
+        // get IDs of all children attached to the project in the database
+        QSet<quint64> idsInProject;
+        query.prepare("SELECT child FROM folder2item WHERE parent=:parent");
+        query.bindValue(":parent", getId());
+        QUERY_EXEC(return );
+        while(query.next())
+        {
+            idsInProject << query.value(0).toULongLong();
+        }
+
+        // get IDs of all children by their keys, a batch of keys per query
+        QList<IGisItem*> items;
+        QStringList keys;
         const int N = childCount();
         for(int i = 0; i < N; i++)
         {
             IGisItem * item = dynamic_cast<IGisItem*>(child(i));
-            if(item == nullptr)
+            if(item != nullptr)
             {
-                continue;
+                items << item;
+                keys << item->getKey().item;
             }
+        }
 
-            const IGisItem::key_t& key = item->getKey();
-            // update item from database
-            query.prepare("SELECT id FROM items WHERE keyqms=:keyqms");
-            query.bindValue(":keyqms", key.item);
+        QHash<QString, quint64> key2id;
+        for(int i = 0; i < keys.size(); i += DB_BATCH_SIZE)
+        {
+            const QStringList& batch = keys.mid(i, DB_BATCH_SIZE);
+
+            QStringList placeholders;
+            for(int n = 0; n < batch.size(); n++)
+            {
+                placeholders << "?";
+            }
+
+            query.prepare("SELECT id, keyqms FROM items WHERE keyqms IN (" + placeholders.join(",") + ")");
+            for(const QString& key : batch)
+            {
+                query.addBindValue(key);
+            }
             QUERY_EXEC(return );
 
-            if(query.next())
+            while(query.next())
             {
-                // item is in the database
-                quint64 idItem = query.value(0).toULongLong();
+                key2id[query.value(1).toString()] = query.value(0).toULongLong();
+            }
+        }
 
-                QSqlQuery query2(db);
-                query2.prepare("SELECT id FROM folder2item WHERE parent=:parent AND child=:child");
-                query2.bindValue(":parent", getId());
-                query2.bindValue(":child", idItem);
-                query2.exec();
+        // Iterate over all children and update
+        for(IGisItem * item : items)
+        {
+            const IGisItem::key_t& key = item->getKey();
+            if(key2id.contains(key.item))
+            {
+                // item is in the database
+                quint64 idItem = key2id[key.item];
 
-                if(query2.next())
+                if(idsInProject.contains(idItem))
                 {
                     // item is connected to this project
                     item->updateFromDB(idItem, db);
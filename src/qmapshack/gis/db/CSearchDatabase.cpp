@@ -16,6 +16,8 @@
 
 **********************************************************************************************/
 
+#include "CMainWindow.h"
+#include "canvas/CCanvas.h"
 #include "gis/CGisListDB.h"
 #include "gis/CGisWorkspace.h"
 #include "gis/db/CDBFolderGroup.h"
@@ -37,9 +39,15 @@ CSearchDatabase::CSearchDatabase(IDBFolder &dbFolder, CGisListDB *parent)
 
     labelName->setText(tr("Search database '%1':").arg(dbFolder.getDBName()));
 
+    const QDateTime& now = QDateTime::currentDateTime();
+    dateStart->setDateTime(now.addMonths(-1));
+    dateEnd->setDateTime(now);
+
     connect(pushSearch, &QPushButton::clicked, this, &CSearchDatabase::slotSearch);
     connect(pushClose, &QPushButton::clicked, this, &CSearchDatabase::accept);
     connect(treeResult, &QTreeWidget::itemChanged, this, &CSearchDatabase::slotItemChanged);
+    connect(checkTime, &QCheckBox::toggled, dateStart, &QDateTimeEdit::setEnabled);
+    connect(checkTime, &QCheckBox::toggled, dateEnd, &QDateTimeEdit::setEnabled);
 }
 
 void CSearchDatabase::slotItemChanged(QTreeWidgetItem * item, int column)
@@ -84,13 +92,62 @@ void CSearchDatabase::slotSearch()
 
     QSqlDatabase& db = dbFolder.getDb();
     QSqlQuery query(db);
-    dbFolder.search(lineQuery->text(), query);
+
+    const QString& text = lineQuery->text();
+    const bool searchText   = !text.isEmpty();
+    const bool searchExtent = checkArea->isChecked() || checkTime->isChecked();
+
+    // the IDs of all items found by the text search
+    QList<quint64> itemIds;
+    if(searchText && dbFolder.search(text, query))
+    {
+        while(query.next())
+        {
+            itemIds << query.value(0).toULongLong();
+        }
+    }
+
+    if(searchExtent)
+    {
+        QRectF area;
+        CCanvas * canvas = CMainWindow::self().getVisibleCanvas();
+        if(checkArea->isChecked() && (canvas != nullptr))
+        {
+            QPointF pt1 = canvas->rect().topLeft();
+            QPointF pt2 = canvas->rect().bottomRight();
+            canvas->convertPx2Rad(pt1);
+            canvas->convertPx2Rad(pt2);
+            area = QRectF(pt1, pt2);
+        }
+
+        QDateTime start;
+        QDateTime end;
+        if(checkTime->isChecked())
+        {
+            start = dateStart->dateTime();
+            end   = dateEnd->dateTime();
+        }
+
+        QSet<quint64> textIds = itemIds.toSet();
+        itemIds.clear();
+        if(dbFolder.search(area, start, end, query))
+        {
+            while(query.next())
+            {
+                quint64 itemId = query.value(0).toULongLong();
+                // combine both searches if a text is given
+                if(!searchText || textIds.contains(itemId))
+                {
+                    itemIds << itemId;
+                }
+            }
+        }
+    }
 
     QMap<quint64, IDBFolder*> folders;
 
-    while(query.next())
+    for(quint64 itemId : itemIds)
     {
-        quint64 itemId = query.value(0).toULongLong();
 
         QSqlQuery query2(db);
         query2.prepare("SELECT t1.id, t1.type FROM folders AS t1 WHERE id=(SELECT parent FROM folder2item WHERE child=:id)");
@@ -19,7 +19,9 @@
 #include "CMainWindow.h"
 #include "gis/db/IDB.h"
 #include "gis/db/macros.h"
+#include "gis/trk/CGisItemTrk.h"
 
+#include <proj_api.h>
 #include <QtSql>
 #include <QtWidgets>
 
@@ -136,3 +138,34 @@ quint64 IDB::getLastInsertID(QSqlDatabase& db, const QString& table)
     query.next();
     return query.value(0).toULongLong();
 }
+
+void IDB::bindExtent(QSqlQuery& query, const IGisItem& item)
+{
+    // all items use west as left side. An item without points has west > east.
+    const QRectF& rect  = item.getBoundingRect();
+    const qreal lonMin  = rect.left() * RAD_TO_DEG;
+    const qreal lonMax  = rect.right() * RAD_TO_DEG;
+    const qreal latMin  = qMin(rect.top(), rect.bottom()) * RAD_TO_DEG;
+    const qreal latMax  = qMax(rect.top(), rect.bottom()) * RAD_TO_DEG;
+    const bool hasArea  = (lonMin <= lonMax) && (lonMin >= -180.0) && (lonMax <= 180.0) && (latMin >= -90.0) && (latMax <= 90.0);
+
+    const QVariant null(QVariant::Double);
+    query.bindValue(":lon_min", hasArea ? QVariant(lonMin) : null);
+    query.bindValue(":lat_min", hasArea ? QVariant(latMin) : null);
+    query.bindValue(":lon_max", hasArea ? QVariant(lonMax) : null);
+    query.bindValue(":lat_max", hasArea ? QVariant(latMax) : null);
+
+    // tracks cover a time range, all other items a single point in time
+    QDateTime timeStart = item.getTimestamp();
+    QDateTime timeEnd   = timeStart;
+    const CGisItemTrk * trk = dynamic_cast<const CGisItemTrk*>(&item);
+    if(trk != nullptr)
+    {
+        timeStart   = trk->getTimeStart();
+        timeEnd     = trk->getTimeEnd();
+    }
+
+    const QVariant nullTime(QVariant::LongLong);
+    query.bindValue(":time_start", timeStart.isValid() ? QVariant(timeStart.toMSecsSinceEpoch() / 1000) : nullTime);
+    query.bindValue(":time_end",   timeEnd.isValid()   ? QVariant(timeEnd.toMSecsSinceEpoch() / 1000)   : nullTime);
+}
@@ -23,6 +23,9 @@
 #include <QMap>
 #include <QSqlDatabase>
 
+class IGisItem;
+class QSqlQuery;
+
 class IDB
 {
     Q_DECLARE_TR_FUNCTIONS(IDB)
@@ -35,6 +38,18 @@ public:
 
     static quint64 getLastInsertID(QSqlDatabase& db, const QString& table);
 
+    /**
+       @brief Bind the bounding box and the time range of an item to a prepared query
+
+       The query has to use the placeholders :lon_min, :lat_min, :lon_max, :lat_max in [°]
+       and :time_start, :time_end in [s] since epoch. Values not defined by the item are
+       bound as NULL.
+
+       @param query     the prepared query
+       @param item      the item to get the values from
+     */
+    static void bindExtent(QSqlQuery& query, const IGisItem& item);
+
     bool isUsable() const
     {
         return db.isOpen();
@@ -170,6 +170,23 @@ public:
         return false;
     }
 
+    /**
+       @brief Search the database for items by their bounding box and time range.
+
+       This must be overridden by the database folder classes. As a result the query will
+       contain a list of item IDs. Items without position are never found by an area search,
+       items without timestamp are never found by a time search.
+
+       @param area      The area in [rad] the items have to intersect, a null area means any area
+       @param start     The start of the time span, invalid for no lower limit
+       @param end       The end of the time span, invalid for no upper limit
+       @param query     The sql query item to use
+     */
+    virtual bool search(const QRectF& area, const QDateTime& start, const QDateTime& end, QSqlQuery& query)
+    {
+        return false;
+    }
+
     bool isSiblingFrom(IDBFolder * folder) const;
 
     void exportToGpx();
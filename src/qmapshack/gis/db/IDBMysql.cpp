@@ -29,6 +29,9 @@
 #include <QtSql>
 #include <QtWidgets>
 
+/// the bounding box of an item as geometry in [°], with SRID 0 as all geometries built by Point()
+#define BBOX_FROM_NEW "ST_Envelope(LineString(Point(NEW.lon_min, NEW.lat_min), Point(NEW.lon_max, NEW.lat_max)))"
+
 
 IDBMysql::IDBMysql()
 {
@@ -125,7 +128,14 @@ bool IDBMysql::initDB()
                "last_user      TEXT DEFAULT NULL,"
                "last_change    DATETIME DEFAULT NOW() ON UPDATE NOW(),"
                "trash          DATETIME DEFAULT NULL,"
+               "lon_min        DOUBLE DEFAULT NULL,"
+               "lat_min        DOUBLE DEFAULT NULL,"
+               "lon_max        DOUBLE DEFAULT NULL,"
+               "lat_max        DOUBLE DEFAULT NULL,"
+               "time_start     BIGINT DEFAULT NULL,"
+               "time_end       BIGINT DEFAULT NULL,"
                "FULLTEXT INDEX searchindex(comment),"
+               "INDEX timeindex(time_start, time_end),"
                "UNIQUE KEY (keyqms)"
                ")", return false);
 
@@ -139,6 +149,11 @@ bool IDBMysql::initDB()
               "FOR EACH ROW SET NEW.last_user = USER();"
               , return false);
 
+    if(!initSpatialIndex())
+    {
+        return false;
+    }
+
     query.prepare("INSERT INTO folders (type, name, comment) VALUES (2, :name, '')");
     query.bindValue(":name", db.connectionName());
     QUERY_EXEC(return false);
@@ -195,6 +210,14 @@ bool IDBMysql::migrateDB(int version)
                 throw -1;
             }
         }
+
+        if(version < 7)
+        {
+            if(!migrateDB6to7())
+            {
+                throw -1;
+            }
+        }
     }
     catch(int i)
     {
@@ -316,3 +339,114 @@ bool IDBMysql::migrateDB5to6()
     return true;
 }
 
+bool IDBMysql::migrateDB6to7()
+{
+    QSqlQuery query(db);
+
+    // bounding box in [°] and time range in [s] since epoch
+    QUERY_RUN("ALTER TABLE items "
+              "ADD COLUMN lon_min DOUBLE DEFAULT NULL, "
+              "ADD COLUMN lat_min DOUBLE DEFAULT NULL, "
+              "ADD COLUMN lon_max DOUBLE DEFAULT NULL, "
+              "ADD COLUMN lat_max DOUBLE DEFAULT NULL, "
+              "ADD COLUMN time_start BIGINT DEFAULT NULL, "
+              "ADD COLUMN time_end BIGINT DEFAULT NULL, "
+              "ADD INDEX timeindex (time_start, time_end)"
+              , return false);
+
+    // the spatial index is filled by its triggers while the items are migrated
+    if(!initSpatialIndex())
+    {
+        return false;
+    }
+
+    // get number of items in the database
+    QUERY_RUN("SELECT Count(*) FROM items", return false);
+    query.next();
+    quint32 N = query.value(0).toUInt();
+
+    // over all items
+    QUERY_RUN("SELECT id, type FROM items", return false);
+    PROGRESS_SETUP(tr("Update to database version 7. Migrate all GIS items."), 0, N, CMainWindow::self().getBestWidgetForParent());
+    progress.enableCancel(false);
+    quint32 cnt = 0;
+    while(query.next())
+    {
+        PROGRESS(cnt++,;
+                 );
+
+        quint64 itemId      = query.value(0).toULongLong();
+        quint32 itemType    = query.value(1).toUInt();
+        IGisItem *item      = IGisItem::newGisItem(itemType, itemId, db, nullptr);
+
+        if(nullptr == item)
+        {
+            continue;
+        }
+
+        QSqlQuery query2(db);
+        query2.prepare("UPDATE items SET lon_min=:lon_min, lat_min=:lat_min, lon_max=:lon_max, lat_max=:lat_max, "
+                       "time_start=:time_start, time_end=:time_end WHERE id=:id");
+        IDB::bindExtent(query2, *item);
+        query2.bindValue(":id", itemId);
+        if(!query2.exec())
+        {
+            qWarning() << query2.lastQuery();
+            qWarning() << query2.lastError();
+        }
+
+        delete item;
+    }
+
+    return true;
+}
+
+bool IDBMysql::initSpatialIndex()
+{
+    QSqlQuery query(db);
+
+    // MySQL 8 uses a spatial index only if the column is restricted to a SRID. MariaDB
+    // and MySQL 5.7 do not know the attribute.
+    QString srid;
+    QUERY_RUN("SELECT VERSION()", return false);
+    if(query.next())
+    {
+        const QString& version = query.value(0).toString();
+        if(!version.contains("MariaDB") && (version.section('.', 0, 0).toInt() >= 8))
+        {
+            srid = " SRID 0";
+        }
+    }
+
+    // a spatial index needs a NOT NULL column. Thus the bounding boxes are kept in a
+    // table of their own, holding items with a position only.
+    QUERY_RUN("CREATE TABLE spatialindex ("
+              "id             INTEGER PRIMARY KEY,"
+              "bbox           GEOMETRY NOT NULL" + srid + ","
+              "SPATIAL INDEX spatialindex(bbox)"
+              ")", return false);
+
+    QUERY_RUN("CREATE TRIGGER spatialindex_insert "
+              "AFTER INSERT ON items "
+              "FOR EACH ROW INSERT INTO spatialindex(id, bbox) "
+              "SELECT NEW.id, " BBOX_FROM_NEW " FROM DUAL WHERE NEW.lon_min IS NOT NULL;"
+              , return false);
+
+    QUERY_RUN("CREATE TRIGGER spatialindex_update "
+              "AFTER UPDATE ON items "
+              "FOR EACH ROW BEGIN "
+              "IF NOT (NEW.lon_min <=> OLD.lon_min AND NEW.lat_min <=> OLD.lat_min AND NEW.lon_max <=> OLD.lon_max AND NEW.lat_max <=> OLD.lat_max) THEN "
+              "DELETE FROM spatialindex WHERE id=OLD.id; "
+              "INSERT INTO spatialindex(id, bbox) "
+              "SELECT NEW.id, " BBOX_FROM_NEW " FROM DUAL WHERE NEW.lon_min IS NOT NULL; "
+              "END IF; "
+              "END;"
+              , return false);
+
+    QUERY_RUN("CREATE TRIGGER spatialindex_delete "
+              "AFTER DELETE ON items "
+              "FOR EACH ROW DELETE FROM spatialindex WHERE id=OLD.id;"
+              , return false);
+
+    return true;
+}
@@ -35,6 +35,9 @@ protected:
     bool migrateDB(int version) override;
     bool migrateDB4to5();
     bool migrateDB5to6();
+    bool migrateDB6to7();
+    /// create the table of the items' bounding boxes and the triggers to fill it
+    bool initSpatialIndex();
 };
 
 #endif //IDBMYSQL_H
@@ -114,7 +114,13 @@ bool IDBSqlite::initDB()
                   "hash           TEXT NOT NULL,"
                   "last_user      TEXT DEFAULT 'QMapShack',"
                   "last_change    DATETIME DEFAULT CURRENT_TIMESTAMP,"
-                  "trash          DATETIME DEFAULT NULL"
+                  "trash          DATETIME DEFAULT NULL,"
+                  "lon_min        REAL DEFAULT NULL,"
+                  "lat_min        REAL DEFAULT NULL,"
+                  "lon_max        REAL DEFAULT NULL,"
+                  "lat_max        REAL DEFAULT NULL,"
+                  "time_start     INTEGER DEFAULT NULL,"
+                  "time_end       INTEGER DEFAULT NULL"
                   ")", throw -1)
 
         QUERY_RUN("CREATE TRIGGER items_update_last_change "
@@ -169,6 +175,29 @@ bool IDBSqlite::initDB()
                   "INSERT INTO searchindex(id, comment) VALUES(NEW.id, NEW.comment); "
                   "END;", throw -1);
 
+        // create virtual table with spatial index
+        QUERY_RUN("CREATE VIRTUAL TABLE spatialindex USING rtree(id, lon_min, lon_max, lat_min, lat_max)", throw -1);
+
+        QUERY_RUN("CREATE TRIGGER spatialindex_insert "
+                  "AFTER INSERT ON items WHEN NEW.lon_min IS NOT NULL BEGIN "
+                  "INSERT INTO spatialindex(id, lon_min, lon_max, lat_min, lat_max) "
+                  "VALUES(NEW.id, NEW.lon_min, NEW.lon_max, NEW.lat_min, NEW.lat_max); "
+                  "END;", throw -1);
+
+        QUERY_RUN("CREATE TRIGGER spatialindex_update "
+                  "AFTER UPDATE OF lon_min, lat_min, lon_max, lat_max ON items BEGIN "
+                  "DELETE FROM spatialindex WHERE id=OLD.id; "
+                  "INSERT INTO spatialindex(id, lon_min, lon_max, lat_min, lat_max) "
+                  "SELECT NEW.id, NEW.lon_min, NEW.lon_max, NEW.lat_min, NEW.lat_max WHERE NEW.lon_min IS NOT NULL; "
+                  "END;", throw -1);
+
+        QUERY_RUN("CREATE TRIGGER spatialindex_delete "
+                  "AFTER DELETE ON items BEGIN "
+                  "DELETE FROM spatialindex WHERE id=OLD.id; "
+                  "END;", throw -1);
+
+        QUERY_RUN("CREATE INDEX items_time ON items(time_start, time_end)", throw -1);
+
         QUERY_RUN("END TRANSACTION;", throw -1);
     }
     catch(int i)
@@ -231,6 +260,14 @@ bool IDBSqlite::migrateDB(int version)
             }
         }
 
+        if(version < 7)
+        {
+            if(!migrateDB6to7())
+            {
+                throw -1;
+            }
+        }
+
         QUERY_RUN("END TRANSACTION;", throw -1);
     }
     catch(int i)
@@ -487,3 +524,79 @@ bool IDBSqlite::migrateDB5to6()
     return true;
 }
 
+bool IDBSqlite::migrateDB6to7()
+{
+    QSqlQuery query(db);
+
+    // bounding box in [°] and time range in [s] since epoch
+    QUERY_RUN("ALTER TABLE items ADD COLUMN lon_min REAL DEFAULT NULL",       return false);
+    QUERY_RUN("ALTER TABLE items ADD COLUMN lat_min REAL DEFAULT NULL",       return false);
+    QUERY_RUN("ALTER TABLE items ADD COLUMN lon_max REAL DEFAULT NULL",       return false);
+    QUERY_RUN("ALTER TABLE items ADD COLUMN lat_max REAL DEFAULT NULL",       return false);
+    QUERY_RUN("ALTER TABLE items ADD COLUMN time_start INTEGER DEFAULT NULL", return false);
+    QUERY_RUN("ALTER TABLE items ADD COLUMN time_end INTEGER DEFAULT NULL",   return false);
+
+    // create virtual table with spatial index, it is filled by the triggers
+    QUERY_RUN("CREATE VIRTUAL TABLE spatialindex USING rtree(id, lon_min, lon_max, lat_min, lat_max)", return false);
+
+    QUERY_RUN("CREATE TRIGGER spatialindex_insert "
+              "AFTER INSERT ON items WHEN NEW.lon_min IS NOT NULL BEGIN "
+              "INSERT INTO spatialindex(id, lon_min, lon_max, lat_min, lat_max) "
+              "VALUES(NEW.id, NEW.lon_min, NEW.lon_max, NEW.lat_min, NEW.lat_max); "
+              "END;", return false);
+
+    QUERY_RUN("CREATE TRIGGER spatialindex_update "
+              "AFTER UPDATE OF lon_min, lat_min, lon_max, lat_max ON items BEGIN "
+              "DELETE FROM spatialindex WHERE id=OLD.id; "
+              "INSERT INTO spatialindex(id, lon_min, lon_max, lat_min, lat_max) "
+              "SELECT NEW.id, NEW.lon_min, NEW.lon_max, NEW.lat_min, NEW.lat_max WHERE NEW.lon_min IS NOT NULL; "
+              "END;", return false);
+
+    QUERY_RUN("CREATE TRIGGER spatialindex_delete "
+              "AFTER DELETE ON items BEGIN "
+              "DELETE FROM spatialindex WHERE id=OLD.id; "
+              "END;", return false);
+
+    QUERY_RUN("CREATE INDEX items_time ON items(time_start, time_end)", return false);
+
+    // get number of items in the database
+    QUERY_RUN("SELECT Count(*) FROM items", return false);
+    query.next();
+    quint32 N = query.value(0).toUInt();
+
+    // over all items
+    QUERY_RUN("SELECT id, type FROM items", return false);
+    PROGRESS_SETUP(tr("Update to database version 7. Migrate all GIS items."), 0, N, CMainWindow::self().getBestWidgetForParent());
+    progress.enableCancel(false);
+    quint32 cnt = 0;
+    while(query.next())
+    {
+        PROGRESS(cnt++,;
+                 );
+
+        quint64 idItem      = query.value(0).toULongLong();
+        quint32 typeItem    = query.value(1).toUInt();
+
+        IGisItem *item = IGisItem::newGisItem(typeItem, idItem, db, nullptr);
+
+        if(nullptr == item)
+        {
+            continue;
+        }
+
+        QSqlQuery query2(db);
+        query2.prepare("UPDATE items SET lon_min=:lon_min, lat_min=:lat_min, lon_max=:lon_max, lat_max=:lat_max, "
+                       "time_start=:time_start, time_end=:time_end WHERE id=:id");
+        IDB::bindExtent(query2, *item);
+        query2.bindValue(":id", idItem);
+        if(!query2.exec())
+        {
+            qWarning() << query2.lastQuery();
+            qWarning() << query2.lastError();
+        }
+
+        delete item;
+    }
+
+    return true;
+}
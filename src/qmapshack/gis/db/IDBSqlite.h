@@ -38,6 +38,7 @@ protected:
     bool migrateDB3to4();
     bool migrateDB4to5();
     bool migrateDB5to6();
+    bool migrateDB6to7();
 };
 
 #endif //IDBSQLITE_H
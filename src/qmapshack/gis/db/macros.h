@@ -19,7 +19,10 @@
 #ifndef MACROS_H
 #define MACROS_H
 
-#define DB_VERSION 6
+#define DB_VERSION 7
+
+/// the maximum number of values bound to a single "IN (...)" clause, SQLite allows 999 at most
+#define DB_BATCH_SIZE 500
 
 #define NO_CMD ((void)0)
 
@@ -33,14 +33,14 @@ CFitDecoder::CFitDecoder()
     stateMap[eDecoderStateRecordContent] = new CFitRecordContentState(data);
     stateMap[eDecoderStateFieldDef] = new CFitFieldDefinitionState(data);
     stateMap[eDecoderStateDevFieldDef] = new CFitDevFieldDefinitionState(data);
-    stateMap[eDecoderStateFieldData] = new CFitFieldDataState(data);
+    fieldDataState = new CFitFieldDataState(data);
+    stateMap[eDecoderStateFieldData] = fieldDataState;
     stateMap[eDecoderStateFileCrc] = new CFitCrcState(data);
 }
 
 CFitDecoder::~CFitDecoder()
 {
-    qDeleteAll(stateMap);
-    stateMap.clear();
+    qDeleteAll(stateMap, stateMap + eDecoderStateEnd);
 
     data.messages.clear();
 }
@@ -58,6 +58,9 @@ void CFitDecoder::resetSharedData()
     data.fileBytesRead = 0;
     data.fileLength = 0;
     data.crc = 0;
+
+    // the field data state keeps a pointer into the definitions
+    stateMap[eDecoderStateFieldData]->reset();
 }
 
 void printDefinitions(const QList<CFitDefinitionMessage>& defs)
@@ -91,28 +94,61 @@ void CFitDecoder::printDebugInfo()
 QList<QString> decoderStateNames = {"File Header", "Record", "Record Content", "Field Definition",
                                     "Development Field Definition", "Field Data", "CRC", "End"};
 
-void printByte(QFile& file, decode_state_e state, quint8 dataByte)
+void printByte(qint64 pos, decode_state_e state, quint8 dataByte)
 {
     FITDEBUG(3, qDebug() << QString("decoding byte %1 - %2 - %3")
-             .arg(file.pos(), 6, 10, QLatin1Char(' '))
+             .arg(pos, 6, 10, QLatin1Char(' '))
              .arg(dataByte, 8, 2, QLatin1Char('0'))
              .arg(decoderStateNames.at(state)));
 }
 
 void CFitDecoder::decode(QFile &file)
+{
+    // Get all of the file at once. Reading it byte by byte via the
+    // QIODevice is by far more expensive than decoding it.
+    const qint64 size = file.size();
+    uchar * mapped = size > 0 ? file.map(0, size) : nullptr;
+    if(mapped == nullptr)
+    {
+        file.seek(0);
+        decode(file.readAll(), file.fileName());
+        return;
+    }
+
+    try
+    {
+        decode(QByteArray::fromRawData((const char*)mapped, size), file.fileName());
+    }
+    catch(QString& errormsg)
+    {
+        file.unmap(mapped);
+        throw errormsg;
+    }
+    file.unmap(mapped);
+}
+
+void CFitDecoder::decode(const QByteArray& buffer, const QString& fileName)
 {
     resetSharedData();
 
-    file.seek(0);
+    const quint8 * const start = (const quint8 *)buffer.constData();
+    const quint8 * const end = start + buffer.size();
 
-    quint8 dataByte;
     decode_state_e state = eDecoderStateFileHeader;
-    while (!file.atEnd())
+    const quint8 * ptr = start;
+    while(ptr != end)
     {
-        file.getChar((char *) &dataByte);
         try
         {
-            printByte(file, state, dataByte);
+            // Data records make up most of a file. Decode them in one go if
+            // possible. Everything else goes through the state machine byte by byte.
+            if(state == eDecoderStateFieldData && fieldDataState->processRecord(ptr, end, state))
+            {
+                continue;
+            }
+
+            quint8 dataByte = *ptr++;
+            printByte(ptr - start, state, dataByte);
             state = stateMap[state]->processByte(dataByte);
             if (state == eDecoderStateEnd)
             {
@@ -129,7 +165,7 @@ void CFitDecoder::decode(QFile &file)
     }
     // unexpected end of file
     printDebugInfo();
-    throw tr("FIT decoding error: unexpected end of file %1.").arg(file.fileName());
+    throw tr("FIT decoding error: unexpected end of file %1.").arg(fileName);
 }
 
 const QList<CFitMessage>& CFitDecoder::getMessages() const
@@ -23,6 +23,7 @@
 
 #include <QtCore>
 
+class CFitFieldDataState;
 class CFitMessage;
 
 class CFitDecoder final
@@ -36,11 +37,14 @@ public:
     const QList<CFitMessage>& getMessages() const;
 
 private:
+    void decode(const QByteArray& buffer, const QString& fileName);
     void resetSharedData();
     void printDebugInfo();
 
-    // map containing all states for the decoder. Needs to be pointer because decoder state is abstract class
-    QMap<decode_state_e, IFitDecoderState *> stateMap;
+    // all states for the decoder indexed by the state. Needs to be pointer because decoder state is abstract class
+    IFitDecoderState * stateMap[eDecoderStateEnd];
+    /// the field data state again, to decode data records as a whole
+    CFitFieldDataState * fieldDataState;
 
     // shared data passed along the decoder state instances.
     IFitDecoderState::shared_state_data_t data;
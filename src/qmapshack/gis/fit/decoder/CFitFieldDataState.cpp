@@ -26,6 +26,7 @@
 
 void CFitFieldDataState::reset()
 {
+    defMesg = nullptr;
     fieldDataIndex = 0;
     fieldIndex = 0;
     devFieldIndex = 0;
@@ -35,45 +36,116 @@ void CFitFieldDataState::reset()
 decode_state_e CFitFieldDataState::process(quint8 &dataByte)
 {
     CFitMessage& mesg = *latestMessage();
-    CFitDefinitionMessage* defMesg = definition(mesg.getLocalMesgNr());
+    if(defMesg == nullptr)
+    {
+        // the definition does not change while the message is read
+        defMesg = definition(mesg.getLocalMesgNr());
+    }
 
     // add the read byte to the data array
     fieldData[fieldDataIndex++] = dataByte;
 
-    handleFitField();
+    handleFitField(mesg, *defMesg);
     bool allFieldRead =  fieldIndex >= defMesg->getNrOfFields();
     if(allFieldRead)
     {
-        handleDevField();
+        handleDevField(mesg, *defMesg);
     }
     bool allDevFielRead = devFieldIndex >= defMesg->getNrOfDevFields();
 
     if (allFieldRead && allDevFielRead)
     {
-        // Now that the entire message is decoded we may evaluate subfields and expand components
-        CFitFieldBuilder::evaluateSubfieldsAndExpandComponents(mesg);
-
-        devProfile(mesg);
-
-        reset();
-        FITDEBUG(2, qDebug() << mesg.messageInfo())
-        // after all fields read, go to next record header
-        return eDecoderStateRecord;
+        return endOfMessage(mesg);
     }
 
     // there are more fields to read for the current message
     return eDecoderStateFieldData;
 }
 
-
-bool CFitFieldDataState::handleFitField()
+bool CFitFieldDataState::processRecord(const quint8 *& ptr, const quint8 * end, decode_state_e& state)
 {
+    if(defMesg != nullptr || bytesLeftToRead() <= 2)
+    {
+        // the record has been started byte by byte already
+        return false;
+    }
+
     CFitMessage& mesg = *latestMessage();
-    CFitDefinitionMessage* defMesg = definition(mesg.getLocalMesgNr());
+    const CFitDefinitionMessage& def = *definition(mesg.getLocalMesgNr());
+
+    // The byte by byte decoding consumes one byte for a field of size 0. Leave
+    // such odd records to it, to keep the result the same.
+    quint32 size = 0;
+    for(quint8 i = 0; i < def.getNrOfFields(); i++)
+    {
+        const quint8 fieldSize = def.getFieldByIndex(i).getSize();
+        if(fieldSize == 0)
+        {
+            return false;
+        }
+        size += fieldSize;
+    }
+    for(quint8 i = 0; i < def.getNrOfDevFields(); i++)
+    {
+        const quint8 fieldSize = def.getDevFieldByIndex(i).getSize();
+        if(fieldSize == 0)
+        {
+            return false;
+        }
+        size += fieldSize;
+    }
 
-    if (fieldIndex < defMesg->getNrOfFields())
+    // the last 2 bytes of the file are the CRC
+    if(size == 0 || size > quint32(end - ptr) || size > bytesLeftToRead() - 2)
     {
-        const CFitFieldDefinition& fieldDef = defMesg->getFieldByIndex(fieldIndex);
+        return false;
+    }
+
+    consumeBytes(ptr, size);
+
+    for(quint8 i = 0; i < def.getNrOfFields(); i++)
+    {
+        fieldDataIndex = def.getFieldByIndex(i).getSize();
+        memcpy(fieldData, ptr, fieldDataIndex);
+        ptr += fieldDataIndex;
+        handleFitField(mesg, def);
+    }
+    for(quint8 i = 0; i < def.getNrOfDevFields(); i++)
+    {
+        fieldDataIndex = def.getDevFieldByIndex(i).getSize();
+        memcpy(fieldData, ptr, fieldDataIndex);
+        ptr += fieldDataIndex;
+        handleDevField(mesg, def);
+    }
+
+    state = endOfMessage(mesg);
+    if(bytesLeftToRead() == 2)
+    {
+        // end of file, 2 bytes left, this is the crc
+        state = eDecoderStateFileCrc;
+    }
+    return true;
+}
+
+decode_state_e CFitFieldDataState::endOfMessage(CFitMessage& mesg)
+{
+    // Now that the entire message is decoded we may evaluate subfields and expand components
+    CFitFieldBuilder::evaluateSubfieldsAndExpandComponents(mesg);
+
+    devProfile(mesg);
+
+    reset();
+    FITDEBUG(2, qDebug() << mesg.messageInfo())
+    // after all fields read, go to next record header
+    return eDecoderStateRecord;
+}
+
+
+bool CFitFieldDataState::handleFitField(CFitMessage& mesg, const CFitDefinitionMessage& defMesg)
+{
+    if (fieldIndex < defMesg.getNrOfFields())
+    {
+        const CFitFieldDefinition& fieldDef = defMesg.getFieldByIndex(fieldIndex);
         if (fieldDataIndex >= fieldDef.getSize())
         {
             // all bytes are read for current field
@@ -94,17 +166,14 @@ bool CFitFieldDataState::handleFitField()
             fieldIndex++;
         }
     }
-    return fieldIndex >= defMesg->getNrOfFields();
+    return fieldIndex >= defMesg.getNrOfFields();
 }
 
-bool CFitFieldDataState::handleDevField()
+bool CFitFieldDataState::handleDevField(CFitMessage& mesg, const CFitDefinitionMessage& defMesg)
 {
-    CFitMessage& mesg = *latestMessage();
-    CFitDefinitionMessage* defMesg = definition(mesg.getLocalMesgNr());
-
-    if (devFieldIndex < defMesg->getNrOfDevFields())
+    if (devFieldIndex < defMesg.getNrOfDevFields())
     {
-        const CFitFieldDefinition& fieldDef = defMesg->getDevFieldByIndex(devFieldIndex);
+        const CFitFieldDefinition& fieldDef = defMesg.getDevFieldByIndex(devFieldIndex);
         if (fieldDataIndex >= fieldDef.getSize())
         {
             // handling developer data for mapping the field data to its definitions:
@@ -124,7 +193,7 @@ bool CFitFieldDataState::handleDevField()
             devFieldIndex++;
         }
     }
-    return devFieldIndex >= defMesg->getNrOfDevFields();
+    return devFieldIndex >= defMesg.getNrOfDevFields();
 }
 
 void CFitFieldDataState::devProfile(CFitMessage& mesg)
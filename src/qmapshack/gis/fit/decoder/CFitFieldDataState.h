@@ -32,12 +32,30 @@ public:
     void reset() override;
     decode_state_e process(quint8 &dataByte) override;
 
+    /**
+       @brief Decode a whole data record at once
+
+       This is the fast path for the common case. It is taken if the record has
+       not been started byte by byte yet, and all of its bytes are in the buffer
+       in front of the file's CRC. Otherwise nothing is consumed and the record
+       has to be decoded byte by byte with processByte().
+
+       @param ptr       the first byte of the record, advanced past the record on success
+       @param end       the end of the buffer
+       @param state     set to the next decoder state on success
+       @return True if the record has been decoded.
+     */
+    bool processRecord(const quint8 *& ptr, const quint8 * end, decode_state_e& state);
+
 private:
-    bool handleFitField();
-    bool handleDevField();
+    decode_state_e endOfMessage(CFitMessage& mesg);
+    bool handleFitField(CFitMessage& mesg, const CFitDefinitionMessage& defMesg);
+    bool handleDevField(CFitMessage& mesg, const CFitDefinitionMessage& defMesg);
     void devProfile(CFitMessage& mesg);
     CFitFieldProfile buildDevFieldProfile(CFitMessage& mesg);
 
+    /// the definition of the message currently read, nullptr at the start of a message
+    CFitDefinitionMessage * defMesg;
     quint8 fieldIndex;
     quint8 devFieldIndex;
     quint8 fieldDataIndex;
@@ -115,6 +115,15 @@ void IFitDecoderState::incFileBytesRead()
     data.fileBytesRead++;
 }
 
+void IFitDecoderState::consumeBytes(const quint8 * bytes, quint32 size)
+{
+    for(quint32 i = 0; i < size; i++)
+    {
+        buildCrc(bytes[i]);
+    }
+    data.fileBytesRead += size;
+}
+
 void IFitDecoderState::addDevFieldProfile(const CFitFieldProfile &fieldProfile)
 {
     // for documentation: a development field definition is linked to an developer data ID. Only the tuple developer data index
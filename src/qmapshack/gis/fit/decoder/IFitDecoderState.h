@@ -72,6 +72,7 @@ protected:
     void setFileLength(quint32 fileLength);
     void resetFileBytesRead();
     void incFileBytesRead();
+    void consumeBytes(const quint8 * bytes, quint32 size);
     quint32 bytesLeftToRead();
 
     CFitDefinitionMessage* latestDefinition() const { return data.lastDefinition; }
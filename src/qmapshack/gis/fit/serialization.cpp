@@ -102,7 +102,7 @@ static bool readFitRecord(const CFitMessage &mesg, CTrackData::trkpt_t &pt)
 
         readKnownExtensions(pt.extensions, mesg);
 
-        pt.extensions.squeeze();
+        pt.squeezeExtensions();
         return true;
     }
     return false;
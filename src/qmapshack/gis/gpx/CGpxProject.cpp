@@ -33,6 +33,83 @@
 
 #include <QtWidgets>
 
+/**
+   @brief Read an element and all its children from the stream into a DOM element
+
+   The reader has to be at the start of the element. On return it is at
+   the element's end. Whitespace-only text is dropped, just like
+   QDomDocument::setContent() does.
+
+   @param in    the XML stream
+   @param doc   the document owning the new element
+   @return The element, not yet inserted in the document.
+ */
+static QDomElement readElement(QXmlStreamReader& in, QDomDocument& doc)
+{
+    auto createElement = [&]()
+    {
+        QDomElement elem = doc.createElement(in.qualifiedName().toString());
+        for(const QXmlStreamAttribute& att : in.attributes())
+        {
+            elem.setAttribute(att.qualifiedName().toString(), att.value().toString());
+        }
+        return elem;
+    };
+
+    QDomElement root = createElement();
+    QDomNode parent  = root;
+    int depth = 1;
+    while(depth > 0 && !in.atEnd())
+    {
+        switch(in.readNext())
+        {
+        case QXmlStreamReader::StartElement:
+            parent = parent.appendChild(createElement());
+            ++depth;
+            break;
+
+        case QXmlStreamReader::EndElement:
+            parent = parent.parentNode();
+            --depth;
+            break;
+
+        case QXmlStreamReader::Characters:
+        {
+            if(in.isCDATA())
+            {
+                parent.appendChild(doc.createCDATASection(in.text().toString()));
+                break;
+            }
+
+            // the reader might split text at entities, keep it a single node
+            QDomNode last = parent.lastChild();
+            if(last.isText() && !last.isCDATASection())
+            {
+                last.toText().appendData(in.text().toString());
+            }
+            else if(!in.isWhitespace())
+            {
+                parent.appendChild(doc.createTextNode(in.text().toString()));
+            }
+            break;
+        }
+
+        case QXmlStreamReader::Comment:
+            parent.appendChild(doc.createComment(in.text().toString()));
+            break;
+
+        case QXmlStreamReader::ProcessingInstruction:
+            parent.appendChild(doc.createProcessingInstruction(in.processingInstructionTarget().toString(), in.processingInstructionData().toString()));
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return root;
+}
+
 CGpxProject::CGpxProject(const QString &filename, CGisListWks *parent)
     : IGisProject(eTypeGpx, filename, parent)
 {
@@ -114,49 +191,148 @@ void CGpxProject::loadGpx(const QString &filename, CGpxProject *project)
     }
 
 
-    // load file content to xml document
-    QDomDocument xml;
-    QString msg;
-    int line;
-    int column;
-    if(!xml.setContent(&file, false, &msg, &line, &column))
+    /*
+        The file is streamed in a single pass instead of loading it into a
+        QDomDocument as a whole. The track points, by far the largest part
+        of a file, are read from the stream directly into the track's
+        segments (see CGisItemTrk::readTrkseg()). Everything else is small.
+        It is read into DOM elements to use the readers in
+        gis/gpx/serialization.cpp.
+
+        The project's extensions with its key and settings come last in a
+        GPX file. But they are needed before any item is created. Thus the
+        items are created once the whole file has been read.
+     */
+    QXmlStreamReader in(&file);
+    in.setNamespaceProcessing(false);
+
+    auto throwError = [&]()
     {
         file.close();
-        throw tr("Failed to read: %1\nline %2, column %3:\n %4").arg(filename).arg(line).arg(column).arg(msg);
+        throw tr("Failed to read: %1\nline %2, column %3:\n %4").arg(filename).arg(in.lineNumber()).arg(in.columnNumber()).arg(in.errorString());
+    };
+
+    if(!in.readNextStartElement())
+    {
+        throwError();
     }
-    file.close();
 
-    int N;
-    QDomElement xmlGpx = xml.documentElement();
-    if(xmlGpx.tagName() != "gpx")
+    if(in.qualifiedName() != "gpx")
     {
+        file.close();
         throw tr("Not a GPX file: %1").arg(filename);
     }
 
     // Read all attributes and find any registrations for actually known extensions.
     // This is used to properly detect valid .gpx files using uncommon namespaces.
-    QDomNamedNodeMap attributes = xmlGpx.attributes();
-    for(int i = 0; i < attributes.size(); ++i)
+    const QString xmlns("xmlns");
+    QList<QPair<QString, QString> > namespaces;
+    for(const QXmlStreamAttribute& att : in.attributes())
     {
-        const QString xmlns("xmlns");
-        QDomAttr att = attributes.item(i).toAttr();
+        const QString& name = att.qualifiedName().toString();
+        if(name.startsWith(xmlns + ":"))
+        {
+            namespaces << qMakePair(name.mid(xmlns.length() + 1), att.value().toString());
+        }
+    }
+    for(const QXmlStreamNamespaceDeclaration& decl : in.namespaceDeclarations())
+    {
+        namespaces << qMakePair(decl.prefix().toString(), decl.namespaceUri().toString());
+    }
 
-        if(att.name().startsWith(xmlns + ":"))
+    for(const QPair<QString, QString>& ns : namespaces)
+    {
+        if(ns.second == gpxtpx_ns)
+        {
+            CKnownExtension::initGarminTPXv1(IUnit::self(), ns.first);
+        }
+        else if(ns.second == gpxdata_ns)
         {
-            QString ns = att.name().mid(xmlns.length() + 1);
+            CKnownExtension::initClueTrustTPXv1(IUnit::self(), ns.first);
+        }
+    }
 
-            if(att.value() == gpxtpx_ns)
+    struct trk_t
+    {
+        QDomElement xml;
+        QVector<CTrackData::trkseg_t> segs;
+    };
+
+    QDomDocument xml;
+    QDomElement xmlMetadata;
+    QDomElement xmlExtension;
+    QList<trk_t> xmlTrks;
+    QList<QDomElement> xmlRtes;
+    QList<QDomElement> xmlWpts;
+
+    // items are searched in all elements but the ones read, like elementsByTagName() of the root did
+    int depth = 0;
+    while(!in.atEnd())
+    {
+        const QXmlStreamReader::TokenType token = in.readNext();
+        if(token == QXmlStreamReader::EndElement)
+        {
+            if(depth-- == 0)
             {
-                CKnownExtension::initGarminTPXv1(IUnit::self(), ns);
+                // end of <gpx>
+                break;
             }
-            else if(att.value() == gpxdata_ns)
+            continue;
+        }
+
+        if(token != QXmlStreamReader::StartElement)
+        {
+            continue;
+        }
+
+        const QStringRef& name = in.qualifiedName();
+        if(name == "trk")
+        {
+            xmlTrks << trk_t();
+            trk_t& trk = xmlTrks.last();
+
+            trk.xml = xml.createElement(name.toString());
+            while(in.readNextStartElement())
             {
-                CKnownExtension::initClueTrustTPXv1(IUnit::self(), ns);
+                if(in.qualifiedName() == "trkseg")
+                {
+                    trk.segs << CTrackData::trkseg_t();
+                    CGisItemTrk::readTrkseg(in, trk.segs.last());
+                }
+                else
+                {
+                    trk.xml.appendChild(readElement(in, xml));
+                }
             }
         }
+        else if(name == "rte")
+        {
+            xmlRtes << readElement(in, xml);
+        }
+        else if(name == "wpt")
+        {
+            xmlWpts << readElement(in, xml);
+        }
+        else if(name == "metadata" && depth == 0 && xmlMetadata.isNull())
+        {
+            xmlMetadata = readElement(in, xml);
+        }
+        else if(name == "extensions" && depth == 0 && xmlExtension.isNull())
+        {
+            xmlExtension = readElement(in, xml);
+        }
+        else
+        {
+            ++depth;
+        }
     }
 
-    const QDomElement& xmlExtension = xmlGpx.namedItem("extensions").toElement();
+    if(in.hasError())
+    {
+        throwError();
+    }
+    file.close();
+
     if(xmlExtension.namedItem("ql:key").isElement())
     {
         project->key = xmlExtension.namedItem("ql:key").toElement().text();
@@ -182,37 +358,27 @@ void CGpxProject::loadGpx(const QString &filename, CGpxProject *project)
         project->invalidDataOk = bool(xmlExtension.namedItem("ql:invalidDataOk").toElement().text().toInt() != 0);
     }
 
-    const QDomNode& xmlMetadata = xmlGpx.namedItem("metadata");
     if(xmlMetadata.isElement())
     {
         project->readMetadata(xmlMetadata, project->metadata);
     }
 
-
     /** @note   If you change the order of the item types read you have to
                 take care of the order enforced in IGisItem().
      */
-    const QDomNodeList& xmlTrks = xmlGpx.elementsByTagName("trk");
-    N = xmlTrks.count();
-    for(int n = 0; n < N; ++n)
+    while(!xmlTrks.isEmpty())
     {
-        const QDomNode& xmlTrk = xmlTrks.item(n);
-        new CGisItemTrk(xmlTrk, project);
+        trk_t trk = xmlTrks.takeFirst();
+        new CGisItemTrk(trk.xml, trk.segs, project);
     }
 
-    const QDomNodeList& xmlRtes = xmlGpx.elementsByTagName("rte");
-    N = xmlRtes.count();
-    for(int n = 0; n < N; ++n)
+    for(const QDomElement& xmlRte : xmlRtes)
     {
-        const QDomNode& xmlRte = xmlRtes.item(n);
         new CGisItemRte(xmlRte, project);
     }
 
-    const QDomNodeList& xmlWpts = xmlGpx.elementsByTagName("wpt");
-    N = xmlWpts.count();
-    for(int n = 0; n < N; ++n)
+    for(const QDomElement& xmlWpt : xmlWpts)
     {
-        const QDomNode& xmlWpt = xmlWpts.item(n);
         CGisItemWpt * wpt = new CGisItemWpt(xmlWpt, project);
 
         /*
@@ -228,7 +394,7 @@ void CGpxProject::loadGpx(const QString &filename, CGpxProject *project)
     }
 
     const QDomNodeList& xmlAreas = xmlExtension.elementsByTagName("ql:area");
-    N = xmlAreas.count();
+    const int N = xmlAreas.count();
     for(int n = 0; n < N; ++n)
     {
         const QDomNode& xmlArea = xmlAreas.item(n);
@@ -42,78 +42,79 @@ const QString IGisProject::tp1_ns    = "http://www.garmin.com/xmlschemas/TrackPo
 const QString IGisProject::gpxdata_ns = "http://www.cluetrust.com/XML/GPXDATA/1/0";
 
 
-static void readXml(const QDomNode& xml, const QString& tag, qint32& value)
+static void fromText(const QString& text, qint32& value)
 {
-    if(xml.namedItem(tag).isElement())
+    bool ok = false;
+    qint32 tmp = text.toInt(&ok);
+    if(!ok)
     {
-        bool ok = false;
-        qint32 tmp = xml.namedItem(tag).toElement().text().toInt(&ok);
-        if(!ok)
-        {
-            tmp = qRound(xml.namedItem(tag).toElement().text().toDouble(&ok));
-        }
-        if(ok)
-        {
-            value = tmp;
-        }
+        tmp = qRound(text.toDouble(&ok));
+    }
+    if(ok)
+    {
+        value = tmp;
     }
 }
 
-static void readXml(const QDomNode& xml, const QString& tag, trkact_t& value)
+static void fromText(const QString& text, trkact_t& value)
 {
-    if(xml.namedItem(tag).isElement())
+    bool ok = false;
+    qint32 tmp = text.toInt(&ok);
+    if(!ok)
     {
-        bool ok = false;
-        qint32 tmp = xml.namedItem(tag).toElement().text().toInt(&ok);
-        if(!ok)
-        {
-            value = CTrackData::trkpt_t::eAct20None;
-        }
-        else
-        {
-            value = trkact_t(tmp);
-        }
+        value = CTrackData::trkpt_t::eAct20None;
+    }
+    else
+    {
+        value = trkact_t(tmp);
     }
 }
 
-
 template<typename T>
-static void readXml(const QDomNode& xml, const QString& tag, T& value)
+static void fromText(const QString& text, T& value)
 {
-    if(xml.namedItem(tag).isElement())
-    {
-        bool ok = false;
-        T tmp;
+    bool ok = false;
+    T tmp;
 
-        if(std::is_same<T, quint32>::value)
-        {
-            tmp = xml.namedItem(tag).toElement().text().toUInt(&ok);
-        }
-        else if(std::is_same<T, quint64>::value)
-        {
-            tmp = xml.namedItem(tag).toElement().text().toULongLong(&ok);
-        }
-        else if(std::is_same<T,   qreal>::value)
-        {
-            tmp = xml.namedItem(tag).toElement().text().toDouble(&ok);
-        }
-        else if(std::is_same<T,    bool>::value)
-        {
-            tmp = xml.namedItem(tag).toElement().text().toInt(&ok);
-        }
+    if(std::is_same<T, quint32>::value)
+    {
+        tmp = text.toUInt(&ok);
+    }
+    else if(std::is_same<T, quint64>::value)
+    {
+        tmp = text.toULongLong(&ok);
+    }
+    else if(std::is_same<T,   qreal>::value)
+    {
+        tmp = text.toDouble(&ok);
+    }
+    else if(std::is_same<T,    bool>::value)
+    {
+        tmp = text.toInt(&ok);
+    }
 
-        if(ok)
-        {
-            value = tmp;
-        }
+    if(ok)
+    {
+        value = tmp;
     }
 }
 
-static void readXml(const QDomNode& xml, const QString& tag, QString& value)
+static void fromText(const QString& text, QString& value)
+{
+    value = text;
+}
+
+static void fromText(const QString& text, QDateTime& value)
+{
+    IUnit::parseTimestamp(text, value);
+}
+
+template<typename T>
+static void readXml(const QDomNode& xml, const QString& tag, T& value)
 {
     if(xml.namedItem(tag).isElement())
     {
-        value = xml.namedItem(tag).toElement().text();
+        fromText(xml.namedItem(tag).toElement().text(), value);
     }
 }
 
@@ -127,15 +128,6 @@ static void readXml(const QDomNode& xml, const QString& tag, QString& value, boo
     }
 }
 
-static void readXml(const QDomNode& xml, const QString& tag, QDateTime& value)
-{
-    if(xml.namedItem(tag).isElement())
-    {
-        QString time = xml.namedItem(tag).toElement().text();
-        IUnit::parseTimestamp(time, value);
-    }
-}
-
 static void readXml(const QDomNode& xml, const QString& tag, QList<IGisItem::link_t>& l)
 {
     if(xml.namedItem(tag).isElement())
@@ -356,6 +348,286 @@ static void readXml(const QDomNode& ext, QHash<QString, QVariant>& extensions)
     extensions.squeeze();
 }
 
+/*
+    The stream based readers below are used for track points, as they make up
+    almost all of a GPX file. They have to give exactly the same result as the
+    DOM based readers above. QDomDocument::setContent() drops text nodes made
+    of whitespace only, and QDomElement::text() is the text of all descendants.
+ */
+
+static bool isWhitespace(const QString& text)
+{
+    for(const QChar& c : text)
+    {
+        if(c != ' ' && c != '\t' && c != '\n' && c != '\r')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+   @brief Read the text of the current element like QDomElement::text() would return it
+
+   The reader has to be at the start of the element. On return it is at the element's end.
+
+   @param in    the XML stream
+   @return The text of the element and all its descendants.
+ */
+static QString readText(QXmlStreamReader& in)
+{
+    QString text;
+    QString run;    // the reader might split text at entities, a text node can be several tokens
+    int depth = 1;
+    while(depth > 0 && !in.atEnd())
+    {
+        const QXmlStreamReader::TokenType token = in.readNext();
+        if(token == QXmlStreamReader::Characters && !in.isCDATA())
+        {
+            run += in.text();
+            continue;
+        }
+
+        if(!isWhitespace(run))
+        {
+            text += run;
+        }
+        run.clear();
+
+        switch(token)
+        {
+        case QXmlStreamReader::Characters:
+            text += in.text();
+            break;
+
+        case QXmlStreamReader::StartElement:
+            ++depth;
+            break;
+
+        case QXmlStreamReader::EndElement:
+            --depth;
+            break;
+
+        default:
+            break;
+        }
+    }
+    return text;
+}
+
+/// stream counterpart of readXml(const QDomNode& node, const QString& parentTags, QHash<QString, QVariant>& extensions)
+static void readXml(QXmlStreamReader& in, const QString& parentTags, QHash<QString, QVariant>& extensions)
+{
+    const QStringRef& tag = in.qualifiedName();
+    if(tag.startsWith("ql:flags") || tag.startsWith("ql:activity"))
+    {
+        in.skipCurrentElement();
+        return;
+    }
+
+    const QString& tags = parentTags.isEmpty() ? tag.toString() : parentTags + "|" + tag.toString();
+
+    // find the first child node to decide if the element is a value or a parent of values
+    QString run;
+    while(!in.atEnd())
+    {
+        const QXmlStreamReader::TokenType token = in.readNext();
+        if(token == QXmlStreamReader::Characters && !in.isCDATA())
+        {
+            run += in.text();
+            continue;
+        }
+
+        if(!isWhitespace(run) || token == QXmlStreamReader::Characters)
+        {
+            // the first child is text, take the text of all descendants
+            QString text = isWhitespace(run) ? QString() : run;
+            switch(token)
+            {
+            case QXmlStreamReader::Characters:
+                text += in.text();
+                break;
+
+            case QXmlStreamReader::StartElement:
+                text += readText(in);
+                break;
+
+            case QXmlStreamReader::EndElement:
+                extensions[tags] = text;
+                return;
+
+            default:
+                break;
+            }
+
+            extensions[tags] = text + readText(in);
+            return;
+        }
+
+        switch(token)
+        {
+        case QXmlStreamReader::StartElement:
+            readXml(in, tags, extensions);
+            break;
+
+        case QXmlStreamReader::EndElement:
+            return;
+
+        default:
+            break;
+        }
+
+        // the first child is no text, read all child elements
+        while(in.readNextStartElement())
+        {
+            readXml(in, tags, extensions);
+        }
+        return;
+    }
+}
+
+/// stream counterpart of readXml(const QDomNode& xml, const QString& tag, QList<IGisItem::link_t>& l) for a single link
+static void readXml(QXmlStreamReader& in, IGisItem::link_t& link)
+{
+    link.uri.setUrl(in.attributes().value("href").toString());
+
+    bool hasText = false;
+    bool hasType = false;
+    while(in.readNextStartElement())
+    {
+        if(in.qualifiedName() == "text" && !hasText)
+        {
+            link.text = readText(in);
+            hasText   = true;
+        }
+        else if(in.qualifiedName() == "type" && !hasType)
+        {
+            link.type = readText(in);
+            hasType   = true;
+        }
+        else
+        {
+            in.skipCurrentElement();
+        }
+    }
+}
+
+/// stream counterpart of IGisItem::readWpt() plus the extensions of a track point
+static void readXml(QXmlStreamReader& in, CTrackData::trkpt_t& trkpt)
+{
+    const QXmlStreamAttributes& attr = in.attributes();
+    trkpt.lat = attr.value("lat").toDouble();
+    trkpt.lon = attr.value("lon").toDouble();
+
+    enum tag_e
+    {
+        eTagEle, eTagTime, eTagMagvar, eTagGeoidheight, eTagName, eTagCmt, eTagDesc, eTagSrc
+        , eTagSym, eTagType, eTagFix, eTagSat, eTagHdop, eTagVdop, eTagPdop, eTagAgeofdgpsdata
+        , eTagDgpsid, eTagUrl, eTagUrlname, eTagExtensions, eTagFlags, eTagActivity, eTagMax
+    };
+
+    static const char * const tags[eTagMax] =
+    {
+        "ele", "time", "magvar", "geoidheight", "name", "cmt", "desc", "src"
+        , "sym", "type", "fix", "sat", "hdop", "vdop", "pdop", "ageofdgpsdata"
+        , "dgpsid", "url", "urlname", "extensions"
+    };
+
+    // like QDomNode::namedItem() only the first element of a name is used
+    quint32 found = 0;
+    QString url;
+    QString urlname;
+
+    while(in.readNextStartElement())
+    {
+        const QStringRef& name = in.qualifiedName();
+        if(name == "link")
+        {
+            IGisItem::link_t link;
+            readXml(in, link);
+            trkpt.links << link;
+            continue;
+        }
+
+        int tag = 0;
+        while(tag <= eTagExtensions && name != QLatin1String(tags[tag]))
+        {
+            ++tag;
+        }
+
+        if(tag > eTagExtensions || (found & (1 << tag)))
+        {
+            in.skipCurrentElement();
+            continue;
+        }
+        found |= 1 << tag;
+
+        if(tag == eTagExtensions)
+        {
+            while(in.readNextStartElement())
+            {
+                if(in.qualifiedName() == "ql:flags" && !(found & (1 << eTagFlags)))
+                {
+                    found |= 1 << eTagFlags;
+                    fromText(readText(in), trkpt.flags);
+                }
+                else if(in.qualifiedName() == "ql:activity" && !(found & (1 << eTagActivity)))
+                {
+                    found |= 1 << eTagActivity;
+                    fromText(readText(in), trkpt.activity);
+                }
+                else
+                {
+                    readXml(in, "", trkpt.extensions);
+                }
+            }
+            continue;
+        }
+
+        const QString& text = readText(in);
+        switch(tag)
+        {
+        case eTagEle:           fromText(text, trkpt.ele);           break;
+        case eTagTime:          fromText(text, trkpt.time);          break;
+        case eTagMagvar:        fromText(text, trkpt.magvar);        break;
+        case eTagGeoidheight:   fromText(text, trkpt.geoidheight);   break;
+        case eTagName:          fromText(text, trkpt.name);          break;
+        case eTagCmt:           fromText(text, trkpt.cmt);           break;
+        case eTagDesc:          fromText(text, trkpt.desc);          break;
+        case eTagSrc:           fromText(text, trkpt.src);           break;
+        case eTagSym:           fromText(text, trkpt.sym);           break;
+        case eTagType:          fromText(text, trkpt.type);          break;
+        case eTagFix:           fromText(text, trkpt.fix);           break;
+        case eTagSat:           fromText(text, trkpt.sat);           break;
+        case eTagHdop:          fromText(text, trkpt.hdop);          break;
+        case eTagVdop:          fromText(text, trkpt.vdop);          break;
+        case eTagPdop:          fromText(text, trkpt.pdop);          break;
+        case eTagAgeofdgpsdata: fromText(text, trkpt.ageofdgpsdata); break;
+        case eTagDgpsid:        fromText(text, trkpt.dgpsid);        break;
+        case eTagUrl:           url = text;                          break;
+        case eTagUrlname:       urlname = text;                      break;
+        }
+    }
+
+    // some GPX 1.0 backward compatibility
+    if(!url.isEmpty())
+    {
+        IGisItem::link_t link;
+        link.uri.setUrl(url);
+        link.text = urlname;
+
+        trkpt.links << link;
+    }
+
+    if(found & (1 << eTagExtensions))
+    {
+        trkpt.sanitizeFlags();
+        trkpt.extensions.squeeze();
+        trkpt.squeezeExtensions();
+    }
+}
+
 static void writeXml(QDomNode& ext, const QHash<QString, QVariant>& extensions)
 {
     if(extensions.isEmpty())
@@ -795,9 +1067,13 @@ void CGisItemTrk::readTrk(const QDomNode& xml, CTrackData& trk)
     readXml(xml, "number", trk.number);
     readXml(xml, "type",   trk.type);
 
+    // the segments might have been streamed already, see CGpxProject::loadGpx()
     const QDomNodeList& trksegs = xml.toElement().elementsByTagName("trkseg");
     int N = trksegs.count();
-    trk.segs.resize(N);
+    if(N != 0)
+    {
+        trk.segs.resize(N);
+    }
     for(int n = 0; n < N; ++n)
     {
         const QDomNode& trkseg = trksegs.item(n);
@@ -819,6 +1095,7 @@ void CGisItemTrk::readTrk(const QDomNode& xml, CTrackData& trk)
                 readXml(ext, "ql:activity", trkpt.activity);
                 trkpt.sanitizeFlags();
                 readXml(ext, trkpt.extensions);
+                trkpt.squeezeExtensions();
             }
         }
     }
@@ -839,7 +1116,22 @@ void CGisItemTrk::readTrk(const QDomNode& xml, CTrackData& trk)
     deriveSecondaryData();
 }
 
-
+void CGisItemTrk::readTrkseg(QXmlStreamReader& in, CTrackData::trkseg_t& seg)
+{
+    while(in.readNextStartElement())
+    {
+        if(in.qualifiedName() == "trkpt")
+        {
+            seg.pts.append(CTrackData::trkpt_t());
+            readXml(in, seg.pts.last());
+        }
+        else
+        {
+            in.skipCurrentElement();
+        }
+    }
+    seg.pts.squeeze();
+}
 
 void CGisItemTrk::save(QDomNode& gpx, bool strictGpx11)
 {
@@ -106,6 +106,12 @@ CGisItemOvlArea::CGisItemOvlArea(quint64 id, QSqlDatabase& db, IGisProject * pro
     loadFromDb(id, db);
 }
 
+CGisItemOvlArea::CGisItemOvlArea(const dbitem_t& dbItem, IGisProject * project)
+    : IGisItem(project, eTypeOvl, NOIDX)
+{
+    loadFromDb(dbItem);
+}
+
 CGisItemOvlArea::~CGisItemOvlArea()
 {
     // reset user focus if focused on this track
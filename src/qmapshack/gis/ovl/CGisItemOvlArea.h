@@ -42,6 +42,7 @@ public:
     CGisItemOvlArea(const QDomNode &xml, IGisProject *project);
     CGisItemOvlArea(const history_t& hist, const QString& dbHash, IGisProject * project);
     CGisItemOvlArea(quint64 id, QSqlDatabase& db, IGisProject * project);
+    CGisItemOvlArea(const dbitem_t& dbItem, IGisProject * project);
     CGisItemOvlArea(const IQlgtOverlay& ovl, IGisProject *project = nullptr);
     virtual ~CGisItemOvlArea();
 
@@ -375,8 +375,17 @@ void IGisProject::updateItems()
     changedRoadbookMode = false;
 
 
-    quint32 total   = cntTrkPts * cntWpts;
+    // the same as findWaypointsCloseBy() advances the progress by
+    quint32 total   = 0;
     quint32 current = 0;
+    for(int i = 0; i < childCount(); i++)
+    {
+        CGisItemTrk * trk = dynamic_cast<CGisItemTrk*>(child(i));
+        if(trk)
+        {
+            total += trk->getNumberOfVisiblePoints() + cntWpts;
+        }
+    }
 
     PROGRESS_SETUP(tr("%1: Correlate tracks and waypoints.").arg(getName()), 0, total, CMainWindow::getBestWidgetForParent());
 
@@ -113,6 +113,41 @@ public:
         QMap<QString, QVariant> extensions;
     };
 
+    /**
+       @brief A copy of all data written by operator>>()
+
+       Taking a snapshot is cheap as the items' history is implicitly shared.
+       Once taken it is not changed by the project anymore. Thus it can be
+       serialized by another thread.
+     */
+    struct snapshot_t
+    {
+        struct item_t
+        {
+            quint8 type = 0;
+            IGisItem::history_t history;
+            quint8 changed = 0;
+            QString lastDatabaseHash;
+        };
+
+        QString filename;
+        metadata_t metadata;
+        QString key;
+        qint32 sortingRoadbook = 0;
+        qint8 flags = 0;
+        qint32 sortingFolder = 0;
+        /// all items sorted by type: tracks, routes, waypoints, areas
+        QList<item_t> items;
+
+        /**
+           @brief Get a hash over the snapshot's state
+
+           Instead of the items' complete data only their current history
+           event is used. Thus this is much cheaper than serializing the snapshot.
+         */
+        QByteArray fingerprint() const;
+    };
+
     static const QString filedialogAllSupported;
     static const QString filedialogFilterGPX;
     static const QString filedialogFilterTCX;
@@ -478,6 +513,12 @@ public:
      */
     virtual QDataStream& operator>>(QDataStream& stream) const;
 
+    /// take a snapshot of the data written by operator>>()
+    snapshot_t getSnapshot() const;
+
+    /// serialize a snapshot the same way operator>>() serializes the project
+    static QDataStream& writeSnapshot(QDataStream& stream, const snapshot_t& snapshot);
+
     /**
        @brief writeMetadata
        @param doc
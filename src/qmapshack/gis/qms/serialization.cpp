@@ -58,6 +58,8 @@
 #define MAGIC_AREA      "QMArea    "
 #define MAGIC_PROJ      "QMProj    "
 
+const int IGisItem::sizeSerializedHeader = MAGIC_SIZE + sizeof(VER_TRK);
+
 
 QDataStream& operator<<(QDataStream& stream, const IGisItem::link_t& link)
 {
@@ -164,7 +166,23 @@ QDataStream& operator<<(QDataStream& stream, const IGisItem::history_t& h)
     stream << VER_HIST;
     stream << h.histIdxInitial;
     stream << h.histIdxCurrent;
-    stream << h.events;
+
+    // same as streaming the list, but with the complete data of each event
+    stream << quint32(h.events.size());
+    for(int i = 0; i < h.events.size(); i++)
+    {
+        const IGisItem::history_event_t& event = h.events[i];
+        if(event.isDelta)
+        {
+            IGisItem::history_event_t tmp = event;
+            tmp.data = h.getData(i);
+            stream << tmp;
+        }
+        else
+        {
+            stream << event;
+        }
+    }
     return stream;
 }
 
@@ -377,6 +395,7 @@ QDataStream& operator>>(QDataStream& stream, CTrackData::trkpt_t& pt)
     if(version > 1)
     {
         stream >> pt.extensions;
+        pt.squeezeExtensions();
     }
 
     if(version > 2)
@@ -597,6 +616,8 @@ QDataStream& CGisItemTrk::operator<<(QDataStream& stream)
     }
 
     resetMouseRange();
+    // the track points are replaced, including the attached waypoints
+    keyCorrelation.clear();
 
     stream >> version;
     stream >> buffer;
@@ -1061,77 +1082,102 @@ QDataStream& IGisProject::operator<<(QDataStream& stream)
 
 QDataStream& IGisProject::operator>>(QDataStream& stream) const
 {
-    stream.writeRawData(MAGIC_PROJ, MAGIC_SIZE);
-    stream << VER_PROJECT;
-
-    stream << filename;
-    stream << metadata.name;
-    stream << metadata.desc;
-    stream << metadata.author;
-    stream << metadata.copyright;
-    stream << metadata.links;
-    stream << metadata.time;
-    stream << metadata.keywords;
-    stream << metadata.bounds;
-    stream << key;
-    stream << qint32(sortingRoadbook);
-    stream << qint8((noCorrelation ? eFlagNoCorrelation : 0) | (autoSave ? eFlagAutoSave : 0) | (invalidDataOk ? eFlagInvalidDataOk : 0)); // collect trivial flags in one field.
-    stream << qint32(sortingFolder);
+    return writeSnapshot(stream, getSnapshot());
+}
 
-    for(int i = 0; i < childCount(); i++)
-    {
-        CGisItemTrk * item = dynamic_cast<CGisItemTrk*>(child(i));
-        if(nullptr == item)
-        {
-            continue;
-        }
-        stream << VER_ITEM;
-        stream << quint8(item->type());
-        stream << item->getHistory();
-        stream << quint8(item->data(1, Qt::UserRole).toUInt() & IGisItem::eMarkChanged);
-        stream << item->getLastDatabaseHash();
-    }
-    for(int i = 0; i < childCount(); i++)
+IGisProject::snapshot_t IGisProject::getSnapshot() const
+{
+    snapshot_t snapshot;
+    snapshot.filename           = filename;
+    snapshot.metadata           = metadata;
+    snapshot.key                = key;
+    snapshot.sortingRoadbook    = qint32(sortingRoadbook);
+    snapshot.flags              = qint8((noCorrelation ? eFlagNoCorrelation : 0) | (autoSave ? eFlagAutoSave : 0) | (invalidDataOk ? eFlagInvalidDataOk : 0)); // collect trivial flags in one field.
+    snapshot.sortingFolder      = qint32(sortingFolder);
+
+    const IGisItem::type_e types[] = {IGisItem::eTypeTrk, IGisItem::eTypeRte, IGisItem::eTypeWpt, IGisItem::eTypeOvl};
+    for(IGisItem::type_e type : types)
     {
-        CGisItemRte * item = dynamic_cast<CGisItemRte*>(child(i));
-        if(nullptr == item)
+        for(int i = 0; i < childCount(); i++)
         {
-            continue;
+            IGisItem * item = dynamic_cast<IGisItem*>(child(i));
+            if((nullptr == item) || (item->type() != type))
+            {
+                continue;
+            }
+
+            snapshot_t::item_t snap;
+            snap.type               = quint8(item->type());
+            snap.history            = item->getHistory();
+            snap.changed            = quint8(item->data(1, Qt::UserRole).toUInt() & IGisItem::eMarkChanged);
+            snap.lastDatabaseHash   = item->getLastDatabaseHash();
+            snapshot.items << snap;
         }
-        stream << VER_ITEM;
-        stream << quint8(item->type());
-        stream << item->getHistory();
-        stream << quint8(item->data(1, Qt::UserRole).toUInt() & IGisItem::eMarkChanged);
-        stream << item->getLastDatabaseHash();
     }
-    for(int i = 0; i < childCount(); i++)
+
+    return snapshot;
+}
+
+static void writeSnapshotHeader(QDataStream& stream, const IGisProject::snapshot_t& snapshot)
+{
+    stream.writeRawData(MAGIC_PROJ, MAGIC_SIZE);
+    stream << VER_PROJECT;
+
+    stream << snapshot.filename;
+    stream << snapshot.metadata.name;
+    stream << snapshot.metadata.desc;
+    stream << snapshot.metadata.author;
+    stream << snapshot.metadata.copyright;
+    stream << snapshot.metadata.links;
+    stream << snapshot.metadata.time;
+    stream << snapshot.metadata.keywords;
+    stream << snapshot.metadata.bounds;
+    stream << snapshot.key;
+    stream << snapshot.sortingRoadbook;
+    stream << snapshot.flags;
+    stream << snapshot.sortingFolder;
+}
+
+QDataStream& IGisProject::writeSnapshot(QDataStream& stream, const snapshot_t& snapshot)
+{
+    writeSnapshotHeader(stream, snapshot);
+
+    for(const snapshot_t::item_t& item : snapshot.items)
     {
-        CGisItemWpt * item = dynamic_cast<CGisItemWpt*>(child(i));
-        if(nullptr == item)
-        {
-            continue;
-        }
         stream << VER_ITEM;
-        stream << quint8(item->type());
-        stream << item->getHistory();
-        stream << quint8(item->data(1, Qt::UserRole).toUInt() & IGisItem::eMarkChanged);
-        stream << item->getLastDatabaseHash();
+        stream << item.type;
+        stream << item.history;
+        stream << item.changed;
+        stream << item.lastDatabaseHash;
     }
-    for(int i = 0; i < childCount(); i++)
+
+    return stream;
+}
+
+QByteArray IGisProject::snapshot_t::fingerprint() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_2);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    writeSnapshotHeader(stream, *this);
+
+    for(const item_t& item : items)
     {
-        CGisItemOvlArea * item = dynamic_cast<CGisItemOvlArea*>(child(i));
-        if(nullptr == item)
+        const IGisItem::history_t& history = item.history;
+        stream << item.type;
+        stream << history.histIdxCurrent;
+        stream << qint32(history.events.size());
+        if((history.histIdxCurrent >= 0) && (history.histIdxCurrent < history.events.size()))
         {
-            continue;
+            stream << history.events[history.histIdxCurrent].hash;
         }
-        stream << VER_ITEM;
-        stream << quint8(item->type());
-        stream << item->getHistory();
-        stream << quint8(item->data(1, Qt::UserRole).toUInt() & IGisItem::eMarkChanged);
-        stream << item->getLastDatabaseHash();
+        stream << item.changed;
+        stream << item.lastDatabaseHash;
     }
 
-    return stream;
+    return QCryptographicHash::hash(data, QCryptographicHash::Md5);
 }
 
 QDataStream& CDBProject::operator<<(QDataStream& stream)
@@ -121,6 +121,12 @@ CGisItemRte::CGisItemRte(quint64 id, QSqlDatabase& db, IGisProject * project)
     loadFromDb(id, db);
 }
 
+CGisItemRte::CGisItemRte(const dbitem_t& dbItem, IGisProject * project)
+    : IGisItem(project, eTypeRte, NOIDX)
+{
+    loadFromDb(dbItem);
+}
+
 CGisItemRte::CGisItemRte(const SGisLine &l, const QString &name, IGisProject *project, int idx)
     : IGisItem(project, eTypeRte, idx)
 {
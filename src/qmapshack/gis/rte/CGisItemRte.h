@@ -113,6 +113,7 @@ public:
     CGisItemRte(const CGisItemRte& parentRte, IGisProject *project, int idx, bool clone);
     CGisItemRte(const history_t& hist, const QString& dbHash, IGisProject * project);
     CGisItemRte(quint64 id, QSqlDatabase& db, IGisProject * project);
+    CGisItemRte(const dbitem_t& dbItem, IGisProject * project);
     CGisItemRte(const CQlgtRoute& rte1, IGisProject *project = nullptr);
     CGisItemRte(const SGisLine& l, const QString &name, IGisProject *project, int idx);
     CGisItemRte(CFitStream& stream, IGisProject * project);
@@ -256,6 +256,7 @@ void CSlfReader::readEntries(const QDomNode& xml)
                 trkpt.extensions[attrToExt[key]] = attr.namedItem(key).nodeValue().toDouble();
             }
         }
+        trkpt.squeezeExtensions();
 
         const long trainingTime = attr.namedItem("trainingTimeAbsolute").nodeValue().toLong();
         while(trainingTime > laps[lap])
@@ -62,6 +62,7 @@ void ISuuntoProject::fillTrackPointsFromSamples(QList<sample_t> &samplesList, QL
                 ext.func(trkpt, sample[ext.tag]);
             }
         }
+        trkpt.squeezeExtensions();
 
         seg->pts.append(trkpt);
     }
@@ -206,6 +206,7 @@ void CTcxProject::loadActivity(const QDomNode& activityRootNode)
                         trkpt.extensions["gpxtpx:TrackPointExtension|gpxtpx:cad"] = CADElement.firstChild().nodeValue().toDouble();
                     }
 
+                    trkpt.squeezeExtensions();
                     seg->pts.append(trkpt); // 1 TCX lap gives 1 GPX track segment
                 }
             }
@@ -255,6 +256,7 @@ void CTcxProject::loadCourse(const QDomNode& courseRootNode)
                     trkpt.extensions["gpxtpx:TrackPointExtension|gpxtpx:cad"] = CADElement.firstChild().nodeValue().toDouble();
                 }
 
+                trkpt.squeezeExtensions();
                 seg->pts.append(trkpt);
             }
         }
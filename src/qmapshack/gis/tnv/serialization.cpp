@@ -432,6 +432,7 @@ bool CGisItemTrk::readTwoNav(const QString& filename)
             if(N > 13)
             {
                 pt.extensions["gpxtpx:TrackPointExtension|gpxtpx:atemp"] = values[13].toFloat();
+                pt.squeezeExtensions();
             }
 
             if(N > 14)
@@ -469,6 +470,7 @@ bool CGisItemTrk::readTwoNav(const QString& filename)
             if(N > 0)
             {
                 pt.extensions["gpxtpx:TrackPointExtension|gpxtpx:atemp"] = values[0].toFloat() / 10;
+                pt.squeezeExtensions();
             }
             if(N > 1)
             {
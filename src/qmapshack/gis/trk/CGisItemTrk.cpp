@@ -31,10 +31,12 @@
 #include "gis/wpt/CGisItemWpt.h"
 #include "GeoMath.h"
 #include "helpers/CDraw.h"
+#include "helpers/CPackedRTree.h"
 #include "helpers/CProgressDialog.h"
 #include "helpers/CSettings.h"
 #include "misc.h"
 
+#include <algorithm>
 #include <proj_api.h>
 #include <QtWidgets>
 #include <QtXml>
@@ -46,6 +48,19 @@
 #define WPT_FOCUS_DIST_IN   (50 * 50)
 #define WPT_FOCUS_DIST_OUT  (200 * 200)
 
+/// the number of points of a line_rad_t chunk
+#define LINE_CHUNK_SIZE     128
+/// the margin around the viewport for culling chunks [px]
+#define LINE_CULL_MARGIN    20
+/// the Douglas-Peucker tolerance of the first level of detail [rad], about 0.6m
+#define LOD_MIN_TOLERANCE   1e-7
+/// the maximum number of levels of detail, each with a 4 times larger tolerance
+#define LOD_MAX_LEVELS      8
+/// lines with less points are not simplified any further
+#define LOD_MIN_POINTS      256
+/// the maximum deviation of a simplified line [px]
+#define LOD_MAX_ERROR_PX    0.5
+
 namespace
 {
 // helper to declutter and draw clusters of track info points
@@ -241,6 +256,21 @@ CGisItemTrk::CGisItemTrk(const QDomNode& xml, IGisProject *project)
     checkForInvalidPoints();
 }
 
+CGisItemTrk::CGisItemTrk(const QDomNode& xml, QVector<CTrackData::trkseg_t>& segs, IGisProject *project)
+    : IGisItem(project, eTypeTrk, project->childCount())
+{
+    // --- start read and process data ----
+    setColor(penForeground.color());
+    trk.segs.swap(segs);
+    readTrk(xml, trk);
+    // --- stop read and process data ----
+
+    setupHistory();
+    updateDecoration(eMarkNone, eMarkNone);
+
+    checkForInvalidPoints();
+}
+
 CGisItemTrk::CGisItemTrk(const QString& filename, IGisProject * project)
     : IGisItem(project, eTypeTrk, project->childCount())
 {
@@ -275,6 +305,12 @@ CGisItemTrk::CGisItemTrk(quint64 id, QSqlDatabase& db, IGisProject * project)
     loadFromDb(id, db);
 }
 
+CGisItemTrk::CGisItemTrk(const dbitem_t& dbItem, IGisProject * project)
+    : IGisItem(project, eTypeTrk, NOIDX)
+{
+    loadFromDb(dbItem);
+}
+
 CGisItemTrk::CGisItemTrk(CTrackData& trkdata, IGisProject *project)
     : IGisItem(project, eTypeTrk, NOIDX)
     , trk(std::move(trkdata))
@@ -929,9 +965,6 @@ static inline void updateExtrema(CGisItemTrk::limits_t &extrema, qreal val, cons
 void CGisItemTrk::updateExtremaAndExtensions()
 {
     extrema = QHash<QString, limits_t>();
-    limits_t extremaSpeed;
-    limits_t extremaSlope;
-    limits_t extremaEle;
     limits_t extremaProgress;
 
 
@@ -945,47 +978,81 @@ void CGisItemTrk::updateExtremaAndExtensions()
             continue;
         }
 
-        existingExtensions.unite(pt.extensions.keys().toSet());
-
         const QPointF& pos = {pt.lon, pt.lat};
-        for(const QString &key : pt.extensions.keys())
+        for(auto it = pt.extensions.constBegin(); it != pt.extensions.constEnd(); ++it)
         {
             bool isReal = false;
-            qreal val = pt.extensions.value(key).toReal(&isReal);
-
+            qreal val = it.value().toReal(&isReal);
 
             if(isReal)
             {
-                if(!extrema.contains(key))
+                auto limits = extrema.find(it.key());
+                if(limits == extrema.end())
                 {
-                    extrema[key] = limits_t();
+                    limits = extrema.insert(it.key(), limits_t());
+                    existingExtensions << it.key();
                 }
-                updateExtrema(extrema[key], val, pos);
+                updateExtrema(*limits, val, pos);
             }
             else
             {
-                nonRealExtensions << key;
+                nonRealExtensions << it.key();
             }
         }
 
-        updateExtrema(extremaSpeed,    pt.speed, pos);
-        updateExtrema(extremaEle,      pt.ele, pos);
-        updateExtrema(extremaSlope,    pt.slope1, pos);
         updateExtrema(extremaProgress, pt.distance, pos);
     }
 
+    if(numeric_limits<qreal>::max() != extremaProgress.min)
+    {
+        existingExtensions << CKnownExtension::internalProgress;
+        extrema[CKnownExtension::internalProgress] = extremaProgress;
+    }
+
+    existingExtensions.subtract(nonRealExtensions);
+
+    updateExtremaDerived();
+}
+
+void CGisItemTrk::updateExtremaDerived()
+{
+    limits_t extremaSlope;
+    limits_t extremaEle;
+    limits_t extremaSpeed;
+
+    for(const CTrackData::trkpt_t &pt : trk)
+    {
+        if(pt.isHidden())
+        {
+            continue;
+        }
+
+        const QPointF& pos = {pt.lon, pt.lat};
+        updateExtrema(extremaEle,   pt.ele, pos);
+        updateExtrema(extremaSlope, pt.slope1, pos);
+        updateExtrema(extremaSpeed, pt.speed, pos);
+    }
+
+    existingExtensions.remove(CKnownExtension::internalEle);
+    extrema.remove(CKnownExtension::internalEle);
     if(extremaEle.min < extremaEle.max)
     {
         existingExtensions << CKnownExtension::internalEle;
         extrema[CKnownExtension::internalEle] = extremaEle;
     }
 
+    existingExtensions.remove(CKnownExtension::internalSlope);
+    extrema.remove(CKnownExtension::internalSlope);
     if(extremaSlope.min < extremaSlope.max)
     {
         existingExtensions << CKnownExtension::internalSlope;
         extrema[CKnownExtension::internalSlope] = extremaSlope;
     }
 
+    existingExtensions.remove(CKnownExtension::internalSpeedDist);
+    existingExtensions.remove(CKnownExtension::internalSpeedTime);
+    extrema.remove(CKnownExtension::internalSpeedDist);
+    extrema.remove(CKnownExtension::internalSpeedTime);
     if(numeric_limits<qreal>::max() != extremaSpeed.min)
     {
         existingExtensions << CKnownExtension::internalSpeedDist;
@@ -993,14 +1060,6 @@ void CGisItemTrk::updateExtremaAndExtensions()
         extrema[CKnownExtension::internalSpeedDist] = extremaSpeed;
         extrema[CKnownExtension::internalSpeedTime] = extremaSpeed;
     }
-
-    if(numeric_limits<qreal>::max() != extremaProgress.min)
-    {
-        existingExtensions << CKnownExtension::internalProgress;
-        extrema[CKnownExtension::internalProgress] = extremaProgress;
-    }
-
-    existingExtensions.subtract(nonRealExtensions);
 }
 
 void CGisItemTrk::resetInternalData()
@@ -1052,10 +1111,213 @@ void CGisItemTrk::consolidatePoints()
     }
 }
 
+/**
+   @brief Accumulate ascent and descent from the last point
+
+   Only elevation changes of at least ASCENT_THRESHOLD are counted.
+
+   @param lastTrkpt     the previous visible point
+   @param trkpt         the point to update
+   @param lastEle       the elevation the next change is measured from
+ */
+static inline void deriveAscent(const CTrackData::trkpt_t& lastTrkpt, CTrackData::trkpt_t& trkpt, qint32& lastEle)
+{
+    if(lastEle != NOINT)
+    {
+        qint32 delta  = trkpt.ele - lastEle;
+
+        trkpt.ascent  = lastTrkpt.ascent;
+        trkpt.descent = lastTrkpt.descent;
+
+        if(qAbs(delta) >= ASCENT_THRESHOLD)
+        {
+            const qint32 step = (delta / ASCENT_THRESHOLD) * ASCENT_THRESHOLD;
+
+            if(delta > 0)
+            {
+                trkpt.ascent  += step;
+            }
+            else
+            {
+                trkpt.descent -= step;
+            }
+            lastEle += step;
+        }
+    }
+}
+
+/**
+   @brief Derive slope and speed of the visible points depending on a range of points
+
+   Both are measured between the closest points with elevation at least 25m
+   before and after a point. As the distance grows along the track these
+   points are found by moving two indices along with the point instead of
+   searching the track for each point again.
+
+   If only the elevation of the points idx1..idx2 has changed, only the points
+   using one of them or a point linked across them are derived again. These
+   are all points whose window overlaps the range extended to the closest
+   points with elevation before and after it.
+
+   @param lintrk    linear list of pointers to visible track points
+   @param idx1      the first point with changed elevation
+   @param idx2      the last point with changed elevation
+   @param first     returns the first point derived again
+   @param last      returns the last point derived again
+ */
+static void deriveSlopeAndSpeed(const QVector<CTrackData::trkpt_t*>& lintrk, int idx1, int idx2, int& first, int& last)
+{
+    const int N = lintrk.size();
+    first = 0;
+    last  = N - 1;
+    if(N == 0)
+    {
+        return;
+    }
+
+    // the closest points with elevation at or before / at or after each point
+    QVector<int> prevEle(N);
+    QVector<int> nextEle(N);
+
+    int ele = NOIDX;
+    for(int n = 0; n < N; n++)
+    {
+        if(lintrk[n]->ele != NOINT)
+        {
+            ele = n;
+        }
+        prevEle[n] = ele;
+    }
+
+    ele = N;
+    for(int n = N - 1; n >= 0; n--)
+    {
+        if(lintrk[n]->ele != NOINT)
+        {
+            ele = n;
+        }
+        nextEle[n] = ele;
+    }
+
+    // the last point at least 25m before and the first point at least 25m after a point
+    auto getIdxBefore = [&lintrk](int p)
+    {
+        const qreal d = lintrk[p]->distance;
+        return int(std::partition_point(lintrk.begin(), lintrk.end(), [d](const CTrackData::trkpt_t* pt){return d - pt->distance >= 25; }) - lintrk.begin()) - 1;
+    };
+
+    auto getIdxAfter = [&lintrk](int p)
+    {
+        const qreal d = lintrk[p]->distance;
+        return int(std::partition_point(lintrk.begin() + p, lintrk.end(), [d](const CTrackData::trkpt_t* pt){return pt->distance - d < 25; }) - lintrk.begin());
+    };
+
+    // the first and last point used by the window of a point
+    auto getWindowStart = [&](int p)
+    {
+        const int n = getIdxBefore(p);
+        return n != NOIDX ? prevEle[n] : NOIDX;
+    };
+
+    auto getWindowEnd = [&](int p)
+    {
+        const int n = getIdxAfter(p);
+        return n < N ? nextEle[n] : N;
+    };
+
+    idx1 = qBound(0, idx1, N - 1);
+    idx2 = qBound(idx1, idx2, N - 1);
+    if((idx1 > 0) || (idx2 < N - 1))
+    {
+        const int ele1 = idx1 > 0 ? qMax(0, prevEle[idx1 - 1]) : 0;
+        const int ele2 = idx2 < N - 1 ? qMin(N - 1, nextEle[idx2 + 1]) : N - 1;
+
+        first = idx1;
+        while((first > 0) && (getWindowEnd(first - 1) >= ele1))
+        {
+            --first;
+        }
+
+        last = idx2;
+        while((last < N - 1) && (getWindowStart(last + 1) <= ele2))
+        {
+            ++last;
+        }
+    }
+
+    auto getTimestamp = [&lintrk](int n)
+    {
+        return lintrk[n]->time.toMSecsSinceEpoch() / 1000.0;
+    };
+
+    int idxBefore = getIdxBefore(first);
+    int idxAfter  = getIdxAfter(first);
+    for(int p = first; p <= last; p++)
+    {
+        CTrackData::trkpt_t& trkpt = *lintrk[p];
+
+        while((idxBefore + 1 < N) && (trkpt.distance - lintrk[idxBefore + 1]->distance >= 25))
+        {
+            ++idxBefore;
+        }
+
+        while((idxAfter < N) && (lintrk[idxAfter]->distance - trkpt.distance < 25))
+        {
+            ++idxAfter;
+        }
+
+        qreal d1 = trkpt.distance;
+        qreal e1 = trkpt.ele;
+        qreal t1 = getTimestamp(p);
+        // the first point is never used as start of the window
+        const int n1 = (idxBefore != NOIDX) ? prevEle[idxBefore] : NOIDX;
+        if(n1 > 0)
+        {
+            d1 = lintrk[n1]->distance;
+            e1 = lintrk[n1]->ele;
+            t1 = getTimestamp(n1);
+        }
+
+        qreal d2 = trkpt.distance;
+        qreal e2 = trkpt.ele;
+        qreal t2 = getTimestamp(p);
+        const int n2 = (idxAfter < N) ? nextEle[idxAfter] : N;
+        if(n2 < N)
+        {
+            d2 = lintrk[n2]->distance;
+            e2 = lintrk[n2]->ele;
+            t2 = getTimestamp(n2);
+        }
+
+        if(d1 < d2)
+        {
+            qreal a      = qAtan((e2 - e1) / (d2 - d1));
+            trkpt.slope1 = a * 360.0 / (2 * M_PI);
+            trkpt.slope2 = qTan(trkpt.slope1 * DEG_TO_RAD) * 100;
+        }
+        else
+        {
+            trkpt.slope1 = NOFLOAT;
+            trkpt.slope2 = NOFLOAT;
+        }
+
+        if(t1 < t2)
+        {
+            trkpt.speed = (d2 - d1) / (t2 - t1);
+        }
+        else
+        {
+            trkpt.speed = NOFLOAT;
+        }
+    }
+}
+
 void CGisItemTrk::deriveSecondaryData()
 {
     consolidatePoints();
 
+    lineRadChanged.storeRelease(1);
+
     qreal north = -90;
     qreal east  = -180;
     qreal south =  90;
@@ -1073,6 +1335,9 @@ void CGisItemTrk::deriveSecondaryData()
     totalDescent              = NOFLOAT;
     totalElapsedSeconds       = NOTIME;
     totalElapsedSecondsMoving = NOTIME;
+    trk.idxVisible2Total.clear();
+    visibleDistances.clear();
+    visibleTimestamps.clear();
 
     trk.removeEmptySegments();
 
@@ -1119,28 +1384,7 @@ void CGisItemTrk::deriveSecondaryData()
             trkpt.elapsedSeconds = trkpt.time.toMSecsSinceEpoch() / 1000.0 - timestampStart;
 
             // ascent descent
-            if(lastEle != NOINT)
-            {
-                qint32 delta  = trkpt.ele - lastEle;
-
-                trkpt.ascent  = lastTrkpt->ascent;
-                trkpt.descent = lastTrkpt->descent;
-
-                if(qAbs(delta) >= ASCENT_THRESHOLD)
-                {
-                    const qint32 step = (delta / ASCENT_THRESHOLD) * ASCENT_THRESHOLD;
-
-                    if(delta > 0)
-                    {
-                        trkpt.ascent  += step;
-                    }
-                    else
-                    {
-                        trkpt.descent -= step;
-                    }
-                    lastEle += step;
-                }
-            }
+            deriveAscent(*lastTrkpt, trkpt, lastEle);
 
             // time moving
             trkpt.elapsedSecondsMoving = lastTrkpt->elapsedSecondsMoving;
@@ -1169,70 +1413,14 @@ void CGisItemTrk::deriveSecondaryData()
 
     boundingRect = QRectF(QPointF(west * DEG_TO_RAD, north * DEG_TO_RAD), QPointF(east * DEG_TO_RAD, south * DEG_TO_RAD));
 
-    for(int p = 0; p < lintrk.size(); p++)
-    {
-        CTrackData::trkpt_t& trkpt = *lintrk[p];
+    updateFocusIndex(lintrk);
 
-        qreal d1 = trkpt.distance;
-        qreal e1 = trkpt.ele;
-        qreal t1 = trkpt.time.toMSecsSinceEpoch() / 1000.0;
-        for(int n = p; n > 0; --n)
-        {
-            CTrackData::trkpt_t & trkpt2 = *lintrk[n];
-            if(trkpt2.ele == NOINT)
-            {
-                continue;
-            }
-
-            if(trkpt.distance - trkpt2.distance >= 25)
-            {
-                d1 = trkpt2.distance;
-                e1 = trkpt2.ele;
-                t1 = trkpt2.time.toMSecsSinceEpoch() / 1000.0;
-                break;
-            }
-        }
+    int first, last;
+    deriveSlopeAndSpeed(lintrk, 0, lintrk.size() - 1, first, last);
 
-        qreal d2 = trkpt.distance;
-        qreal e2 = trkpt.ele;
-        qreal t2 = trkpt.time.toMSecsSinceEpoch() / 1000.0;
-        for(int n = p; n < lintrk.size(); ++n)
-        {
-            CTrackData::trkpt_t & trkpt2 = *lintrk[n];
-            if(trkpt2.ele == NOINT)
-            {
-                continue;
-            }
-
-            if(trkpt2.distance - trkpt.distance >= 25)
-            {
-                d2 = trkpt2.distance;
-                e2 = trkpt2.ele;
-                t2 = trkpt2.time.toMSecsSinceEpoch() / 1000.0;
-                break;
-            }
-        }
-
-        if(d1 < d2)
-        {
-            qreal a      = qAtan((e2 - e1) / (d2 - d1));
-            trkpt.slope1 = a * 360.0 / (2 * M_PI);
-            trkpt.slope2 = qTan(trkpt.slope1 * DEG_TO_RAD) * 100;
-        }
-        else
-        {
-            trkpt.slope1 = NOFLOAT;
-            trkpt.slope2 = NOFLOAT;
-        }
-
-        if(t1 < t2)
-        {
-            trkpt.speed = (d2 - d1) / (t2 - t1);
-        }
-        else
-        {
-            trkpt.speed = NOFLOAT;
-        }
+    for(CTrackData::trkpt_t * pTrkpt : lintrk)
+    {
+        CTrackData::trkpt_t& trkpt = *pTrkpt;
 
         // verify data
         verifyTrkPt(lastValid, trkpt);
@@ -1283,6 +1471,98 @@ void CGisItemTrk::deriveSecondaryData()
 //    qDebug() << "totalElapsedSecondsMoving" << totalElapsedSecondsMoving;
 }
 
+void CGisItemTrk::deriveElevationData(qint32 idx1, qint32 idx2)
+{
+    allValidFlags     = 0;
+    cntInvalidPoints  = 0;
+    totalAscent       = NOFLOAT;
+    totalDescent      = NOFLOAT;
+
+    if(trk.isEmpty())
+    {
+        return;
+    }
+
+    // linear list of pointers to visible track points
+    QVector<CTrackData::trkpt_t*> lintrk;
+    lintrk.reserve(cntVisiblePoints);
+    for(CTrackData::trkpt_t& trkpt : trk)
+    {
+        if(!trkpt.isHidden())
+        {
+            lintrk << &trkpt;
+        }
+    }
+
+    const int N = lintrk.size();
+    if(N == 0)
+    {
+        return;
+    }
+
+    idx1 = qBound(0, idx1, N - 1);
+    idx2 = (idx2 == NOIDX) ? N - 1 : qBound(idx1, idx2, N - 1);
+
+    // ascent and descent accumulate, thus all points from the first changed one are
+    // derived again. The elevation the next change is measured from is the start
+    // elevation plus the ascent minus the descent so far.
+    const qint32 eleStart = lintrk[0]->ele;
+    qint32 lastEle        = eleStart;
+    if(idx1 == 0)
+    {
+        lintrk[0]->ascent  = 0;
+        lintrk[0]->descent = 0;
+    }
+    else if(eleStart != NOINT)
+    {
+        lastEle = eleStart + qRound(lintrk[idx1 - 1]->ascent - lintrk[idx1 - 1]->descent);
+    }
+
+    for(int n = qMax(1, idx1); n < N; n++)
+    {
+        deriveAscent(*lintrk[n - 1], *lintrk[n], lastEle);
+    }
+
+    int first, last;
+    deriveSlopeAndSpeed(lintrk, idx1, idx2, first, last);
+
+    // only the elevation and slope flags depend on the elevation
+    const quint32 maskEle = CTrackData::trkpt_t::eValidEle | CTrackData::trkpt_t::eInvalidEle | CTrackData::trkpt_t::eValidSlope | CTrackData::trkpt_t::eInvalidSlope;
+    for(int n = 0; n < N; n++)
+    {
+        CTrackData::trkpt_t& trkpt = *lintrk[n];
+        if(((n >= idx1) && (n <= idx2)) || ((n >= first) && (n <= last)))
+        {
+            trkpt.valid &= ~maskEle;
+            trkpt.valid |= (trkpt.ele != NOINT) ? quint32(CTrackData::trkpt_t::eValidEle) : quint32(CTrackData::trkpt_t::eInvalidEle);
+            trkpt.valid |= (trkpt.slope1 == NOFLOAT) || (trkpt.slope2 == NOFLOAT) ? quint32(CTrackData::trkpt_t::eInvalidSlope) : quint32(CTrackData::trkpt_t::eValidSlope);
+        }
+
+        allValidFlags |= trkpt.valid;
+        if((trkpt.valid & 0xFFFF0000) != 0)
+        {
+            cntInvalidPoints++;
+        }
+    }
+
+    totalAscent     = lintrk[N - 1]->ascent;
+    totalDescent    = lintrk[N - 1]->descent;
+
+    activities.update();
+
+    updateExtremaDerived();
+    if(propHandler != nullptr)
+    {
+        propHandler->setupData();
+    }
+
+    setupInterpolation(interp.valid, interp.Q);
+
+    energyCycling.compute();
+
+    updateVisuals(eVisualAll, "deriveElevationData()");
+}
+
 
 void CGisItemTrk::findWaypointsCloseBy(CProgressDialog& progress, quint32& current)
 {
@@ -1292,10 +1572,11 @@ void CGisItemTrk::findWaypointsCloseBy(CProgressDialog& progress, quint32& curre
         return;
     }
 
-    quint32 lastCurrent = current;
-
     bool withDoubles = project->getSortingRoadbook() != IGisProject::eSortRoadbookTrackWithoutDouble;
 
+    // each track advances the progress by its points plus all waypoints of the project,
+    // no matter how much of the work is skipped. See IGisProject::updateItems()
+    const quint32 currentEnd = current + cntVisiblePoints + project->getItemCountByType(IGisItem::eTypeWpt);
 
     qreal north = -90 * DEG_TO_RAD;
     qreal south = 90 * DEG_TO_RAD;
@@ -1303,9 +1584,8 @@ void CGisItemTrk::findWaypointsCloseBy(CProgressDialog& progress, quint32& curre
     qreal east = -180 * DEG_TO_RAD;
     QVector<pointDP> line;
     // combine all segments to a single line
-    for(CTrackData::trkpt_t& pt : trk)
+    for(const CTrackData::trkpt_t& pt : trk)
     {
-        pt.keyWpt.clear();
         pointDP dp(pt.lon * DEG_TO_RAD, pt.lat * DEG_TO_RAD, 0);
         dp.idx = pt.idxTotal;
 
@@ -1319,15 +1599,21 @@ void CGisItemTrk::findWaypointsCloseBy(CProgressDialog& progress, quint32& curre
 
     if(line.isEmpty())
     {
+        keyCorrelation.clear();
+        current = currentEnd;
+        PROGRESS(current, return );
         return;
     }
 
     constexpr qreal OFFSET = 0.1 * DEG_TO_RAD;
     QRectF _boundingRect(QPointF(west - OFFSET, north + OFFSET), QPointF(east + OFFSET, south - OFFSET));
 
-    // convert coordinates of all waypoints into meter coordinates relative to the first track point
-    point3D pt0 = line[0];
-    QList<trkwpt_t> trkwpts;
+    // the result only depends on the track, the waypoints close by and the roadbook mode
+    QCryptographicHash md5(QCryptographicHash::Md5);
+    md5.addData(getHash().toLatin1());
+    md5.addData(withDoubles ? "1" : "0");
+
+    QList<CGisItemWpt*> wpts;
     for(int i = 0; i < project->childCount(); i++)
     {
         CGisItemWpt * wpt = dynamic_cast<CGisItemWpt*>(project->child(i));
@@ -1341,6 +1627,25 @@ void CGisItemTrk::findWaypointsCloseBy(CProgressDialog& progress, quint32& curre
             continue;
         }
 
+        md5.addData(wpt->getHash().toLatin1());
+        wpts << wpt;
+    }
+
+    const QByteArray& key = md5.result();
+    if(key == keyCorrelation)
+    {
+        // nothing changed since the last correlation
+        current = currentEnd;
+        PROGRESS(current, return );
+        return;
+    }
+    keyCorrelation.clear();
+
+    // convert coordinates of all waypoints into meter coordinates relative to the first track point
+    point3D pt0 = line[0];
+    QList<trkwpt_t> trkwpts;
+    for(CGisItemWpt * wpt : wpts)
+    {
         QPointF pos = wpt->getPosition();
 
         qreal a1 = 0, a2 = 0;
@@ -1355,77 +1660,109 @@ void CGisItemTrk::findWaypointsCloseBy(CProgressDialog& progress, quint32& curre
         trkwpts << trkwpt;
     }
 
-    // convert all coordinates into meter relative to the first track point.
-    for(pointDP& pt1 : line)
+    // convert all coordinates into meter relative to the first track point
+    // and index them spatially.
+    QVector<CTrackData::trkpt_t*> trkpts;
+    trkpts.reserve(line.size());
+    for(CTrackData::trkpt_t& pt : trk)
+    {
+        pt.keyWpt.clear();
+        trkpts << &pt;
+    }
+
+    QVector<CPackedRTree::item_t> items(line.size());
+    for(int i = 0; i < line.size(); i++)
     {
+        pointDP& pt1 = line[i];
+
         qreal a1 = 0, a2 = 0;
         qreal d = GPS_Math_Distance(pt0.x, pt0.y, pt1.x, pt1.y, a1, a2);
 
         pt1.x = qCos(a1 * DEG_TO_RAD) * d;
         pt1.y = qSin(a1 * DEG_TO_RAD) * d;
+
+        items[i].box = QRectF(pt1.x, pt1.y, 0, 0);
+        items[i].id  = i;
     }
 
+    CPackedRTree tree;
+    tree.build(items);
+
+    current += cntVisiblePoints;
+    PROGRESS(current, return );
+
+    auto attach = [&](qint32 i, const trkwpt_t& trkwpt)
+    {
+        CTrackData::trkpt_t * trkpt = trkpts[i];
+        ++numberOfAttachedWpt;
+        trkpt->keyWpt = trkwpt.key;
+        if(trkpt->isHidden())
+        {
+            trkpt->unsetFlag(CTrackData::trkpt_t::eFlagHidden);
+            return true;
+        }
+        return false;
+    };
+
+    /*
+        Each waypoint is attached to the closest track point closer than
+        WPT_FOCUS_DIST_IN. If doubles are allowed, each pass of the track
+        is handled separately. A pass ends as soon as the track is further
+        away than WPT_FOCUS_DIST_OUT. Thus only the points closer than that
+        are of interest. A gap in their indices marks the end of a pass.
+     */
+    const qreal distOut = qSqrt(WPT_FOCUS_DIST_OUT);
+
     bool doDeriveData = false;
     numberOfAttachedWpt = 0;
     for(const trkwpt_t &trkwpt : trkwpts)
     {
+        QVector<qint32> ids;
+        tree.query(QRectF(trkwpt.x - distOut, trkwpt.y - distOut, 2 * distOut, 2 * distOut), ids);
+        std::sort(ids.begin(), ids.end());
+
         qreal minD   = WPT_FOCUS_DIST_IN;
         qint32 index = NOIDX;
+        qint32 last  = NOIDX;
 
-        for(const pointDP &pt : line)
+        for(qint32 i : ids)
         {
-            ++current;
+            const pointDP &pt = line[i];
             qreal d = (trkwpt.x - pt.x) * (trkwpt.x - pt.x) + (trkwpt.y - pt.y) * (trkwpt.y - pt.y);
-
-            if(d < WPT_FOCUS_DIST_IN)
+            if(d > WPT_FOCUS_DIST_OUT)
             {
-                if(d < minD)
-                {
-                    index = pt.idx;
-                    minD  = d;
-                }
+                continue;
             }
-            else if(withDoubles && (d > WPT_FOCUS_DIST_OUT))
-            {
-                CTrackData::trkpt_t * trkpt = const_cast<CTrackData::trkpt_t*>(trk.getTrkPtByTotalIndex(index));
-                if(trkpt)
-                {
-                    ++numberOfAttachedWpt;
-                    trkpt->keyWpt = trkwpt.key;
-                    if(trkpt->isHidden())
-                    {
-                        trkpt->unsetFlag(CTrackData::trkpt_t::eFlagHidden);
-                        doDeriveData = true;
-                    }
-                }
 
+            if(withDoubles && (last != NOIDX) && (i != last + 1) && (index != NOIDX))
+            {
+                doDeriveData |= attach(index, trkwpt);
                 index = NOIDX;
                 minD  = WPT_FOCUS_DIST_IN;
             }
+            last = i;
 
-            if(current - lastCurrent > 100)
+            if(d < minD)
             {
-                lastCurrent = current;
-                PROGRESS(current, return );
+                index = i;
+                minD  = d;
             }
         }
 
         if(index != NOIDX)
         {
-            CTrackData::trkpt_t * trkpt = const_cast<CTrackData::trkpt_t*>(trk.getTrkPtByTotalIndex(index));
-            if(trkpt)
-            {
-                ++numberOfAttachedWpt;
-                trkpt->keyWpt = trkwpt.key;
-                if(trkpt->isHidden())
-                {
-                    trkpt->unsetFlag(CTrackData::trkpt_t::eFlagHidden);
-                    doDeriveData = true;
-                }
-            }
+            doDeriveData |= attach(index, trkwpt);
         }
+
+        ++current;
+        PROGRESS(current, return );
     }
 
+    keyCorrelation = key;
+
+    current = currentEnd;
+    progress.setValue(current);
+
     if(doDeriveData)
     {
         deriveSecondaryData();
@@ -1885,52 +2222,38 @@ void CGisItemTrk::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>
         return;
     }
 
-    QPointF pt1;
     QPointF p1 = viewport[0];
     QPointF p2 = viewport[2];
     gis->convertRad2Px(p1);
     gis->convertRad2Px(p2);
     QRectF extViewport(p1, p2);
 
-    if(mode == eModeNormal)
+    if(lineRadChanged.fetchAndStoreAcquire(0))
     {
-        // in normal mode the trackline without points marked as deleted is drawn
-        for(const CTrackData::trkpt_t &pt : trk)
-        {
-            if(pt.isHidden())
-            {
-                continue;
-            }
+        // collect the track points only after the track has changed,
+        // not for each redraw.
+        updateLinesRad();
+    }
 
-            pt1.setX(pt.lon);
-            pt1.setY(pt.lat);
-            pt1 *= DEG_TO_RAD;
-            lineSimple << pt1;
-        }
+    // the viewport in [rad] with a margin for the pen. Parts of the track outside
+    // are not projected. Close to the antimeridian everything is projected.
+    QRectF viewportRad = QRectF(viewport[0], viewport[2]).normalized();
+    const qreal radPerPx = qMin(viewportRad.width() / qMax(1.0, qAbs(extViewport.width())), viewportRad.height() / qMax(1.0, qAbs(extViewport.height())));
+    viewportRad.adjust(-LINE_CULL_MARGIN * radPerPx, -LINE_CULL_MARGIN * radPerPx, LINE_CULL_MARGIN * radPerPx, LINE_CULL_MARGIN * radPerPx);
+    if((viewportRad.left() < -M_PI) || (viewportRad.right() > M_PI))
+    {
+        viewportRad = QRectF();
     }
-    else
+
+    // in normal mode the trackline without points marked as deleted is drawn
+    convertLineRad2Px(lineSimpleRad, viewportRad, gis, lineSimple);
+    if(mode != eModeNormal)
     {
         // in full mode the complete track including points marked as deleted
         // is drawn as gray line first. Then the track without points marked as
         // deleted is drawn with it's configured color
-        for(const CTrackData::trkpt_t &pt : trk)
-        {
-            pt1.setX(pt.lon);
-            pt1.setY(pt.lat);
-            pt1 *= DEG_TO_RAD;
-
-            lineFull << pt1;
-
-            if(pt.isHidden())
-            {
-                continue;
-            }
-
-            lineSimple << pt1;
-        }
+        convertLineRad2Px(lineFullRad, viewportRad, gis, lineFull);
     }
-    gis->convertRad2Px(lineSimple);
-    gis->convertRad2Px(lineFull);
 
     // draw the full line first
     if(mode == eModeRange)
@@ -1956,9 +2279,26 @@ void CGisItemTrk::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>
     }
     // -------------------------
 
-    // draw the reduced track line
+    // draw the reduced track line. When zoomed out, use the coarsest level of
+    // detail that does not deviate visibly.
+    const line_rad_t * lod = nullptr;
+    for(const line_rad_t& line : lineSimpleLod)
+    {
+        if(line.tolerance < LOD_MAX_ERROR_PX * radPerPx)
+        {
+            lod = &line;
+        }
+    }
+
     QList<QPolygonF> lines;
-    splitLineToViewport(lineSimple, extViewport, lines);
+    if(lod == nullptr)
+    {
+        splitLineToViewport(lineSimple, extViewport, lines);
+    }
+    else
+    {
+        splitLineRadToViewport(*lod, viewportRad, gis, extViewport, lines);
+    }
 
     const CMainWindow& w = CMainWindow::self();
     if(key == keyUserFocus && w.isShowTrackHighlight())
@@ -2068,6 +2408,172 @@ void CGisItemTrk::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>
 }
 
 
+/// true if both rectangles overlap, unlike QRectF::intersects() this works for lines, too
+static bool overlaps(const QRectF& r1, const QRectF& r2)
+{
+    return (r1.left() <= r2.right()) && (r1.right() >= r2.left()) && (r1.top() <= r2.bottom()) && (r1.bottom() >= r2.top());
+}
+
+void CGisItemTrk::line_rad_t::clear()
+{
+    pts.clear();
+    chunks.clear();
+    tolerance = 0;
+}
+
+void CGisItemTrk::line_rad_t::updateChunks()
+{
+    chunks.clear();
+
+    const int N = pts.size();
+    chunks.reserve((N + LINE_CHUNK_SIZE - 1) / LINE_CHUNK_SIZE);
+    for(int idx = 0; idx < N; idx += LINE_CHUNK_SIZE)
+    {
+        chunk_t chunk;
+        chunk.idx = idx;
+        chunk.cnt = qMin(LINE_CHUNK_SIZE, N - idx);
+
+        // include the first point of the next chunk to cover the segment connecting both
+        const int last = qMin(idx + chunk.cnt, N - 1);
+        qreal left   = pts[idx].x();
+        qreal right  = left;
+        qreal top    = pts[idx].y();
+        qreal bottom = top;
+        for(int i = idx + 1; i <= last; i++)
+        {
+            const QPointF& pt = pts[i];
+            left   = qMin(left, pt.x());
+            right  = qMax(right, pt.x());
+            top    = qMin(top, pt.y());
+            bottom = qMax(bottom, pt.y());
+        }
+        chunk.boundingRect = QRectF(QPointF(left, top), QPointF(right, bottom));
+
+        chunks << chunk;
+    }
+}
+
+void CGisItemTrk::updateLinesRad()
+{
+    lineSimpleRad.clear();
+    lineFullRad.clear();
+    lineSimpleLod.clear();
+    lineSimpleRad.pts.reserve(cntVisiblePoints);
+    lineFullRad.pts.reserve(cntTotalPoints);
+
+    for(const CTrackData::trkpt_t &pt : trk)
+    {
+        const QPointF pt1(pt.lon * DEG_TO_RAD, pt.lat * DEG_TO_RAD);
+
+        lineFullRad.pts << pt1;
+
+        if(pt.isHidden())
+        {
+            continue;
+        }
+
+        lineSimpleRad.pts << pt1;
+    }
+
+    lineSimpleRad.updateChunks();
+    lineFullRad.updateChunks();
+
+    // each level of detail is simplified from the previous one with a 4 times larger tolerance
+    lineSimpleLod.reserve(LOD_MAX_LEVELS);
+    const QPolygonF * prev = &lineSimpleRad.pts;
+    qreal tolerance = LOD_MIN_TOLERANCE;
+    for(int level = 0; (level < LOD_MAX_LEVELS) && (prev->size() > LOD_MIN_POINTS); level++, tolerance *= 4)
+    {
+        QVector<pointDP> line;
+        line.reserve(prev->size());
+        for(const QPointF& pt : *prev)
+        {
+            line << pointDP(pt.x(), pt.y(), 0);
+        }
+
+        GPS_Math_DouglasPeucker(line, tolerance);
+
+        line_rad_t lod;
+        lod.tolerance = tolerance;
+        for(const pointDP& pt : line)
+        {
+            if(pt.used)
+            {
+                lod.pts << QPointF(pt.x, pt.y);
+            }
+        }
+
+        // a level that hardly reduces the points is not worth it
+        if(lod.pts.size() > (prev->size() * 3) / 4)
+        {
+            continue;
+        }
+
+        lod.updateChunks();
+        lineSimpleLod << lod;
+        prev = &lineSimpleLod.last().pts;
+    }
+}
+
+void CGisItemTrk::convertLineRad2Px(const line_rad_t& line, const QRectF& viewport, CGisDraw * gis, QPolygonF& pixel)
+{
+    pixel = line.pts;
+    if(viewport.isEmpty())
+    {
+        gis->convertRad2Px(pixel);
+        return;
+    }
+
+    QPointF * pts = pixel.data();
+    for(const chunk_t& chunk : line.chunks)
+    {
+        QPointF * first = pts + chunk.idx;
+        if(overlaps(chunk.boundingRect, viewport))
+        {
+            gis->convertRad2Px(first, chunk.cnt);
+            continue;
+        }
+
+        // The line between the first and the last point stays within the bounding
+        // rectangle. Thus it is off screen like the original points.
+        QPointF ends[2] = {first[0], first[chunk.cnt - 1]};
+        gis->convertRad2Px(ends, 2);
+        std::fill(first, first + chunk.cnt - 1, ends[0]);
+        first[chunk.cnt - 1] = ends[1];
+    }
+}
+
+void CGisItemTrk::splitLineRadToViewport(const line_rad_t& line, const QRectF& viewport, CGisDraw * gis, const QRectF& extViewport, QList<QPolygonF>& lines)
+{
+    const int N = line.pts.size();
+    const int M = line.chunks.size();
+
+    int i = 0;
+    while(i < M)
+    {
+        if(!viewport.isEmpty() && !overlaps(line.chunks[i].boundingRect, viewport))
+        {
+            i++;
+            continue;
+        }
+
+        // project a run of consecutive chunks inside the viewport at once
+        int j = i;
+        while((j + 1 < M) && (viewport.isEmpty() || overlaps(line.chunks[j + 1].boundingRect, viewport)))
+        {
+            j++;
+        }
+
+        const int idx1 = line.chunks[i].idx;
+        const int idx2 = qMin(line.chunks[j].idx + line.chunks[j].cnt, N - 1);
+        QPolygonF run = line.pts.mid(idx1, idx2 - idx1 + 1);
+        gis->convertRad2Px(run);
+        splitLineToViewport(run, extViewport, lines);
+
+        i = j + 1;
+    }
+}
+
 void CGisItemTrk::drawLimitLabels(limit_type_e type, const QString& label, const QPointF& pos, QPainter& p, const QFontMetricsF& fm, QList<QRectF>& blockedAreas)
 {
     const QString& fullLabel = (type == eLimitTypeMin ? tr("min.") : tr("max.")) + " " + label;
@@ -2597,7 +3103,7 @@ void CGisItemTrk::setElevation(qint32 idx, qint32 ele)
     if((trkpt != nullptr) && (trkpt->ele != ele))
     {
         trkpt->ele = ele;
-        deriveSecondaryData();
+        deriveElevationData(trkpt->idxVisible, trkpt->idxVisible);
         changed(tr("Changed elevation of point %1 to %2 %3").arg(idx).arg(ele * IUnit::self().elevationFactor).arg(IUnit::self().elevationUnit), "://icons/48x48/SetEle.png");
     }
 }
@@ -2687,27 +3193,60 @@ void CGisItemTrk::setIcon(const QString& iconColor)
     IGisItem::setIcon(mask.scaled(22, 22, Qt::KeepAspectRatio, Qt::SmoothTransformation));
 }
 
-bool CGisItemTrk::setMouseFocusByDistance(qreal dist, focusmode_e fmode, const QString &owner)
+void CGisItemTrk::updateFocusIndex(const QVector<CTrackData::trkpt_t*>& lintrk)
 {
-    const CTrackData::trkpt_t * newPointOfFocus = nullptr;
+    const int N = lintrk.size();
+    trk.idxVisible2Total.resize(N);
+    visibleDistances.resize(N);
+    visibleTimestamps.resize(N);
+    visibleDistancesSorted  = true;
+    visibleTimestampsSorted = true;
 
-    if(dist != NOFLOAT)
+    for(int n = 0; n < N; n++)
     {
-        qreal delta = totalDistance;
-
-        /// @todo: optimize search by single out segment and then do a binary search
+        const CTrackData::trkpt_t& trkpt = *lintrk[n];
+        trk.idxVisible2Total[n] = trkpt.idxTotal;
+        visibleDistances[n]     = trkpt.distance;
+        visibleTimestamps[n]    = trkpt.time.toTime_t();
 
-        for(const CTrackData::trkpt_t &pt : trk)
+        if(n > 0)
         {
-            if(pt.isHidden())
-            {
-                continue;
-            }
+            visibleDistancesSorted  = visibleDistancesSorted  && (visibleDistances[n - 1]  <= visibleDistances[n]);
+            visibleTimestampsSorted = visibleTimestampsSorted && (visibleTimestamps[n - 1] <= visibleTimestamps[n]);
+        }
+    }
+}
 
-            qreal d = qAbs(pt.distance - dist);
+/**
+   @brief Find the index of the value closest to the given one
+
+   The values are scanned from the start as long as they get closer to the
+   given value. Of several values with the same distance the last one is used.
+   If the values are sorted the same result is found by a binary search.
+
+   @param values    the values to search
+   @param sorted    true if the values are sorted ascending
+   @param value     the value to search for
+   @param maxDelta  the maximum difference allowed for the first value
+   @return The index of the closest value or NOIDX.
+ */
+static qint32 findClosest(const QVector<qreal>& values, bool sorted, qreal value, qreal maxDelta)
+{
+    if(values.isEmpty() || (qAbs(values.first() - value) > maxDelta))
+    {
+        return NOIDX;
+    }
+
+    if(!sorted)
+    {
+        qint32 idx  = NOIDX;
+        qreal delta = maxDelta;
+        for(int n = 0; n < values.size(); n++)
+        {
+            qreal d = qAbs(values[n] - value);
             if(d <= delta)
             {
-                newPointOfFocus = &pt;
+                idx   = n;
                 delta = d;
             }
             else
@@ -2715,39 +3254,43 @@ bool CGisItemTrk::setMouseFocusByDistance(qreal dist, focusmode_e fmode, const Q
                 break;
             }
         }
+        return idx;
     }
 
-    return publishMouseFocus(newPointOfFocus, fmode, owner);
+    // the last value less or equal and the first value greater than the one searched
+    const qint32 idxGreater = std::upper_bound(values.begin(), values.end(), value) - values.begin();
+    const qint32 idxLess    = idxGreater - 1;
+
+    if((idxGreater < values.size()) && ((idxLess < 0) || (values[idxGreater] - value <= value - values[idxLess])))
+    {
+        // use the last one of several equal values
+        return std::upper_bound(values.begin() + idxGreater, values.end(), values[idxGreater]) - values.begin() - 1;
+    }
+
+    return idxLess;
 }
 
-bool CGisItemTrk::setMouseFocusByTime(quint32 time, focusmode_e fmode, const QString &owner)
+bool CGisItemTrk::setMouseFocusByDistance(qreal dist, focusmode_e fmode, const QString &owner)
 {
     const CTrackData::trkpt_t * newPointOfFocus = nullptr;
 
-    if(time != NOTIME)
+    if(dist != NOFLOAT)
     {
-        /// @todo: optimize search by single out segment and then do a binary search
+        qint32 idx = findClosest(visibleDistances, visibleDistancesSorted, dist, totalDistance);
+        newPointOfFocus = trk.getTrkPtByVisibleIndex(idx);
+    }
 
-        qreal delta = totalElapsedSeconds;
+    return publishMouseFocus(newPointOfFocus, fmode, owner);
+}
 
-        for(const CTrackData::trkpt_t &pt : trk)
-        {
-            if(pt.isHidden())
-            {
-                continue;
-            }
+bool CGisItemTrk::setMouseFocusByTime(quint32 time, focusmode_e fmode, const QString &owner)
+{
+    const CTrackData::trkpt_t * newPointOfFocus = nullptr;
 
-            qreal d = qAbs(qreal(pt.time.toTime_t()) - qreal(time));
-            if(d <= delta)
-            {
-                newPointOfFocus = &pt;
-                delta = d;
-            }
-            else
-            {
-                break;
-            }
-        }
+    if(time != NOTIME)
+    {
+        qint32 idx = findClosest(visibleTimestamps, visibleTimestampsSorted, time, totalElapsedSeconds);
+        newPointOfFocus = trk.getTrkPtByVisibleIndex(idx);
     }
 
     return publishMouseFocus(newPointOfFocus, fmode, owner);
@@ -3072,6 +3615,8 @@ void CGisItemTrk::updateVisuals(quint32 visuals, const QString& who)
 {
     qDebug() << "CGisItemTrk::updateVisuals()" << getName() << who;
 
+    lineRadChanged.storeRelease(1);
+
     if(!dlgDetails.isNull() && (visuals & eVisualDetails))
     {
         dlgDetails->updateData();
@@ -33,6 +33,7 @@
 
 #include <functional>
 #include <interpolation.h>
+#include <QAtomicInt>
 #include <QDebug>
 #include <QPen>
 #include <QPointer>
@@ -40,6 +41,7 @@
 using std::numeric_limits;
 
 class QDomNode;
+class QXmlStreamReader;
 class IGisProject;
 class INotifyTrk;
 class CDetailsTrk;
@@ -107,12 +109,32 @@ public:
     /** @brief Used to create track from GPX file */
     CGisItemTrk(const QDomNode &xml, IGisProject *project);
 
+    /**
+       @brief Used to create track from GPX file with the segments streamed by readTrkseg()
+
+       @param xml       The XML <trk> section without the <trkseg> sections
+       @param segs      The segments, moved into the track
+       @param project   The parent project
+     */
+    CGisItemTrk(const QDomNode &xml, QVector<CTrackData::trkseg_t>& segs, IGisProject *project);
+
+    /**
+       @brief Read the points of a <trkseg> section in a GPX file from a stream
+
+       @param in    The XML stream at the start of the <trkseg> element. On return it is at the element's end.
+       @param seg   The segment to append the points to
+     */
+    static void readTrkseg(QXmlStreamReader& in, CTrackData::trkseg_t& seg);
+
     /** @brief Used to restore track from history structure */
     CGisItemTrk(const history_t& hist, const QString& dbHash, IGisProject * project);
 
     /** @brief Used to restore track from database */
     CGisItemTrk(quint64 id, QSqlDatabase& db, IGisProject * project);
 
+    /** @brief Used to restore track from data read by IGisItem::readFromDb() */
+    CGisItemTrk(const dbitem_t& dbItem, IGisProject * project);
+
     /** @brief Clone QLandkarte GT track */
     CGisItemTrk(const CQlgtTrack& trk1, IGisProject *project = nullptr);
 
@@ -632,8 +654,14 @@ public:
        If a waypoint correlates with a trackpoint it's key is written to
        CTrackData::trkpt_t::keyWpt.
 
+       The track points are indexed by a CPackedRTree, thus each waypoint
+       is compared with the track points close by, only. Nothing is done if
+       neither the track nor the waypoints within its bounding box changed
+       since the last call.
+
        @param progress  a progress dialog as this operation can take quite some time
-       @param current   the current progress if the operation is done for several tracks
+       @param current   the current progress if the operation is done for several tracks,
+                        it is increased by the number of visible points and the number of waypoints
      */
     void findWaypointsCloseBy(CProgressDialog &progress, quint32 &current);
 
@@ -676,6 +704,19 @@ private:
      */
     void deriveSecondaryData();
 
+    /**
+       @brief Derive only the secondary data depending on the elevation
+
+       Use this instead of deriveSecondaryData() if nothing but the elevation
+       of the points has changed. Neither the track's geometry nor its time
+       stamps or extensions are processed again. Slope and speed are derived
+       again only for the points close to the changed ones.
+
+       @param idx1  the visible index of the first point with changed elevation
+       @param idx2  the visible index of the last point with changed elevation, NOIDX for the last point of the track
+     */
+    void deriveElevationData(qint32 idx1 = 0, qint32 idx2 = NOIDX);
+
     /**
      * @brief Reset internal data like range selection and details dialog
      */
@@ -720,6 +761,8 @@ private:
     QSet<QString> existingExtensions;
     QHash<QString, limits_t> extrema;
     void updateExtremaAndExtensions();
+    /// update the extrema of elevation, slope and speed, all depending on the elevation
+    void updateExtremaDerived();
 
     enum limit_type_e
     {
@@ -852,11 +895,29 @@ private:
     qreal totalElapsedSeconds = 0;
     qreal totalElapsedSecondsMoving = 0;
     quint32 numberOfAttachedWpt = 0;
+    /// a hash of everything the last call of findWaypointsCloseBy() depended on
+    QByteArray keyCorrelation;
     CEnergyCycling energyCycling {*this};
 
     void checkForInvalidPoints();
     /**@}*/
 
+    /**
+       \defgroup FocusIndex Lookup tables to find visible points by distance and time
+
+       Both are rebuilt by deriveSecondaryData(). Index n refers to the visible
+       point with idxVisible == n. As long as the values are sorted the point closest
+       to a value is found by a binary search.
+     */
+    /**@{*/
+    QVector<qreal> visibleDistances;    //< the distance of each visible point in [m]
+    QVector<qreal> visibleTimestamps;   //< the time stamp of each visible point in [s]
+    bool visibleDistancesSorted  = true;
+    bool visibleTimestampsSorted = true;
+
+    void updateFocusIndex(const QVector<CTrackData::trkpt_t*>& lintrk);
+    /**@}*/
+
 
 
     /**
@@ -871,6 +932,62 @@ private:
     QPolygonF lineSimple;   //< the current track line as screen pixel coordinates
     QPolygonF lineFull;     //< visible and invisible points
 
+    /// consecutive points of a line_rad_t and their bounding rectangle in [rad]
+    struct chunk_t
+    {
+        qint32 idx = 0;         //< index of the first point
+        qint32 cnt = 0;         //< number of points
+        QRectF boundingRect;    //< including the first point of the next chunk
+    };
+
+    /// a line in [rad] split into chunks to project the parts inside the viewport only
+    struct line_rad_t
+    {
+        QPolygonF pts;
+        QVector<chunk_t> chunks;
+        /// the Douglas-Peucker tolerance the line has been simplified with [rad]
+        qreal tolerance = 0;
+
+        void clear();
+        void updateChunks();
+    };
+
+    line_rad_t lineSimpleRad;   //< all visible points, the source of lineSimple
+    line_rad_t lineFullRad;     //< all points, the source of lineFull
+    /// lineSimpleRad simplified with increasing tolerance, used to draw the track line when zoomed out
+    QVector<line_rad_t> lineSimpleLod;
+    /// set to 1 if the lines in [rad] have to be rebuilt, it is set by the GUI thread and reset by drawItem()
+    QAtomicInt lineRadChanged {1};
+
+    /// rebuild lineSimpleRad, lineFullRad and lineSimpleLod from the track points
+    void updateLinesRad();
+
+    /**
+       @brief Project a line with one pixel point per point
+
+       Chunks outside the viewport are not projected point by point. Only their first
+       and last point are, with all other points collapsed onto the first one. The
+       line still connects all parts inside the viewport but stays off screen
+       elsewhere.
+
+       @param line          the line in [rad]
+       @param viewport      the viewport in [rad], an empty rectangle disables culling
+       @param gis           the draw context
+       @param pixel         the projected line with the same number of points as line
+     */
+    static void convertLineRad2Px(const line_rad_t& line, const QRectF& viewport, CGisDraw * gis, QPolygonF& pixel);
+
+    /**
+       @brief Project the parts of a line inside the viewport and split them into polylines to draw
+
+       @param line          the line in [rad]
+       @param viewport      the viewport in [rad], an empty rectangle disables culling
+       @param gis           the draw context
+       @param extViewport   the viewport in pixel
+       @param lines         the resulting polylines are appended
+     */
+    void splitLineRadToViewport(const line_rad_t& line, const QRectF& viewport, CGisDraw * gis, const QRectF& extViewport, QList<QPolygonF>& lines);
+
     qint32 penWidthFg = 1;  //< inner trackline width
     qint32 penWidthBg = 3;  //< outer trackline width
     qint32 penWidthHi = 11; //< highlighted trackline width
@@ -31,6 +31,55 @@ const QMap<CTrackData::trkpt_t::act20_e, CTrackData::trkpt_t::act10_e> CTrackDat
     , {CTrackData::trkpt_t::eAct20Train,   CTrackData::trkpt_t::eActTrain}
 };
 
+QString CTrackData::internExtensionKey(const QString& key)
+{
+    // function local, as static keys of other translation units are interned
+    // during static initialization, too (see CKnownExtension)
+
+    /// all extension keys ever used by a track point
+    static QSet<QString> extensionKeys;
+    static QMutex mutexExtensionKeys;
+    /// the shared keys already looked up by a thread, to take the lock once per key only
+    static QThreadStorage<QSet<QString> > localExtensionKeys;
+
+    QSet<QString>& localKeys = localExtensionKeys.localData();
+    QSet<QString>::const_iterator it = localKeys.constFind(key);
+    if(it != localKeys.constEnd())
+    {
+        return *it;
+    }
+
+    QString sharedKey;
+    {
+        QMutexLocker lock(&mutexExtensionKeys);
+        QSet<QString>::const_iterator shared = extensionKeys.constFind(key);
+        if(shared == extensionKeys.constEnd())
+        {
+            shared = extensionKeys.insert(key);
+        }
+        sharedKey = *shared;
+    }
+
+    localKeys.insert(sharedKey);
+    return sharedKey;
+}
+
+void CTrackData::trkpt_t::squeezeExtensions()
+{
+    if(extensions.isEmpty())
+    {
+        return;
+    }
+
+    QHash<QString, QVariant> tmp;
+    tmp.reserve(extensions.size());
+    for(auto it = extensions.constBegin(); it != extensions.constEnd(); ++it)
+    {
+        tmp.insert(internExtensionKey(it.key()), it.value());
+    }
+    tmp.squeeze();
+    extensions.swap(tmp);
+}
 
 CTrackData::CTrackData(const QString &name, const CTrackData &other, qint32 rangeStart, qint32 rangeEnd) : name(name)
 {
@@ -190,6 +239,15 @@ const CTrackData::trkpt_t* CTrackData::getTrkPtByVisibleIndex(qint32 idx) const
         return nullptr;
     }
 
+    if((idx >= 0) && (idx < idxVisible2Total.size()))
+    {
+        const trkpt_t * trkpt = getTrkPtByTotalIndex(idxVisible2Total[idx]);
+        if((trkpt != nullptr) && (trkpt->idxVisible == idx))
+        {
+            return trkpt;
+        }
+    }
+
     auto condition = [idx](const trkpt_t &pt) { return pt.idxVisible == idx;  };
     return getTrkPtByCondition(condition);
 }
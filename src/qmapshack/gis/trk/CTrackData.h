@@ -176,6 +176,16 @@ public:
             return GPS_Math_Distance(lon * DEG_TO_RAD, lat * DEG_TO_RAD, other.lon * DEG_TO_RAD, other.lat * DEG_TO_RAD);
         }
 
+        /**
+           @brief Make the point's extensions use as little memory as possible
+
+           The extension keys are long strings like "gpxtpx:TrackPointExtension|gpxtpx:hr".
+           Every reader creates a new copy of each key for each point. This replaces the
+           keys by a copy shared with all other track points and squeezes the hash.
+           Call it after the extensions of a point have been read.
+         */
+        void squeezeExtensions();
+
         inline void sanitizeFlags()
         {
             if((activity == eAct20None))
@@ -236,8 +246,19 @@ public:
     // -- all gpx tags - stop
     QString color;
 
+    /// the total index of each visible point, maintained by CGisItemTrk::deriveSecondaryData()
+    QVector<qint32> idxVisible2Total;
+
     void removeEmptySegments();
 
+    /**
+       @brief Get a copy of an extension key that is shared with all other users of that key
+
+       @param key   the extension key
+       @return The shared copy of the key.
+     */
+    static QString internExtensionKey(const QString& key);
+
     void readFrom(const SGisLine &l);
     void readFrom(const QVector<trkpt_t> &pts);
     void getPolyline(SGisLine  &l) const;
@@ -263,7 +284,8 @@ public:
     /**
        @brief Try to get access Nth visible point matching the idx
 
-       This will iterate over all segments and count the visible points. If the
+       The point is looked up by idxVisible2Total. If that is out of date this
+       will iterate over all segments and count the visible points. If the
        count matches idx a pointer to the track point is returned.
 
        @param idx The index into all visible points
@@ -197,7 +197,7 @@ void CGisItemTrk::filterSmoothProfile(int points)
     {
         pt.ele = ele2[cnt++];
     }
-    deriveSecondaryData();
+    deriveElevationData();
     changed(tr("Smoothed profile with a Median filter of size %1").arg(points), "://icons/48x48/SetEle.png");
 }
 
@@ -248,7 +248,7 @@ void CGisItemTrk::filterReplaceElevation(CCanvas * canvas)
         ++cnt;
     }
 
-    deriveSecondaryData();
+    deriveElevationData();
     changed(tr("Replaced elevation data with data from DEM files."), "://icons/48x48/SetEle.png");
 }
 
@@ -266,7 +266,7 @@ void CGisItemTrk::filterInterpolateElevation()
     }
 
     interp.valid = false;
-    deriveSecondaryData();
+    deriveElevationData();
     changed(tr("Replaced elevation data with interpolated values. (M=%1, RMSErr=%2)").arg(interp.m).arg(interp.rep.rmserror), "://icons/48x48/SetEle.png");
 }
 
@@ -282,7 +282,7 @@ void CGisItemTrk::filterOffsetElevation(int offset)
 
     QString val, unit;
     IUnit::self().meter2elevation(offset, val, unit);
-    deriveSecondaryData();
+    deriveElevationData();
     changed(tr("Offset elevation data by %1%2.").arg(val).arg(unit), "://icons/48x48/SetEle.png");
 }
 
@@ -160,6 +160,13 @@ CGisItemWpt::CGisItemWpt(quint64 id, QSqlDatabase& db, IGisProject * project)
     detBoundingRect();
 }
 
+CGisItemWpt::CGisItemWpt(const dbitem_t& dbItem, IGisProject * project)
+    : IGisItem(project, eTypeWpt, NOIDX)
+{
+    loadFromDb(dbItem);
+    detBoundingRect();
+}
+
 CGisItemWpt::CGisItemWpt(const CTwoNavProject::wpt_t &tnvWpt, IGisProject * project)
     : IGisItem(project, eTypeWpt, NOIDX)
 {
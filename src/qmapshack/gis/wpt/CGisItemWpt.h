@@ -145,6 +145,13 @@ public:
      */
     CGisItemWpt(quint64 id, QSqlDatabase& db, IGisProject * project);
 
+    /**
+       @brief Create item from data read by IGisItem::readFromDb()
+       @param dbItem    the item's data
+       @param project   the project to append with item
+     */
+    CGisItemWpt(const dbitem_t& dbItem, IGisProject * project);
+
     /**
        @brief Read item from text stream with TwoNav encoding
        @param tnvWpt
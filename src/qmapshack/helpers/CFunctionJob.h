@@ -0,0 +1,47 @@
+/**********************************************************************************************
+    Copyright (C) 2020 Norbert Truchsess <norbert.truchsess@t-online.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CFUNCTIONJOB_H
+#define CFUNCTIONJOB_H
+
+#include <functional>
+#include <QRunnable>
+
+/**
+   @brief Run a function object on a QThreadPool
+
+   The job is deleted by the pool after it has been run.
+ */
+class CFunctionJob : public QRunnable
+{
+public:
+    CFunctionJob(std::function<void()> job) : job(job)
+    {
+    }
+
+    void run() override
+    {
+        job();
+    }
+
+private:
+    std::function<void()> job;
+};
+
+#endif //CFUNCTIONJOB_H
+
@@ -0,0 +1,145 @@
+/**********************************************************************************************
+    Copyright (C) 2020 Norbert Truchsess <norbert.truchsess@t-online.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "helpers/CPackedRTree.h"
+
+#include <algorithm>
+#include <QtCore>
+
+/// the maximum number of children per node
+#define NODE_CAPACITY 16
+
+inline bool overlaps(qreal left, qreal top, qreal right, qreal bottom, const QRectF& area)
+{
+    return left <= area.right() && area.left() <= right && top <= area.bottom() && area.top() <= bottom;
+}
+
+void CPackedRTree::sortTileRecursive(QVector<node_t>& nodes)
+{
+    const qint32 N      = nodes.size();
+    const qint32 P      = (N + NODE_CAPACITY - 1) / NODE_CAPACITY;
+    const qint32 slices = qCeil(qSqrt(qreal(P)));
+    const qint32 size   = slices * NODE_CAPACITY;
+
+    auto centerX = [](const node_t& n){return n.left + n.right; };
+    auto centerY = [](const node_t& n){return n.top + n.bottom; };
+
+    // sort by x into vertical slices and each slice by y
+    std::sort(nodes.begin(), nodes.end(), [&](const node_t& n1, const node_t& n2){return centerX(n1) < centerX(n2); });
+    for(qint32 i = 0; i < N; i += size)
+    {
+        std::sort(nodes.begin() + i, nodes.begin() + qMin(N, i + size), [&](const node_t& n1, const node_t& n2){return centerY(n1) < centerY(n2); });
+    }
+}
+
+void CPackedRTree::build(const QVector<item_t>& items)
+{
+    levels.clear();
+    if(items.isEmpty())
+    {
+        return;
+    }
+
+    QVector<node_t> level;
+    level.reserve(items.size());
+    for(const item_t &item : items)
+    {
+        const QRectF& box = item.box.normalized();
+
+        node_t node;
+        node.left   = box.left();
+        node.top    = box.top();
+        node.right  = box.right();
+        node.bottom = box.bottom();
+        node.first  = item.id;
+        level << node;
+    }
+
+    while(true)
+    {
+        sortTileRecursive(level);
+        levels << level;
+
+        const qint32 N = level.size();
+        if(N <= NODE_CAPACITY)
+        {
+            break;
+        }
+
+        // pack consecutive nodes into parent nodes
+        QVector<node_t> parents;
+        parents.reserve((N + NODE_CAPACITY - 1) / NODE_CAPACITY);
+        for(qint32 i = 0; i < N; i += NODE_CAPACITY)
+        {
+            node_t parent = level[i];
+            parent.first  = i;
+            parent.count  = qMin(NODE_CAPACITY, N - i);
+            for(qint32 n = i + 1; n < i + parent.count; n++)
+            {
+                const node_t& child = level[n];
+                parent.left   = qMin(parent.left, child.left);
+                parent.top    = qMin(parent.top, child.top);
+                parent.right  = qMax(parent.right, child.right);
+                parent.bottom = qMax(parent.bottom, child.bottom);
+            }
+            parents << parent;
+        }
+        level = parents;
+    }
+}
+
+void CPackedRTree::query(const QRectF& area, QVector<qint32>& ids) const
+{
+    if(levels.isEmpty())
+    {
+        return;
+    }
+
+    const QRectF& rect = area.normalized();
+
+    // pending nodes as pairs of level and node index
+    QVector< QPair<qint32, qint32> > stack;
+    const qint32 top = levels.size() - 1;
+    for(qint32 i = 0; i < levels[top].size(); i++)
+    {
+        stack << qMakePair(top, i);
+    }
+
+    while(!stack.isEmpty())
+    {
+        const QPair<qint32, qint32> entry = stack.takeLast();
+        const node_t& node = levels[entry.first][entry.second];
+
+        if(!overlaps(node.left, node.top, node.right, node.bottom, rect))
+        {
+            continue;
+        }
+
+        if(entry.first == 0)
+        {
+            ids << node.first;
+            continue;
+        }
+
+        for(qint32 i = node.first; i < node.first + node.count; i++)
+        {
+            stack << qMakePair(entry.first - 1, i);
+        }
+    }
+}
+
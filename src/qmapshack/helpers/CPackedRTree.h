@@ -0,0 +1,90 @@
+/**********************************************************************************************
+    Copyright (C) 2020 Norbert Truchsess <norbert.truchsess@t-online.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CPACKEDRTREE_H
+#define CPACKEDRTREE_H
+
+#include <QRectF>
+#include <QVector>
+
+/**
+   @brief A static R-tree, bulk loaded by the Sort-Tile-Recursive algorithm
+
+   The tree is built once from a list of bounding boxes, each with an
+   arbitrary integer id. It can't be modified afterwards, but it has no
+   memory overhead besides the nodes and answers area queries in O(log n).
+
+   Boxes do not have to be normalized. Thus the usual [rad] rectangles with
+   negative height can be used as they are.
+ */
+class CPackedRTree
+{
+public:
+    struct item_t
+    {
+        QRectF box;
+        qint32 id;
+    };
+
+    CPackedRTree() = default;
+    virtual ~CPackedRTree() = default;
+
+    /// replace the tree's content by the given items
+    void build(const QVector<item_t>& items);
+    /// remove all items
+    void clear()
+    {
+        levels.clear();
+    }
+
+    bool isEmpty() const
+    {
+        return levels.isEmpty();
+    }
+
+    /**
+       @brief Get the ids of all items with a bounding box overlapping the area
+
+       Boxes touching the area are reported, too. The result is not sorted.
+
+       @param area      the query area
+       @param ids       the result is appended to this list
+     */
+    void query(const QRectF& area, QVector<qint32>& ids) const;
+
+private:
+    struct node_t
+    {
+        qreal left   = 0;
+        qreal top    = 0;
+        qreal right  = 0;
+        qreal bottom = 0;
+        /// leaf level: the item's id, else the index of the first child in the lower level
+        qint32 first = 0;
+        /// number of children, 0 for the leaf level
+        qint32 count = 0;
+    };
+
+    static void sortTileRecursive(QVector<node_t>& nodes);
+
+    /// the nodes per level, index 0 is the leaf level, the last one holds the root nodes
+    QVector< QVector<node_t> > levels;
+};
+
+#endif //CPACKEDRTREE_H
+
@@ -18,6 +18,7 @@
 
 #include "CMainWindow.h"
 #include "CSingleInstanceProxy.h"
+#include "map/cache/CTileSeeder.h"
 #include "setup/IAppSetup.h"
 #include "version.h"
 
@@ -47,6 +48,12 @@ int main(int argc, char ** argv)
     // setup default proxy
     QNetworkProxyFactory::setUseSystemConfiguration(true);
 
+    // seeding a map's cache runs without any window and does not interfere with a running instance
+    if(!qlOpts->seedMap.isEmpty())
+    {
+        return CTileSeeder::exec(qlOpts->seedMap, qlOpts->seedArea, qlOpts->seedLevels);
+    }
+
     // make sure this is the one and only instance on the system
     CSingleInstanceProxy s(qlOpts->arguments);
 
@@ -20,6 +20,7 @@
 #include "CMainWindow.h"
 #include "gis/Poi.h"
 #include "helpers/CDraw.h"
+#include "helpers/CFunctionJob.h"
 #include "helpers/CSettings.h"
 #include "map/cache/CDiskCache.h"
 #include "map/CMapDraw.h"
@@ -37,7 +38,7 @@
 QList<CMapDraw*> CMapDraw::maps;
 QString CMapDraw::cachePath = "";
 QStringList CMapDraw::mapPaths;
-QStringList CMapDraw::supportedFormats = QString("*.vrt|*.jnx|*.img|*.rmap|*.wmts|*.tms|*.gemf").split('|');
+QStringList CMapDraw::supportedFormats = QString("*.vrt|*.jnx|*.img|*.rmap|*.map|*.wmts|*.tms|*.gemf").split('|');
 
 
 CMapDraw::CMapDraw(CCanvas *parent)
@@ -439,8 +440,8 @@ void CMapDraw::reportStatusToCanvas(const QString& key, const QString& msg)
 
 void CMapDraw::drawt(IDrawContext::buffer_t& currentBuffer) /* override */
 {
-    bool seenActiveMap = false;
-    // iterate over all active maps and call the draw method
+    // collect all active maps
+    QList<IMap*> activeMaps;
     CMapItem::mutexActiveMaps.lock();
     if(mapList && (mapList->count() != 0))
     {
@@ -456,12 +457,65 @@ void CMapDraw::drawt(IDrawContext::buffer_t& currentBuffer) /* override */
                 break;
             }
 
-            item->mapfile->draw(currentBuffer);
-            seenActiveMap = true;
+            activeMaps << item->mapfile;
+        }
+    }
+
+    if(activeMaps.count() == 1)
+    {
+        // no need for an extra layer
+        activeMaps.first()->draw(currentBuffer);
+    }
+    else if(activeMaps.count() > 1)
+    {
+        /*
+            Each map renders into a layer of its own in parallel. The maps
+            apply their opacity while drawing. Thus the layers are simply
+            stacked in the order of the map list afterwards.
+
+            Each map uses projection objects of its own. The conversions of
+            this draw context use projection objects of the calling thread.
+
+            Maps still waiting for a worker are skipped if a new redraw has been
+            requested meanwhile.
+         */
+        layers.resize(activeMaps.count());
+        for(int i = 0; i < activeMaps.count(); i++)
+        {
+            buffer_t& layer = layers[i];
+            QImage image    = layer.image;
+            layer           = currentBuffer;
+            if(image.size() != currentBuffer.image.size())
+            {
+                image = QImage(currentBuffer.image.size(), currentBuffer.image.format());
+            }
+            image.fill(Qt::transparent);
+            layer.image = image;
+
+            IMap * mapfile = activeMaps[i];
+            pool.start(new CFunctionJob([this, mapfile, &layer]()
+            {
+                if(!needsRedraw())
+                {
+                    mapfile->draw(layer);
+                }
+            }));
+        }
+        pool.waitForDone();
+
+        // a new request makes the layers obsolete, as all maps have stopped early anyway
+        if(!needsRedraw())
+        {
+            QPainter p(&currentBuffer.image);
+            for(const buffer_t& layer : layers)
+            {
+                p.drawImage(0, 0, layer.image);
+            }
         }
     }
     CMapItem::mutexActiveMaps.unlock();
 
+    bool seenActiveMap = !activeMaps.isEmpty();
     if(seenActiveMap != hasActiveMap)
     {
         hasActiveMap = seenActiveMap;
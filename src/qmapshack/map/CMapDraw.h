@@ -21,6 +21,7 @@
 
 #include "canvas/IDrawContext.h"
 #include <QStringList>
+#include <QThreadPool>
 
 class QPainter;
 class CCanvas;
@@ -195,6 +196,11 @@ private:
     static QStringList supportedFormats;
 
     bool hasActiveMap = false;
+
+    /// thread pool to render the layers of several active maps in parallel
+    QThreadPool pool;
+    /// one buffer per active map, reused between redraws to avoid reallocation
+    QVector<buffer_t> layers;
 };
 
 #endif //CMAPDRAW_H
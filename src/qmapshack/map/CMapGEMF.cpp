@@ -59,7 +59,7 @@ CMapGEMF::CMapGEMF(const QString &filename, CMapDraw *parent)
     , filename(filename)
 {
     qDebug() << "CMapGEMF: try to open " << filename;
-    pjsrc = pj_init_plus("+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs");
+    pjsrc = pj_init_plus_ctx(pjctx, "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs");
     qDebug() << "CMapGEMF:" << "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs";
     QFile file(filename);
     file.open(QIODevice::ReadOnly);
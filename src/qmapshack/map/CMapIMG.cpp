@@ -46,7 +46,7 @@
 
 int CFileExt::cnt = 0;
 
-static inline bool isCompletelyOutside(const QPolygonF& poly, const QRectF &viewport)
+static inline QRectF boundingBox(const QPolygonF& poly)
 {
     qreal north =  -90.0 * DEG_TO_RAD;
     qreal south =   90.0 * DEG_TO_RAD;
@@ -84,7 +84,7 @@ static inline bool isCompletelyOutside(const QPolygonF& poly, const QRectF &view
         ref.setHeight(0.00001);
     }
 
-    return !viewport.intersects(ref);
+    return ref;
 }
 
 static inline QImage img2line(const QImage &img, int width)
@@ -137,6 +137,8 @@ CMapIMG::CMapIMG(const QString &filename, CMapDraw *parent)
     qDebug() << "------------------------------";
     qDebug() << "IMG: try to open" << filename;
 
+    subdivCache.setMaxCost(subdivCacheSizeMB * 1024);
+
     try
     {
         readBasics();
@@ -153,10 +155,19 @@ CMapIMG::CMapIMG(const QString &filename, CMapDraw *parent)
     isActivated = true;
 }
 
+void CMapIMG::saveConfig(QSettings& cfg)
+{
+    IMap::saveConfig(cfg);
+    cfg.setValue("subdivCacheSizeMB", subdivCacheSizeMB);
+}
+
 void CMapIMG::loadConfig(QSettings& cfg)
 {
     IMap::loadConfig(cfg);
 
+    subdivCacheSizeMB = cfg.value("subdivCacheSizeMB", subdivCacheSizeMB).toInt();
+    subdivCache.setMaxCost(subdivCacheSizeMB * 1024);
+
     if(!typeFile.isEmpty())
     {
         setupTyp();
@@ -685,6 +696,15 @@ void CMapIMG::readBasics()
         ++subfile;
     }
 
+    QVector<CPackedRTree::item_t> items;
+    subfileKeys.clear();
+    for(auto it = subfiles.constBegin(); it != subfiles.constEnd(); ++it)
+    {
+        items << CPackedRTree::item_t {it->area, subfileKeys.size()};
+        subfileKeys << it.key();
+    }
+    subfileIndex.build(items);
+
     // combine copyright sections
     copyright.clear();
     for(const QString &str : copyrights)
@@ -995,6 +1015,19 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt &file)
 
     subfile.subdivs = subdivs;
 
+    // build a spatial index of the subdivisions for each map level
+    QMap<quint32, QVector<CPackedRTree::item_t> > items;
+    for(qint32 i = 0; i < subdivs.size(); i++)
+    {
+        items[subdivs[i].level] << CPackedRTree::item_t {subdivs[i].area, i};
+    }
+
+    subfile.subdivIndex.clear();
+    for(quint32 level : items.keys())
+    {
+        subfile.subdivIndex[level].build(items[level]);
+    }
+
 #ifdef DEBUG_SHOW_SUBDIV_DATA
     {
         QVector<subdiv_desc_t>::iterator subdiv = subfile.subdivs.begin();
@@ -1354,14 +1387,22 @@ void CMapIMG::loadVisibleData(bool fast, polytype_t& polygons, polytype_t& polyl
     }
 #endif
 
-    for(const subfile_desc_t &subfile : subfiles)
+    // keep the order of the map file for subfiles and subdivisions
+    QVector<qint32> subfileIds;
+    subfileIndex.query(viewport, subfileIds);
+    std::sort(subfileIds.begin(), subfileIds.end());
+
+    for(qint32 subfileIdx : subfileIds)
     {
+        const subfile_desc_t& subfile = *subfiles.constFind(subfileKeys[subfileIdx]);
+
 //        qDebug() << "-------";
 //        qDebug() << (viewport.topLeft() * RAD_TO_DEG) << (viewport.bottomRight() * RAD_TO_DEG);
 //        qDebug() << (subfile.area.topLeft() * RAD_TO_DEG) << (subfile.area.bottomRight() * RAD_TO_DEG);
 //        qDebug() << subfile.area.intersects(viewport);
 
-        if(!subfile.area.intersects(viewport))
+        auto index = subfile.subdivIndex.constFind(level);
+        if(!subfile.area.intersects(viewport) || index == subfile.subdivIndex.constEnd())
         {
             continue;
         }
@@ -1379,15 +1420,19 @@ void CMapIMG::loadVisibleData(bool fast, polytype_t& polygons, polytype_t& polyl
         }
 #endif
 
+        // the RGN part is read on demand, only if a subdivision is not in the cache
         QByteArray rgndata;
-        readFile(file, subfile.parts["RGN"].offset, subfile.parts["RGN"].size, rgndata);
 
         // qDebug() << "rgn range" << hex << subfile.parts["RGN"].offset << (subfile.parts["RGN"].offset + subfile.parts["RGN"].size);
 
-        const QVector<subdiv_desc_t>& subdivs = subfile.subdivs;
+        QVector<qint32> subdivIds;
+        index->query(viewport, subdivIds);
+        std::sort(subdivIds.begin(), subdivIds.end());
+
         // collect polylines
-        for(const subdiv_desc_t &subdiv : subdivs)
+        for(qint32 subdivIdx : subdivIds)
         {
+            const subdiv_desc_t& subdiv = subfile.subdivs[subdivIdx];
             // if(subdiv.level == level) qDebug() << "subdiv:" << subdiv.level << level <<  subdiv.area << viewport << subdiv.area.intersects(viewport);
             if(subdiv.level != level || !subdiv.area.intersects(viewport))
             {
@@ -1397,7 +1442,26 @@ void CMapIMG::loadVisibleData(bool fast, polytype_t& polygons, polytype_t& polyl
             {
                 break;
             }
-            loadSubDiv(file, subdiv, subfile.strtbl, rgndata, fast, viewport, polylines, polygons, points, pois);
+
+            const quint64 key = (quint64(subfileIdx) << 40) | (quint64(subdiv.level & 0xFF) << 32) | subdiv.n;
+            const subdiv_data_t * data = subdivCache.object(key);
+            if(data != nullptr)
+            {
+                copyVisibleData(*data, fast, viewport, polylines, polygons, points, pois);
+            }
+            else
+            {
+                if(rgndata.isEmpty())
+                {
+                    readFile(file, subfile.parts["RGN"].offset, subfile.parts["RGN"].size, rgndata);
+                }
+
+                subdiv_data_t * newData = new subdiv_data_t();
+                loadSubDiv(file, subdiv, subfile.strtbl, rgndata, *newData);
+                copyVisibleData(*newData, fast, viewport, polylines, polygons, points, pois);
+                // the cache takes ownership and might delete the data right away
+                subdivCache.insert(key, newData, newData->cost());
+            }
 
 #ifdef DEBUG_SHOW_SECTION_BORDERS
             const QRectF& a = subdiv.area;
@@ -1444,7 +1508,7 @@ void CMapIMG::loadVisibleData(bool fast, polytype_t& polygons, polytype_t& polyl
 #endif
 }
 
-void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStrTbl * strtbl, const QByteArray& rgndata, bool fast, const QRectF& viewport, polytype_t& polylines, polytype_t& polygons, pointtype_t& points, pointtype_t& pois)
+void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStrTbl * strtbl, const QByteArray& rgndata, subdiv_data_t& data)
 {
     if(subdiv.rgn_start == subdiv.rgn_end && !subdiv.lengthPolygons2 && !subdiv.lengthPolylines2 && !subdiv.lengthPoints2)
     {
@@ -1520,7 +1584,7 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
     CGarminPolygon p;
 
     // decode points
-    if(subdiv.hasPoints && !fast && getShowPOIs())
+    if(subdiv.hasPoints)
     {
         const quint8 *pData = pRawData + opnt;
         const quint8 *pEnd  = pRawData + (oidx ? oidx : opline ? opline : opgon ? opgon : subdiv.rgn_end);
@@ -1529,24 +1593,18 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
             CGarminPoint p;
             pData += p.decode(subdiv.iCenterLng, subdiv.iCenterLat, subdiv.shift, pData);
 
-            // skip points outside our current viewport
-            if(!viewport.contains(p.pos))
-            {
-                continue;
-            }
-
             if(strtbl)
             {
                 p.isLbl6 ? strtbl->get(file, p.lbl_ptr, IGarminStrTbl::poi, p.labels)
                 : strtbl->get(file, p.lbl_ptr, IGarminStrTbl::norm, p.labels);
             }
 
-            points.push_back(p);
+            data.points.push_back(p);
         }
     }
 
     // decode indexed points
-    if(subdiv.hasIdxPoints && !fast && getShowPOIs())
+    if(subdiv.hasIdxPoints)
     {
         const quint8 *pData = pRawData + oidx;
         const quint8 *pEnd  = pRawData + (opline ? opline : opgon ? opgon : subdiv.rgn_end);
@@ -1555,24 +1613,18 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
             CGarminPoint p;
             pData += p.decode(subdiv.iCenterLng, subdiv.iCenterLat, subdiv.shift, pData);
 
-            // skip points outside our current viewport
-            if(!viewport.contains(p.pos))
-            {
-                continue;
-            }
-
             if(strtbl)
             {
                 p.isLbl6 ? strtbl->get(file, p.lbl_ptr, IGarminStrTbl::poi, p.labels)
                 : strtbl->get(file, p.lbl_ptr, IGarminStrTbl::norm, p.labels);
             }
 
-            pois.push_back(p);
+            data.pois.push_back(p);
         }
     }
 
     // decode polylines
-    if(subdiv.hasPolylines && !fast && getShowPolylines())
+    if(subdiv.hasPolylines)
     {
         CGarminPolygon::cnt = 0;
         const quint8 *pData = pRawData + opline;
@@ -1581,12 +1633,6 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
         {
             pData += p.decode(subdiv.iCenterLng, subdiv.iCenterLat, subdiv.shift, true, pData, pEnd);
 
-            // skip points outside our current viewport
-            if(isCompletelyOutside(p.pixel, viewport))
-            {
-                continue;
-            }
-
             if(strtbl && !p.lbl_in_NET && p.lbl_info)
             {
                 strtbl->get(file, p.lbl_info, IGarminStrTbl::norm, p.labels);
@@ -1596,12 +1642,13 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
                 strtbl->get(file, p.lbl_info, IGarminStrTbl::net, p.labels);
             }
 
-            polylines.push_back(p);
+            data.polylines.push_back(p);
+            data.boundsPolylines.push_back(boundingBox(p.coords));
         }
     }
 
     // decode polygons
-    if(subdiv.hasPolygons && getShowPolygons())
+    if(subdiv.hasPolygons)
     {
         CGarminPolygon::cnt = 0;
         const quint8 *pData = pRawData + opgon;
@@ -1611,21 +1658,16 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
         {
             pData += p.decode(subdiv.iCenterLng, subdiv.iCenterLat, subdiv.shift, false, pData, pEnd);
 
-            // skip points outside our current viewport
-            if(isCompletelyOutside(p.pixel, viewport))
-            {
-                continue;
-            }
-
-            if(strtbl && !p.lbl_in_NET && p.lbl_info && !fast)
+            if(strtbl && !p.lbl_in_NET && p.lbl_info)
             {
                 strtbl->get(file, p.lbl_info, IGarminStrTbl::norm, p.labels);
             }
-            else if(strtbl && p.lbl_in_NET && p.lbl_info && !fast)
+            else if(strtbl && p.lbl_in_NET && p.lbl_info)
             {
                 strtbl->get(file, p.lbl_info, IGarminStrTbl::net, p.labels);
             }
-            polygons.push_back(p);
+            data.polygons.push_back(p);
+            data.boundsPolygons.push_back(boundingBox(p.coords));
         }
     }
 
@@ -1641,7 +1683,7 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
     //         qDebug() << "point len: " << hex << subdiv.lengthPoints2 << dec << subdiv.lengthPoints2;
     //         qDebug() << "point end: " << hex << subdiv.lengthPoints2 + subdiv.offsetPoints2;
 
-    if(subdiv.lengthPolygons2 && getShowPolygons())
+    if(subdiv.lengthPolygons2)
     {
         const quint8 *pData   = pRawData + subdiv.offsetPolygons2;
         const quint8 *pEnd    = pData + subdiv.lengthPolygons2;
@@ -1650,22 +1692,17 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
             //             qDebug() << "rgn offset:" << hex << (rgnoff + (pData - pRawData));
             pData += p.decode2(subdiv.iCenterLng, subdiv.iCenterLat, subdiv.shift, false, pData, pEnd);
 
-            // skip points outside our current viewport
-            if(isCompletelyOutside(p.pixel, viewport))
-            {
-                continue;
-            }
-
-            if(strtbl && !p.lbl_in_NET && p.lbl_info && !fast)
+            if(strtbl && !p.lbl_in_NET && p.lbl_info)
             {
                 strtbl->get(file, p.lbl_info, IGarminStrTbl::norm, p.labels);
             }
 
-            polygons.push_back(p);
+            data.polygons.push_back(p);
+            data.boundsPolygons.push_back(boundingBox(p.coords));
         }
     }
 
-    if(subdiv.lengthPolylines2 && !fast && getShowPolylines())
+    if(subdiv.lengthPolylines2)
     {
         const quint8 *pData = pRawData + subdiv.offsetPolylines2;
         const quint8 *pEnd  = pData + subdiv.lengthPolylines2;
@@ -1674,22 +1711,17 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
             //             qDebug() << "rgn offset:" << hex << (rgnoff + (pData - pRawData));
             pData += p.decode2(subdiv.iCenterLng, subdiv.iCenterLat, subdiv.shift, true, pData, pEnd);
 
-            // skip points outside our current viewport
-            if(isCompletelyOutside(p.pixel, viewport))
-            {
-                continue;
-            }
-
             if(strtbl && !p.lbl_in_NET && p.lbl_info)
             {
                 strtbl->get(file, p.lbl_info, IGarminStrTbl::norm, p.labels);
             }
 
-            polylines.push_back(p);
+            data.polylines.push_back(p);
+            data.boundsPolylines.push_back(boundingBox(p.coords));
         }
     }
 
-    if(subdiv.lengthPoints2 && !fast && getShowPOIs())
+    if(subdiv.lengthPoints2)
     {
         const quint8 *pData   = pRawData + subdiv.offsetPoints2;
         const quint8 *pEnd    = pData + subdiv.lengthPoints2;
@@ -1699,22 +1731,78 @@ void CMapIMG::loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStr
             //             qDebug() << "rgn offset:" << hex << (rgnoff + (pData - pRawData));
             pData += p.decode2(subdiv.iCenterLng, subdiv.iCenterLat, subdiv.shift, pData, pEnd);
 
+            if(strtbl)
+            {
+                p.isLbl6 ? strtbl->get(file, p.lbl_ptr, IGarminStrTbl::poi, p.labels)
+                : strtbl->get(file, p.lbl_ptr, IGarminStrTbl::norm, p.labels);
+            }
+            data.pois.push_back(p);
+        }
+    }
+}
+
+void CMapIMG::copyVisibleData(const subdiv_data_t& data, bool fast, const QRectF& viewport, polytype_t& polylines, polytype_t& polygons, pointtype_t& points, pointtype_t& pois)
+{
+    if(!fast && getShowPOIs())
+    {
+        for(const CGarminPoint &pt : data.points)
+        {
             // skip points outside our current viewport
-            if(!viewport.contains(p.pos))
+            if(viewport.contains(pt.pos))
             {
-                continue;
+                points.push_back(pt);
+            }
+        }
+
+        for(const CGarminPoint &pt : data.pois)
+        {
+            if(viewport.contains(pt.pos))
+            {
+                pois.push_back(pt);
             }
+        }
+    }
 
-            if(strtbl)
+    if(!fast && getShowPolylines())
+    {
+        const int N = data.polylines.size();
+        for(int i = 0; i < N; i++)
+        {
+            if(viewport.intersects(data.boundsPolylines[i]))
             {
-                p.isLbl6 ? strtbl->get(file, p.lbl_ptr, IGarminStrTbl::poi, p.labels)
-                : strtbl->get(file, p.lbl_ptr, IGarminStrTbl::norm, p.labels);
+                polylines.push_back(data.polylines[i]);
+            }
+        }
+    }
+
+    if(getShowPolygons())
+    {
+        const int N = data.polygons.size();
+        for(int i = 0; i < N; i++)
+        {
+            if(viewport.intersects(data.boundsPolygons[i]))
+            {
+                polygons.push_back(data.polygons[i]);
             }
-            pois.push_back(p);
         }
     }
 }
 
+int CMapIMG::subdiv_data_t::cost() const
+{
+    qint64 bytes = sizeof(subdiv_data_t);
+    for(const polytype_t * items : {&polygons, &polylines})
+    {
+        for(const CGarminPolygon &item : *items)
+        {
+            bytes += sizeof(CGarminPolygon) + sizeof(QRectF) + item.coords.size() * sizeof(QPointF);
+        }
+    }
+    bytes += (points.size() + pois.size()) * sizeof(CGarminPoint);
+
+    return qMax(1, int(bytes >> 10));
+}
+
 void CMapIMG::drawPolygons(QPainter& p, polytype_t& lines)
 {
     const int N = polygonDrawOrder.size();
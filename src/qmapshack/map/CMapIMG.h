@@ -19,12 +19,14 @@
 #ifndef CMAPIMG_H
 #define CMAPIMG_H
 
+#include "helpers/CPackedRTree.h"
 #include "map/garmin/CGarminPoint.h"
 #include "map/garmin/CGarminPolygon.h"
 #include "map/garmin/CGarminTyp.h"
 #include "map/garmin/Garmin.h"
 #include "map/IMap.h"
 
+#include <QCache>
 #include <QMap>
 
 class CMapDraw;
@@ -110,6 +112,8 @@ public:
 
         /// list of subdivisions
         QVector<subdiv_desc_t> subdivs;
+        /// spatial index of the subdivisions per map level, the id is the index into subdivs
+        QMap<quint32, CPackedRTree> subdivIndex;
         /// used maplevels
         QVector<maplevel_t> maplevels;
         /// bit 1 of POI_flags (TRE header @ 0x3F)
@@ -121,6 +125,7 @@ public:
     CMapIMG(const QString &filename, CMapDraw *parent);
     virtual ~CMapIMG() = default;
 
+    void saveConfig(QSettings& cfg) override;
     void loadConfig(QSettings& cfg) override;
 
     void draw(IDrawContext::buffer_t& buf) override;
@@ -156,6 +161,21 @@ private:
         exce_e err;
         QString msg;
     };
+    /// all decoded objects of a subdivision
+    struct subdiv_data_t
+    {
+        polytype_t polygons;
+        polytype_t polylines;
+        pointtype_t points;
+        pointtype_t pois;
+        /// bounding boxes of the polygons and polylines [rad]
+        QVector<QRectF> boundsPolygons;
+        QVector<QRectF> boundsPolylines;
+
+        /// estimated memory footprint in kByte
+        int cost() const;
+    };
+
     struct strlbl_t
     {
         QPoint pt;
@@ -172,7 +192,8 @@ private:
     void processPrimaryMapData();
     void readFile(CFileExt& file, quint32 offset, quint32 size, QByteArray& data);
     void loadVisibleData(bool fast, polytype_t& polygons, polytype_t& polylines, pointtype_t& points, pointtype_t& pois, unsigned level, const QRectF& viewport, QPainter& p);
-    void loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStrTbl * strtbl, const QByteArray& rgndata, bool fast, const QRectF& viewport, polytype_t& polylines, polytype_t& polygons, pointtype_t& points, pointtype_t& pois);
+    void loadSubDiv(CFileExt &file, const subdiv_desc_t& subdiv, IGarminStrTbl * strtbl, const QByteArray& rgndata, subdiv_data_t& data);
+    void copyVisibleData(const subdiv_data_t& data, bool fast, const QRectF& viewport, polytype_t& polylines, polytype_t& polygons, pointtype_t& points, pointtype_t& pois);
     bool intersectsWithExistingLabel(const QRect &rect) const;
     void addLabel(const CGarminPoint &pt, const QRect &rect, CGarminTyp::label_type_e type);
     void drawPolygons(QPainter& p, polytype_t& lines);
@@ -478,6 +499,10 @@ private:
         own subfile parts.
      */
     QMap<QString, subfile_desc_t> subfiles;
+    /// the keys of the subfiles in the order of the map, used to resolve the ids of subfileIndex
+    QVector<QString> subfileKeys;
+    /// spatial index of all subfiles
+    CPackedRTree subfileIndex;
     /// relay the transparent flags from the subfiles
     bool transparent = false;
 
@@ -499,6 +524,16 @@ private:
     pointtype_t points;
     pointtype_t pois;
 
+    /**
+       @brief Decoded subdivisions of recent draw cycles
+
+       The key is made of the subfile's index, the map level and the subdivision's
+       number. The cost is given in kByte. The budget can be set by "subdivCacheSizeMB"
+       in the map's configuration.
+     */
+    QCache<quint64, subdiv_data_t> subdivCache;
+    qint32 subdivCacheSizeMB = 64;
+
     QVector<strlbl_t> labels;
 
     struct textpath_t
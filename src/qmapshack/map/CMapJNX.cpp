@@ -17,6 +17,7 @@
 **********************************************************************************************/
 
 #include "helpers/CDraw.h"
+#include "helpers/CFunctionJob.h"
 #include "inttypes.h"
 #include "map/CMapDraw.h"
 #include "map/CMapJNX.h"
@@ -24,6 +25,9 @@
 
 #include <QtGui>
 
+/// memory budget for decoded tiles in kByte
+#define TILEBUDGET (64 * 1024)
+
 static void readCString(QDataStream& stream, QByteArray& ba)
 {
     quint8 byte;
@@ -84,10 +88,12 @@ CMapJNX::CMapJNX(const QString &filename, CMapDraw *parent)
     qDebug() << "------------------------------";
     qDebug() << "JNX: try to open" << filename;
 
+    cache.setMaxCost(TILEBUDGET);
+
     qint32 productId = -1;
     readFile(filename, productId);
 
-    pjsrc = pj_init_plus("+proj=merc +ellps=WGS84 +datum=WGS84 +units=m +no_defs +towgs84=0,0,0");
+    pjsrc = pj_init_plus_ctx(pjctx, "+proj=merc +ellps=WGS84 +datum=WGS84 +units=m +no_defs +towgs84=0,0,0");
 
     isActivated = true;
 }
@@ -235,6 +241,22 @@ void CMapJNX::readFile(const QString& fn, qint32& productId)
             tile.area.setBottom(bottom * 180.0 / 0x7FFFFFFF);
             tile.area.setLeft(left * 180.0 / 0x7FFFFFFF);
         }
+
+        QVector<CPackedRTree::item_t> items(M);
+        for(quint32 m = 0; m < M; m++)
+        {
+            items[m].box = level.tiles[m].area;
+            items[m].id  = m;
+        }
+        level.index.build(items);
+    }
+
+    // keep the file open and mapped to avoid opening and seeking it on each redraw
+    file.close();
+    mapFile.file = QSharedPointer<QFile>(new QFile(fn));
+    if(mapFile.file->open(QIODevice::ReadOnly))
+    {
+        mapFile.data = mapFile.file->map(0, mapFile.file->size());
     }
 
     if(mapFile.lon1 < lon1)
@@ -255,6 +277,34 @@ void CMapJNX::readFile(const QString& fn, qint32& productId)
     }
 }
 
+QByteArray CMapJNX::readTile(file_t& mapFile, const tile_t& tile)
+{
+    if((qint64(tile.offset) + tile.size) > mapFile.file->size())
+    {
+        return QByteArray();
+    }
+
+    // the tiles are stored without the JPEG's SOI marker
+    QByteArray data;
+    data.reserve(tile.size + 2);
+    //(char) typecast needed to avoid MSVC compiler warning
+    //in MSVC, char is a signed type.
+    data.append((char) 0xFF);
+    data.append((char) 0xD8);
+
+    if(mapFile.data != nullptr)
+    {
+        data.append((const char*)mapFile.data + tile.offset, tile.size);
+    }
+    else
+    {
+        mapFile.file->seek(tile.offset);
+        data.append(mapFile.file->read(tile.size));
+    }
+
+    return data;
+}
+
 qint32 CMapJNX::scale2level(qreal s, const file_t& file)
 {
     qint32 idxLvl    = NOIDX;
@@ -306,8 +356,9 @@ void CMapJNX::draw(IDrawContext::buffer_t& buf) /* override */
     p.setOpacity(getOpacity() / 100.0);
     p.translate(-pp);
 
-    for(const file_t &mapFile : files)
+    for(int n = 0; n < files.size(); n++)
     {
+        file_t& mapFile = files[n];
         if(!viewport.intersects(mapFile.bbox))
         {
             continue;
@@ -350,47 +401,79 @@ void CMapJNX::draw(IDrawContext::buffer_t& buf) /* override */
             continue;
         }
 
-        QByteArray data(1024 * 1024 * 4, 0);
-        //(char) typecast needed to avoid MSVC compiler warning
-        //in MSVC, char is a signed type.
-        //Maybe the QByteArray declaration should be fixed ;-)
-        data[0] = (char) 0xFF;
-        data[1] = (char) 0xD8;
-        char * pData = data.data() + 2;
+        const QVector<tile_t>& tiles = mapFile.levels[level].tiles;
 
-        QFile file(mapFile.filename);
-        file.open(QIODevice::ReadOnly);
+        QVector<qint32> ids;
+        mapFile.levels[level].index.query(viewport, ids);
 
-        const QVector<tile_t>& tiles = mapFile.levels[level].tiles;
-        const quint32 M = tiles.size();
-        for(quint32 m = 0; m < M; m++)
+        // take decoded tiles from the cache, read all others
+        const qint32 M = ids.size();
+        QVector<quint64> keys(M);
+        QVector<QImage> imgs(M);
+        QVector<QByteArray> jpegs(M);
+        for(qint32 m = 0; m < M; m++)
+        {
+            keys[m] = (quint64(n) << 40) | (quint64(level) << 32) | quint32(ids[m]);
+
+            const QImage * cached = cache.object(keys[m]);
+            if(cached != nullptr)
+            {
+                imgs[m] = *cached;
+            }
+            else
+            {
+                jpegs[m] = readTile(mapFile, tiles[ids[m]]);
+            }
+        }
+
+        if(map->needsRedraw())
+        {
+            break;
+        }
+
+        // decode the new tiles in parallel
+        QImage * pImgs = imgs.data();
+        const QByteArray * pJpegs = jpegs.constData();
+        for(qint32 m = 0; m < M; m++)
+        {
+            if(!pJpegs[m].isEmpty())
+            {
+                pool.start(new CFunctionJob([pImgs, pJpegs, m](){pImgs[m].loadFromData(pJpegs[m], "JPG"); }));
+            }
+        }
+        pool.waitForDone();
+
+        for(qint32 m = 0; m < M; m++)
         {
             if(map->needsRedraw())
             {
                 break;
             }
 
-            const tile_t& tile = tiles[m];
+            const QImage& img = imgs[m];
+            if(img.isNull())
+            {
+                continue;
+            }
 
-            if(viewport.intersects(tile.area))
+            if(!jpegs[m].isEmpty())
             {
-                QImage img;
-                file.seek(tile.offset);
-                file.read(pData, tile.size);
-                img.loadFromData(data);
-
-                QPolygonF l(4);
-                l[0].rx() = tile.area.left()   * DEG_TO_RAD;
-                l[0].ry() = tile.area.top()    * DEG_TO_RAD;
-                l[1].rx() = tile.area.right()  * DEG_TO_RAD;
-                l[1].ry() = tile.area.top()    * DEG_TO_RAD;
-                l[2].rx() = tile.area.right()  * DEG_TO_RAD;
-                l[2].ry() = tile.area.bottom() * DEG_TO_RAD;
-                l[3].rx() = tile.area.left()   * DEG_TO_RAD;
-                l[3].ry() = tile.area.bottom() * DEG_TO_RAD;
-
-                drawTile(img, l, p);
+                cache.insert(keys[m], new QImage(img), qMax(1, (img.bytesPerLine() * img.height()) >> 10));
             }
+
+            const tile_t& tile = tiles[ids[m]];
+
+            QPolygonF l(4);
+            l[0].rx() = tile.area.left()   * DEG_TO_RAD;
+            l[0].ry() = tile.area.top()    * DEG_TO_RAD;
+            l[1].rx() = tile.area.right()  * DEG_TO_RAD;
+            l[1].ry() = tile.area.top()    * DEG_TO_RAD;
+            l[2].rx() = tile.area.right()  * DEG_TO_RAD;
+            l[2].ry() = tile.area.bottom() * DEG_TO_RAD;
+            l[3].rx() = tile.area.left()   * DEG_TO_RAD;
+            l[3].ry() = tile.area.bottom() * DEG_TO_RAD;
+
+            drawTile(img, l, p);
         }
     }
 }
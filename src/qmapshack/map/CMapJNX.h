@@ -19,9 +19,15 @@
 #ifndef CMAPJNX_H
 #define CMAPJNX_H
 
+#include "helpers/CPackedRTree.h"
 #include "map/IMap.h"
 
+#include <QCache>
+#include <QSharedPointer>
+#include <QThreadPool>
+
 class CMapDraw;
+class QFile;
 
 class CMapJNX : public IMap
 {
@@ -79,6 +85,8 @@ private:
         QString copyright2;
 
         QVector<tile_t> tiles;
+        /// spatial index of the tiles, the ids are the indices into tiles
+        CPackedRTree index;
     };
 
 
@@ -92,10 +100,23 @@ private:
 
         QString filename;
         QVector<level_t> levels;
+
+        /// the file is kept open for the lifetime of the map
+        QSharedPointer<QFile> file;
+        /// the memory mapped file, nullptr if mapping failed
+        const uchar * data = nullptr;
     };
 
     void readFile(const QString& fn, qint32& productId);
     qint32 scale2level(qreal s, const file_t& file);
+    /**
+       @brief Read the raw JPEG data of a tile
+
+       @param mapFile   the file the tile belongs to
+       @param tile      the tile
+       @return The JPEG data with the SOI marker restored. Empty on errors.
+     */
+    QByteArray readTile(file_t& mapFile, const tile_t& tile);
 
     QList<file_t> files;
 
@@ -103,6 +124,11 @@ private:
     qreal lat1 = -90;
     qreal lon2 = -180;
     qreal lat2 = 90;
+
+    /// recently decoded tiles, the cost is in kByte
+    QCache<quint64, QImage> cache;
+    /// thread pool to decode tiles in parallel
+    QThreadPool pool;
 };
 
 #endif // CMAPJNX_H
@@ -16,23 +16,158 @@
 
 **********************************************************************************************/
 
+#include "canvas/CCanvas.h"
 #include "CMainWindow.h"
+#include "helpers/CDraw.h"
 #include "helpers/CFileExt.h"
+#include "helpers/CFunctionJob.h"
 #include "map/CMapDraw.h"
 #include "map/CMapMAP.h"
+#include "units/IUnit.h"
 
 #include <proj_api.h>
+#include <QPainterPath>
 #include <QtWidgets>
 
 #define INT_TO_DEG(x) (qreal(x) / 1e6)
 
 #define INT_TO_RAD(x) (qreal(x) / (1e6 * RAD_TO_DEG))
 
+/// the size of rendered tiles in pixel
+#define TILESIZE 256
+/// memory budget for rendered tiles in kByte
+#define TILEBUDGET (64 * 1024)
+/// the limit of the Mercator projection
+#define MAXLAT 85.0511
 
+// Mapsforge element flags
+#define FLAG_NAME           0x80
+#define FLAG_HOUSENUMBER    0x40
+#define FLAG_ELEVATION      0x20
+#define FLAG_REF            0x20
+#define FLAG_LABELPOS       0x10
+#define FLAG_DATABLOCKS     0x08
+#define FLAG_DOUBLEDELTA    0x04
+
+static qint32 lonToTileX(qreal lon, quint8 zoom)
+{
+    const qint32 n = 1 << zoom;
+    return qBound(0, qFloor((lon + 180.0) / 360.0 * n), n - 1);
+}
+
+static qint32 latToTileY(qreal lat, quint8 zoom)
+{
+    const qint32 n = 1 << zoom;
+    const qreal s  = qSin(qBound(-MAXLAT, lat, MAXLAT) * DEG_TO_RAD);
+    return qBound(0, qFloor((0.5 - qLn((1 + s) / (1 - s)) / (4 * M_PI)) * n), n - 1);
+}
+
+static qreal tileXToLon(qint32 x, quint8 zoom)
+{
+    return qreal(x) / (1 << zoom) * 360.0 - 180.0;
+}
+
+static qreal tileYToLat(qint32 y, quint8 zoom)
+{
+    const qreal n = M_PI - 2.0 * M_PI * y / (1 << zoom);
+    return RAD_TO_DEG * qAtan(0.5 * (qExp(n) - qExp(-n)));
+}
+
+static qreal lonToPx(qreal lon, qreal worldSize)
+{
+    return (lon + 180.0) / 360.0 * worldSize;
+}
+
+static qreal latToPx(qreal lat, qreal worldSize)
+{
+    const qreal s = qSin(qBound(-MAXLAT, lat, MAXLAT) * DEG_TO_RAD);
+    return (0.5 - qLn((1 + s) / (1 - s)) / (4 * M_PI)) * worldSize;
+}
+
+/// convert world pixel of a zoom level to lon/lat in [rad]
+static QPointF pxToRad(const QPointF& px, qreal worldSize)
+{
+    const qreal n = M_PI - 2.0 * M_PI * px.y() / worldSize;
+    return QPointF((px.x() / worldSize * 2.0 - 1.0) * M_PI, qAtan(0.5 * (qExp(n) - qExp(-n))));
+}
+
+static qint8 sizeOfValue(const QString& tag)
+{
+    if(tag.endsWith("=%b"))
+    {
+        return 1;
+    }
+    if(tag.endsWith("=%h"))
+    {
+        return 2;
+    }
+    if(tag.endsWith("=%i") || tag.endsWith("=%f"))
+    {
+        return 4;
+    }
+    if(tag.endsWith("=%s"))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+   @brief Get the mask of the 4x4 sub-tiles of a block covered by a tile
+
+   @param col       the tile's column
+   @param row       the tile's row
+   @param shift     the tile's zoom level minus the base zoom level of the block
+ */
+static quint16 subTileMask(qint32 col, qint32 row, qint32 shift)
+{
+    qint32 x, y, n;
+    if(shift == 1)
+    {
+        x = (col & 1) * 2;
+        y = (row & 1) * 2;
+        n = 2;
+    }
+    else
+    {
+        x = (col >> (shift - 2)) & 0x03;
+        y = (row >> (shift - 2)) & 0x03;
+        n = 1;
+    }
+
+    quint16 mask = 0;
+    for(qint32 dy = 0; dy < n; dy++)
+    {
+        for(qint32 dx = 0; dx < n; dx++)
+        {
+            mask |= 1 << (15 - ((y + dy) * 4 + x + dx));
+        }
+    }
+    return mask;
+}
+
+static QString cleanName(const utf8& str)
+{
+    // multilingual names are "default\rlang\bname\r..."
+    const QString& name = str.val;
+    return name.left(name.indexOf('\r'));
+}
+
+static void drawText(QPainter& p, const CRenderTheme::instruction_t& inst, const QString& text, const QPointF& pos)
+{
+    QPainterPath path;
+    path.addText(pos, inst.font, text);
+    if(inst.widthHalo > 0)
+    {
+        p.strokePath(path, QPen(inst.colorHalo, inst.widthHalo, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    }
+    p.fillPath(path, inst.colorText);
+}
 
 CMapMAP::CMapMAP(const QString &filename, CMapDraw *parent)
-    : IMap(eFeatVisibility | eFeatVectorItems, parent)
+    : IMap(eFeatVisibility | eFeatVectorItems | eFeatTypFile, parent)
     , filename(filename)
+    , file(filename)
 {
     qDebug() << "------------------------------";
     qDebug() << "MAP: try to open" << filename;
@@ -47,12 +182,56 @@ CMapMAP::CMapMAP(const QString &filename, CMapDraw *parent)
         return;
     }
 
+    // keep the file open and mapped, the tiles are rendered by several threads
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        QMessageBox::critical(CMainWindow::getBestWidgetForParent(), tr("Failed ..."), tr("Failed to open: ") + filename, QMessageBox::Abort);
+        return;
+    }
+    data = file.map(0, file.size());
+
+    pjsrc = pj_init_plus_ctx(pjctx, "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs");
+
+    loadTheme();
+    tiles.setMaxCost(TILEBUDGET);
 
     isActivated = true;
 }
 
 CMapMAP::~CMapMAP()
 {
+    pool.waitForDone();
+    pj_free(pjsrc);
+}
+
+void CMapMAP::slotSetTypeFile(const QString& filename)
+{
+    IMap::slotSetTypeFile(filename);
+    loadTheme();
+    CCanvas::triggerCompleteUpdate(CCanvas::eRedrawMap);
+}
+
+void CMapMAP::loadTheme()
+{
+    // the new theme is loaded aside, tiles still being rendered keep the old one
+    QSharedPointer<CRenderTheme> newTheme(new CRenderTheme());
+
+    QString msg;
+    if(!typeFile.isEmpty() && !newTheme->load(typeFile, msg))
+    {
+        qWarning() << msg;
+    }
+
+    if(typeFile.isEmpty() || !msg.isEmpty())
+    {
+        newTheme->load("://map/mapsforge/Default.xml", msg);
+    }
+
+    newTheme->compile(header.tagsPOIs, header.tagsWays);
+
+    QMutexLocker lock(&mutex);
+    theme = newTheme;
+    tiles.clear();
 }
 
 void CMapMAP::readBasics()
@@ -142,11 +321,934 @@ void CMapMAP::readBasics()
         stream >> layer.offsetSubFile;
         stream >> layer.sizeSubFile;
 
+        layer.boundaryLeft   = lonToTileX(INT_TO_DEG(header.minLon), layer.baseZoom);
+        layer.boundaryTop    = latToTileY(INT_TO_DEG(header.maxLat), layer.baseZoom);
+        layer.boundaryRight  = lonToTileX(INT_TO_DEG(header.maxLon), layer.baseZoom);
+        layer.boundaryBottom = latToTileY(INT_TO_DEG(header.minLat), layer.baseZoom);
+
         layers << layer;
     }
     // ---------- end file header ----------------------
+
+    if(stream.status() != QDataStream::Ok || layers.isEmpty())
+    {
+        throw exce_t(errFormat, tr("Bad file format: ") + filename);
+    }
+
+    for(const QString& tag : header.tagsPOIs)
+    {
+        sizeValuesPOIs << sizeOfValue(tag);
+    }
+    for(const QString& tag : header.tagsWays)
+    {
+        sizeValuesWays << sizeOfValue(tag);
+    }
+    tagSea = header.tagsWays.indexOf("natural=sea");
+}
+
+const CMapMAP::layer_t * CMapMAP::findLayer(quint8 zoom) const
+{
+    // beyond the last zoom interval the data of the most detailed one is used
+    const layer_t * best = nullptr;
+    for(const layer_t& layer : layers)
+    {
+        if((zoom >= layer.minZoom) && (zoom <= layer.maxZoom))
+        {
+            return &layer;
+        }
+        if((zoom > layer.maxZoom) && ((best == nullptr) || (layer.maxZoom > best->maxZoom)))
+        {
+            best = &layer;
+        }
+    }
+    return best;
 }
 
 void CMapMAP::draw(IDrawContext::buffer_t& buf) /* override */
 {
+    if(map->needsRedraw())
+    {
+        return;
+    }
+
+    QPointF bufferScale = buf.scale * buf.zoomFactor;
+
+    if(isOutOfScale(bufferScale))
+    {
+        return;
+    }
+
+    // find the tile zoom level the same way as for online maps
+    qint32 z    = 20;
+    qreal d     = NOFLOAT;
+    for(qint32 i = 0; i < 21; i++)
+    {
+        qreal s2 = 0.055 * (1 << i);
+        if(qAbs(s2 - bufferScale.x()) < d)
+        {
+            z = i;
+            d = qAbs(s2 - bufferScale.x());
+        }
+    }
+    const quint8 zoom = 21 - z;
+
+    // get pixel offset of top left buffer corner
+    QPointF pp = buf.ref1;
+    map->convertRad2Px(pp);
+
+    // start to draw the map
+    QPainter p(&buf.image);
+    USE_ANTI_ALIASING(p, true);
+    p.setOpacity(getOpacity() / 100.0);
+    p.translate(-pp);
+
+    // calculate maximum viewport and clip it to the map's area
+    qreal x1 = qMax(qMin(buf.ref1.x(), buf.ref4.x()), ref1.x()) * RAD_TO_DEG;
+    qreal y1 = qMin(qMax(buf.ref1.y(), buf.ref2.y()), ref1.y()) * RAD_TO_DEG;
+    qreal x2 = qMin(qMax(buf.ref2.x(), buf.ref3.x()), ref2.x()) * RAD_TO_DEG;
+    qreal y2 = qMax(qMin(buf.ref3.y(), buf.ref4.y()), ref2.y()) * RAD_TO_DEG;
+
+    if((x1 >= x2) || (y2 >= y1))
+    {
+        return;
+    }
+
+    const qint32 col1 = lonToTileX(x1, zoom);
+    const qint32 col2 = lonToTileX(x2, zoom);
+    const qint32 row1 = latToTileY(y1, zoom);
+    const qint32 row2 = latToTileY(y2, zoom);
+
+    // the settings are taken once, all tiles of this call are rendered with them
+    render_t render;
+    render.zoom          = zoom;
+    render.detail        = qBound(0, zoom + adjustDetailLevel, 22);
+    render.showPolygons  = showPolygons;
+    render.showPolylines = showPolylines;
+    render.showPOIs      = showPOIs;
+
+    // the tiles depend on the level of detail and the element types shown, too
+    const quint64 flags = (render.showPolygons ? 0x01 : 0) | (render.showPolylines ? 0x02 : 0) | (render.showPOIs ? 0x04 : 0);
+
+    // take rendered tiles from the cache, render all others in parallel
+    QVector<QPoint> idx;
+    QVector<quint64> keys;
+    QVector<tile_t> data;
+    QVector<bool> rendered;
+    {
+        QMutexLocker lock(&mutex);
+        render.theme = theme;
+
+        for(qint32 row = row1; row <= row2; row++)
+        {
+            for(qint32 col = col1; col <= col2; col++)
+            {
+                const quint64 key = (flags << 58) | (quint64(render.detail) << 53) | (quint64(zoom) << 48) | (quint64(col) << 24) | quint64(row);
+                idx   << QPoint(col, row);
+                keys  << key;
+
+                const tile_t * cached = tiles.object(key);
+                data     << (cached != nullptr ? *cached : tile_t());
+                rendered << (cached == nullptr);
+            }
+        }
+    }
+
+    const qint32 M = idx.size();
+    tile_t * pData = data.data();
+    for(qint32 m = 0; m < M; m++)
+    {
+        if(rendered[m])
+        {
+            const QPoint& tile = idx[m];
+            pool.start(new CFunctionJob([this, pData, m, &render, tile](){renderTile(render, tile.x(), tile.y(), pData[m]); }));
+        }
+    }
+    pool.waitForDone();
+
+    if(map->needsRedraw())
+    {
+        return;
+    }
+
+    {
+        // tiles rendered with a theme replaced meanwhile are not cached
+        QMutexLocker lock(&mutex);
+        for(qint32 m = 0; (m < M) && (theme == render.theme); m++)
+        {
+            const tile_t& tile = data[m];
+            if(rendered[m] && !tile.img.isNull())
+            {
+                const qint32 cost = tile.img.bytesPerLine() * tile.img.height() + tile.labels.size() * sizeof(label_t);
+                tiles.insert(keys[m], new tile_t(tile), qMax(1, cost >> 10));
+            }
+        }
+    }
+
+    QVector<label_t> labels;
+    for(qint32 m = 0; m < M; m++)
+    {
+        const QImage& img = data[m].img;
+        if(img.isNull())
+        {
+            continue;
+        }
+        labels += data[m].labels;
+
+        const qint32 col = idx[m].x();
+        const qint32 row = idx[m].y();
+
+        QPolygonF l;
+
+        qreal xx1 = tileXToLon(col, zoom) * DEG_TO_RAD;
+        qreal yy1 = tileYToLat(row, zoom) * DEG_TO_RAD;
+        qreal xx2 = tileXToLon(col + 1, zoom) * DEG_TO_RAD;
+        qreal yy2 = tileYToLat(row + 1, zoom) * DEG_TO_RAD;
+
+        l << QPointF(xx1, yy1) << QPointF(xx2, yy1) << QPointF(xx2, yy2) << QPointF(xx1, yy2);
+        drawTile(img, l, p);
+    }
+
+    // labels are placed across all tiles to not cut them at the tiles' borders
+    drawLabels(p, QRectF(pp, buf.image.size()), zoom, labels);
+}
+
+void CMapMAP::drawLabels(QPainter& p, const QRectF& rectBuffer, quint8 zoom, QVector<label_t>& labels)
+{
+    // labels with higher priority are placed first
+    std::stable_sort(labels.begin(), labels.end(), [](const label_t& a, const label_t& b)
+    {
+        return a.inst->priority > b.inst->priority;
+    });
+
+    // convert the anchors and segments from world pixel to the buffer's pixel
+    const qreal worldSize = qreal(TILESIZE) * (1 << zoom);
+    const qint32 N = labels.size();
+    QPolygonF pts(N * 3);
+    for(qint32 n = 0; n < N; n++)
+    {
+        const label_t& label = labels[n];
+        pts[n * 3]     = pxToRad(label.pos, worldSize);
+        pts[n * 3 + 1] = pxToRad(label.pt1, worldSize);
+        pts[n * 3 + 2] = pxToRad(label.pt2, worldSize);
+    }
+    map->convertRad2Px(pts);
+
+    QList<QRectF> blocked;
+    for(qint32 n = 0; n < N; n++)
+    {
+        const CRenderTheme::instruction_t& inst = *labels[n].inst;
+        const QString& text = labels[n].text;
+        const QPointF& pos = pts[n * 3];
+        const QPointF& pt1 = pts[n * 3 + 1];
+        const QPointF& pt2 = pts[n * 3 + 2];
+
+        switch(inst.type)
+        {
+        case CRenderTheme::eInstSymbol:
+        {
+            QRectF rect(QPointF(), inst.symbol.size());
+            rect.moveCenter(pos);
+            if(!rectBuffer.contains(rect) || CDraw::doesOverlap(blocked, rect))
+            {
+                continue;
+            }
+            blocked << rect;
+            p.drawImage(rect.topLeft(), inst.symbol);
+            break;
+        }
+
+        case CRenderTheme::eInstLineSymbol:
+        {
+            // line symbols are part of the line and do not block labels
+            QRectF box(QPointF(), inst.symbol.size());
+            box.moveCenter(QPointF(inst.alignCenter ? 0 : box.width() / 2, inst.dy));
+
+            QTransform trFrm;
+            trFrm.translate(pos.x(), pos.y());
+            trFrm.rotate(qAtan2(pt2.y() - pt1.y(), pt2.x() - pt1.x()) * RAD_TO_DEG);
+            if(!rectBuffer.contains(trFrm.mapRect(box)))
+            {
+                continue;
+            }
+
+            p.save();
+            p.setTransform(trFrm, true);
+            p.drawImage(box.topLeft(), inst.symbol);
+            p.restore();
+            break;
+        }
+
+        case CRenderTheme::eInstCaption:
+        {
+            const QRectF rectText = QFontMetricsF(inst.font).boundingRect(text);
+            QRectF rect = rectText;
+            rect.moveCenter(pos + QPointF(0, inst.dy));
+            if(!rectBuffer.contains(rect) || CDraw::doesOverlap(blocked, rect))
+            {
+                continue;
+            }
+            blocked << rect;
+            drawText(p, inst, text, rect.topLeft() - rectText.topLeft());
+            break;
+        }
+
+        case CRenderTheme::eInstPathText:
+        {
+            // the segment might be shorter than the text at the buffer's scale
+            const QRectF rectText = QFontMetricsF(inst.font).boundingRect(text);
+            if(QLineF(pt1, pt2).length() < rectText.width())
+            {
+                continue;
+            }
+
+            qreal a = qAtan2(pt2.y() - pt1.y(), pt2.x() - pt1.x()) * RAD_TO_DEG;
+            if(a > 90)
+            {
+                a -= 180;
+            }
+            else if(a < -90)
+            {
+                a += 180;
+            }
+
+            QTransform trFrm;
+            trFrm.translate(pos.x(), pos.y());
+            trFrm.rotate(a);
+
+            QRectF box = rectText;
+            box.moveCenter(QPointF());
+            const QRectF rect = trFrm.mapRect(box);
+            if(!rectBuffer.contains(rect) || CDraw::doesOverlap(blocked, rect))
+            {
+                continue;
+            }
+            blocked << rect;
+
+            p.save();
+            p.setTransform(trFrm, true);
+            drawText(p, inst, text, box.topLeft() - rectText.topLeft());
+            p.restore();
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+}
+
+void CMapMAP::renderTile(const render_t& render, qint32 col, qint32 row, tile_t& tile)
+{
+    if(map->needsRedraw())
+    {
+        return;
+    }
+
+    const CRenderTheme& theme = *render.theme;
+    const quint8 zoom = render.zoom;
+
+    // the level of detail selects the zoom interval, the data and the theme's rules
+    const quint8 detail = render.detail;
+    const layer_t * layer = findLayer(detail);
+    if(layer == nullptr)
+    {
+        return;
+    }
+    const quint8 query = qBound(layer->minZoom, detail, layer->maxZoom);
+
+    // find the blocks of the sub-file covering the tile
+    qint32 bx1, by1, bx2, by2;
+    quint16 bitmask = 0xFFFF;
+    if(zoom >= layer->baseZoom)
+    {
+        const qint32 shift = zoom - layer->baseZoom;
+        bx1 = bx2 = col >> shift;
+        by1 = by2 = row >> shift;
+        if(shift > 0)
+        {
+            bitmask = subTileMask(col, row, shift);
+        }
+    }
+    else
+    {
+        const qint32 shift = layer->baseZoom - zoom;
+        bx1 = col << shift;
+        by1 = row << shift;
+        bx2 = ((col + 1) << shift) - 1;
+        by2 = ((row + 1) << shift) - 1;
+    }
+
+    bx1 = qMax(bx1, layer->boundaryLeft);
+    by1 = qMax(by1, layer->boundaryTop);
+    bx2 = qMin(bx2, layer->boundaryRight);
+    by2 = qMin(by2, layer->boundaryBottom);
+
+    // read all elements and convert their coordinates to tile pixel
+    const qreal worldSize = qreal(TILESIZE) * (1 << zoom);
+    const QPointF origin(qreal(col) * TILESIZE, qreal(row) * TILESIZE);
+
+    QVector<poi_t> pois;
+    QVector<way_t> ways;
+    bool isAllWater = true;
+    for(qint32 by = by1; by <= by2; by++)
+    {
+        for(qint32 bx = bx1; bx <= bx2; bx++)
+        {
+            bool isWater = false;
+            const QByteArray& block = readBlock(*layer, bx, by, isWater);
+            isAllWater &= isWater;
+            if(!block.isEmpty())
+            {
+                decodeBlock(block, *layer, query, bx, by, bitmask, origin, worldSize, pois, ways);
+            }
+        }
+
+        if(map->needsRedraw())
+        {
+            return;
+        }
+    }
+
+    const QRectF rectTile(0, 0, TILESIZE, TILESIZE);
+
+    // blocks completely covered by water have no data, fill them by the theme's sea area
+    if(isAllWater && (tagSea >= 0) && (bx1 <= bx2) && (by1 <= by2))
+    {
+        way_t sea;
+        sea.tags << tagSea;
+        sea.lines << QPolygonF(rectTile);
+        sea.path.addPolygon(sea.lines.first());
+        ways.prepend(sea);
+    }
+
+    // ---------- style pass: collect what to draw ----------------------
+    struct item_t
+    {
+        qint8 layer;
+        qint32 level;
+        const way_t * way;
+        const CRenderTheme::instruction_t * inst;
+    };
+
+    auto getText = [](const QString& key, const QString& name, const QString& houseNumber, const QString& ref, const QString& ele)
+                   {
+                       if(key == "name")
+                       {
+                           return name;
+                       }
+                       if(key == "ref")
+                       {
+                           return ref;
+                       }
+                       if(key == "addr:housenumber")
+                       {
+                           return houseNumber;
+                       }
+                       if(key == "ele")
+                       {
+                           return ele;
+                       }
+                       return QString();
+                   };
+
+    QVector<item_t> items;
+    QVector<label_t> labels;
+    QVector<const CRenderTheme::instruction_t*> insts;
+
+    for(const way_t& way : ways)
+    {
+        const QPolygonF& outer = way.lines.first();
+        const bool closed = (outer.size() > 2) && (outer.first() == outer.last());
+
+        insts.clear();
+        theme.match(CRenderTheme::eElementWay, way.tags, detail, closed, insts);
+        for(const CRenderTheme::instruction_t * inst : insts)
+        {
+            switch(inst->type)
+            {
+            case CRenderTheme::eInstArea:
+                if(render.showPolygons)
+                {
+                    items << item_t {way.layer, inst->level, &way, inst};
+                }
+                break;
+
+            case CRenderTheme::eInstLine:
+                if(render.showPolylines)
+                {
+                    items << item_t {way.layer, inst->level, &way, inst};
+                }
+                break;
+
+            case CRenderTheme::eInstCaption:
+            {
+                const QString& text = getText(inst->key, way.name, way.houseNumber, way.ref, QString());
+                if(!text.isEmpty())
+                {
+                    labels << label_t {inst, text, way.label, way.label, way.label};
+                }
+                break;
+            }
+
+            case CRenderTheme::eInstPathText:
+            {
+                const QString& text = getText(inst->key, way.name, way.houseNumber, way.ref, QString());
+                if(text.isEmpty())
+                {
+                    break;
+                }
+
+                // follow the longest segment that is long enough for the text
+                const qreal width = QFontMetricsF(inst->font).width(text);
+                qreal length = width + 10;
+                qint32 best  = -1;
+                for(qint32 i = 1; i < outer.size(); i++)
+                {
+                    const qreal l = QLineF(outer[i - 1], outer[i]).length();
+                    if(l > length)
+                    {
+                        length = l;
+                        best   = i;
+                    }
+                }
+
+                if(best > 0)
+                {
+                    const QPointF& pt1 = outer[best - 1];
+                    const QPointF& pt2 = outer[best];
+                    labels << label_t {inst, text, (pt1 + pt2) / 2, pt1, pt2};
+                }
+                break;
+            }
+
+            case CRenderTheme::eInstSymbol:
+                if(!inst->symbol.isNull())
+                {
+                    labels << label_t {inst, QString(), way.label, way.label, way.label};
+                }
+                break;
+
+            case CRenderTheme::eInstLineSymbol:
+            {
+                if(inst->symbol.isNull())
+                {
+                    break;
+                }
+
+                // walk along the line and add a symbol each repeatGap pixel
+                qreal next = inst->repeatStart;
+                qreal dist = 0;
+                for(qint32 i = 1; i < outer.size(); i++)
+                {
+                    const QPointF& pt1 = outer[i - 1];
+                    const QPointF& pt2 = outer[i];
+                    const qreal l = QLineF(pt1, pt2).length();
+                    while((l > 0) && (next <= dist + l))
+                    {
+                        labels << label_t {inst, QString(), pt1 + (pt2 - pt1) * ((next - dist) / l), pt1, pt2};
+                        next = inst->repeat ? next + inst->repeatGap : NOFLOAT;
+                    }
+                    dist += l;
+                }
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+    }
+
+    QVector<QPair<QPointF, const CRenderTheme::instruction_t*> > circles;
+    if(render.showPOIs)
+    {
+        for(const poi_t& poi : pois)
+        {
+            insts.clear();
+            theme.match(CRenderTheme::eElementNode, poi.tags, detail, false, insts);
+            for(const CRenderTheme::instruction_t * inst : insts)
+            {
+                if(inst->type == CRenderTheme::eInstCircle)
+                {
+                    circles << qMakePair(poi.pos, inst);
+                }
+                else if(inst->type == CRenderTheme::eInstCaption)
+                {
+                    const QString& text = getText(inst->key, poi.name, poi.houseNumber, QString(), poi.ele);
+                    if(!text.isEmpty())
+                    {
+                        labels << label_t {inst, text, poi.pos, poi.pos, poi.pos};
+                    }
+                }
+                else if((inst->type == CRenderTheme::eInstSymbol) && !inst->symbol.isNull())
+                {
+                    labels << label_t {inst, QString(), poi.pos, poi.pos, poi.pos};
+                }
+            }
+        }
+    }
+
+    // Mapsforge draws by the element's layer first, then by the order of the theme
+    std::stable_sort(items.begin(), items.end(), [](const item_t& a, const item_t& b)
+    {
+        return a.layer == b.layer ? a.level < b.level : a.layer < b.layer;
+    });
+
+    // ---------- render pass ----------------------
+    QImage img(TILESIZE, TILESIZE, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::transparent);
+
+    QPainter p(&img);
+    USE_ANTI_ALIASING(p, true);
+
+    // the background is limited to the map's area to not cover other maps
+    const QPointF ptMap1(lonToPx(INT_TO_DEG(header.minLon), worldSize), latToPx(INT_TO_DEG(header.maxLat), worldSize));
+    const QPointF ptMap2(lonToPx(INT_TO_DEG(header.maxLon), worldSize), latToPx(INT_TO_DEG(header.minLat), worldSize));
+    p.fillRect(QRectF(ptMap1 - origin, ptMap2 - origin) & rectTile, theme.getBackground());
+
+    // Mapsforge increases the stroke width by 50% for each zoom level above 12
+    const qreal scaleStroke = qPow(1.5, qMax(0, zoom - 12));
+
+    for(const item_t& item : items)
+    {
+        QPen pen = item.inst->pen;
+        if(item.inst->scaleStroke && (pen.style() != Qt::NoPen))
+        {
+            pen.setWidthF(pen.widthF() * scaleStroke);
+        }
+        p.setPen(pen);
+
+        if(item.inst->type == CRenderTheme::eInstArea)
+        {
+            p.setBrush(item.inst->brush);
+            p.drawPath(item.way->path);
+        }
+        else
+        {
+            p.setBrush(Qt::NoBrush);
+            for(const QPolygonF& line : item.way->lines)
+            {
+                p.drawPolyline(line);
+            }
+        }
+    }
+
+    for(const QPair<QPointF, const CRenderTheme::instruction_t*>& circle : circles)
+    {
+        const CRenderTheme::instruction_t * inst = circle.second;
+        const qreal r = inst->scaleRadius ? inst->radius * scaleStroke : inst->radius;
+        p.setPen(inst->pen);
+        p.setBrush(inst->brush);
+        p.drawEllipse(circle.first, r, r);
+    }
+
+    p.end();
+
+    // keep the labels anchored on this tile, the neighbours keep all others. The
+    // labels are placed after all tiles are drawn.
+    for(label_t& label : labels)
+    {
+        const QPointF& pos = label.pos;
+        if((pos.x() >= 0) && (pos.x() < TILESIZE) && (pos.y() >= 0) && (pos.y() < TILESIZE))
+        {
+            label.pos += origin;
+            label.pt1 += origin;
+            label.pt2 += origin;
+            tile.labels << label;
+        }
+    }
+
+    tile.img   = img;
+    tile.theme = render.theme;
+}
+
+QByteArray CMapMAP::readData(quint64 offset, quint64 size)
+{
+    if((offset + size) > quint64(file.size()))
+    {
+        return QByteArray();
+    }
+
+    if(data != nullptr)
+    {
+        // the data stays valid as long as the file is mapped
+        return QByteArray::fromRawData((const char*)data + offset, size);
+    }
+
+    QMutexLocker lock(&mutexFile);
+    file.seek(offset);
+    return file.read(size);
+}
+
+QByteArray CMapMAP::readBlock(const layer_t& layer, qint32 bx, qint32 by, bool& isWater)
+{
+    const quint64 width  = layer.boundaryRight - layer.boundaryLeft + 1;
+    const quint64 height = layer.boundaryBottom - layer.boundaryTop + 1;
+    const quint64 n      = quint64(by - layer.boundaryTop) * width + quint64(bx - layer.boundaryLeft);
+    const bool isLast    = (n + 1) == (width * height);
+
+    // the index is a list of 5 byte offsets relative to the sub-file, the MSB is the water flag
+    const quint64 offsetIndex = layer.offsetSubFile + ((header.flags & eHeaderFlagDebugInfo) ? 16 : 0) + n * 5;
+    const QByteArray& index = readData(offsetIndex, isLast ? 5 : 10);
+    if(index.isEmpty())
+    {
+        return QByteArray();
+    }
+
+    auto readEntry = [&index](int pos)
+                     {
+                         const uchar * p = (const uchar*)index.constData() + pos;
+                         return (quint64(p[0]) << 32) | (quint64(p[1]) << 24) | (quint64(p[2]) << 16) | (quint64(p[3]) << 8) | quint64(p[4]);
+                     };
+
+    const quint64 entry = readEntry(0);
+    isWater = (entry & 0x8000000000ULL) != 0;
+
+    const quint64 offset = entry & 0x7FFFFFFFFFULL;
+    const quint64 next   = isLast ? layer.sizeSubFile : (readEntry(5) & 0x7FFFFFFFFFULL);
+    if(next <= offset)
+    {
+        return QByteArray();
+    }
+
+    return readData(layer.offsetSubFile + offset, next - offset);
+}
+
+void CMapMAP::readTags(QDataStream& stream, qint32 n, const QVector<qint8>& sizeValues, QVector<quint32>& tags)
+{
+    tags.reserve(n);
+    for(qint32 i = 0; i < n; i++)
+    {
+        uintX tag;
+        stream >> tag;
+        tags << quint32(tag.val);
+    }
+
+    // Mapsforge v5 stores the values of tags like "ele=%i" right after the tags
+    for(quint32 tag : tags)
+    {
+        const qint8 size = tag < quint32(sizeValues.size()) ? sizeValues[tag] : 0;
+        if(size < 0)
+        {
+            utf8 value;
+            stream >> value;
+        }
+        else if(size > 0)
+        {
+            stream.skipRawData(size);
+        }
+    }
+}
+
+void CMapMAP::decodeBlock(const QByteArray& block, const layer_t& layer, quint8 zoom, qint32 bx, qint32 by, quint16 bitmask
+                          , const QPointF& origin, qreal worldSize, QVector<poi_t>& pois, QVector<way_t>& ways)
+{
+    QByteArray tmp(block);
+    QBuffer buffer(&tmp);
+    buffer.open(QIODevice::ReadOnly);
+
+    QDataStream stream(&buffer);
+    stream.setByteOrder(QDataStream::BigEndian);
+
+    const bool hasDebugInfo = header.flags & eHeaderFlagDebugInfo;
+    if(hasDebugInfo)
+    {
+        stream.skipRawData(32);
+    }
+
+    // the zoom table holds the number of elements per zoom level, the elements are sorted by zoom level
+    quint64 nPOIs = 0;
+    quint64 nWays = 0;
+    for(qint32 z = layer.minZoom; z <= layer.maxZoom; z++)
+    {
+        uintX n1, n2;
+        stream >> n1 >> n2;
+        if(z <= zoom)
+        {
+            nPOIs += n1;
+            nWays += n2;
+        }
+    }
+
+    uintX offsetWays;
+    stream >> offsetWays;
+    const qint64 posWays = buffer.pos() + offsetWays.val;
+
+    // all coordinates are in microdegrees relative to the block's top left corner
+    const qint64 latTile = qRound64(tileYToLat(by, layer.baseZoom) * 1e6);
+    const qint64 lonTile = qRound64(tileXToLon(bx, layer.baseZoom) * 1e6);
+
+    auto toPx = [&](qint64 lat, qint64 lon)
+                {
+                    return QPointF(lonToPx(INT_TO_DEG(lon), worldSize), latToPx(INT_TO_DEG(lat), worldSize)) - origin;
+                };
+
+    for(quint64 i = 0; (i < nPOIs) && (stream.status() == QDataStream::Ok); i++)
+    {
+        if(hasDebugInfo)
+        {
+            stream.skipRawData(32);
+        }
+
+        poi_t poi;
+        intX lat, lon;
+        quint8 special, flags;
+        stream >> lat >> lon >> special;
+        poi.layer = qint8(special >> 4) - 5;
+        readTags(stream, special & 0x0F, sizeValuesPOIs, poi.tags);
+
+        stream >> flags;
+        if(flags & FLAG_NAME)
+        {
+            utf8 name;
+            stream >> name;
+            poi.name = cleanName(name);
+        }
+        if(flags & FLAG_HOUSENUMBER)
+        {
+            utf8 houseNumber;
+            stream >> houseNumber;
+            poi.houseNumber = houseNumber;
+        }
+        if(flags & FLAG_ELEVATION)
+        {
+            intX ele;
+            stream >> ele;
+            poi.ele = QString::number(ele.val);
+        }
+
+        poi.pos = toPx(latTile + lat.val, lonTile + lon.val);
+        pois << poi;
+    }
+
+    buffer.seek(posWays);
+    for(quint64 i = 0; (i < nWays) && (stream.status() == QDataStream::Ok); i++)
+    {
+        if(hasDebugInfo)
+        {
+            stream.skipRawData(32);
+        }
+
+        uintX size;
+        stream >> size;
+        const qint64 posNext = buffer.pos() + size.val;
+
+        // skip ways not touching the tile at all
+        quint16 subTiles;
+        stream >> subTiles;
+        if((subTiles & bitmask) == 0)
+        {
+            buffer.seek(posNext);
+            continue;
+        }
+
+        way_t way;
+        quint8 special, flags;
+        stream >> special;
+        way.layer = qint8(special >> 4) - 5;
+        readTags(stream, special & 0x0F, sizeValuesWays, way.tags);
+
+        stream >> flags;
+        if(flags & FLAG_NAME)
+        {
+            utf8 name;
+            stream >> name;
+            way.name = cleanName(name);
+        }
+        if(flags & FLAG_HOUSENUMBER)
+        {
+            utf8 houseNumber;
+            stream >> houseNumber;
+            way.houseNumber = houseNumber;
+        }
+        if(flags & FLAG_REF)
+        {
+            utf8 ref;
+            stream >> ref;
+            way.ref = ref;
+        }
+
+        intX latLabel, lonLabel;
+        if(flags & FLAG_LABELPOS)
+        {
+            stream >> latLabel >> lonLabel;
+        }
+
+        uintX nBlocks;
+        nBlocks.val = 1;
+        if(flags & FLAG_DATABLOCKS)
+        {
+            stream >> nBlocks;
+        }
+
+        // each data block is a way of its own with the same tags
+        for(quint64 b = 0; (b < nBlocks.val) && (stream.status() == QDataStream::Ok); b++)
+        {
+            way_t w = way;
+
+            uintX nLines;
+            stream >> nLines;
+            qint64 latFirst = 0;
+            qint64 lonFirst = 0;
+            for(quint64 l = 0; (l < nLines.val) && (stream.status() == QDataStream::Ok); l++)
+            {
+                uintX nNodes;
+                stream >> nNodes;
+
+                QPolygonF line;
+                line.reserve(qMin(nNodes.val, quint64(buffer.size())));
+
+                qint64 lat = latTile;
+                qint64 lon = lonTile;
+                qint64 deltaLat = 0;
+                qint64 deltaLon = 0;
+                for(quint64 k = 0; (k < nNodes.val) && (stream.status() == QDataStream::Ok); k++)
+                {
+                    intX dLat, dLon;
+                    stream >> dLat >> dLon;
+
+                    if((k > 0) && (flags & FLAG_DOUBLEDELTA))
+                    {
+                        // the difference to the previous delta
+                        deltaLat += dLat.val;
+                        deltaLon += dLon.val;
+                        lat += deltaLat;
+                        lon += deltaLon;
+                    }
+                    else
+                    {
+                        // the first node is relative to the block, all others to the previous node
+                        lat += dLat.val;
+                        lon += dLon.val;
+                    }
+
+                    if((l == 0) && (k == 0))
+                    {
+                        latFirst = lat;
+                        lonFirst = lon;
+                    }
+
+                    line << toPx(lat, lon);
+                }
+
+                if(!line.isEmpty())
+                {
+                    w.path.addPolygon(line);
+                    w.lines << line;
+                }
+            }
+
+            if(w.lines.isEmpty())
+            {
+                continue;
+            }
+
+            // the label position is relative to the way's first node
+            w.label = (flags & FLAG_LABELPOS) ? toPx(latFirst + latLabel.val, lonFirst + lonLabel.val) : w.lines.first().boundingRect().center();
+            w.path.setFillRule(Qt::OddEvenFill);
+            ways << w;
+        }
+
+        buffer.seek(posNext);
+    }
 }
@@ -20,21 +20,31 @@
 #define CMAPMAP_H
 
 #include "map/IMap.h"
+#include "map/mapsforge/CRenderTheme.h"
 #include "map/mapsforge/types.h"
 
+#include <QCache>
+#include <QFile>
 #include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThreadPool>
 
 class CMapDraw;
 
 class CMapMAP : public IMap
 {
-    Q_DECLARE_TR_FUNCTIONS(CMapMAP)
+    Q_OBJECT
 public:
     CMapMAP(const QString& filename, CMapDraw *parent);
     virtual ~CMapMAP();
 
     void draw(IDrawContext::buffer_t& buf) override;
 
+public slots:
+    /// the "type file" of a Mapsforge map is its render theme
+    void slotSetTypeFile(const QString& filename) override;
+
 private:
     enum exce_e {eErrOpen, eErrAccess, errFormat, errAbort};
     struct exce_t
@@ -53,6 +63,38 @@ private:
         quint8 maxZoom;
         quint64 offsetSubFile;
         quint64 sizeSubFile;
+
+        /// the range of blocks in the sub-file as tiles on the base zoom level
+        qint32 boundaryLeft   = 0;
+        qint32 boundaryTop    = 0;
+        qint32 boundaryRight  = -1;
+        qint32 boundaryBottom = -1;
+    };
+
+    struct poi_t
+    {
+        qint8 layer = 0;
+        QVector<quint32> tags;
+        /// the position in tile pixel
+        QPointF pos;
+        QString name;
+        QString houseNumber;
+        QString ele;
+    };
+
+    struct way_t
+    {
+        qint8 layer = 0;
+        QVector<quint32> tags;
+        /// the first line is the outer ring of an area, all others are inner rings. In tile pixel.
+        QVector<QPolygonF> lines;
+        /// all lines as path to fill areas with holes
+        QPainterPath path;
+        QString name;
+        QString houseNumber;
+        QString ref;
+        /// the label position, if given, else the center of the way
+        QPointF label;
     };
 
     enum header_flags_e
@@ -94,9 +136,71 @@ private:
         QStringList tagsWays;
     };
 
+    /// the settings of a draw() call, shared by all threads rendering its tiles
+    struct render_t
+    {
+        quint8 zoom;
+        /// the zoom level to select the data and the theme's rules
+        quint8 detail;
+        bool showPolygons;
+        bool showPolylines;
+        bool showPOIs;
+        QSharedPointer<const CRenderTheme> theme;
+    };
+
+    /// captions, path texts and symbols, placed after all tiles are drawn
+    struct label_t
+    {
+        const CRenderTheme::instruction_t * inst;
+        QString text;
+        /// the anchor in world pixel of the tile's zoom level
+        QPointF pos;
+        /// the line segment to follow by path texts and line symbols, in world pixel
+        QPointF pt1;
+        QPointF pt2;
+    };
+
+    struct tile_t
+    {
+        QImage img;
+        /// the labels with their anchor on this tile
+        QVector<label_t> labels;
+        /// keeps the instructions referenced by the labels
+        QSharedPointer<const CRenderTheme> theme;
+    };
+
     QList<layer_t> layers;
 
     void readBasics();
+    void loadTheme();
+
+    const layer_t * findLayer(quint8 zoom) const;
+    /**
+       @brief Render a single tile
+
+       @param render    the settings of the draw() call
+       @param col       the tile's column
+       @param row       the tile's row
+       @param tile      the rendered tile, a null image if the tile is empty or rendering was aborted
+     */
+    void renderTile(const render_t& render, qint32 col, qint32 row, tile_t& tile);
+    /**
+       @brief Place and draw the labels of all tiles
+
+       Labels with higher priority are placed first. All that overlap already placed ones
+       or do not fit into the buffer are skipped.
+
+       @param p         the painter of the buffer
+       @param rectBuffer the buffer's area in the painter's coordinates
+       @param zoom      the zoom level of the tiles
+       @param labels    the labels of all tiles
+     */
+    void drawLabels(QPainter& p, const QRectF& rectBuffer, quint8 zoom, QVector<label_t>& labels);
+    QByteArray readData(quint64 offset, quint64 size);
+    QByteArray readBlock(const layer_t& layer, qint32 bx, qint32 by, bool& isWater);
+    void decodeBlock(const QByteArray& block, const layer_t& layer, quint8 zoom, qint32 bx, qint32 by, quint16 bitmask
+                     , const QPointF& origin, qreal worldSize, QVector<poi_t>& pois, QVector<way_t>& ways);
+    void readTags(QDataStream& stream, qint32 n, const QVector<qint8>& sizeValues, QVector<quint32>& tags);
 
     QString filename;
 
@@ -106,6 +210,29 @@ private:
     QPointF ref1;
     /// bottom right point of the map
     QPointF ref2;
+
+    /// size of the inline values of tags like "ele=%i" in bytes, -1 for strings. Mapsforge v5 only.
+    QVector<qint8> sizeValuesPOIs;
+    QVector<qint8> sizeValuesWays;
+    /// the tag of the synthetic area drawn for blocks flagged as water, -1 if unknown
+    qint32 tagSea = -1;
+
+    /// the current theme, replaced as a whole when the type file changes
+    QSharedPointer<const CRenderTheme> theme;
+
+    /// the file is kept open for the lifetime of the map
+    QFile file;
+    /// the memory mapped file, nullptr if mapping failed
+    const uchar * data = nullptr;
+    /// serializes file access if the file is not mapped
+    QMutex mutexFile;
+
+    /// guards the theme and the tile cache
+    QMutex mutex;
+    /// rendered tiles, the cost is in kByte
+    QCache<quint64, tile_t> tiles;
+    /// thread pool to render tiles in parallel
+    QThreadPool pool;
 };
 
 #endif //CMAPMAP_H
@@ -19,8 +19,10 @@
 #include "helpers/CSettings.h"
 #include "helpers/Signals.h"
 #include "map/CMapDraw.h"
+#include "map/CMapMAP.h"
 #include "map/CMapPropSetup.h"
-#include "map/IMap.h"
+#include "map/CMapSeedDialog.h"
+#include "map/IMapOnline.h"
 #include "units/IUnit.h"
 
 #include <QtWidgets>
@@ -50,12 +52,15 @@ CMapPropSetup::CMapPropSetup(IMap * mapfile, CMapDraw *map)
 
     connect(spinCacheSize,       static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), mapfile, &IMap::slotSetCacheSize);
     connect(spinCacheExpiration, static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), mapfile, &IMap::slotSetCacheExpiration);
+    connect(spinPrefetch,        static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), mapfile, &IMap::slotSetPrefetchMargin);
 
     connect(toolOpenTypFile,    &QToolButton::pressed,      this,      &CMapPropSetup::slotLoadTypeFile);
     connect(toolClearTypFile,   &QToolButton::pressed,      this,      &CMapPropSetup::slotClearTypeFile);
+    connect(pushSeed,           &QPushButton::clicked,      this,      &CMapPropSetup::slotSeedCache);
 
     frameVectorItems->setVisible( mapfile->hasFeatureVectorItems() );
     frameTileCache->setVisible( mapfile->hasFeatureTileCache() );
+    pushSeed->setVisible(dynamic_cast<IMapOnline*>(mapfile) != nullptr);
 
     if(mapfile->hasFeatureLayers())
     {
@@ -101,6 +106,7 @@ void CMapPropSetup::slotPropertiesChanged() /* override */
     labelCachePath->setToolTip(lbl);
     spinCacheSize->setValue(mapfile->getCacheSize());
     spinCacheExpiration->setValue(mapfile->getCacheExpiration());
+    spinPrefetch->setValue(mapfile->getPrefetchMargin());
 
     // type file
     QFileInfo fi(mapfile->getTypeFile());
@@ -137,7 +143,16 @@ void CMapPropSetup::slotLoadTypeFile()
 {
     SETTINGS;
     QString path = cfg.value("Paths/lastTypePath", QDir::homePath()).toString();
-    QString filename = QFileDialog::getOpenFileName(this, tr("Select type file..."), path, "Garmin type file (*.typ)");
+    QString filename;
+    if(dynamic_cast<CMapMAP*>(mapfile) != nullptr)
+    {
+        // Mapsforge maps use a render theme instead
+        filename = QFileDialog::getOpenFileName(this, tr("Select render theme..."), path, "Mapsforge render theme (*.xml)");
+    }
+    else
+    {
+        filename = QFileDialog::getOpenFileName(this, tr("Select type file..."), path, "Garmin type file (*.typ)");
+    }
     if(filename.isEmpty())
     {
         return;
@@ -155,3 +170,15 @@ void CMapPropSetup::slotClearTypeFile()
     mapfile->slotSetTypeFile("");
     slotPropertiesChanged();
 }
+
+void CMapPropSetup::slotSeedCache()
+{
+    IMapOnline * online = dynamic_cast<IMapOnline*>(mapfile);
+    if(online == nullptr)
+    {
+        return;
+    }
+
+    CMapSeedDialog dlg(online, map->getViewport(), this);
+    dlg.exec();
+}
@@ -18,6 +18,7 @@
 
 #include "CMainWindow.h"
 #include "helpers/CDraw.h"
+#include "helpers/CFunctionJob.h"
 #include "map/CMapDraw.h"
 #include "map/CMapRMAP.h"
 #include "units/IUnit.h"
@@ -25,6 +26,9 @@
 #include <QtGui>
 #include <QtWidgets>
 
+/// memory budget for decoded tiles in kByte
+#define TILEBUDGET (64 * 1024)
+
 CMapRMAP::CMapRMAP(const QString &filename, CMapDraw *parent)
     : IMap(eFeatVisibility, parent)
     , filename(filename)
@@ -333,6 +337,14 @@ CMapRMAP::CMapRMAP(const QString &filename, CMapDraw *parent)
         //qDebug() << i << level.xscale << level.yscale;
     }
 
+    // keep the file open and mapped to avoid opening and seeking it on each redraw
+    cache.setMaxCost(TILEBUDGET);
+    this->file.setFileName(filename);
+    if(this->file.open(QIODevice::ReadOnly))
+    {
+        data = this->file.map(0, this->file.size());
+    }
+
     isActivated = true;
 
 //    qDebug() << "xref1:" << xref1 << "yref1:" << yref1;
@@ -379,7 +391,7 @@ bool CMapRMAP::setProjection(const QString& projection, const QString& datum)
         projstr += " +ellps=bessel +towgs84=606,23,413,0,0,0,0 +units=m +no_defs";
     }
 
-    pjsrc = pj_init_plus(projstr.toLocal8Bit().data());
+    pjsrc = pj_init_plus_ctx(pjctx, projstr.toLocal8Bit().data());
     if(pjsrc == 0)
     {
         return false;
@@ -494,61 +506,118 @@ void CMapRMAP::draw(IDrawContext::buffer_t& buf) /* override */
     p.setOpacity(getOpacity() / 100.0);
     p.translate(-pp);
 
-    QFile file(filename);
-    file.open(QIODevice::ReadOnly);
+    // take decoded tiles from the cache, read all others
+    QVector<QPoint> idx;
+    QVector<quint64> keys;
+    QVector<QImage> imgs;
+    QVector<QByteArray> jpegs;
+    for(int idxy = idxy1; idxy < idxy2; idxy++)
+    {
+        for(int idxx = idxx1; idxx < idxx2; idxx++)
+        {
+            const quint64 offset = level.getOffsetJpeg(idxx, idxy);
+            idx   << QPoint(idxx, idxy);
+            keys  << offset;
 
-    QDataStream stream(&file);
-    stream.setByteOrder(QDataStream::LittleEndian);
+            const QImage * cached = cache.object(offset);
+            if(cached != nullptr)
+            {
+                imgs  << *cached;
+                jpegs << QByteArray();
+            }
+            else
+            {
+                imgs  << QImage();
+                jpegs << readTile(offset);
+            }
+        }
+    }
 
-    for(int idxy = idxy1; idxy < idxy2; idxy++)
+    if(map->needsRedraw())
+    {
+        return;
+    }
+
+    // decode the new tiles in parallel
+    const qint32 M = idx.size();
+    QImage * pImgs = imgs.data();
+    const QByteArray * pJpegs = jpegs.constData();
+    for(qint32 m = 0; m < M; m++)
+    {
+        if(!pJpegs[m].isEmpty())
+        {
+            pool.start(new CFunctionJob([pImgs, pJpegs, m](){pImgs[m].loadFromData(pJpegs[m], "JPG"); }));
+        }
+    }
+    pool.waitForDone();
+
+    for(qint32 m = 0; m < M; m++)
     {
         if(map->needsRedraw())
         {
             break;
         }
 
-        for(int idxx = idxx1; idxx < idxx2; idxx++)
+        const QImage& img = imgs[m];
+        if(img.isNull())
         {
-            if(map->needsRedraw())
-            {
-                break;
-            }
+            continue;
+        }
 
-            quint32 tag;
-            quint32 len;
-            quint64 offset = level.getOffsetJpeg(idxx, idxy);
-            file.seek(offset);
-            stream >> tag >> len;
+        if(!jpegs[m].isEmpty())
+        {
+            cache.insert(keys[m], new QImage(img), qMax(1, (img.bytesPerLine() * img.height()) >> 10));
+        }
 
-            QImage img;
-            img.load(&file, "JPG");
+        const int idxx = idx[m].x();
+        const int idxy = idx[m].y();
+        qreal imgw = img.width();
+        qreal imgh = img.height();
+
+        // derive tile's corner coordinate
+        QPolygonF l(4);
+        l[0].rx() = xref1 + idxx * tileSizeX * level.xscale;
+        l[0].ry() = yref1 + idxy * tileSizeY * level.yscale;
+        l[1].rx() = xref1 + (idxx * tileSizeX + imgw) * level.xscale;
+        l[1].ry() = yref1 +  idxy * tileSizeY * level.yscale;
+        l[2].rx() = xref1 + (idxx * tileSizeX + imgw) * level.xscale;
+        l[2].ry() = yref1 + (idxy * tileSizeY + imgh) * level.yscale;
+        l[3].rx() = xref1 +  idxx * tileSizeX * level.xscale;
+        l[3].ry() = yref1 + (idxy * tileSizeY + imgh) * level.yscale;
+
+        pj_transform(pjsrc, pjtar, 1, 0, &l[0].rx(), &l[0].ry(), 0);
+        pj_transform(pjsrc, pjtar, 1, 0, &l[1].rx(), &l[1].ry(), 0);
+        pj_transform(pjsrc, pjtar, 1, 0, &l[2].rx(), &l[2].ry(), 0);
+        pj_transform(pjsrc, pjtar, 1, 0, &l[3].rx(), &l[3].ry(), 0);
+
+        drawTile(img, l, p);
+    }
+}
 
-            if(img.isNull())
-            {
-                continue;
-            }
+QByteArray CMapRMAP::readTile(quint64 offset)
+{
+    // each tile starts with a tag and the length of the JPEG data
+    if(offset == 0 || qint64(offset + 8) > file.size())
+    {
+        return QByteArray();
+    }
 
-            qreal imgw = img.width();
-            qreal imgh = img.height();
-
-            // derive tile's corner coordinate
-            QPolygonF l(4);
-            l[0].rx() = xref1 + idxx * tileSizeX * level.xscale;
-            l[0].ry() = yref1 + idxy * tileSizeY * level.yscale;
-            l[1].rx() = xref1 + (idxx * tileSizeX + imgw) * level.xscale;
-            l[1].ry() = yref1 +  idxy * tileSizeY * level.yscale;
-            l[2].rx() = xref1 + (idxx * tileSizeX + imgw) * level.xscale;
-            l[2].ry() = yref1 + (idxy * tileSizeY + imgh) * level.yscale;
-            l[3].rx() = xref1 +  idxx * tileSizeX * level.xscale;
-            l[3].ry() = yref1 + (idxy * tileSizeY + imgh) * level.yscale;
-
-            pj_transform(pjsrc, pjtar, 1, 0, &l[0].rx(), &l[0].ry(), 0);
-            pj_transform(pjsrc, pjtar, 1, 0, &l[1].rx(), &l[1].ry(), 0);
-            pj_transform(pjsrc, pjtar, 1, 0, &l[2].rx(), &l[2].ry(), 0);
-            pj_transform(pjsrc, pjtar, 1, 0, &l[3].rx(), &l[3].ry(), 0);
-
-            drawTile(img, l, p);
+    quint32 len;
+    if(data != nullptr)
+    {
+        len = qFromLittleEndian<quint32>(data + offset + 4);
+        if(qint64(offset + 8 + len) > file.size())
+        {
+            return QByteArray();
         }
+        // the data stays valid as long as the file is mapped
+        return QByteArray::fromRawData((const char*)data + offset + 8, len);
     }
-}
 
+    file.seek(offset);
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    quint32 tag;
+    stream >> tag >> len;
+    return file.read(len);
+}
@@ -21,6 +21,10 @@
 
 #include "IMap.h"
 
+#include <QCache>
+#include <QFile>
+#include <QThreadPool>
+
 class CMapDraw;
 
 class CMapRMAP : public IMap
@@ -56,6 +60,13 @@ private:
 
     bool setProjection(const QString& projection, const QString& datum);
     level_t& findBestLevel(const QPointF &s);
+    /**
+       @brief Read the raw JPEG data of a tile
+
+       @param offset    the tile's offset into the file
+       @return The JPEG data. Empty on errors.
+     */
+    QByteArray readTile(quint64 offset);
 
     QString filename;
 
@@ -79,6 +90,15 @@ private:
     qreal yref2 = 0;
 
     QPointF scale;
+
+    /// the file is kept open for the lifetime of the map
+    QFile file;
+    /// the memory mapped file, nullptr if mapping failed
+    const uchar * data = nullptr;
+    /// recently decoded tiles, the key is the tile's offset into the file, the cost is in kByte
+    QCache<quint64, QImage> cache;
+    /// thread pool to decode tiles in parallel
+    QThreadPool pool;
 };
 
 #endif // CMAPRMAP_H
@@ -0,0 +1,124 @@
+/**********************************************************************************************
+    Copyright (C) 2020 Norbert Truchsess <norbert.truchsess@t-online.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "map/cache/CTileSeeder.h"
+#include "map/CMapSeedDialog.h"
+#include "map/IMapOnline.h"
+#include "units/IUnit.h"
+
+#include <QtWidgets>
+
+CMapSeedDialog::CMapSeedDialog(IMapOnline *mapfile, const QRectF &area, QWidget *parent)
+    : QDialog(parent)
+    , mapfile(mapfile)
+    , area(area)
+{
+    setupUi(this);
+
+    seeder = new CTileSeeder(mapfile, this);
+    connect(seeder, &CTileSeeder::sigProgress, this, &CMapSeedDialog::slotProgress);
+    connect(seeder, &CTileSeeder::sigFinished, this, &CMapSeedDialog::slotFinished);
+
+    QString str1, str2;
+    IUnit::degToStr(area.left() * RAD_TO_DEG, area.top() * RAD_TO_DEG, str1);
+    IUnit::degToStr(area.right() * RAD_TO_DEG, area.bottom() * RAD_TO_DEG, str2);
+    labelArea->setText(str1 + "\n" + str2);
+
+    qint32 minLevel, maxLevel;
+    mapfile->getSeedLevels(minLevel, maxLevel);
+    spinMinLevel->setRange(minLevel, maxLevel);
+    spinMaxLevel->setRange(minLevel, maxLevel);
+    spinMinLevel->setValue(minLevel);
+    spinMaxLevel->setValue(minLevel);
+
+    connect(spinMinLevel, static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), this, &CMapSeedDialog::slotLevelsChanged);
+    connect(spinMaxLevel, static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), this, &CMapSeedDialog::slotLevelsChanged);
+    connect(pushStart,    &QPushButton::clicked, this, &CMapSeedDialog::slotStart);
+    connect(pushStop,     &QPushButton::clicked, this, &CMapSeedDialog::slotStop);
+
+    slotLevelsChanged();
+}
+
+CMapSeedDialog::~CMapSeedDialog()
+{
+}
+
+void CMapSeedDialog::reject()
+{
+    seeder->stop();
+    QDialog::reject();
+}
+
+void CMapSeedDialog::slotLevelsChanged()
+{
+    if(spinMinLevel->value() > spinMaxLevel->value())
+    {
+        spinMaxLevel->setValue(spinMinLevel->value());
+        return;
+    }
+
+    const qint64 cnt  = mapfile->getSeedTiles(QPolygonF(area), spinMinLevel->value(), spinMaxLevel->value(), nullptr);
+    const qint64 size = CTileSeeder::estimateSize(mapfile, cnt);
+
+    QString msg = tr("%1 tiles, about %2 MB").arg(cnt).arg(size >> 20);
+    if(cnt > CTileSeeder::maxTiles)
+    {
+        msg += "\n" + tr("This exceeds the limit of %1 tiles. Please reduce the area or the zoom levels.").arg(CTileSeeder::maxTiles);
+    }
+    else if(size > mapfile->getMaxCacheSize())
+    {
+        msg += "\n" + tr("This exceeds the cache size. Tiles will be removed from the cache right away.");
+    }
+    labelEstimate->setText(msg);
+
+    pushStart->setEnabled((cnt > 0) && (cnt <= CTileSeeder::maxTiles) && !seeder->isRunning());
+}
+
+void CMapSeedDialog::slotStart()
+{
+    QStringList urls;
+    mapfile->getSeedTiles(QPolygonF(area), spinMinLevel->value(), spinMaxLevel->value(), &urls);
+
+    spinMinLevel->setEnabled(false);
+    spinMaxLevel->setEnabled(false);
+    pushStart->setEnabled(false);
+    pushStop->setEnabled(true);
+    progressBar->setRange(0, urls.count());
+
+    seeder->start(urls);
+}
+
+void CMapSeedDialog::slotStop()
+{
+    pushStop->setEnabled(false);
+    seeder->stop();
+}
+
+void CMapSeedDialog::slotProgress(qint32 done, qint32 failed, qint32 total)
+{
+    progressBar->setValue(done + failed);
+    labelStatus->setText(tr("%1 of %2 tiles, %3 failed").arg(done).arg(total).arg(failed));
+}
+
+void CMapSeedDialog::slotFinished()
+{
+    spinMinLevel->setEnabled(true);
+    spinMaxLevel->setEnabled(true);
+    pushStop->setEnabled(false);
+    slotLevelsChanged();
+}
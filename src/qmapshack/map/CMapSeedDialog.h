@@ -0,0 +1,59 @@
+/**********************************************************************************************
+    Copyright (C) 2020 Norbert Truchsess <norbert.truchsess@t-online.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CMAPSEEDDIALOG_H
+#define CMAPSEEDDIALOG_H
+
+#include "ui_IMapSeedDialog.h"
+#include <QDialog>
+
+class IMapOnline;
+class CTileSeeder;
+
+class CMapSeedDialog : public QDialog, private Ui::IMapSeedDialog
+{
+    Q_OBJECT
+public:
+    /**
+       @brief Dialog to download all tiles of an area into the cache of an online map
+
+       @param mapfile   the online map
+       @param area      the area's top left and bottom right corner in [rad]
+       @param parent    the parent widget
+     */
+    CMapSeedDialog(IMapOnline * mapfile, const QRectF& area, QWidget * parent);
+    virtual ~CMapSeedDialog();
+
+public slots:
+    void reject() override;
+
+private slots:
+    void slotLevelsChanged();
+    void slotStart();
+    void slotStop();
+    void slotProgress(qint32 done, qint32 failed, qint32 total);
+    void slotFinished();
+
+private:
+    IMapOnline * mapfile;
+    const QRectF area;
+    CTileSeeder * seeder;
+};
+
+#endif //CMAPSEEDDIALOG_H
+
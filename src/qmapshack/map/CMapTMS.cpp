@@ -29,6 +29,7 @@
 #include <QtWidgets>
 #include <QtXml>
 
+#include <atomic>
 #include <ogr_spatialref.h>
 #include <proj_api.h>
 
@@ -59,7 +60,7 @@ CMapTMS::CMapTMS(const QString &filename, CMapDraw *parent)
     qDebug() << "------------------------------";
     qDebug() << "TMS: try to open" << filename;
 
-    pjsrc = pj_init_plus("+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs");
+    pjsrc = pj_init_plus_ctx(pjctx, "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs");
     qDebug() << "tms:" << "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs";
 
 
@@ -99,6 +100,12 @@ CMapTMS::CMapTMS(const QString &filename, CMapDraw *parent)
     qint32 N = xmlLayers.count();
     layers.resize(N);
 
+    static std::atomic<quint64> lastLayerKey {0};
+    for(layer_t& layer : layers)
+    {
+        layer.key = ++lastLayerKey;
+    }
+
     for(qint32 n = 0; n < N; ++n)
     {
         const QDomNode& xmlLayer = xmlLayers.item(n);
@@ -264,58 +271,250 @@ void CMapTMS::slotLayersChanged(QListWidgetItem * item)
 }
 
 
-QString CMapTMS::createUrl(const layer_t& layer, int x, int y, int z)
+/// each thread compiles the URL scripts with its own engine
+struct script_engine_t
 {
-    QMutexLocker lock(&mutex);
+    QJSEngine engine;
+    /// the compiled scripts, the key is layer_t::key
+    QHash<quint64, QJSValue> functions;
+    /// the value of retiredGeneration the functions have been cleaned up for
+    quint32 generation = 0;
+};
+
+static QThreadStorage<script_engine_t*> scriptEngines;
+
+/**
+   The keys of the layers of all destroyed maps. The thread local storage of
+   other threads can't be accessed. Thus each thread removes the functions of
+   these layers the next time it compiles a script.
+ */
+static QSet<quint64> retiredLayerKeys;
+static QMutex mutexRetiredLayerKeys;
+static std::atomic<quint32> retiredGeneration {0};
+
+CMapTMS::~CMapTMS()
+{
+    QMutexLocker lock(&mutexRetiredLayerKeys);
+    for(const layer_t& layer : layers)
+    {
+        retiredLayerKeys.insert(layer.key);
+    }
+    ++retiredGeneration;
+}
+
+bool CMapTMS::compileScript(const layer_t& layer, QJSValue& function)
+{
+    if(!scriptEngines.hasLocalData())
+    {
+        scriptEngines.setLocalData(new script_engine_t());
+    }
+
+    script_engine_t * engine = scriptEngines.localData();
+
+    const quint32 generation = retiredGeneration;
+    if(engine->generation != generation)
+    {
+        QMutexLocker lock(&mutexRetiredLayerKeys);
+        auto it = engine->functions.begin();
+        while(it != engine->functions.end())
+        {
+            if(retiredLayerKeys.contains(it.key()))
+            {
+                it = engine->functions.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        engine->generation = generation;
+    }
+
+    if(engine->functions.contains(layer.key))
+    {
+        function = engine->functions[layer.key];
+        return function.isCallable();
+    }
 
+    QString filename;
+    QString contents = layer.script;
     if(layer.strUrl.startsWith("script"))
     {
-        QString filename = layer.strUrl.mid(9);
+        filename = layer.strUrl.mid(9);
         QFile scriptFile(filename);
-        if (!scriptFile.open(QIODevice::ReadOnly))
+        if(scriptFile.open(QIODevice::ReadOnly))
         {
-            return "";
+            QTextStream stream(&scriptFile);
+            contents = stream.readAll();
+            scriptFile.close();
+        }
+        else
+        {
+            contents.clear();
         }
-        QTextStream stream(&scriptFile);
-        QString contents = stream.readAll();
-        scriptFile.close();
+    }
+
+    function = engine->engine.evaluate(contents, filename);
+    engine->functions[layer.key] = function;
+
+    if(function.isError())
+    {
+        qDebug() << "Uncaught exception at line"
+                 << function.property("lineNumber").toInt()
+                 << ":" << function.toString();
+    }
+
+    return function.isCallable();
+}
 
-        QJSEngine engine;
-        QJSValue fun = engine.evaluate(contents, filename);
+QString CMapTMS::createUrl(layer_t& layer, int x, int y, int z)
+{
+    QMutexLocker lock(&mutex);
 
-        if(fun.isError())
+    if(layer.strUrl.startsWith("script") || !layer.script.isEmpty())
+    {
+        QJSValue function;
+        if(!compileScript(layer, function))
         {
-            qDebug() << "Uncaught exception at line"
-                     << fun.property("lineNumber").toInt()
-                     << ":" << fun.toString();
+            return "";
         }
 
         QJSValueList args;
         args << z << x << y;
-        QJSValue res = fun.call(args);
+        QJSValue res = function.call(args);
         return res.toString();
     }
-    else if(!layer.script.isEmpty())
+
+    return layer.strUrl.arg(z).arg(x).arg(y);
+}
+
+CMapTMS::tile_t CMapTMS::getTile(layer_t& layer, int x, int y, int z)
+{
+    QMutexLocker lock(&mutex);
+
+    const quint64 key = (quint64(z) << 48) | (quint64(x & 0xFFFFFF) << 24) | quint64(y & 0xFFFFFF);
+
+    auto it = layer.tiles.find(key);
+    if(it == layer.tiles.end())
     {
-        QJSEngine engine;
-        QJSValue fun = engine.evaluate(layer.script);
+        // keep the table bounded, it is refilled by the next few redraws
+        if(layer.tiles.size() > 50000)
+        {
+            layer.tiles.clear();
+        }
 
-        QJSValueList args;
-        args << z << x << y;
-        QJSValue res = fun.call(args);
-        return res.toString();
+        tile_t tile;
+        tile.url  = createUrl(layer, x, y, z);
+        tile.hash = CDiskCache::hashKey(tile.url);
+        it = layer.tiles.insert(key, tile);
     }
 
-    return layer.strUrl.arg(z).arg(x).arg(y);
+    return *it;
 }
 
 
+void CMapTMS::getSeedLevels(qint32& minLevel, qint32& maxLevel) const
+{
+    // the seed levels are the tile zoom levels
+    minLevel = qMax(21 - this->maxZoomLevel, 0);
+    maxLevel = qMin(21 - this->minZoomLevel, 20);
+}
+
+qint64 CMapTMS::getSeedTiles(const QPolygonF& area, qint32 minLevel, qint32 maxLevel, QStringList * urls)
+{
+    QMutexLocker lock(&mutex);
+
+    QPolygonF areaDeg = area;
+    for(QPointF& pt : areaDeg)
+    {
+        pt *= RAD_TO_DEG;
+    }
+
+    const QRectF& bounding = areaDeg.boundingRect();
+    const qreal x1 = qMax(bounding.left(),  -180.0);
+    const qreal x2 = qMin(bounding.right(),  180.0);
+    const qreal y1 = bounding.bottom();
+    const qreal y2 = bounding.top();
+
+    qint64 cnt = 0;
+    for(layer_t &layer : layers)
+    {
+        if(!layer.enabled)
+        {
+            continue;
+        }
+
+        for(qint32 z = minLevel; z <= maxLevel; z++)
+        {
+            // see draw() for the relation of zoom level and tile zoom level
+            const qint32 level = 21 - z;
+            if(level < layer.minZoomLevel || level > layer.maxZoomLevel)
+            {
+                continue;
+            }
+
+            const qint32 n = 1 << z;
+            const QRect range = QRect(QPoint(lon2tile(x1, z) / 256, lat2tile(y1, z) / 256), QPoint(lon2tile(x2, z) / 256, lat2tile(y2, z) / 256)) & QRect(0, 0, n, n);
+
+            for(qint32 row = range.top(); row <= range.bottom(); row++)
+            {
+                const qreal north = tile2lat(row, z);
+                const qreal south = tile2lat(row + 1, z);
+                for(qint32 col = range.left(); col <= range.right(); col++)
+                {
+                    const QRectF tile(QPointF(tile2lon(col, z), south), QPointF(tile2lon(col + 1, z), north));
+                    if(!isTileInArea(areaDeg, tile))
+                    {
+                        continue;
+                    }
+
+                    cnt++;
+                    if(urls != nullptr)
+                    {
+                        *urls << createUrl(layer, col, row, z);
+                    }
+                }
+            }
+        }
+    }
+
+    return cnt;
+}
+
+void CMapTMS::prefetchTiles(layer_t& layer, int z, const QRect& range, const QRect& skip)
+{
+    const qint32 n = 1 << z;
+    const QRect area = range & QRect(0, 0, n, n);
+
+    for(qint32 row = area.top(); row <= area.bottom(); row++)
+    {
+        for(qint32 col = area.left(); col <= area.right(); col++)
+        {
+            if(urlPrefetch.size() >= MAX_PREFETCH_TILES)
+            {
+                return;
+            }
+
+            if(skip.contains(col, row))
+            {
+                continue;
+            }
+
+            const tile_t tile = getTile(layer, col, row, z);
+            if(!diskCache->contains(tile.hash))
+            {
+                urlPrefetch << tile.url;
+            }
+        }
+    }
+}
+
 void CMapTMS::draw(IDrawContext::buffer_t& buf) /* override */
 {
     QMutexLocker lock(&mutex);
 
     timeLastUpdate.start();
-    urlQueue.clear();
+    clearQueues();
 
     if(map->needsRedraw())
     {
@@ -356,7 +555,7 @@ void CMapTMS::draw(IDrawContext::buffer_t& buf) /* override */
     }
 
     // draw layers
-    for(const layer_t &layer : layers)
+    for(layer_t &layer : layers)
     {
         if(!layer.enabled)
         {
@@ -382,6 +581,7 @@ void CMapTMS::draw(IDrawContext::buffer_t& buf) /* override */
             continue;
         }
 
+        const qint32 level = z;
         z = 21 - z;
 
 
@@ -399,13 +599,13 @@ void CMapTMS::draw(IDrawContext::buffer_t& buf) /* override */
         {
             for(qint32 col = col1; col <= col2; col++)
             {
-                QString url = createUrl(layer, col, row, z);
-//                qDebug() << url;
+                const tile_t tile = getTile(layer, col, row, z);
+//                qDebug() << tile.url;
 
-                if(diskCache->contains(url))
+                if(diskCache->contains(tile.hash))
                 {
                     QImage img;
-                    diskCache->restore(url, img);
+                    diskCache->restore(tile.hash, img);
 
                     QPolygonF l;
 
@@ -419,11 +619,35 @@ void CMapTMS::draw(IDrawContext::buffer_t& buf) /* override */
                 }
                 else
                 {
-                    urlQueue << url;
+                    urlQueue << tile.url;
                 }
             }
         }
 
+        // queue a ring of tiles around the viewport first to be ready for panning,
+        // then the tiles of the next zoom level out and in. Zooming in keeps the
+        // center, thus only the tiles of the viewport's inner half are of interest.
+        if(prefetchMargin > 0)
+        {
+            const QRect visible(QPoint(col1, row1), QPoint(col2, row2));
+
+            prefetchTiles(layer, z, visible.adjusted(-prefetchMargin, -prefetchMargin, prefetchMargin, prefetchMargin), visible);
+
+            if((level + 1) <= layer.maxZoomLevel && (level + 1) < 21)
+            {
+                const QRect range(QPoint(col1 >> 1, row1 >> 1), QPoint(col2 >> 1, row2 >> 1));
+                prefetchTiles(layer, z - 1, range, QRect());
+            }
+
+            if((level - 1) >= layer.minZoomLevel)
+            {
+                const qint32 dCol = (col2 - col1 + 1) / 4;
+                const qint32 dRow = (row2 - row1 + 1) / 4;
+                const QRect range(QPoint((col1 + dCol) << 1, (row1 + dRow) << 1), QPoint(((col2 - dCol) << 1) + 1, ((row2 - dRow) << 1) + 1));
+                prefetchTiles(layer, z + 1, range, QRect());
+            }
+        }
+
         emit sigQueueChanged();
     }
 }
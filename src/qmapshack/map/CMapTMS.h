@@ -22,6 +22,7 @@
 #include "map/IMapOnline.h"
 
 class CDiskCache;
+class QJSValue;
 class QListWidgetItem;
 class QNetworkAccessManager;
 class QNetworkReply;
@@ -31,12 +32,15 @@ class CMapTMS : public IMapOnline
     Q_OBJECT
 public:
     CMapTMS(const QString& filename, CMapDraw *parent);
-    virtual ~CMapTMS() {}
+    virtual ~CMapTMS();
 
     void draw(IDrawContext::buffer_t& buf) override;
 
     void getLayers(QListWidget& list) override;
 
+    void getSeedLevels(qint32& minLevel, qint32& maxLevel) const override;
+    qint64 getSeedTiles(const QPolygonF& area, qint32 minLevel, qint32 maxLevel, QStringList * urls) override;
+
     void saveConfig(QSettings& cfg) override;
     void loadConfig(QSettings& cfg) override;
 
@@ -45,7 +49,26 @@ private slots:
 
 private:
     struct layer_t;
-    QString createUrl(const layer_t& layer, int x, int y, int z);
+    struct tile_t;
+    QString createUrl(layer_t& layer, int x, int y, int z);
+    bool compileScript(const layer_t& layer, QJSValue& function);
+    tile_t getTile(layer_t& layer, int x, int y, int z);
+    /**
+       @brief Queue all tiles of a range that are not in the cache for prefetch
+
+       @param layer     the layer to request the tiles from
+       @param z         the tile zoom level
+       @param range     the range of tile columns and rows
+       @param skip      tiles in this range are skipped, as they are queued already
+     */
+    void prefetchTiles(layer_t& layer, int z, const QRect& range, const QRect& skip);
+
+    struct tile_t
+    {
+        QString url;
+        /// the tile's hash in the disk cache
+        QByteArray hash;
+    };
 
     struct layer_t
     {
@@ -58,6 +81,11 @@ private:
         QString title;
         QString strUrl;
         QString script;
+
+        /// a key unique for the lifetime of the application to find the compiled URL script
+        quint64 key = 0;
+        /// memoised URLs and hashes, the key is z, x and y packed into 64 bit
+        QHash<quint64, tile_t> tiles;
     };
 
     QVector<layer_t> layers;
@@ -26,9 +26,15 @@
 #include <ogr_spatialref.h>
 #include <QtWidgets>
 
+/// the maximum number of tiles to read from files without overviews
 #define TILELIMIT 2500
 #define TILESIZEX 64
 #define TILESIZEY 64
+/// the range of the tile size aligned to the file's blocks
+#define TILESIZEMIN 64
+#define TILESIZEMAX 512
+/// memory budget for the tile cache in kByte
+#define TILEBUDGET (32 * 1024)
 
 
 CMapVRT::CMapVRT(const QString &filename, CMapDraw *parent)
@@ -116,6 +122,54 @@ CMapVRT::CMapVRT(const QString &filename, CMapDraw *parent)
     }
     qDebug() << "has overviews" << hasOverviews;
 
+    // ------- setup tiles ---------------
+    if(dataset->GetRasterCount() > 0)
+    {
+        GDALRasterBand * pBand = dataset->GetRasterBand(1);
+
+        // align tiles to the file's blocks. Files organized in strips or
+        // with huge blocks get tiles of the maximum size.
+        int blockSizeX = 0;
+        int blockSizeY = 0;
+        pBand->GetBlockSize(&blockSizeX, &blockSizeY);
+        tileSizeX = blockSizeX <= TILESIZEMAX ? qMax(blockSizeX, TILESIZEMIN) : TILESIZEMAX;
+        tileSizeY = blockSizeY <= TILESIZEMAX ? qMax(blockSizeY, TILESIZEMIN) : TILESIZEMAX;
+
+        // the overviews sorted by their scale factor. If only the files combined
+        // by the VRT have overviews, the list stays empty and the factor is simply
+        // doubled. GDAL will pick the files' overviews then.
+        overviewFactors << 1.0;
+        for(int i = 0; i < pBand->GetOverviewCount(); i++)
+        {
+            GDALRasterBand * pOverview = pBand->GetOverview(i);
+            if(pOverview != nullptr && pOverview->GetXSize() > 0)
+            {
+                overviewFactors << qreal(pBand->GetXSize()) / pOverview->GetXSize();
+            }
+        }
+        std::sort(overviewFactors.begin(), overviewFactors.end());
+    }
+
+    // map the bands of colored files to the bytes of a ARGB32 pixel
+    if(rasterBandCount > 1)
+    {
+        const QRgb testPix = qRgba(GCI_RedBand, GCI_GreenBand, GCI_BlueBand, GCI_AlphaBand);
+        for(unsigned int offset = 0; offset < sizeof(testPix); offset++)
+        {
+            for(int b = 1; b <= rasterBandCount; ++b)
+            {
+                if(dataset->GetRasterBand(b)->GetColorInterpretation() == *(((quint8 *)&testPix) + offset))
+                {
+                    bandMap << b;
+                    bandOffsets << offset;
+                    break;
+                }
+            }
+        }
+    }
+
+    tiles.setMaxCost(TILEBUDGET);
+
 
     // ------- setup projection ---------------
     char str[1025] = {0};
@@ -130,7 +184,7 @@ CMapVRT::CMapVRT(const QString &filename, CMapDraw *parent)
 
     char *proj4 = nullptr;
     oSRS.exportToProj4(&proj4);
-    pjsrc = pj_init_plus(proj4);
+    pjsrc = pj_init_plus_ctx(pjctx, proj4);
     free(proj4);
 
     if(pjsrc == 0)
@@ -328,6 +382,9 @@ void CMapVRT::draw(IDrawContext::buffer_t& buf) /* override */
     pt3 = trInv.map(pt3);
     pt4 = trInv.map(pt4);
 
+    // the number of file pixels per pixel of the buffer
+    const qreal pxPerPx = qMax(QLineF(pt1, pt2).length() / buf.image.width(), QLineF(pt1, pt4).length() / buf.image.height());
+
     qreal left, right, top, bottom;
     left     = pt1.x() < pt4.x() ? pt1.x() : pt4.x();
     right    = pt2.x() > pt3.x() ? pt2.x() : pt3.x();
@@ -370,26 +427,26 @@ void CMapVRT::draw(IDrawContext::buffer_t& buf) /* override */
         bottom = 0;
     }
 
-    qreal imgw = TILESIZEX;
-    qreal imgh = TILESIZEY;
-    qreal dx =  imgw;
-    qreal dy =  imgh;
-
+    // estimate number of tiles, of the size used at full resolution, and use it as
+    // a limit if no user defined limit is given
+    qreal nTiles = ((right - left) * (bottom - top) / (TILESIZEX * TILESIZEY));
 
-    // estimate number of tiles and use it as a limit if no
-    // user defined limit is given
-    qreal nTiles = ((right - left) * (bottom - top) / (dx * dy));
+    // select the overview. Use the coarsest overview that still has at least one
+    // pixel per pixel of the buffer. Beyond the last overview of the file the
+    // factor is doubled, GDAL will read from that overview.
+    qreal factor = 1.0;
     if(hasOverviews)
     {
-        // if there are overviews tiles can be reduced by reading
-        // with a scale factor from file. Increase amount of pixel
-        // read until tile limit is met.
-        while(nTiles > TILELIMIT)
+        for(int i = 1; ; i++)
         {
-            dx *= 2;
-            dy *= 2;
-            nTiles /= 4;
+            const qreal next = i < overviewFactors.size() ? overviewFactors[i] : factor * 2;
+            if(next > pxPerPx)
+            {
+                break;
+            }
+            factor = next;
         }
+        nTiles = 0;
     }
     else
     {
@@ -402,127 +459,45 @@ void CMapVRT::draw(IDrawContext::buffer_t& buf) /* override */
     p.setOpacity(getOpacity() / 100.0);
     p.translate(-pp);
 
-
-//    qDebug() << imgw << dx << nTiles;
     // limit number of tiles to keep performance
     if(!isOutOfScale(bufferScale) && (nTiles < TILELIMIT))
     {
-        for(qreal y = top; y < bottom; y += dy)
+        // the tiles are a fixed grid for each scale factor to be able to reuse them
+        const qreal dx = tileSizeX * factor;
+        const qreal dy = tileSizeY * factor;
+
+        const qint32 col1 = qFloor(left / dx);
+        const qint32 col2 = qCeil(right / dx);
+        const qint32 row1 = qFloor(top / dy);
+        const qint32 row2 = qCeil(bottom / dy);
+
+        for(qint32 row = row1; row < row2; row++)
         {
             if(map->needsRedraw())
             {
                 break;
             }
 
-            for(qreal x = left; x < right; x += dx)
+            for(qint32 col = col1; col < col2; col++)
             {
                 if(map->needsRedraw())
                 {
                     break;
                 }
 
-                // read tile from file
-                CPLErr err = CE_Failure;
-
-                // reduce tile size at the border of the file
-                qreal dx_used   = dx;
-                qreal dy_used   = dy;
-                qreal imgw_used = imgw;
-                qreal imgh_used = imgh;
-
-                if((x + dx) > xsize_px)
-                {
-                    dx_used     = xsize_px - x;
-                    imgw_used   = qRound(imgw * dx_used / dx) & 0xFFFFFFFC;
-                }
-                if((y + dy) > ysize_px)
-                {
-                    dy_used     = ysize_px - y;
-                    imgh_used   = imgh * dy_used / dy;
-                }
-
-                x           = qRound(x);
-                y           = qRound(y);
-                dx_used     = qFloor(dx_used);
-                dy_used     = qFloor(dy_used);
-                imgw_used   = qRound(imgw_used);
-                imgh_used   = qRound(imgh_used);
-
-                if(imgw_used < 1 || imgh_used < 1)
-                {
-                    continue;
-                }
-
                 QImage img;
-                if(rasterBandCount == 1)
-                {
-                    GDALRasterBand * pBand;
-                    pBand = dataset->GetRasterBand(1);
-
-                    img = QImage(QSize(imgw_used, imgh_used), QImage::Format_Indexed8);
-                    img.setColorTable(colortable);
-
-                    err = pBand->RasterIO(GF_Read
-                                          , x, y
-                                          , dx_used, dy_used
-                                          , img.bits()
-                                          , imgw_used, imgh_used
-                                          , GDT_Byte, 0, 0);
-                }
-                else
-                {
-                    img = QImage(imgw_used, imgh_used, QImage::Format_ARGB32);
-                    img.fill(qRgba(255, 255, 255, 255));
-
-                    QVector<quint8> buffer(imgw_used * imgh_used);
-
-                    QRgb testPix = qRgba(GCI_RedBand, GCI_GreenBand, GCI_BlueBand, GCI_AlphaBand);
-
-                    for(int b = 1; b <= rasterBandCount; ++b)
-                    {
-                        GDALRasterBand * pBand;
-                        pBand = dataset->GetRasterBand(b);
-
-                        err = pBand->RasterIO(GF_Read
-                                              , x, y
-                                              , dx_used, dy_used
-                                              , buffer.data()
-                                              , imgw_used, imgh_used
-                                              , GDT_Byte, 0, 0);
-
-                        if(!err)
-                        {
-                            int pbandColour = pBand->GetColorInterpretation();
-                            unsigned int offset;
-
-                            for (offset = 0; offset < sizeof(testPix) && *(((quint8 *)&testPix) + offset) != pbandColour; offset++)
-                            {
-                            }
-                            if(offset < sizeof(testPix))
-                            {
-                                quint8 * pTar   = img.bits() + offset;
-                                quint8 * pSrc   = buffer.data();
-                                const int size  = buffer.size();
-
-                                for(int i = 0; i < size; ++i)
-                                {
-                                    *pTar = *pSrc;
-                                    pTar += sizeof(testPix);
-                                    pSrc += 1;
-                                }
-                            }
-                        }
-                    }
-                }
-
-                if(err)
+                if(!getTile(factor, col, row, img))
                 {
                     continue;
                 }
 
+                const qreal x = col * dx;
+                const qreal y = row * dy;
+                const qreal x2 = qMin(x + dx, qreal(xsize_px));
+                const qreal y2 = qMin(y + dy, qreal(ysize_px));
 
                 QPolygonF l;
-                l << QPointF(x, y) << QPointF(x + dx_used, y) << QPointF(x + dx_used, y + dy_used) << QPointF(x, y + dy_used);
+                l << QPointF(x, y) << QPointF(x2, y) << QPointF(x2, y2) << QPointF(x, y2);
                 l = trFwd.map(l);
 
                 pj_transform(pjsrc, pjtar, 1, 0, &l[0].rx(), &l[0].ry(), 0);
@@ -540,3 +515,80 @@ void CMapVRT::draw(IDrawContext::buffer_t& buf) /* override */
     p.drawPolygon(boundingBox);
 }
 
+bool CMapVRT::getTile(qreal factor, qint32 col, qint32 row, QImage& img)
+{
+    const quint64 key = (quint64(qRound(factor * 16)) << 48) | (quint64(col & 0xFFFFFF) << 24) | quint64(row & 0xFFFFFF);
+
+    const QImage * cached = tiles.object(key);
+    if(cached != nullptr)
+    {
+        img = *cached;
+        return true;
+    }
+
+    // the area to read, reduced at the border of the file
+    const qint32 x = qRound(col * tileSizeX * factor);
+    const qint32 y = qRound(row * tileSizeY * factor);
+    const qint32 w = qMin(qRound((col + 1) * tileSizeX * factor), qint32(xsize_px)) - x;
+    const qint32 h = qMin(qRound((row + 1) * tileSizeY * factor), qint32(ysize_px)) - y;
+
+    const qint32 imgw = qMin(tileSizeX, qRound(w / factor));
+    const qint32 imgh = qMin(tileSizeY, qRound(h / factor));
+
+    if(w < 1 || h < 1 || imgw < 1 || imgh < 1)
+    {
+        return false;
+    }
+
+    // read tile from file straight into the image's scanlines
+    CPLErr err = CE_Failure;
+    if(rasterBandCount == 1)
+    {
+        img = QImage(QSize(imgw, imgh), QImage::Format_Indexed8);
+        img.setColorTable(colortable);
+
+        err = dataset->GetRasterBand(1)->RasterIO(GF_Read
+                                                  , x, y, w, h
+                                                  , img.bits(), imgw, imgh
+                                                  , GDT_Byte, 1, img.bytesPerLine());
+    }
+    else
+    {
+        img = QImage(imgw, imgh, QImage::Format_ARGB32);
+        img.fill(qRgba(255, 255, 255, 255));
+
+        // if the bands cover consecutive bytes of a pixel a single pixel
+        // interleaved read will do. Else each band is read on its own.
+        const bool isInterleaved = !bandOffsets.isEmpty() && (bandOffsets.last() - bandOffsets.first() + 1) == bandOffsets.size();
+        if(isInterleaved)
+        {
+            err = dataset->RasterIO(GF_Read
+                                    , x, y, w, h
+                                    , img.bits() + bandOffsets.first(), imgw, imgh
+                                    , GDT_Byte, bandMap.size(), bandMap.data()
+                                    , 4, img.bytesPerLine(), 1);
+        }
+        else
+        {
+            for(int i = 0; i < bandMap.size(); i++)
+            {
+                err = dataset->GetRasterBand(bandMap[i])->RasterIO(GF_Read
+                                                                   , x, y, w, h
+                                                                   , img.bits() + bandOffsets[i], imgw, imgh
+                                                                   , GDT_Byte, 4, img.bytesPerLine());
+                if(err)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    if(err)
+    {
+        return false;
+    }
+
+    tiles.insert(key, new QImage(img), qMax(1, (img.bytesPerLine() * img.height()) >> 10));
+    return true;
+}
@@ -21,6 +21,8 @@
 
 #include "map/IMap.h"
 
+#include <QCache>
+
 
 class CMapDraw;
 class GDALDataset;
@@ -34,13 +36,23 @@ public:
 
     void draw(IDrawContext::buffer_t& buf) override;
 
-private:
+protected:
     /**
        @brief Test subfiles of VRT for overviews
        @param filename The VRT filename to inspect
        @return Return true if all subfiles have overviews.
      */
     bool testForOverviews(const QString& filename);
+    /**
+       @brief Get a tile from the cache or read it from the file
+
+       @param factor    the scale factor of the file's pixel to the tile's pixel
+       @param col       the tile's column in the grid of tiles for that factor
+       @param row       the tile's row in the grid of tiles for that factor
+       @param img       the tile's image
+       @return Return false if the tile could not be read.
+     */
+    bool getTile(qreal factor, qint32 col, qint32 row, QImage& img);
     QString filename;
     /// instance of GDAL dataset
     GDALDataset * dataset;
@@ -71,6 +83,18 @@ private:
     QTransform trInv;
 
     bool hasOverviews = false;
+
+    /// the scale factors of the overviews of the first band, starting with 1 for full resolution
+    QVector<qreal> overviewFactors;
+    /// the tile size in pixel of the file or the overview, aligned to the file's blocks
+    qint32 tileSizeX = 64;
+    qint32 tileSizeY = 64;
+    /// the raster bands in the order of their byte offset into an ARGB32 pixel
+    QVector<int> bandMap;
+    /// the byte offset into an ARGB32 pixel for each band in bandMap
+    QVector<int> bandOffsets;
+    /// recently used tiles, the cost is in kByte
+    QCache<quint64, QImage> tiles;
 };
 
 #endif //CMAPVRT_H
@@ -221,7 +221,7 @@ CMapWMTS::CMapWMTS(const QString &filename, CMapDraw *parent)
         oSRS.exportToProj4(&ptr2);
 
         qDebug() << ptr1 << ptr2;
-        tileset.pjsrc = pj_init_plus(ptr2);
+        tileset.pjsrc = pj_init_plus_ctx(pjctx, ptr2);
 
         free(ptr1);
         free(ptr2);
@@ -373,7 +373,7 @@ void CMapWMTS::draw(IDrawContext::buffer_t& buf) /* override */
     QMutexLocker lock(&mutex);
 
     timeLastUpdate.start();
-    urlQueue.clear();
+    clearQueues();
 
     if(map->needsRedraw())
     {
@@ -424,8 +424,7 @@ void CMapWMTS::draw(IDrawContext::buffer_t& buf) /* override */
             continue;
         }
 
-        const tileset_t& tileset            = tilesets[layer.tileMatrixSet];
-        const QMap<QString, limit_t>& limits = layer.limits;
+        const tileset_t& tileset = tilesets[layer.tileMatrixSet];
 
         // convert viewport to layer's coordinate system
         QPointF pt1(x1, y1);
@@ -458,88 +457,29 @@ void CMapWMTS::draw(IDrawContext::buffer_t& buf) /* override */
         }
 
 
-        // get min/max col/row values for that level
-        qint32 minRow, maxRow, minCol, maxCol;
         const tilematrix_t& tilematrix = tileset.tilematrix[tileMatrixId];
-        if(!limits.isEmpty())
-        {
-            if(limits.contains(tileMatrixId))
-            {
-                const limit_t& limit = limits[tileMatrixId];
-                minCol = limit.minTileCol;
-                maxCol = limit.maxTileCol;
-                minRow = limit.minTileRow;
-                maxRow = limit.maxTileRow;
-            }
-            else
-            {
-                // layer has limits but not for the selected tileMatrixId -> skip layer
-                continue;
-            }
-        }
-        else
+
+        QRect visible;
+        if(!getTileRange(layer, tilematrix, tileMatrixId, pt1, pt2, 0, visible))
         {
-            minCol = 0;
-            maxCol = tilematrix.matrixWidth;
-            minRow = 0;
-            maxRow = tilematrix.matrixHeight;
+            // layer has limits but not for the selected tileMatrixId -> skip layer
+            continue;
         }
 
+        qint32 col1 = visible.left();
+        qint32 row1 = visible.top();
+        qint32 col2 = visible.right();
+        qint32 row2 = visible.bottom();
 
-        // derive range of col/row to request tiles
         qreal xscale =  tilematrix.scale * 0.28e-3;
         qreal yscale = -tilematrix.scale * 0.28e-3;
 
-        qint32 col1 = qFloor((pt1.x() - tilematrix.topLeft.x()) / ( xscale * tilematrix.tileWidth));
-        qint32 row1 = qFloor((pt1.y() - tilematrix.topLeft.y()) / ( yscale * tilematrix.tileHeight));
-        qint32 col2 = qFloor((pt2.x() - tilematrix.topLeft.x()) / ( xscale * tilematrix.tileWidth));
-        qint32 row2 = qFloor((pt2.y() - tilematrix.topLeft.y()) / ( yscale * tilematrix.tileHeight));
-
-
-        if(col1 < minCol)
-        {
-            col1 = minCol;
-        }
-        if(col1 > maxCol)
-        {
-            col1 = maxCol;
-        }
-        if(row1 < minRow)
-        {
-            row1 = minRow;
-        }
-        if(row1 > maxRow)
-        {
-            row1 = maxRow;
-        }
-
-        if(col2 < minCol)
-        {
-            col2 = minCol;
-        }
-        if(col2 > maxCol)
-        {
-            col2 = maxCol;
-        }
-        if(row2 < minRow)
-        {
-            row2 = minRow;
-        }
-        if(row2 > maxRow)
-        {
-            row2 = maxRow;
-        }
-
-
         // start to request tiles. draw tiles in cache, queue urls of tile yet to be requested
         for(qint32 row = row1; row <= row2; row++)
         {
             for(qint32 col = col1; col <= col2; col++)
             {
-                QString url = layer.resourceURL;
-                url = url.replace("{TileMatrix}", tileMatrixId, Qt::CaseInsensitive);
-                url = url.replace("{TileRow}", QString::number(row), Qt::CaseInsensitive);
-                url = url.replace("{TileCol}", QString::number(col), Qt::CaseInsensitive);
+                const QString& url = getTileUrl(layer, tileMatrixId, col, row);
 
                 if(diskCache->contains(url))
                 {
@@ -568,6 +508,222 @@ void CMapWMTS::draw(IDrawContext::buffer_t& buf) /* override */
             }
         }
 
+        // queue a ring of tiles around the viewport first to be ready for panning,
+        // then the tiles of the next zoom level out and in. Zooming in keeps the
+        // center, thus only the tiles of the viewport's inner half are of interest.
+        if(prefetchMargin > 0)
+        {
+            QRect range;
+            if(getTileRange(layer, tilematrix, tileMatrixId, pt1, pt2, prefetchMargin, range))
+            {
+                prefetchTiles(layer, tileMatrixId, range, visible);
+            }
+
+            QString coarserId;
+            QString finerId;
+            for(const QString &key : tileset.tilematrix.keys())
+            {
+                const qreal s = tileset.tilematrix[key].scale;
+                if(s > tilematrix.scale && (coarserId.isEmpty() || s < tileset.tilematrix[coarserId].scale))
+                {
+                    coarserId = key;
+                }
+                if(s < tilematrix.scale && (finerId.isEmpty() || s > tileset.tilematrix[finerId].scale))
+                {
+                    finerId = key;
+                }
+            }
+
+            if(!coarserId.isEmpty() && getTileRange(layer, tileset.tilematrix[coarserId], coarserId, pt1, pt2, 0, range))
+            {
+                prefetchTiles(layer, coarserId, range, QRect());
+            }
+
+            const QPointF ptc = (pt1 + pt2) / 2;
+            const QPointF pt3 = ptc + (pt1 - ptc) / 2;
+            const QPointF pt4 = ptc + (pt2 - ptc) / 2;
+            if(!finerId.isEmpty() && getTileRange(layer, tileset.tilematrix[finerId], finerId, pt3, pt4, 0, range))
+            {
+                prefetchTiles(layer, finerId, range, QRect());
+            }
+        }
+
         emit sigQueueChanged();
     }
 }
+
+bool CMapWMTS::getTileRange(const layer_t& layer, const tilematrix_t& tilematrix, const QString& tileMatrixId, const QPointF& pt1, const QPointF& pt2, qint32 margin, QRect& range) const
+{
+    // get min/max col/row values for that level
+    qint32 minRow, maxRow, minCol, maxCol;
+    if(!layer.limits.isEmpty())
+    {
+        if(!layer.limits.contains(tileMatrixId))
+        {
+            return false;
+        }
+
+        const limit_t& limit = layer.limits[tileMatrixId];
+        minCol = limit.minTileCol;
+        maxCol = limit.maxTileCol;
+        minRow = limit.minTileRow;
+        maxRow = limit.maxTileRow;
+    }
+    else
+    {
+        minCol = 0;
+        maxCol = tilematrix.matrixWidth;
+        minRow = 0;
+        maxRow = tilematrix.matrixHeight;
+    }
+
+    // derive range of col/row to request tiles
+    qreal xscale =  tilematrix.scale * 0.28e-3;
+    qreal yscale = -tilematrix.scale * 0.28e-3;
+
+    qint32 col1 = qFloor((pt1.x() - tilematrix.topLeft.x()) / ( xscale * tilematrix.tileWidth)) - margin;
+    qint32 row1 = qFloor((pt1.y() - tilematrix.topLeft.y()) / ( yscale * tilematrix.tileHeight)) - margin;
+    qint32 col2 = qFloor((pt2.x() - tilematrix.topLeft.x()) / ( xscale * tilematrix.tileWidth)) + margin;
+    qint32 row2 = qFloor((pt2.y() - tilematrix.topLeft.y()) / ( yscale * tilematrix.tileHeight)) + margin;
+
+    col1 = qBound(minCol, col1, maxCol);
+    row1 = qBound(minRow, row1, maxRow);
+    col2 = qBound(minCol, col2, maxCol);
+    row2 = qBound(minRow, row2, maxRow);
+
+    range = QRect(QPoint(col1, row1), QPoint(col2, row2));
+    return true;
+}
+
+QStringList CMapWMTS::getTileMatrixIds(const tileset_t& tileset)
+{
+    QStringList ids = tileset.tilematrix.keys();
+    std::sort(ids.begin(), ids.end(), [&tileset](const QString& id1, const QString& id2)
+    {
+        return tileset.tilematrix[id1].scale > tileset.tilematrix[id2].scale;
+    });
+    return ids;
+}
+
+void CMapWMTS::getSeedLevels(qint32& minLevel, qint32& maxLevel) const
+{
+    // the seed levels are the indices into the tile matrices, sorted by resolution
+    minLevel = 0;
+    maxLevel = 0;
+    for(const layer_t &layer : layers)
+    {
+        // do not use operator[] here, a copy of the tile set would free the projection
+        auto tileset = tilesets.constFind(layer.tileMatrixSet);
+        if(layer.enabled && tileset != tilesets.constEnd())
+        {
+            maxLevel = qMax(maxLevel, tileset->tilematrix.count() - 1);
+        }
+    }
+}
+
+qint64 CMapWMTS::getSeedTiles(const QPolygonF& area, qint32 minLevel, qint32 maxLevel, QStringList * urls)
+{
+    QMutexLocker lock(&mutex);
+
+    const QRectF& bounding = area.boundingRect();
+    const QRectF viewport(QPointF(bounding.left(), bounding.bottom()) * RAD_TO_DEG, QPointF(bounding.right(), bounding.top()) * RAD_TO_DEG);
+
+    qint64 cnt = 0;
+    for(const layer_t &layer : layers)
+    {
+        if(!layer.boundingBox.intersects(viewport) || !layer.enabled)
+        {
+            continue;
+        }
+
+        const tileset_t& tileset = tilesets[layer.tileMatrixSet];
+
+        // convert area to layer's coordinate system
+        QPolygonF areaLayer = area;
+        pj_transform(pjtar, tileset.pjsrc, areaLayer.size(), 2, &areaLayer[0].rx(), &areaLayer[0].ry(), 0);
+
+        if(pj_is_latlong(tileset.pjsrc))
+        {
+            for(QPointF& pt : areaLayer)
+            {
+                pt *= RAD_TO_DEG;
+            }
+        }
+
+        const QRectF& boundingLayer = areaLayer.boundingRect();
+        const QPointF pt1(boundingLayer.left(),  boundingLayer.bottom());
+        const QPointF pt2(boundingLayer.right(), boundingLayer.top());
+
+        const QStringList& ids = getTileMatrixIds(tileset);
+        for(qint32 level = minLevel; level <= maxLevel && level < ids.count(); level++)
+        {
+            const QString& tileMatrixId = ids[level];
+            const tilematrix_t& tilematrix = tileset.tilematrix[tileMatrixId];
+
+            QRect range;
+            if(!getTileRange(layer, tilematrix, tileMatrixId, pt1, pt2, 0, range))
+            {
+                continue;
+            }
+
+            // the size of a tile in the layer's coordinate system, see getTileRange()
+            const qreal w =  tilematrix.scale * 0.28e-3 * tilematrix.tileWidth;
+            const qreal h = -tilematrix.scale * 0.28e-3 * tilematrix.tileHeight;
+
+            for(qint32 row = range.top(); row <= range.bottom(); row++)
+            {
+                for(qint32 col = range.left(); col <= range.right(); col++)
+                {
+                    const QPointF corner = tilematrix.topLeft + QPointF(col * w, row * h);
+                    const QRectF tile = QRectF(corner, corner + QPointF(w, h)).normalized();
+                    if(!isTileInArea(areaLayer, tile))
+                    {
+                        continue;
+                    }
+
+                    cnt++;
+                    if(urls != nullptr)
+                    {
+                        *urls << getTileUrl(layer, tileMatrixId, col, row);
+                    }
+                }
+            }
+        }
+    }
+
+    return cnt;
+}
+
+QString CMapWMTS::getTileUrl(const layer_t& layer, const QString& tileMatrixId, qint32 col, qint32 row)
+{
+    QString url = layer.resourceURL;
+    url = url.replace("{TileMatrix}", tileMatrixId, Qt::CaseInsensitive);
+    url = url.replace("{TileRow}", QString::number(row), Qt::CaseInsensitive);
+    url = url.replace("{TileCol}", QString::number(col), Qt::CaseInsensitive);
+    return url;
+}
+
+void CMapWMTS::prefetchTiles(const layer_t& layer, const QString& tileMatrixId, const QRect& range, const QRect& skip)
+{
+    for(qint32 row = range.top(); row <= range.bottom(); row++)
+    {
+        for(qint32 col = range.left(); col <= range.right(); col++)
+        {
+            if(urlPrefetch.size() >= MAX_PREFETCH_TILES)
+            {
+                return;
+            }
+
+            if(skip.contains(col, row))
+            {
+                continue;
+            }
+
+            const QString& url = getTileUrl(layer, tileMatrixId, col, row);
+            if(!diskCache->contains(url))
+            {
+                urlPrefetch << url;
+            }
+        }
+    }
+}
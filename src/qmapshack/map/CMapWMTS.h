@@ -40,6 +40,9 @@ public:
 
     void getLayers(QListWidget& list) override;
 
+    void getSeedLevels(qint32& minLevel, qint32& maxLevel) const override;
+    qint64 getSeedTiles(const QPolygonF& area, qint32 minLevel, qint32 maxLevel, QStringList * urls) override;
+
     void saveConfig(QSettings& cfg) override;
     void loadConfig(QSettings& cfg) override;
 
@@ -96,6 +99,25 @@ private:
     };
 
     QMap<QString, tileset_t> tilesets;
+
+    /**
+       @brief Get the range of tiles covering an area, limited by the layer's limits
+
+       @param layer         the layer
+       @param tilematrix    the tile matrix of the zoom level
+       @param tileMatrixId  the ID of the tile matrix
+       @param pt1           the top left corner of the area in the tile set's coordinate system
+       @param pt2           the bottom right corner of the area in the tile set's coordinate system
+       @param margin        the number of tiles to add around the area
+       @param range         the range of tile columns and rows
+       @return Return false if the layer has no tiles for that zoom level.
+     */
+    bool getTileRange(const layer_t& layer, const tilematrix_t& tilematrix, const QString& tileMatrixId, const QPointF& pt1, const QPointF& pt2, qint32 margin, QRect& range) const;
+    static QString getTileUrl(const layer_t& layer, const QString& tileMatrixId, qint32 col, qint32 row);
+    /// the IDs of all tile matrices of a tile set, sorted from coarse to fine resolution
+    static QStringList getTileMatrixIds(const tileset_t& tileset);
+    /// queue all tiles of a range, but not in skip, that are not in the cache for prefetch
+    void prefetchTiles(const layer_t& layer, const QString& tileMatrixId, const QRect& range, const QRect& skip);
 };
 
 #endif //CMAPWMTS_H
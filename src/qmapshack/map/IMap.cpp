@@ -28,13 +28,15 @@ IMap::IMap(quint32 features, CMapDraw *parent)
     , map(parent)
     , flagsFeature(features)
 {
-    pjtar = pj_init_plus("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs");
+    pjctx = pj_ctx_alloc();
+    pjtar = pj_init_plus_ctx(pjctx, "+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs");
 }
 
 IMap::~IMap()
 {
     pj_free(pjtar);
     pj_free(pjsrc);
+    pj_ctx_free(pjctx);
     delete setup;
 }
 
@@ -54,6 +56,7 @@ void IMap::saveConfig(QSettings& cfg) /* override */
     {
         cfg.setValue("cacheSizeMB",     cacheSizeMB);
         cfg.setValue("cacheExpiration", cacheExpiration);
+        cfg.setValue("prefetchMargin",  prefetchMargin);
     }
 
     if(hasFeatureTypFile())
@@ -72,6 +75,7 @@ void IMap::loadConfig(QSettings& cfg) /* override */
     slotSetAdjustDetailLevel(cfg.value("adjustDetailLevel", getAdjustDetailLevel()).toInt());
     slotSetCacheSize(cfg.value("cacheSizeMB", getCacheSize()).toInt());
     slotSetCacheExpiration(cfg.value("cacheExpiration", getCacheExpiration()).toInt());
+    slotSetPrefetchMargin(cfg.value("prefetchMargin", getPrefetchMargin()).toInt());
     slotSetTypeFile(cfg.value("typeFile", getTypeFile()).toString());
 }
 
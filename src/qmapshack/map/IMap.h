@@ -138,6 +138,11 @@ public:
         return cacheExpiration;
     }
 
+    qint32 getPrefetchMargin() const
+    {
+        return prefetchMargin;
+    }
+
     qint32 getAdjustDetailLevel() const
     {
         return adjustDetailLevel;
@@ -191,6 +196,10 @@ public slots:
         cacheExpiration = days;
         configureCache();
     }
+    void slotSetPrefetchMargin(qint32 tiles)
+    {
+        prefetchMargin = tiles;
+    }
 
     void slotSetAdjustDetailLevel(qint32 level)
     {
@@ -227,6 +236,16 @@ protected:
     /// the drawcontext this map belongs to
     CMapDraw * map;
 
+    /**
+        PROJ4 context of all projection objects of this map
+
+        Maps are drawn by worker threads in parallel. The default context
+        of PROJ4 must not be shared by them. Thus all projection objects of
+        a map have to be created with pj_init_plus_ctx() and this context.
+        Will be freed by ~IMap()
+     */
+    projCtx pjctx = nullptr;
+
     /**
         Source projection of the current map file
         Has to be set by subclass. Destruction has to be
@@ -259,6 +278,7 @@ protected:
     QString cachePath;            //< streaming map only: path to cached tiles
     qint32 cacheSizeMB     = 100; //< streaming map only: maximum size of all tiles in cache [MByte]
     qint32 cacheExpiration =   8; //< streaming map only: maximum age of tiles in cache [days]
+    qint32 prefetchMargin  =   0; //< streaming map only: tiles to prefetch around the viewport, 0 to disable prefetching
 
     QString copyright; //< a copyright string to be displayed as tool tip
 
@@ -25,10 +25,16 @@
 #include <QMessageBox>
 #include <QtNetwork>
 
+/// maximum number of requests in flight for visible tiles
+#define MAX_PENDING 6
+/// maximum number of requests in flight for prefetched tiles, only while no visible tile is pending
+#define MAX_PENDING_PREFETCH 2
+
 IMapOnline::IMapOnline(CMapDraw * parent)
     : IMap(eFeatVisibility | eFeatTileCache, parent)
 {
-    accessManager = new QNetworkAccessManager(parent->thread());
+    // the map can be created without draw context to seed its cache from the command line
+    accessManager = new QNetworkAccessManager(parent != nullptr ? static_cast<QObject*>(parent->thread()) : this);
     connect(accessManager, &QNetworkAccessManager::finished, this, &IMapOnline::slotRequestFinished);
 
     connect(this, &IMapOnline::sigQueueChanged, this, &IMapOnline::slotQueueChanged);
@@ -51,47 +57,137 @@ bool IMapOnline::httpsCheck(const QString &url)
 }
 
 
+QNetworkRequest IMapOnline::createRequest(const QString& url, bool prefetch) const
+{
+    QNetworkRequest request;
+    request.setUrl(url);
+    // let the access manager pipeline requests on HTTP/1.1 or multiplex them on HTTP/2
+    request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+    request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+    request.setPriority(prefetch ? QNetworkRequest::LowPriority : QNetworkRequest::HighPriority);
+    for(const rawHeaderItem_t &item : rawHeaderItems)
+    {
+        request.setRawHeader(item.name.toLatin1(), item.value.toLatin1());
+    }
+    return request;
+}
+
+QNetworkReply * IMapOnline::sendRequest(const QString& url, bool prefetch)
+{
+    return accessManager->get(createRequest(url, prefetch));
+}
+
+void IMapOnline::clearQueues()
+{
+    QMutexLocker lock(&mutex);
+    urlQueue.clear();
+    urlPrefetch.clear();
+    prefetchRebuilt = true;
+}
+
+bool IMapOnline::hasTile(const QString& url)
+{
+    QMutexLocker lock(&mutex);
+    return diskCache->contains(url);
+}
+
+void IMapOnline::storeTile(const QString& url, const QByteArray& data, const QString& contentType)
+{
+    QMutexLocker lock(&mutex);
+    diskCache->store(url, data, contentType);
+}
+
+qint64 IMapOnline::getAverageTileSize()
+{
+    QMutexLocker lock(&mutex);
+    return diskCache->getAverageSize();
+}
+
+qint64 IMapOnline::getMaxCacheSize()
+{
+    QMutexLocker lock(&mutex);
+    return diskCache->getMaxSize();
+}
+
 void IMapOnline::slotQueueChanged()
 {
     QMutexLocker lock(&mutex);
 
-    if(!urlQueue.isEmpty() && urlPending.size() < 6)
+    if(prefetchRebuilt)
     {
-        // request up to 6 pending request
-        for(int i = 0; i < (6 - urlPending.size()); i++)
-        {
-            QString url = urlQueue.dequeue();
-            lastRequest = urlQueue.isEmpty();
+        // The viewport has changed. Prefetched tiles in flight that are
+        // neither visible nor prefetched anymore just block the connections.
+        prefetchRebuilt = false;
 
-            QNetworkRequest request;
-            request.setUrl(url);
-            for(const rawHeaderItem_t &item : rawHeaderItems)
+        QList<QNetworkReply*> stale;
+        auto it = urlPrefetchPending.begin();
+        while(it != urlPrefetchPending.end())
+        {
+            if(urlQueue.contains(it.key()) || urlPrefetch.removeAll(it.key()))
             {
-                request.setRawHeader(item.name.toLatin1(), item.value.toLatin1());
+                ++it;
+                continue;
             }
-            accessManager->get(request);
+
+            stale << it.value();
+            it = urlPrefetchPending.erase(it);
+        }
+
+        // the replies are not known anymore, slotRequestFinished() will just delete them
+        for(QNetworkReply * reply : stale)
+        {
+            reply->abort();
+        }
+    }
+
+    // visible tiles always go first and have all slots for themselves
+    while(!urlQueue.isEmpty() && (urlPending.size() < MAX_PENDING))
+    {
+        QString url = urlQueue.dequeue();
+        lastRequest = urlQueue.isEmpty();
+
+        if(urlPending.contains(url))
+        {
+            continue;
+        }
+
+        if(urlPrefetchPending.remove(url))
+        {
+            // the tile has become visible while being prefetched
             urlPending << url;
+            continue;
+        }
 
-            if(lastRequest)
-            {
-                break;
-            }
+        sendRequest(url, false);
+        urlPending << url;
+    }
+
+    // tiles are prefetched only while no visible tile is waiting
+    while(urlQueue.isEmpty() && urlPending.isEmpty() && !urlPrefetch.isEmpty() && (urlPrefetchPending.size() < MAX_PENDING_PREFETCH))
+    {
+        QString url = urlPrefetch.dequeue();
+        if(urlPrefetchPending.contains(url))
+        {
+            continue;
         }
+
+        urlPrefetchPending[url] = sendRequest(url, true);
     }
-    else if(lastRequest && urlPending.isEmpty())
+
+    if(lastRequest && urlQueue.isEmpty() && urlPending.isEmpty())
     {
         lastRequest = false;
         // if all tiles are received the map layer can be redrawn with all tiles from cache
         map->emitSigCanvasUpdate();
     }
 
-    if(timeLastUpdate.elapsed() > 2000)
+    if(!urlPending.isEmpty() && timeLastUpdate.elapsed() > 2000)
     {
         timeLastUpdate.start();
         map->emitSigCanvasUpdate();
     }
 
-    // report status of pending tiles
+    // report status of pending tiles, prefetched tiles are not of interest
     int pending = urlQueue.size() + urlPending.size();
     if(pending)
     {
@@ -109,19 +205,27 @@ void IMapOnline::slotRequestFinished(QNetworkReply* reply)
     QMutexLocker lock(&mutex);
 
     QString url = reply->url().toString();
-    if(urlPending.contains(url))
+    if(reply->error() == QNetworkReply::OperationCanceledError)
+    {
+        // an aborted prefetch, nothing to store
+        reply->deleteLater();
+        return;
+    }
+
+    if(urlPending.contains(url) || urlPrefetchPending.contains(url))
     {
-        QImage img;
+        QByteArray data;
         // only take good responses
         if(!reply->error())
         {
-            // read image data
-            img.loadFromData(reply->readAll());
+            // keep the image data as it is, it will be decoded when drawn
+            data = reply->readAll();
         }
-        // always store image to cache, the cache will take care of NULL images
-        diskCache->store(url, img);
+        // always store data to cache, the cache will take care of empty data
+        diskCache->store(url, data, reply->header(QNetworkRequest::ContentTypeHeader).toString());
 
         urlPending.removeAll(url);
+        urlPrefetchPending.remove(url);
     }
 
     // debug output any error
@@ -146,3 +250,48 @@ void IMapOnline::configureCache()
     diskCache = new CDiskCache(getCachePath(), getCacheSize(), getCacheExpiration(), this);
 }
 
+bool IMapOnline::isTileInArea(const QPolygonF& area, const QRectF& tile)
+{
+    const QRectF& bounding = area.boundingRect();
+    if((bounding.left() > tile.right()) || (bounding.right() < tile.left()) || (bounding.top() > tile.bottom()) || (bounding.bottom() < tile.top()))
+    {
+        return false;
+    }
+
+    // the tile is within the area
+    if(area.containsPoint(tile.center(), Qt::OddEvenFill))
+    {
+        return true;
+    }
+
+    // the area is within the tile
+    for(const QPointF& pt : area)
+    {
+        if(tile.contains(pt))
+        {
+            return true;
+        }
+    }
+
+    // the area's outline crosses the tile
+    const QLineF edges[4] =
+    {
+        QLineF(tile.topLeft(), tile.topRight()), QLineF(tile.topRight(), tile.bottomRight()),
+        QLineF(tile.bottomRight(), tile.bottomLeft()), QLineF(tile.bottomLeft(), tile.topLeft())
+    };
+    const int N = area.size();
+    for(int i = 0; i < N; i++)
+    {
+        const QLineF line(area[i], area[(i + 1) % N]);
+        for(const QLineF& edge : edges)
+        {
+            QPointF pt;
+            if(line.intersect(edge, &pt) == QLineF::BoundedIntersection)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -20,13 +20,19 @@
 #ifndef IMAPONLINE_H
 #define IMAPONLINE_H
 #include "map/IMap.h"
+#include <QHash>
 #include <QMutex>
+#include <QPolygonF>
 #include <QQueue>
 #include <QTime>
 
+/// maximum number of tiles queued for prefetch by a single redraw
+#define MAX_PREFETCH_TILES 64
+
 class CDiskCache;
 class QNetworkAccessManager;
 class QNetworkReply;
+class QNetworkRequest;
 
 class IMapOnline : public IMap
 {
@@ -48,12 +54,17 @@ protected:
     QMutex mutex {QMutex::Recursive};
     /// a queue with all tile urls to request
     QQueue<QString> urlQueue;
+    /// a queue with tile urls around the viewport and of adjacent zoom levels, requested if no visible tile is pending. At most MAX_PREFETCH_TILES.
+    QQueue<QString> urlPrefetch;
+    /// set by clearQueues() when the queues are rebuilt for a new viewport
+    bool prefetchRebuilt = false;
     /// the tile cache
     CDiskCache * diskCache = nullptr;
     /// access manager to request tiles
     QNetworkAccessManager * accessManager = nullptr;
     QList<QString> urlPending;
-
+    /// the replies of prefetched tiles by url, to abort them if they are out of interest
+    QHash<QString, QNetworkReply*> urlPrefetchPending;
 
     bool lastRequest = false;
     QTime timeLastUpdate;
@@ -61,6 +72,23 @@ protected:
 
     static bool httpsCheck(const QString &url);
 
+    /**
+       @brief Send a request for a tile
+
+       @param url       the tile's URL
+       @param prefetch  true if the tile is not visible yet
+       @return The reply object of the request.
+     */
+    QNetworkReply * sendRequest(const QString& url, bool prefetch);
+
+    /**
+       @brief Clear the queues of visible and prefetched tiles before they are rebuilt by draw()
+
+       Prefetched tiles still in flight are aborted by slotQueueChanged() if the new
+       queues do not contain them anymore.
+     */
+    void clearQueues();
+
     void registerHeaderItem(const QString &name, const QString &value)
     {
         struct rawHeaderItem_t item;
@@ -71,6 +99,9 @@ protected:
 
     void configureCache() override;
 
+    /// true if a tile overlaps an area, both have to be in the same coordinate system
+    static bool isTileInArea(const QPolygonF& area, const QRectF& tile);
+
 public:
     void slotQueueChanged();
     void slotRequestFinished(QNetworkReply* reply);
@@ -78,6 +109,40 @@ public:
 
     IMapOnline(CMapDraw * parent);
     virtual ~IMapOnline() {}
+
+    const QString& getName() const
+    {
+        return name;
+    }
+
+    /**
+       @brief Get the range of zoom levels that can be seeded into the cache
+
+       Level numbers are map type specific. A larger number has a finer resolution.
+     */
+    virtual void getSeedLevels(qint32& minLevel, qint32& maxLevel) const = 0;
+
+    /**
+       @brief Count and collect the tiles of all enabled layers covering an area
+
+       @param area      the area as polygon in [rad], a rectangle for a bounding box
+       @param minLevel  the first zoom level as defined by getSeedLevels()
+       @param maxLevel  the last zoom level as defined by getSeedLevels()
+       @param urls      a list to append the tile URLs to, nullptr to count the tiles only
+       @return The number of tiles.
+     */
+    virtual qint64 getSeedTiles(const QPolygonF& area, qint32 minLevel, qint32 maxLevel, QStringList * urls) = 0;
+
+    /// create a request for a tile with all header items needed by the server
+    QNetworkRequest createRequest(const QString& url, bool prefetch) const;
+    /// true if the tile is in the cache already
+    bool hasTile(const QString& url);
+    /// store a downloaded tile in the cache
+    void storeTile(const QString& url, const QByteArray& data, const QString& contentType);
+    /// the average size of a tile on disc in bytes, 0 if unknown
+    qint64 getAverageTileSize();
+    /// the maximum size of the cache in bytes
+    qint64 getMaxCacheSize();
 };
 
 #endif //IMAPONLINE_H
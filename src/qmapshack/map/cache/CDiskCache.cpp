@@ -22,13 +22,25 @@
 
 #include <QtWidgets>
 
+/// magic and version of the index file
+#define INDEX_MAGIC     "QMSTILEIDX"
+#define INDEX_VERSION   2
+/// memory budget for decoded tiles in kByte
+#define MEMORY_BUDGET   (64 * 1024)
+/// maximum number of tiles remembered as missing
+#define MAX_MISSING     10000
+/// journal record types
+#define JOURNAL_ADD     quint8('+')
+#define JOURNAL_REMOVE  quint8('-')
+
 CDiskCache::CDiskCache(const QString &path, qint32 maxSizeMB, qint32 expirationDays, QObject * parent)
     : QObject(parent)
     , dir(path)
-    , maxSizeMB(maxSizeMB)
+    , maxSizeBytes(qint64(maxSizeMB) * 1024 * 1024)
     , expirationDays(expirationDays)
 {
     dummy.fill(Qt::transparent);
+    cache.setMaxCost(MEMORY_BUDGET);
 
     dir.mkpath(dir.path());
 
@@ -41,11 +53,16 @@ CDiskCache::CDiskCache(const QString &path, qint32 maxSizeMB, qint32 expirationD
         }
     }
 
-    QFileInfoList files = dir.entryInfoList(QStringList("*.png"), QDir::Files);
-    for(const QFileInfo &fileinfo : files)
+    journal.setFileName(dir.absoluteFilePath("QMS_journal"));
+    if(!loadIndex() || !replayJournal())
+    {
+        rebuildIndex();
+        saveIndex();
+    }
+
+    if(!journal.open(QIODevice::WriteOnly | QIODevice::Append))
     {
-        QString hash = fileinfo.baseName();
-        table[hash]  = fileinfo.fileName();
+        qWarning() << "Failed to open tile cache journal" << journal.fileName();
     }
 
     timer = new QTimer(this);
@@ -54,112 +71,430 @@ CDiskCache::CDiskCache(const QString &path, qint32 maxSizeMB, qint32 expirationD
     connect(timer, &QTimer::timeout, this, &CDiskCache::slotCleanup);
 }
 
-void CDiskCache::store(const QString& key, QImage& img)
+CDiskCache::~CDiskCache()
 {
     QMutexLocker lock(&mutex);
+    if(indexDirty)
+    {
+        saveIndex();
+    }
+    journal.close();
+}
 
-    QCryptographicHash md5(QCryptographicHash::Md5);
-    md5.addData(key.toLatin1());
+QByteArray CDiskCache::hashKey(const QString& key)
+{
+    return QCryptographicHash::hash(key.toLatin1(), QCryptographicHash::Md5);
+}
 
-    QString hash     = md5.result().toHex();
-    QString filename = QString("%1.png").arg(hash);
+QString CDiskCache::filePath(const QByteArray& hash, const QByteArray& type) const
+{
+    // the file suffix is the MIME sub-type, e.g. "png" or "jpeg"
+    const QString& suffix = QString(type.mid(type.indexOf('/') + 1));
+    return dir.absoluteFilePath(QString("%1/%2.%3").arg(QString(hash.left(1).toHex())).arg(QString(hash.toHex())).arg(suffix));
+}
 
-    if(!img.isNull())
+bool CDiskCache::loadIndex()
+{
+    QFile file(dir.absoluteFilePath("QMS_index"));
+    if(!file.open(QIODevice::ReadOnly))
     {
-        img.save(dir.absoluteFilePath(filename));
-        table[hash] = filename;
-        cache[hash] = img;
+        return false;
     }
-    else
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_2);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    QByteArray magic;
+    quint32 version = 0;
+    quint32 count   = 0;
+    in >> magic >> version >> count;
+    if(magic != INDEX_MAGIC || version < 1 || version > INDEX_VERSION)
+    {
+        qDebug() << "tile cache index" << file.fileName() << "has wrong format";
+        return false;
+    }
+
+    char buffer[16];
+    for(quint32 i = 0; i < count; i++)
+    {
+        entry_t entry;
+        if(in.readRawData(buffer, sizeof(buffer)) != sizeof(buffer))
+        {
+            break;
+        }
+        in >> entry.size >> entry.timestamp;
+        if(version > 1)
+        {
+            in >> entry.type;
+        }
+        else
+        {
+            // version 1 stored re-encoded PNG files only
+            entry.type = "image/png";
+        }
+        addEntry(QByteArray(buffer, sizeof(buffer)), entry);
+    }
+
+    if(in.status() != QDataStream::Ok)
     {
-        cache[hash] = dummy;
+        qDebug() << "tile cache index" << file.fileName() << "is corrupt";
+        index.clear();
+        timeline.clear();
+        totalSize = 0;
+        return false;
     }
+
+    indexDirty = false;
+    return true;
 }
 
-void CDiskCache::restore(const QString& key, QImage& img)
+void CDiskCache::saveIndex()
 {
-    QMutexLocker lock(&mutex);
+    QSaveFile file(dir.absoluteFilePath("QMS_index"));
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Failed to write tile cache index" << file.fileName();
+        return;
+    }
 
-    QCryptographicHash md5(QCryptographicHash::Md5);
-    md5.addData(key.toLatin1());
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_2);
+    out.setByteOrder(QDataStream::LittleEndian);
 
-    QString hash = md5.result().toHex();
+    out << QByteArray(INDEX_MAGIC) << quint32(INDEX_VERSION) << quint32(index.size());
+    for(auto it = index.constBegin(); it != index.constEnd(); ++it)
+    {
+        out.writeRawData(it.key().constData(), it.key().size());
+        out << it->size << it->timestamp << it->type;
+    }
 
-    if(cache.contains(hash))
+    if(file.commit())
     {
-        img = cache[hash];
+        indexDirty = false;
+
+        // all changes are part of the index now
+        if(journal.isOpen())
+        {
+            journal.resize(0);
+        }
+        else
+        {
+            QFile::remove(journal.fileName());
+        }
     }
-    else if(table.contains(hash))
+}
+
+bool CDiskCache::replayJournal()
+{
+    QFile file(journal.fileName());
+    if(!file.exists())
     {
-        img.load(dir.absoluteFilePath(table[hash]));
-        if(!cache.contains(hash))
+        return true;
+    }
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_2);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    char buffer[16];
+    while(!in.atEnd())
+    {
+        quint8 op = 0;
+        in >> op;
+        if(in.readRawData(buffer, sizeof(buffer)) != sizeof(buffer))
         {
-            cache[hash] = img;
+            break;
+        }
+
+        const QByteArray hash(buffer, sizeof(buffer));
+        if(op == JOURNAL_ADD)
+        {
+            entry_t entry;
+            in >> entry.size >> entry.timestamp >> entry.type;
+            if(in.status() != QDataStream::Ok)
+            {
+                // the last record has been cut off by a crash
+                break;
+            }
+            addEntry(hash, entry);
+        }
+        else if(op == JOURNAL_REMOVE)
+        {
+            dropEntry(hash);
+        }
+        else
+        {
+            qDebug() << "tile cache journal" << file.fileName() << "is corrupt";
+            return false;
         }
     }
-    else
+
+    return true;
+}
+
+void CDiskCache::writeJournal(const QByteArray& hash, const entry_t * entry)
+{
+    if(!journal.isOpen())
     {
-        img = QImage();
+        return;
+    }
+
+    QDataStream out(&journal);
+    out.setVersion(QDataStream::Qt_5_2);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out << (entry != nullptr ? JOURNAL_ADD : JOURNAL_REMOVE);
+    out.writeRawData(hash.constData(), hash.size());
+    if(entry != nullptr)
+    {
+        out << entry->size << entry->timestamp << entry->type;
     }
+    journal.flush();
 }
 
-bool CDiskCache::contains(const QString& key) const
+void CDiskCache::rebuildIndex()
 {
-    QMutexLocker lock(&mutex);
+    qDebug() << "rebuild tile cache index for" << dir.path();
+
+    index.clear();
+    timeline.clear();
+    totalSize = 0;
+
+    for(int i = 0; i < 256; i++)
+    {
+        dir.mkpath(QString("%1").arg(i, 2, 16, QChar('0')));
+    }
 
-    QCryptographicHash md5(QCryptographicHash::Md5);
-    md5.addData(key.toLatin1());
+    // tiles of the old flat layout are moved into their sub-directory
+    const QFileInfoList& legacy = dir.entryInfoList(QStringList("*.png"), QDir::Files);
+    for(const QFileInfo &fileinfo : legacy)
+    {
+        const QByteArray& hash = QByteArray::fromHex(fileinfo.baseName().toLatin1());
+        if(hash.size() != 16 || !QFile::rename(fileinfo.absoluteFilePath(), filePath(hash, "image/png")))
+        {
+            QFile::remove(fileinfo.absoluteFilePath());
+        }
+    }
 
-    QString hash = md5.result().toHex();
-    return table.contains(hash) || cache.contains(hash);
+    const QStringList& subdirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for(const QString &subdir : subdirs)
+    {
+        const QFileInfoList& files = QDir(dir.absoluteFilePath(subdir)).entryInfoList(QDir::Files);
+        for(const QFileInfo &fileinfo : files)
+        {
+            const QByteArray& hash = QByteArray::fromHex(fileinfo.baseName().toLatin1());
+            if(hash.size() != 16)
+            {
+                continue;
+            }
+
+            entry_t entry;
+            entry.size      = fileinfo.size();
+            entry.timestamp = fileinfo.lastModified().toSecsSinceEpoch();
+            entry.type      = "image/" + fileinfo.suffix().toLatin1();
+            addEntry(hash, entry);
+        }
+    }
+}
+
+void CDiskCache::addEntry(const QByteArray& hash, const entry_t& entry)
+{
+    auto it = index.find(hash);
+    if(it != index.end())
+    {
+        totalSize -= it->size;
+        timeline.remove(it->timestamp, hash);
+    }
+
+    index[hash] = entry;
+    timeline.insert(entry.timestamp, hash);
+    totalSize += entry.size;
+    indexDirty = true;
+}
+
+void CDiskCache::dropEntry(const QByteArray& hash)
+{
+    auto it = index.find(hash);
+    if(it != index.end())
+    {
+        totalSize -= it->size;
+        timeline.remove(it->timestamp, hash);
+        index.erase(it);
+        indexDirty = true;
+    }
 }
 
-void CDiskCache::removeCacheFile(const QFileInfo &fileinfo)
+void CDiskCache::removeEntry(const QByteArray& hash)
 {
-    QString hash = fileinfo.baseName();
-    table.remove(hash);
+    auto it = index.find(hash);
+    if(it != index.end())
+    {
+        QFile::remove(filePath(hash, it->type));
+        dropEntry(hash);
+        writeJournal(hash, nullptr);
+    }
+
     cache.remove(hash);
-    QFile::remove(fileinfo.absoluteFilePath());
 }
 
-void CDiskCache::slotCleanup()
+void CDiskCache::addMissing(const QByteArray& hash)
+{
+    // tiles are remembered as missing for this session only, a simple reset keeps the set bounded
+    if(missing.size() >= MAX_MISSING)
+    {
+        missing.clear();
+    }
+    missing.insert(hash);
+}
+
+void CDiskCache::store(const QString& key, const QByteArray& data, const QString& contentType)
+{
+    QMutexLocker lock(&mutex);
+
+    const QByteArray& hash = hashKey(key);
+
+    QByteArray type = contentType.section(';', 0, 0).trimmed().toLower().toLatin1();
+    if(!data.isEmpty() && !type.startsWith("image/"))
+    {
+        // no or a bogus content type, try to guess the format from the data's header
+        QBuffer buffer;
+        buffer.setData(data);
+        const QByteArray& format = QImageReader::imageFormat(&buffer);
+        type = format.isEmpty() ? QByteArray() : "image/" + format;
+    }
+
+    if(data.isEmpty() || type.isEmpty())
+    {
+        addMissing(hash);
+        return;
+    }
+
+    // a tile of another type has to be removed first as the file name differs
+    auto it = index.find(hash);
+    if(it != index.end() && it->type != type)
+    {
+        removeEntry(hash);
+    }
+
+    QFile file(filePath(hash, type));
+    if(file.open(QIODevice::WriteOnly) && (file.write(data) == data.size()))
+    {
+        entry_t entry;
+        entry.size      = data.size();
+        entry.timestamp = QDateTime::currentSecsSinceEpoch();
+        entry.type      = type;
+        addEntry(hash, entry);
+        writeJournal(hash, &entry);
+    }
+    else
+    {
+        qWarning() << "Failed to write tile" << file.fileName();
+    }
+
+    cache.remove(hash);
+    missing.remove(hash);
+}
+
+void CDiskCache::restore(const QString& key, QImage& img)
+{
+    restore(hashKey(key), img);
+}
+
+void CDiskCache::restore(const QByteArray& hash, QImage& img)
 {
     QMutexLocker lock(&mutex);
 
-    QFileInfoList files = dir.entryInfoList(QStringList("*.png"), QDir::Files);
-    QDateTime now       = QDateTime::currentDateTime();
-    qint32 maxSizeBytes = maxSizeMB * 1024 * 1024;
-    qint32 tmpSize      = 0;
-    // expire old files and calculate cache size
-    for(const QFileInfo &fileinfo : files)
+    QImage * cached = cache.object(hash);
+    if(cached != nullptr)
+    {
+        img = *cached;
+    }
+    else if(missing.contains(hash))
+    {
+        img = dummy;
+    }
+    else if(index.contains(hash))
     {
-        if(fileinfo.lastModified().daysTo(now) > expirationDays)
+        const QByteArray type = index[hash].type;
+
+        QFile file(filePath(hash, type));
+        if(!file.open(QIODevice::ReadOnly))
         {
-            removeCacheFile(fileinfo);
-            qDebug() << "remove tile" << fileinfo.lastModified() << fileinfo.absoluteFilePath() << "(reason: expired)";
+            // the file is gone, request it again
+            removeEntry(hash);
+            img = QImage();
         }
         else
         {
-            tmpSize += fileinfo.size();
+            const QByteArray& data = file.readAll();
+            const QByteArray& format = type.mid(type.indexOf('/') + 1).toUpper();
+            if(img.loadFromData(data, format.constData()) || img.loadFromData(data))
+            {
+                cache.insert(hash, new QImage(img), qMax(1, (img.bytesPerLine() * img.height()) >> 10));
+            }
+            else
+            {
+                // the server did not send an image, do not request it again in this session
+                removeEntry(hash);
+                addMissing(hash);
+                img = dummy;
+            }
         }
     }
+    else
+    {
+        img = QImage();
+    }
+}
+
+qint64 CDiskCache::getAverageSize() const
+{
+    QMutexLocker lock(&mutex);
+
+    return index.isEmpty() ? 0 : totalSize / index.size();
+}
 
-    if(tmpSize > maxSizeBytes)
+bool CDiskCache::contains(const QString& key) const
+{
+    return contains(hashKey(key));
+}
+
+bool CDiskCache::contains(const QByteArray& hash) const
+{
+    QMutexLocker lock(&mutex);
+
+    return index.contains(hash) || missing.contains(hash) || cache.contains(hash);
+}
+
+void CDiskCache::slotCleanup()
+{
+    QMutexLocker lock(&mutex);
+
+    const qint64 expiration = QDateTime::currentSecsSinceEpoch() - qint64(expirationDays) * 86400;
+
+    // the timeline is sorted by age, thus only the oldest tiles have to be checked
+    while(!timeline.isEmpty())
     {
-        files = dir.entryInfoList(QStringList("*.png"), QDir::Files, QDir::Time | QDir::Reversed);
-        // if cache is still too large remove oldest files
-        for(const QFileInfo &fileinfo : files)
+        const qint64 timestamp = timeline.firstKey();
+        if(timestamp >= expiration && totalSize <= maxSizeBytes)
         {
-            removeCacheFile(fileinfo);
-            qDebug() << "remove tile" << fileinfo.lastModified() << fileinfo.absoluteFilePath() << "(reason: cache size limit)";
+            break;
+        }
 
-            tmpSize -= fileinfo.size();
+        const QByteArray hash = timeline.first();
+        qDebug() << "remove tile" << hash.toHex() << "(reason:" << (timestamp < expiration ? "expired)" : "cache size limit)");
+        removeEntry(hash);
+    }
 
-            if(tmpSize < maxSizeBytes)
-            {
-                break;
-            }
-        }
+    if(indexDirty)
+    {
+        saveIndex();
     }
 }
 
@@ -186,12 +521,7 @@ void CDiskCache::cleanupRemovedMaps(const QSet<QString> &maps)
             if(QFile(qdir.absoluteFilePath("QMS_cache")).exists())
             {
                 qDebug() << "remove cache directory" << dir << "(reason: map no longer exists)";
-                for(const QString &file : qdir.entryList(QDir::Files))
-                {
-                    qdir.remove(file);
-                }
-                qdir.cdUp();
-                qdir.rmdir(dir);
+                qdir.removeRecursively();
             }
             else
             {
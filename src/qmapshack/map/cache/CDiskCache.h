@@ -19,41 +19,114 @@
 #ifndef CDISKCACHE_H
 #define CDISKCACHE_H
 
+#include <QCache>
 #include <QDir>
+#include <QFile>
 #include <QHash>
 #include <QImage>
+#include <QMap>
 #include <QMutex>
+#include <QSet>
 
 class QTimer;
 
+/**
+   @brief A bounded tile cache with a persistent index
+
+   Tiles are stored as files in 256 sub-directories named by the first byte
+   of the tile's MD5 hash. An index file keeps the size and time stamp of
+   each tile. Thus the cache never has to list or stat() the directories
+   again after the first start. Changes since the index has been saved last
+   are appended to a journal, that is replayed on the next start. Thus no
+   tile is lost for the index after a crash. The total size is tracked
+   incrementally with 64 bit. Decoded tiles are kept in a byte budgeted LRU
+   in memory.
+
+   Tiles are stored as received from the server, together with their content
+   type. They are decoded in restore(), thus by the draw thread and only if
+   the tile is really drawn.
+ */
 class CDiskCache : public QObject
 {
     Q_OBJECT
 public:
     CDiskCache(const QString& path, qint32 size, qint32 days, QObject *parent);
-    virtual ~CDiskCache() = default;
+    virtual ~CDiskCache();
 
-    void store(const QString& key, QImage& img);
+    /**
+       @brief Store the encoded tile data as received from the server
+
+       @param key           the tile's key, usually the URL
+       @param data          the encoded image, an empty array marks the tile as missing
+       @param contentType   the MIME type of the data, it is guessed from the data if empty
+     */
+    void store(const QString& key, const QByteArray& data, const QString& contentType);
     void restore(const QString& key, QImage& img);
     bool contains(const QString& key) const;
 
+    /// same as above but with the key already hashed by hashKey()
+    void restore(const QByteArray& hash, QImage& img);
+    bool contains(const QByteArray& hash) const;
+
+    static QByteArray hashKey(const QString& key);
+
+    /// the average size of a tile on disc in bytes, 0 if the cache is empty
+    qint64 getAverageSize() const;
+    qint64 getMaxSize() const
+    {
+        return maxSizeBytes;
+    }
+
     static void cleanupRemovedMaps(const QSet<QString> &maps);
 
 private slots:
     void slotCleanup();
 
 private:
-    void removeCacheFile(const QFileInfo &fileinfo);
+    struct entry_t
+    {
+        qint64 size      = 0;
+        qint64 timestamp = 0;
+        /// the MIME type, e.g. "image/png"
+        QByteArray type;
+    };
+
+    QString filePath(const QByteArray& hash, const QByteArray& type) const;
+
+    bool loadIndex();
+    void saveIndex();
+    void rebuildIndex();
+    /// apply all changes recorded in the journal to the index, false if the journal is unreadable
+    bool replayJournal();
+    /// append a change to the journal, entry is nullptr if the tile has been removed
+    void writeJournal(const QByteArray& hash, const entry_t * entry);
+    void addEntry(const QByteArray& hash, const entry_t& entry);
+    /// remove a tile from the index only
+    void dropEntry(const QByteArray& hash);
+    /// remove a tile from the index and the disc
+    void removeEntry(const QByteArray& hash);
+    void addMissing(const QByteArray& hash);
 
     QDir dir;
 
-    const qint32 maxSizeMB;      //< maximum cache size in MB
+    const qint64 maxSizeBytes;   //< maximum cache size in bytes
     const qint32 expirationDays; //< expiration time in days
 
-    /// hash table to cache images as files on disc
-    QHash<QString, QString> table;
-    /// hash table to cache loaded images in memory
-    QHash<QString, QImage>  cache;
+    /// all tiles on disc with their size and time stamp
+    QHash<QByteArray, entry_t> index;
+    /// the same tiles sorted by time stamp, oldest first
+    QMultiMap<qint64, QByteArray> timeline;
+    /// the sum of all tile sizes on disc
+    qint64 totalSize = 0;
+    /// true if the index has changed since the last save
+    bool indexDirty = false;
+    /// all changes since the last save of the index
+    QFile journal;
+
+    /// LRU of decoded tiles, the cost is the tile size in kByte
+    QCache<QByteArray, QImage> cache;
+    /// hashes of tiles that failed to load during this session
+    QSet<QByteArray> missing;
 
     QTimer * timer;
 
@@ -0,0 +1,318 @@
+/**********************************************************************************************
+    Copyright (C) 2020 Norbert Truchsess <norbert.truchsess@t-online.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "helpers/CSettings.h"
+#include "map/cache/CTileSeeder.h"
+#include "map/CMapDraw.h"
+#include "map/CMapTMS.h"
+#include "map/CMapWMTS.h"
+#include "map/IMapOnline.h"
+#include "units/IUnit.h"
+
+#include <iostream>
+#include <QtNetwork>
+#include <QtWidgets>
+
+/// maximum number of requests in flight
+#define MAX_PENDING     4
+/// maximum number of attempts to download a tile
+#define MAX_RETRIES     3
+/// assumed size of a tile if the cache is empty [byte]
+#define DEFAULT_TILE_SIZE   (20 * 1024)
+
+CTileSeeder::CTileSeeder(IMapOnline *mapfile, QObject *parent)
+    : QObject(parent)
+    , mapfile(mapfile)
+{
+    accessManager = new QNetworkAccessManager(this);
+    connect(accessManager, &QNetworkAccessManager::finished, this, &CTileSeeder::slotRequestFinished);
+}
+
+CTileSeeder::~CTileSeeder()
+{
+}
+
+qint64 CTileSeeder::estimateSize(IMapOnline * mapfile, qint64 cnt)
+{
+    const qint64 averageSize = mapfile->getAverageTileSize();
+    return cnt * (averageSize ? averageSize : DEFAULT_TILE_SIZE);
+}
+
+void CTileSeeder::start(const QStringList& urls)
+{
+    queue.clear();
+    retries.clear();
+    for(const QString& url : urls)
+    {
+        queue.enqueue(url);
+    }
+
+    running = true;
+    done    = 0;
+    failed  = 0;
+    total   = urls.count();
+
+    requestNext();
+}
+
+void CTileSeeder::stop()
+{
+    if(!running)
+    {
+        return;
+    }
+
+    running = false;
+    queue.clear();
+    requestNext();
+}
+
+void CTileSeeder::requestNext()
+{
+    while(running && !mapfile.isNull() && (pending < MAX_PENDING) && !queue.isEmpty())
+    {
+        const QString url = queue.dequeue();
+
+        // tiles of a previous, interrupted run are skipped
+        if(mapfile->hasTile(url))
+        {
+            done++;
+            continue;
+        }
+
+        QNetworkReply * reply = accessManager->get(mapfile->createRequest(url, true));
+        // keep the URL as it is, as it is the key to the cache
+        reply->setProperty("url", url);
+        pending++;
+    }
+
+    emit sigProgress(done, failed, total);
+
+    if((pending == 0) && (queue.isEmpty() || !running || mapfile.isNull()))
+    {
+        running = false;
+        queue.clear();
+        emit sigFinished();
+    }
+}
+
+void CTileSeeder::slotRequestFinished(QNetworkReply * reply)
+{
+    reply->deleteLater();
+    pending--;
+
+    const QString& url = reply->property("url").toString();
+
+    if(reply->error() == QNetworkReply::NoError)
+    {
+        const QByteArray& data = reply->readAll();
+        if(!mapfile.isNull() && !data.isEmpty())
+        {
+            mapfile->storeTile(url, data, reply->header(QNetworkRequest::ContentTypeHeader).toString());
+        }
+        done++;
+    }
+    else
+    {
+        // errors of the content (not found, access denied, ...) will not change by retrying
+        const bool isContentError = (reply->error() >= QNetworkReply::ContentAccessDenied) && (reply->error() <= QNetworkReply::UnknownContentError);
+
+        qint32& n = retries[url];
+        if(running && !isContentError && (++n < MAX_RETRIES))
+        {
+            queue.enqueue(url);
+        }
+        else
+        {
+            retries.remove(url);
+            failed++;
+        }
+    }
+
+    requestNext();
+}
+
+bool CTileSeeder::loadMapConfig(IMapOnline * mapfile, const QString& filename)
+{
+    // the key of the map's configuration, see CMapDraw::createMapItem()
+    QFile f(filename);
+    f.open(QIODevice::ReadOnly);
+    QCryptographicHash md5(QCryptographicHash::Md5);
+    md5.addData(f.read(1024));
+    const QString key = md5.result().toHex();
+    f.close();
+
+    SETTINGS;
+    cfg.beginGroup("Canvas");
+    cfg.beginGroup("Views");
+
+    // prefer a view with the map being active
+    QString view;
+    for(const QString& name : cfg.childGroups())
+    {
+        cfg.beginGroup(name);
+        cfg.beginGroup("map");
+        const bool isActive = cfg.value("active").toStringList().contains(key);
+        const bool hasConfig = cfg.childGroups().contains(key);
+        cfg.endGroup(); // map
+        cfg.endGroup(); // name
+
+        if(hasConfig && (view.isEmpty() || isActive))
+        {
+            view = name;
+        }
+        if(hasConfig && isActive)
+        {
+            break;
+        }
+    }
+
+    if(!view.isEmpty())
+    {
+        cfg.beginGroup(view);
+        cfg.beginGroup("map");
+        cfg.beginGroup(key);
+        mapfile->loadConfig(cfg);
+        cfg.endGroup(); // key
+        cfg.endGroup(); // map
+        cfg.endGroup(); // view
+    }
+
+    cfg.endGroup(); // Views
+    cfg.endGroup(); // Canvas
+
+    return !view.isEmpty();
+}
+
+int CTileSeeder::exec(const QString& filename, const QString& area, const QString& levels)
+{
+    // --- parse the area, two points are the corners of a bounding box, more are a polygon
+    const QStringList& coords = area.split(',');
+    bool ok = (coords.count() >= 4) && ((coords.count() & 1) == 0);
+    QPolygonF polygon;
+    for(int i = 0; ok && i < coords.count(); i += 2)
+    {
+        const qreal lon = coords[i].trimmed().toDouble(&ok);
+        const qreal lat = ok ? coords[i + 1].trimmed().toDouble(&ok) : 0;
+        polygon << QPointF(lon, lat) * DEG_TO_RAD;
+    }
+    if(!ok)
+    {
+        std::cerr << tr("Bad area \"%1\". Expected: lon1,lat1,lon2,lat2[,lon3,lat3,...]").arg(area).toUtf8().constData() << std::endl;
+        return 1;
+    }
+
+    if(polygon.size() == 2)
+    {
+        polygon = QPolygonF(QRectF(polygon[0], polygon[1]).normalized());
+    }
+
+    // --- parse the zoom levels
+    const QStringList& range = levels.split('-');
+    qint32 minLevel = range.first().toInt(&ok);
+    qint32 maxLevel = minLevel;
+    if(ok && range.count() == 2)
+    {
+        maxLevel = range.last().toInt(&ok);
+    }
+    if(!ok || range.count() > 2 || minLevel > maxLevel)
+    {
+        std::cerr << tr("Bad zoom levels \"%1\". Expected: min-max").arg(levels).toUtf8().constData() << std::endl;
+        return 1;
+    }
+
+    // --- load the map
+    SETTINGS;
+    cfg.beginGroup("Canvas");
+    CMapDraw::loadMapPath(cfg);
+    cfg.endGroup();
+
+    QScopedPointer<IMapOnline> mapfile;
+    const QString& suffix = QFileInfo(filename).suffix().toLower();
+    if(suffix == "tms")
+    {
+        mapfile.reset(new CMapTMS(filename, nullptr));
+    }
+    else if(suffix == "wmts")
+    {
+        mapfile.reset(new CMapWMTS(filename, nullptr));
+    }
+    else
+    {
+        std::cerr << tr("Only *.tms and *.wmts maps can be seeded.").toUtf8().constData() << std::endl;
+        return 1;
+    }
+
+    if(!mapfile->activated())
+    {
+        std::cerr << tr("Failed to load %1").arg(filename).toUtf8().constData() << std::endl;
+        return 1;
+    }
+
+    // use the enabled layers and the cache settings of the map as configured in QMapShack
+    if(!loadMapConfig(mapfile.data(), filename))
+    {
+        std::cout << tr("No configuration found for %1. Using the defaults.").arg(filename).toUtf8().constData() << std::endl;
+    }
+
+    qint32 minMapLevel, maxMapLevel;
+    mapfile->getSeedLevels(minMapLevel, maxMapLevel);
+    minLevel = qMax(minLevel, minMapLevel);
+    maxLevel = qMin(maxLevel, maxMapLevel);
+
+    // --- collect the tiles
+    const qint64 cnt = mapfile->getSeedTiles(polygon, minLevel, maxLevel, nullptr);
+    if(cnt > maxTiles)
+    {
+        std::cerr << tr("%1 tiles exceed the limit of %2 tiles. Please reduce the area or the zoom levels.").arg(cnt).arg(maxTiles).toUtf8().constData() << std::endl;
+        return 1;
+    }
+
+    QStringList urls;
+    mapfile->getSeedTiles(polygon, minLevel, maxLevel, &urls);
+
+    const qint64 size = estimateSize(mapfile.data(), cnt);
+    std::cout << tr("Seed %1 tiles of zoom level %2 to %3 (about %4 MB) into %5")
+        .arg(cnt).arg(minLevel).arg(maxLevel).arg(size >> 20).arg(mapfile->getCachePath()).toUtf8().constData() << std::endl;
+
+    if(size > mapfile->getMaxCacheSize())
+    {
+        // the cache would remove the tiles right away
+        std::cerr << tr("The tiles exceed the cache size of %1 MB. Please set the map's cache size to at least %2 MB or reduce the area or the zoom levels.")
+            .arg(mapfile->getMaxCacheSize() >> 20).arg((size >> 20) + 1).toUtf8().constData() << std::endl;
+        return 1;
+    }
+
+    // --- download
+    CTileSeeder seeder(mapfile.data(), nullptr);
+    QEventLoop loop;
+    connect(&seeder, &CTileSeeder::sigProgress, [](qint32 done, qint32 failed, qint32 total)
+    {
+        std::cout << "\r" << tr("%1 of %2 tiles, %3 failed").arg(done).arg(total).arg(failed).toUtf8().constData() << std::flush;
+    });
+    connect(&seeder, &CTileSeeder::sigFinished, &loop, &QEventLoop::quit);
+
+    seeder.start(urls);
+    if(seeder.isRunning())
+    {
+        loop.exec();
+    }
+    std::cout << std::endl;
+
+    return seeder.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/**********************************************************************************************
+    Copyright (C) 2020 Norbert Truchsess <norbert.truchsess@t-online.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CTILESEEDER_H
+#define CTILESEEDER_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QRectF>
+
+class IMapOnline;
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/**
+   @brief Download all tiles of a list into the disk cache of an online map
+
+   The seeder uses an access manager of its own with a bounded number of
+   requests in flight. Thus it does not interfere with the map's requests
+   for visible tiles. Tiles already in the cache are skipped. Therefore an
+   interrupted seeding is resumed by simply starting it again with the same
+   area and zoom levels. Failed requests are retried a few times before the
+   tile is given up.
+ */
+class CTileSeeder : public QObject
+{
+    Q_OBJECT
+public:
+    CTileSeeder(IMapOnline * mapfile, QObject * parent);
+    virtual ~CTileSeeder();
+
+    /**
+       @brief Start to download all tiles not in the cache yet
+
+       @param urls  the tile URLs as collected by IMapOnline::getSeedTiles()
+     */
+    void start(const QStringList& urls);
+    /// stop seeding, the requests in flight will be finished
+    void stop();
+
+    bool isRunning() const
+    {
+        return running;
+    }
+
+    /// maximum number of tiles to seed at once
+    static const qint64 maxTiles = 500000;
+
+    /// estimate the size on disc of a number of tiles in bytes
+    static qint64 estimateSize(IMapOnline * mapfile, qint64 cnt);
+
+    /**
+       @brief Seed an online map's cache from the command line
+
+       @param filename  the map's *.tms or *.wmts file
+       @param area      the area as "lon1,lat1,lon2,lat2" in [°] for a bounding box, or more points for a polygon
+       @param levels    the zoom levels as "min-max" or a single level
+       @return The exit code of the application.
+     */
+    static int exec(const QString& filename, const QString& area, const QString& levels);
+
+signals:
+    void sigProgress(qint32 done, qint32 failed, qint32 total);
+    void sigFinished();
+
+private slots:
+    void slotRequestFinished(QNetworkReply * reply);
+
+private:
+    void requestNext();
+
+    /// load the map's configuration of the first view using the map, return false if there is none
+    static bool loadMapConfig(IMapOnline * mapfile, const QString& filename);
+
+    QPointer<IMapOnline> mapfile;
+    QNetworkAccessManager * accessManager;
+
+    /// the tiles still to request
+    QQueue<QString> queue;
+    /// the number of failed requests per tile
+    QHash<QString, qint32> retries;
+
+    bool running   = false;
+    qint32 pending = 0;
+    qint32 done    = 0;
+    qint32 failed  = 0;
+    qint32 total   = 0;
+};
+
+#endif //CTILESEEDER_H
+
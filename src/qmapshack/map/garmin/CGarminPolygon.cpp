@@ -43,8 +43,8 @@ struct sign_info_t
 };
 
 
-quint32 CGarminPolygon::cnt = 0;
-qint32 CGarminPolygon::maxVecSize = 0;
+thread_local quint32 CGarminPolygon::cnt = 0;
+thread_local qint32 CGarminPolygon::maxVecSize = 0;
 
 
 
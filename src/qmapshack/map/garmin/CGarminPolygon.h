@@ -76,8 +76,9 @@ public:
 
     QStringList labels;
 
-    static quint32 cnt;
-    static qint32 maxVecSize;
+    /// the polygons are decoded by the map's worker threads, thus each thread counts on its own
+    static thread_local quint32 cnt;
+    static thread_local qint32 maxVecSize;
 private:
     void bits_per_coord(quint8 base, quint8 bfirst, quint32& bx, quint32& by, sign_info_t& signinfo, bool isVer2);
     int bits_per_coord(quint8 base, bool is_signed);
@@ -0,0 +1,435 @@
+/**********************************************************************************************
+    Copyright (C) 2020 Norbert Truchsess <norbert.truchsess@t-online.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "map/mapsforge/CRenderTheme.h"
+
+static QColor readColor(const QXmlStreamAttributes& attr, const QString& name, const QColor& def)
+{
+    if(!attr.hasAttribute(name))
+    {
+        return def;
+    }
+    // QColor takes #RRGGBB and #AARRGGBB as used by Mapsforge
+    QColor color(attr.value(name).toString());
+    return color.isValid() ? color : def;
+}
+
+static qreal readReal(const QXmlStreamAttributes& attr, const QString& name, qreal def)
+{
+    bool ok = false;
+    const qreal val = attr.value(name).toDouble(&ok);
+    return ok ? val : def;
+}
+
+static QPen readStroke(const QXmlStreamAttributes& attr, qreal defWidth)
+{
+    const qreal width = readReal(attr, "stroke-width", defWidth);
+    if(!attr.hasAttribute("stroke") && (defWidth == 0))
+    {
+        return QPen(Qt::NoPen);
+    }
+    if(width <= 0)
+    {
+        return QPen(Qt::NoPen);
+    }
+
+    QPen pen(readColor(attr, "stroke", Qt::black), width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+
+    const QString& cap = attr.value("stroke-linecap").toString();
+    if(cap == "butt")
+    {
+        pen.setCapStyle(Qt::FlatCap);
+    }
+    else if(cap == "square")
+    {
+        pen.setCapStyle(Qt::SquareCap);
+    }
+
+    // Qt's dash pattern is in units of the pen width, Mapsforge's in pixel
+    const QStringList& dashes = attr.value("stroke-dasharray").toString().split(',', QString::SkipEmptyParts);
+    if(dashes.size() > 1)
+    {
+        QVector<qreal> pattern;
+        for(const QString& dash : dashes)
+        {
+            pattern << qMax(0.1, dash.toDouble() / width);
+        }
+        if(pattern.size() & 1)
+        {
+            pattern << pattern.last();
+        }
+        pen.setDashPattern(pattern);
+    }
+
+    return pen;
+}
+
+bool CRenderTheme::load(const QString& filename, QString& msg)
+{
+    rules.clear();
+    instructions.clear();
+    symbols.clear();
+    background = QColor(0xf8, 0xf8, 0xf8);
+    dir = QFileInfo(filename).absoluteDir();
+
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        msg = tr("Failed to open: ") + filename;
+        return false;
+    }
+
+    QXmlStreamReader xml(&file);
+    if(!xml.readNextStartElement() || (xml.name() != "rendertheme"))
+    {
+        msg = tr("Not a Mapsforge render theme: ") + filename;
+        return false;
+    }
+
+    background = readColor(xml.attributes(), "map-background", background);
+
+    while(xml.readNextStartElement())
+    {
+        if(xml.name() == "rule")
+        {
+            rule_t rule;
+            readRule(xml, rule);
+            rules << rule;
+        }
+        else
+        {
+            xml.skipCurrentElement();
+        }
+    }
+
+    if(xml.hasError())
+    {
+        msg = tr("Failed to read %1: %2 (line %3)").arg(filename).arg(xml.errorString()).arg(xml.lineNumber());
+        rules.clear();
+        instructions.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void CRenderTheme::readRule(QXmlStreamReader& xml, rule_t& rule)
+{
+    const QXmlStreamAttributes& attr = xml.attributes();
+
+    const QString& e = attr.value("e").toString();
+    if(e == "node")
+    {
+        rule.element = eElementNode;
+    }
+    else if(e == "way")
+    {
+        rule.element = eElementWay;
+    }
+
+    const QString& closed = attr.value("closed").toString();
+    if(closed == "yes")
+    {
+        rule.closed = eClosedYes;
+    }
+    else if(closed == "no")
+    {
+        rule.closed = eClosedNo;
+    }
+
+    rule.zoomMin = qBound(0, attr.value("zoom-min").toInt(), 127);
+    rule.zoomMax = attr.hasAttribute("zoom-max") ? qBound(0, attr.value("zoom-max").toInt(), 127) : 127;
+
+    rule.keys   = attr.value("k").toString().split('|', QString::SkipEmptyParts);
+    rule.values = attr.value("v").toString().split('|', QString::SkipEmptyParts);
+
+    rule.matchMissing = rule.values.removeAll("~") > 0;
+    rule.negate       = rule.values.removeAll("-") > 0;
+
+    while(xml.readNextStartElement())
+    {
+        const QStringRef& name = xml.name();
+        if(name == "rule")
+        {
+            rule_t child;
+            readRule(xml, child);
+            rule.rules << child;
+        }
+        else if(name == "area")
+        {
+            readInstruction(xml, eInstArea, rule);
+        }
+        else if(name == "line")
+        {
+            readInstruction(xml, eInstLine, rule);
+        }
+        else if(name == "circle")
+        {
+            readInstruction(xml, eInstCircle, rule);
+        }
+        else if(name == "caption")
+        {
+            readInstruction(xml, eInstCaption, rule);
+        }
+        else if(name == "pathText")
+        {
+            readInstruction(xml, eInstPathText, rule);
+        }
+        else if(name == "symbol")
+        {
+            readInstruction(xml, eInstSymbol, rule);
+        }
+        else if(name == "lineSymbol")
+        {
+            readInstruction(xml, eInstLineSymbol, rule);
+        }
+        else
+        {
+            xml.skipCurrentElement();
+        }
+    }
+}
+
+void CRenderTheme::readInstruction(QXmlStreamReader& xml, instruction_type_e type, rule_t& rule)
+{
+    const QXmlStreamAttributes& attr = xml.attributes();
+
+    instruction_t inst;
+    inst.type  = type;
+    inst.level = instructions.size();
+
+    switch(type)
+    {
+    case eInstArea:
+        inst.brush = QBrush(readColor(attr, "fill", Qt::transparent));
+        inst.pen   = readStroke(attr, 0);
+        break;
+
+    case eInstLine:
+        inst.pen   = readStroke(attr, 1);
+        break;
+
+    case eInstCircle:
+        inst.brush       = QBrush(readColor(attr, "fill", Qt::transparent));
+        inst.pen         = readStroke(attr, 0);
+        inst.scaleStroke = false;
+        inst.radius      = readReal(attr, "radius", readReal(attr, "r", 0));
+        inst.scaleRadius = attr.value("scale-radius") == "true";
+        break;
+
+    case eInstCaption:
+    case eInstPathText:
+    {
+        inst.key       = attr.value("k").toString();
+        inst.colorText = readColor(attr, "fill", Qt::black);
+        inst.colorHalo = readColor(attr, "stroke", Qt::black);
+        inst.widthHalo = readReal(attr, "stroke-width", 0);
+        inst.dy        = readReal(attr, "dy", 0);
+        inst.priority  = attr.value("priority").toInt();
+
+        const QString& family = attr.value("font-family").toString();
+        if(family == "serif")
+        {
+            inst.font.setStyleHint(QFont::Serif);
+        }
+        else if(family == "monospace")
+        {
+            inst.font.setStyleHint(QFont::Monospace);
+        }
+        else
+        {
+            inst.font.setStyleHint(QFont::SansSerif);
+        }
+
+        const QString& style = attr.value("font-style").toString();
+        inst.font.setBold(style.startsWith("bold"));
+        inst.font.setItalic(style.endsWith("italic"));
+        inst.font.setPixelSize(qMax(1, qRound(readReal(attr, "font-size", 10))));
+        break;
+    }
+
+    case eInstSymbol:
+        inst.symbol   = readSymbol(attr);
+        inst.priority = attr.value("priority").toInt();
+        break;
+
+    case eInstLineSymbol:
+        inst.symbol      = readSymbol(attr);
+        inst.priority    = attr.value("priority").toInt();
+        inst.dy          = readReal(attr, "dy", 0);
+        inst.alignCenter = attr.value("align-center") == "true";
+        inst.repeat      = attr.value("repeat") == "true";
+        inst.repeatGap   = qMax(1.0, readReal(attr, "repeat-gap", 200));
+        inst.repeatStart = readReal(attr, "repeat-start", 30);
+        break;
+    }
+
+    rule.instructions << instructions.size();
+    instructions << inst;
+
+    xml.skipCurrentElement();
+}
+
+QImage CRenderTheme::readSymbol(const QXmlStreamAttributes& attr)
+{
+    // Mapsforge prefixes the path by "file:", "jar:" or "assets:". All of them are
+    // taken as relative to the theme's directory.
+    QString src = attr.value("src").toString();
+    src = src.mid(src.indexOf(':') + 1);
+    if(src.isEmpty())
+    {
+        return QImage();
+    }
+    while(src.startsWith('/') && !QFileInfo::exists(src))
+    {
+        src.remove(0, 1);
+    }
+
+    const QString& path = dir.absoluteFilePath(src);
+    const QString& key  = QString("%1 %2 %3 %4").arg(path).arg(attr.value("symbol-width").toString()).arg(attr.value("symbol-height").toString()).arg(attr.value("symbol-percent").toString());
+    if(symbols.contains(key))
+    {
+        return symbols[key];
+    }
+
+    QImageReader reader(path);
+    QSize size = reader.size();
+    const qreal width   = readReal(attr, "symbol-width", 0);
+    const qreal height  = readReal(attr, "symbol-height", 0);
+    const qreal percent = readReal(attr, "symbol-percent", 100);
+    if(size.isValid())
+    {
+        // a single given dimension keeps the aspect ratio
+        if((width > 0) && (height > 0))
+        {
+            size = QSize(qRound(width), qRound(height));
+        }
+        else if(width > 0)
+        {
+            size = QSize(qRound(width), qRound(width * size.height() / size.width()));
+        }
+        else if(height > 0)
+        {
+            size = QSize(qRound(height * size.width() / size.height()), qRound(height));
+        }
+        size = (QSizeF(size) * percent / 100).toSize().expandedTo(QSize(1, 1));
+        reader.setScaledSize(size);
+    }
+
+    QImage img = reader.read();
+    if(img.isNull())
+    {
+        qWarning() << "Failed to read symbol" << path << reader.errorString();
+    }
+    symbols[key] = img;
+    return img;
+}
+
+void CRenderTheme::compile(const QStringList& tagsPOIs, const QStringList& tagsWays)
+{
+    for(rule_t& rule : rules)
+    {
+        compile(rule, tagsPOIs, tagsWays);
+    }
+}
+
+void CRenderTheme::compile(rule_t& rule, const QStringList& tagsPOIs, const QStringList& tagsWays)
+{
+    const bool anyKey   = rule.keys.contains("*");
+    const bool anyValue = rule.values.contains("*");
+
+    const QStringList * tables[2] = {&tagsPOIs, &tagsWays};
+    for(int t = 0; t < 2; t++)
+    {
+        const QStringList& tags = *tables[t];
+        rule.matchTag[t] = QBitArray(tags.size());
+        rule.matchKey[t] = QBitArray(tags.size());
+
+        for(int i = 0; i < tags.size(); i++)
+        {
+            const QString& tag = tags[i];
+            const int pos = tag.indexOf('=');
+            const QString& key   = tag.left(pos);
+            const QString& value = pos < 0 ? QString() : tag.mid(pos + 1);
+
+            const bool isKey = anyKey || rule.keys.contains(key);
+            rule.matchKey[t].setBit(i, isKey);
+            rule.matchTag[t].setBit(i, isKey && (anyValue || rule.values.contains(value)));
+        }
+    }
+
+    for(rule_t& child : rule.rules)
+    {
+        compile(child, tagsPOIs, tagsWays);
+    }
+}
+
+void CRenderTheme::match(element_e element, const QVector<quint32>& tags, quint8 zoom, bool closed, QVector<const instruction_t*>& result) const
+{
+    for(const rule_t& rule : rules)
+    {
+        match(rule, element, tags, zoom, closed, result);
+    }
+}
+
+void CRenderTheme::match(const rule_t& rule, element_e element, const QVector<quint32>& tags, quint8 zoom, bool closed, QVector<const instruction_t*>& result) const
+{
+    if(!(rule.element & element) || (zoom < rule.zoomMin) || (zoom > rule.zoomMax))
+    {
+        return;
+    }
+
+    if(!(rule.closed & (closed ? eClosedYes : eClosedNo)))
+    {
+        return;
+    }
+
+    if(!rule.keys.isEmpty())
+    {
+        const int t = element == eElementWay ? 1 : 0;
+        const QBitArray& matchTag = rule.matchTag[t];
+        const QBitArray& matchKey = rule.matchKey[t];
+
+        bool hasTag = false;
+        bool hasKey = false;
+        for(quint32 tag : tags)
+        {
+            if(tag < quint32(matchTag.size()))
+            {
+                hasTag |= matchTag.testBit(tag);
+                hasKey |= matchKey.testBit(tag);
+            }
+        }
+
+        const bool matches = rule.negate ? !hasTag : (hasTag || (rule.matchMissing && !hasKey));
+        if(!matches)
+        {
+            return;
+        }
+    }
+
+    for(qint32 idx : rule.instructions)
+    {
+        result << &instructions[idx];
+    }
+
+    for(const rule_t& child : rule.rules)
+    {
+        match(child, element, tags, zoom, closed, result);
+    }
+}
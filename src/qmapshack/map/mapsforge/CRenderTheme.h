@@ -0,0 +1,181 @@
+/**********************************************************************************************
+    Copyright (C) 2020 Norbert Truchsess <norbert.truchsess@t-online.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CRENDERTHEME_H
+#define CRENDERTHEME_H
+
+#include <QBitArray>
+#include <QtGui>
+
+/**
+   @brief A subset of the Mapsforge XML render theme
+
+   The theme is a tree of rules. Each rule matches elements by type, tags, zoom level and
+   whether a way is closed. Matching rules contribute their render instructions and pass
+   the element on to their child rules.
+
+   Supported instructions are <area>, <line>, <circle>, <caption>, <pathText>, <symbol> and
+   <lineSymbol>. The images of symbols are loaded relative to the theme's directory. Style
+   menus are ignored.
+
+   The tag matching is compiled against the tag tables of a map file by compile(). Thus
+   match() only tests bits and is safe to be called by several threads at once.
+ */
+class CRenderTheme
+{
+    Q_DECLARE_TR_FUNCTIONS(CRenderTheme)
+public:
+    CRenderTheme() = default;
+    virtual ~CRenderTheme() = default;
+
+    enum element_e
+    {
+        eElementNode   = 0x01
+        , eElementWay  = 0x02
+        , eElementAny  = 0x03
+    };
+
+    enum closed_e
+    {
+        eClosedNo      = 0x01
+        , eClosedYes   = 0x02
+        , eClosedAny   = 0x03
+    };
+
+    enum instruction_type_e
+    {
+        eInstArea
+        , eInstLine
+        , eInstCircle
+        , eInstCaption
+        , eInstPathText
+        , eInstSymbol
+        , eInstLineSymbol
+    };
+
+    struct instruction_t
+    {
+        instruction_type_e type = eInstArea;
+        /// the drawing order of areas and lines, the position in the theme
+        qint32 level = 0;
+
+        QPen pen {Qt::NoPen};
+        QBrush brush {Qt::NoBrush};
+        /// the stroke width scales with the zoom level
+        bool scaleStroke = true;
+
+        qreal radius = 0;
+        bool scaleRadius = false;
+
+        /// the element's text to show, "name", "ref", "addr:housenumber" or "ele"
+        QString key;
+        QFont font;
+        QColor colorText {Qt::black};
+        QColor colorHalo {Qt::transparent};
+        qreal widthHalo = 0;
+        /// vertical offset of captions in [px]
+        qreal dy = 0;
+        qint32 priority = 0;
+
+        /// the image of symbols and line symbols, a null image if it could not be loaded
+        QImage symbol;
+        /// line symbols are centered on the line instead of sitting on top of it
+        bool alignCenter = false;
+        /// line symbols are repeated along the line
+        bool repeat = false;
+        /// distance of repeated line symbols in [px]
+        qreal repeatGap = 200;
+        /// distance of the first line symbol from the start of the line in [px]
+        qreal repeatStart = 30;
+    };
+
+    /**
+       @brief Load the theme from an XML file
+
+       @param filename  the theme's file name, a resource path is fine, too
+       @param msg       an error message if the theme could not be loaded
+       @return True on success.
+     */
+    bool load(const QString& filename, QString& msg);
+
+    /**
+       @brief Resolve the rules' key/value lists to the tag tables of a map
+
+       @param tagsPOIs  the "key=value" tags of the map's POIs
+       @param tagsWays  the "key=value" tags of the map's ways
+     */
+    void compile(const QStringList& tagsPOIs, const QStringList& tagsWays);
+
+    /**
+       @brief Collect the instructions to render an element
+
+       @param element   either eElementNode or eElementWay
+       @param tags      the element's tags as index into the tag tables passed to compile()
+       @param zoom      the zoom level
+       @param closed    true if the element is a closed way
+       @param result    the list of matching instructions, in the order of the theme
+     */
+    void match(element_e element, const QVector<quint32>& tags, quint8 zoom, bool closed, QVector<const instruction_t*>& result) const;
+
+    const QColor& getBackground() const
+    {
+        return background;
+    }
+
+private:
+    struct rule_t
+    {
+        element_e element = eElementAny;
+        closed_e closed = eClosedAny;
+        quint8 zoomMin = 0;
+        quint8 zoomMax = 127;
+
+        QStringList keys;
+        QStringList values;
+        /// match if no tag of the element has one of the keys
+        bool matchMissing = false;
+        /// match if no tag of the element matches keys and values
+        bool negate = false;
+
+        /// tags matching keys and values, [0] for POIs, [1] for ways
+        QBitArray matchTag[2];
+        /// tags matching the keys only, [0] for POIs, [1] for ways
+        QBitArray matchKey[2];
+
+        /// index into CRenderTheme::instructions
+        QVector<qint32> instructions;
+        QVector<rule_t> rules;
+    };
+
+    void readRule(QXmlStreamReader& xml, rule_t& rule);
+    void readInstruction(QXmlStreamReader& xml, instruction_type_e type, rule_t& rule);
+    QImage readSymbol(const QXmlStreamAttributes& attr);
+    void compile(rule_t& rule, const QStringList& tagsPOIs, const QStringList& tagsWays);
+    void match(const rule_t& rule, element_e element, const QVector<quint32>& tags, quint8 zoom, bool closed, QVector<const instruction_t*>& result) const;
+
+    QColor background {0xf8, 0xf8, 0xf8};
+    QVector<rule_t> rules;
+    QVector<instruction_t> instructions;
+
+    /// the directory of the theme file, the base of relative symbol paths
+    QDir dir;
+    /// the symbols loaded so far, by their path
+    QHash<QString, QImage> symbols;
+};
+
+#endif //CRENDERTHEME_H
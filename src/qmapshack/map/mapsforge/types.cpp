@@ -27,7 +27,7 @@ QDataStream & operator>>(QDataStream& s, uintX& v)
     s >> tmp;
     while(tmp & 0x80)
     {
-        v.val |= (tmp & 0x7F) << shift;
+        v.val |= quint64(tmp & 0x7F) << shift;
         shift += 7;
         s >> tmp;
     }
@@ -46,14 +46,14 @@ QDataStream& operator>>(QDataStream& s, intX& v)
     s >> tmp;
     while(tmp & 0x80)
     {
-        v.val |= (tmp & 0x7F) << shift;
+        v.val |= quint64(tmp & 0x7F) << shift;
         shift += 7;
         s >> tmp;
     }
 
     if(tmp & 0x40)
     {
-        v.val = -(v.val | ((tmp & 0x3f) << shift));
+        v.val = -(v.val | (quint64(tmp & 0x3f) << shift));
     }
     else
     {
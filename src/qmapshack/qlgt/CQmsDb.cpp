@@ -260,7 +260,8 @@ quint64 CQmsDb::store(IGisItem& item)
 
     QSqlQuery query(db);
     // item is unknown to database -> create item in database
-    query.prepare("INSERT INTO items (type, keyqms, icon, name, date, comment, data, hash) VALUES (:type, :keyqms, :icon, :name, :date, :comment, :data, :hash)");
+    query.prepare("INSERT INTO items (type, keyqms, icon, name, date, comment, data, hash, lon_min, lat_min, lon_max, lat_max, time_start, time_end) "
+                  "VALUES (:type, :keyqms, :icon, :name, :date, :comment, :data, :hash, :lon_min, :lat_min, :lon_max, :lat_max, :time_start, :time_end)");
     query.bindValue(":type",    item.type());
     query.bindValue(":keyqms",     item.getKey().item);
     query.bindValue(":icon",    buffer.data());
@@ -269,6 +270,7 @@ quint64 CQmsDb::store(IGisItem& item)
     query.bindValue(":comment", item.getInfo(IGisItem::eFeatureShowName | IGisItem::eFeatureShowFullText));
     query.bindValue(":data", data);
     query.bindValue(":hash", item.getHash());
+    IDB::bindExtent(query, item);
     QUERY_EXEC(return 0);
 
     query.prepare("SELECT last_insert_rowid() from items");
@@ -42,6 +42,7 @@ bool CRtGpsTetherRecord::writeEntry(qreal lon, qreal lat, qreal ele, qreal speed
     if(speed != NOFLOAT)
     {
         trkpt.extensions["speed"] = speed;
+        trkpt.squeezeExtensions();
     }
 
     stream << trkpt;
@@ -31,13 +31,19 @@ public:
     const bool logfile;          // -f, print debug messages to logfile
     const bool nosplash;         // -n, do not display splash screen
     const QString configfile;
+    const QString seedMap;       // --seed, seed the cache of this online map and quit
+    const QString seedArea;      // --seed-area, area to seed as lon1,lat1,lon2,lat2[,...]
+    const QString seedLevels;    // --seed-levels, zoom levels to seed as min-max
     const QStringList arguments;
 
-    CAppOpts(bool doDebug, bool doLogfile, bool noSplash, const QString& config, const QStringList& args)
+    CAppOpts(bool doDebug, bool doLogfile, bool noSplash, const QString& config, const QString& seed, const QString& area, const QString& levels, const QStringList& args)
         : debug(doDebug)
         , logfile(doLogfile)
         , nosplash(noSplash)
         , configfile(config)
+        , seedMap(seed)
+        , seedArea(area)
+        , seedLevels(levels)
         , arguments(args)
     {
     }
@@ -40,6 +40,15 @@ CAppOpts* CCommandProcessor::processOptions(const QStringList &arguments)
     QCommandLineOption configOption(QStringList() << "c" << "config", tr("File with QMapShack configuration."), tr("file"));
     parser.addOption(configOption);
 
+    QCommandLineOption seedOption("seed", tr("Download the tiles of an online map (*.tms, *.wmts) into the cache and quit."), tr("file"));
+    parser.addOption(seedOption);
+
+    QCommandLineOption seedAreaOption("seed-area", tr("Area to seed in degrees. Two points are the corners of a bounding box, more points a polygon."), tr("lon1,lat1,lon2,lat2[,...]"));
+    parser.addOption(seedAreaOption);
+
+    QCommandLineOption seedLevelsOption("seed-levels", tr("Zoom levels to seed."), tr("min-max"), "0-16");
+    parser.addOption(seedLevelsOption);
+
     parser.addPositionalArgument("files", tr("Files for future use."));
 
     if (!parser.parse(arguments))
@@ -54,5 +63,12 @@ CAppOpts* CCommandProcessor::processOptions(const QStringList &arguments)
         exit(0);
     }
 
-    return new CAppOpts(parser.isSet(debugOption), parser.isSet(logfileOption), parser.isSet(nosplashOption), parser.value(configOption), parser.positionalArguments());
+    if (parser.isSet(seedOption) && !parser.isSet(seedAreaOption))
+    {
+        std::cerr << tr("Option --seed needs --seed-area.").toUtf8().constData() << std::endl;
+        exit(1);
+    }
+
+    return new CAppOpts(parser.isSet(debugOption), parser.isSet(logfileOption), parser.isSet(nosplashOption), parser.value(configOption),
+                        parser.value(seedOption), parser.value(seedAreaOption), parser.value(seedLevelsOption), parser.positionalArguments());
 }
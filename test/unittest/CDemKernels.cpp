@@ -0,0 +1,285 @@
+/**********************************************************************************************
+    Copyright (C) 2014 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "TestHelper.h"
+#include "test_QMapShack.h"
+
+#include "dem/IDem.h"
+#include "units/IUnit.h"
+
+#include <QtCore>
+#include <QtGui>
+
+#define TILE_SIZE   256
+#define NO_DATA     -32768
+
+/**
+   @brief Access to the shading kernels of IDem together with the kernels
+   of QMapShack 1.9 as reference
+ */
+class CDemKernels : public IDem
+{
+public:
+    CDemKernels() : IDem(nullptr)
+    {
+        xscale    = 10;
+        yscale    = -10;
+        hasNoData = 1;
+        noData    = NO_DATA;
+        setElevationLimit(1500);
+    }
+
+    void draw(IDrawContext::buffer_t&) override
+    {
+    }
+
+    qreal getElevationAt(const QPointF&, bool) override
+    {
+        return NOFLOAT;
+    }
+
+    qreal getSlopeAt(const QPointF&, bool) override
+    {
+        return NOFLOAT;
+    }
+
+    using IDem::hillshading;
+    using IDem::slopecolor;
+    using IDem::elevationLimit;
+
+    void hillshadingRef(QVector<qint16>& data, qreal w, qreal h, QImage& img)
+    {
+        const int wp2 = w + 2;
+        // the default of IDem::factorHillshading
+        const qreal factor = 0.1666666716337204;
+
+        for(int m = 1; m <= h; m++)
+        {
+            uchar * scan = img.scanLine(m - 1);
+            for(int n = 1; n <= w; n++)
+            {
+                qint16 win[eWinsize3x3];
+                fillWindow(data, n, m, wp2, win);
+
+                if(hasNoData && win[4] == noData)
+                {
+                    scan[n - 1] = 255;
+                    continue;
+                }
+
+                qreal dx         = ((win[0] + win[3] + win[3] + win[6]) - (win[2] + win[5] + win[5] + win[8])) / (xscale * factor);
+                qreal dy         = ((win[6] + win[7] + win[7] + win[8]) - (win[0] + win[1] + win[1] + win[2])) / (yscale * factor);
+                qreal aspect     = qAtan2(dy, dx);
+                qreal xx_plus_yy = dx * dx + dy * dy;
+                qreal cang       = (qSin(45 * DEG_TO_RAD) - 0.125 * qCos(45 * DEG_TO_RAD) * qSqrt(xx_plus_yy) * qSin(aspect - 315 * DEG_TO_RAD)) / qSqrt(1 + 0.125 * 0.125 * xx_plus_yy);
+
+                scan[n - 1] = (cang <= 0.0) ? 1.0 : 1.0 + (254.0 * cang);
+            }
+        }
+    }
+
+    void slopecolorRef(QVector<qint16>& data, qreal w, qreal h, QImage& img)
+    {
+        const int wp2 = w + 2;
+        const qreal * steps = getCurrentSlopeStepTable();
+
+        for(int m = 1; m <= h; m++)
+        {
+            uchar * scan = img.scanLine(m - 1);
+            for(int n = 1; n <= w; n++)
+            {
+                qint16 win[eWinsize3x3];
+                fillWindow(data, n, m, wp2, win);
+                const qreal slope = slopeOfWindowInterp(win, eWinsize3x3, 0, 0);
+
+                scan[n - 1] = slope > steps[4] ? 5
+                              : slope > steps[3] ? 4
+                              : slope > steps[2] ? 3
+                              : slope > steps[1] ? 2
+                              : slope > steps[0] ? 1
+                              : 0;
+            }
+        }
+    }
+
+    void elevationLimitRef(QVector<qint16>& data, qreal w, qreal h, QImage& img)
+    {
+        const int wp2 = w + 2;
+
+        for(int m = 1; m <= h; m++)
+        {
+            uchar * scan = img.scanLine(m - 1);
+            for(int n = 1; n <= w; n++)
+            {
+                qint16 win[eWinsize3x3];
+                fillWindow(data, n, m, wp2, win);
+
+                qreal meters = -2.0;
+                for(int i = 0; i < eWinsize3x3; i++)
+                {
+                    if(win[i] != noData && win[i] > meters)
+                    {
+                        meters = win[i];
+                    }
+                }
+
+                qreal elevation;
+                QString unit;
+                IUnit::self().meter2elevation(meters, elevation, unit);
+                scan[n - 1] = (elevation >= getElevationLimit()) ? 1 : 0;
+            }
+        }
+    }
+
+private:
+    static void fillWindow(const QVector<qint16>& data, int x, int y, int dx, qint16 * w)
+    {
+        w[0] = data[(x - 1) + (y - 1) * dx];
+        w[1] = data[(x    ) + (y - 1) * dx];
+        w[2] = data[(x + 1) + (y - 1) * dx];
+        w[3] = data[(x - 1) + (y    ) * dx];
+        w[4] = data[(x    ) + (y    ) * dx];
+        w[5] = data[(x + 1) + (y    ) * dx];
+        w[6] = data[(x - 1) + (y + 1) * dx];
+        w[7] = data[(x    ) + (y + 1) * dx];
+        w[8] = data[(x + 1) + (y + 1) * dx];
+    }
+};
+
+/// a tile of hilly terrain with some noise and a few holes, including the 1 px border
+static QVector<qint16> createTerrain()
+{
+    qsrand(7);
+
+    const int wp2 = TILE_SIZE + 2;
+    QVector<qint16> data(wp2 * wp2);
+    for(int y = 0; y < wp2; y++)
+    {
+        for(int x = 0; x < wp2; x++)
+        {
+            data[x + y * wp2] = 1500 + 600 * qSin(x / 17.0) * qCos(y / 23.0) + 40 * qSin((x + y) / 3.0) + qrand() % 5;
+        }
+    }
+
+    for(int i = 0; i < 50; i++)
+    {
+        data[qrand() % data.size()] = NO_DATA;
+    }
+    return data;
+}
+
+static QImage createImage()
+{
+    QImage img(TILE_SIZE, TILE_SIZE, QImage::Format_Indexed8);
+    img.fill(0);
+    return img;
+}
+
+/**
+   @brief Count the pixels that differ and the maximum difference
+ */
+static void compareImages(const QImage& img1, const QImage& img2, int& cnt, int& maxDiff)
+{
+    cnt     = 0;
+    maxDiff = 0;
+    for(int y = 0; y < img1.height(); y++)
+    {
+        const uchar * scan1 = img1.constScanLine(y);
+        const uchar * scan2 = img2.constScanLine(y);
+        for(int x = 0; x < img1.width(); x++)
+        {
+            const int diff = qAbs(int(scan1[x]) - int(scan2[x]));
+            if(diff)
+            {
+                ++cnt;
+                maxDiff = qMax(maxDiff, diff);
+            }
+        }
+    }
+}
+
+void test_QMapShack::_demKernels()
+{
+    CDemKernels dem;
+    QVector<qint16> data = createTerrain();
+
+    int cnt, maxDiff;
+    QImage img1 = createImage();
+    QImage img2 = createImage();
+
+    // pure integer arithmetic, thus exactly the same
+    dem.elevationLimit(data, TILE_SIZE, TILE_SIZE, img1);
+    dem.elevationLimitRef(data, TILE_SIZE, TILE_SIZE, img2);
+    compareImages(img1, img2, cnt, maxDiff);
+    VERIFY_EQUAL(0, cnt);
+
+    /*
+        The closed forms use other floating point operations than atan2(),
+        sin() and atan(). Pixels right at a rounding or class boundary may
+        change by one. More is a bug.
+     */
+    for(int i = 0; i < int(IDem::slopePresetCount); i++)
+    {
+        dem.setSlopeStepTable(i);
+        dem.slopecolor(data, TILE_SIZE, TILE_SIZE, img1);
+        dem.slopecolorRef(data, TILE_SIZE, TILE_SIZE, img2);
+        compareImages(img1, img2, cnt, maxDiff);
+        qDebug() << "slope color preset" << i << ":" << cnt << "pixels differ";
+        SUBVERIFY(maxDiff <= 1, QString("Slope color differs by %1 classes").arg(maxDiff));
+        SUBVERIFY(cnt <= TILE_SIZE * TILE_SIZE / 1000, QString("Slope color differs for %1 pixels").arg(cnt));
+    }
+
+    dem.hillshading(data, TILE_SIZE, TILE_SIZE, img1);
+    dem.hillshadingRef(data, TILE_SIZE, TILE_SIZE, img2);
+    compareImages(img1, img2, cnt, maxDiff);
+    qDebug() << "hillshading:" << cnt << "pixels differ";
+    SUBVERIFY(maxDiff <= 1, QString("Hillshading differs by %1").arg(maxDiff));
+    SUBVERIFY(cnt <= TILE_SIZE * TILE_SIZE / 1000, QString("Hillshading differs for %1 pixels").arg(cnt));
+}
+
+void test_QMapShack::_demKernelsBenchmark_data()
+{
+    QTest::addColumn<bool>("reference");
+    QTest::newRow("QMapShack 1.9") << true;
+    QTest::newRow("current") << false;
+}
+
+void test_QMapShack::_demKernelsBenchmark()
+{
+    QFETCH(bool, reference);
+
+    CDemKernels dem;
+    QVector<qint16> data = createTerrain();
+    QImage img = createImage();
+
+    QBENCHMARK
+    {
+        if(reference)
+        {
+            dem.hillshadingRef(data, TILE_SIZE, TILE_SIZE, img);
+            dem.slopecolorRef(data, TILE_SIZE, TILE_SIZE, img);
+            dem.elevationLimitRef(data, TILE_SIZE, TILE_SIZE, img);
+        }
+        else
+        {
+            dem.hillshading(data, TILE_SIZE, TILE_SIZE, img);
+            dem.slopecolor(data, TILE_SIZE, TILE_SIZE, img);
+            dem.elevationLimit(data, TILE_SIZE, TILE_SIZE, img);
+        }
+    }
+}
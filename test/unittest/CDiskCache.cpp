@@ -0,0 +1,92 @@
+/**********************************************************************************************
+    Copyright (C) 2014 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "TestHelper.h"
+#include "test_QMapShack.h"
+
+#include "map/cache/CDiskCache.h"
+
+#include <QtCore>
+#include <QtGui>
+
+static QByteArray createTile(const QColor& color)
+{
+    QImage img(256, 256, QImage::Format_ARGB32);
+    img.fill(color);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    img.save(&buffer, "PNG");
+    return data;
+}
+
+void test_QMapShack::_diskCacheStoreRestore()
+{
+    QTemporaryDir tmp;
+    SUBVERIFY(tmp.isValid(), "Failed to create temporary directory");
+
+    const QByteArray& tile = createTile(Qt::red);
+    {
+        CDiskCache cache(tmp.path(), 100, 8, nullptr);
+        cache.store("tile1", tile, "image/png");
+        cache.store("tile2", QByteArray(), "");
+
+        SUBVERIFY(cache.contains("tile1"), "Stored tile not in cache");
+        SUBVERIFY(cache.contains("tile2"), "Missing tile not remembered");
+
+        QImage img;
+        cache.restore("tile1", img);
+        VERIFY_EQUAL(256, img.width());
+        VERIFY_EQUAL(tile.size(), cache.getAverageSize());
+    }
+
+    // the index is saved on destruction, missing tiles are forgotten
+    CDiskCache cache(tmp.path(), 100, 8, nullptr);
+    SUBVERIFY(cache.contains("tile1"), "Tile lost after restart");
+    SUBVERIFY(!cache.contains("tile2"), "Missing tile remembered after restart");
+}
+
+void test_QMapShack::_diskCacheJournal()
+{
+    QTemporaryDir tmp;
+    SUBVERIFY(tmp.isValid(), "Failed to create temporary directory");
+
+    const QByteArray& tile1 = createTile(Qt::red);
+    const QByteArray& tile2 = createTile(Qt::blue);
+
+    {
+        CDiskCache cache(tmp.path(), 100, 8, nullptr);
+        cache.store("tile1", tile1, "image/png");
+    }
+
+    // simulate a crash: the cache is never destroyed, thus the index is never saved
+    CDiskCache * crashed = new CDiskCache(tmp.path(), 100, 8, nullptr);
+    crashed->store("tile2", tile2, "image/png");
+
+    CDiskCache cache(tmp.path(), 100, 8, nullptr);
+    SUBVERIFY(cache.contains("tile1"), "Tile of saved index lost");
+    SUBVERIFY(cache.contains("tile2"), "Tile of journal lost");
+    VERIFY_EQUAL((tile1.size() + tile2.size()) / 2, cache.getAverageSize());
+
+    QImage img;
+    cache.restore("tile2", img);
+    VERIFY_EQUAL(QColor(Qt::blue).rgba(), img.pixel(0, 0));
+
+    Q_UNUSED(crashed);
+}
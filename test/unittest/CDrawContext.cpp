@@ -0,0 +1,111 @@
+/**********************************************************************************************
+    Copyright (C) 2014 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "TestHelper.h"
+#include "test_QMapShack.h"
+
+#include "canvas/IDrawContext.h"
+
+#include <QtCore>
+
+#define PROJ_MERC   "+proj=merc +a=6378137.0000 +b=6356752.3142 +towgs84=0,0,0,0,0,0,0,0 +units=m  +no_defs"
+#define PROJ_WGS84  "+proj=longlat +a=6378137.0000 +b=6356752.3142 +towgs84=0,0,0,0,0,0,0,0 +units=m  +no_defs"
+
+/// points of a zig zag line, every 97th point is beyond the antimeridian if withFixes is true
+static QPolygonF createPoints(int N, bool withFixes)
+{
+    QPolygonF pts(N);
+    for(int i = 0; i < N; i++)
+    {
+        qreal lon = -170 + (i % 3400) * 0.1;
+        if(withFixes && (i % 97 == 0))
+        {
+            lon += (lon < 0) ? -20 : 20;
+        }
+        pts[i] = QPointF(lon, -60 + (i % 1200) * 0.1) * DEG_TO_RAD;
+    }
+    return pts;
+}
+
+void test_QMapShack::_drawContextConvert()
+{
+    projPJ pjsrc = pj_init_plus(PROJ_MERC);
+    projPJ pjtar = pj_init_plus(PROJ_WGS84);
+
+    const QPolygonF& orig = createPoints(10000, true);
+
+    QPolygonF batch = orig;
+    IDrawContext::convertRad2M(pjsrc, pjtar, batch.data(), batch.size());
+
+    for(int i = 0; i < orig.size(); i++)
+    {
+        QPointF pt = orig[i];
+        IDrawContext::convertRad2M(pjsrc, pjtar, &pt, 1);
+        SUBVERIFY(qAbs(pt.x() - batch[i].x()) < 1e-6 && qAbs(pt.y() - batch[i].y()) < 1e-6, QString("Point %1 differs from single conversion").arg(i));
+
+        // points beyond the antimeridian continue the map instead of wrapping around
+        if(orig[i].x() > 180 * DEG_TO_RAD)
+        {
+            SUBVERIFY(batch[i].x() > 20037508, QString("Point %1 east of the antimeridian is wrapped around").arg(i));
+        }
+        else if(orig[i].x() < -180 * DEG_TO_RAD)
+        {
+            SUBVERIFY(batch[i].x() < -20037508, QString("Point %1 west of the antimeridian is wrapped around").arg(i));
+        }
+    }
+
+    pj_free(pjtar);
+    pj_free(pjsrc);
+}
+
+void test_QMapShack::_drawContextBenchmark_data()
+{
+    QTest::addColumn<bool>("batch");
+    QTest::newRow("single") << false;
+    QTest::newRow("batch")  << true;
+}
+
+void test_QMapShack::_drawContextBenchmark()
+{
+    QFETCH(bool, batch);
+
+    projPJ pjsrc = pj_init_plus(PROJ_MERC);
+    projPJ pjtar = pj_init_plus(PROJ_WGS84);
+
+    const QPolygonF& orig = createPoints(10000000, false);
+    QPolygonF pts;
+
+    QBENCHMARK
+    {
+        pts = orig;
+        if(batch)
+        {
+            IDrawContext::convertRad2M(pjsrc, pjtar, pts.data(), pts.size());
+        }
+        else
+        {
+            for(QPointF& pt : pts)
+            {
+                IDrawContext::convertRad2M(pjsrc, pjtar, &pt, 1);
+            }
+        }
+    }
+
+    pj_free(pjtar);
+    pj_free(pjsrc);
+}
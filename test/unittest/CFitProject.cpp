@@ -23,6 +23,8 @@
 
 #include "gis/prj/IGisProject.h"
 #include "gis/fit/CFitProject.h"
+#include "gis/fit/decoder/CFitDecoder.h"
+#include "gis/fit/decoder/CFitMessage.h"
 
 void test_QMapShack::_readValidFitFiles()
 {
@@ -31,3 +33,30 @@ void test_QMapShack::_readValidFitFiles()
     delete readProjFile("2016-03-12_15-16-50_4_20.fit");
 }
 
+
+void test_QMapShack::_fitDecoderBenchmark_data()
+{
+    QTest::addColumn<QString>("file");
+    QTest::newRow("activity")        << "2015-05-07-22-03-17.fit";
+    QTest::newRow("course")          << "Warisouderghem_course.fit";
+    QTest::newRow("developer fields") << "2016-03-12_15-16-50_4_20.fit";
+}
+
+void test_QMapShack::_fitDecoderBenchmark()
+{
+    QFETCH(QString, file);
+
+    QFile fitFile(testInput + "fit/" + file);
+    SUBVERIFY(fitFile.open(QIODevice::ReadOnly), "Failed to open " + file);
+
+    // the samples are small, decode each of them several times per run
+    CFitDecoder decoder;
+    QBENCHMARK
+    {
+        for(int i = 0; i < 20; i++)
+        {
+            decoder.decode(fitFile);
+        }
+    }
+    SUBVERIFY(!decoder.getMessages().isEmpty(), "No messages decoded from " + file);
+}
@@ -21,6 +21,7 @@
 
 #include "gis/gpx/CGpxProject.h"
 #include "gis/trk/CGisItemTrk.h"
+#include "gis/trk/CKnownExtension.h"
 
 #include <QtCore>
 
@@ -54,3 +55,209 @@ void test_QMapShack::_filterDeleteExtension()
     }
 }
 
+
+static QString historyHash(const QByteArray& data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+}
+
+void test_QMapShack::_historyDeltaRoundTrip()
+{
+    // a synthetic track large enough to make deltas worthwhile
+    QByteArray data;
+    data += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<gpx xmlns=\"http://www.topografix.com/GPX/1/1\" version=\"1.1\">\n"
+            " <trk><name>History</name><trkseg>\n";
+    const QDateTime start = QDateTime::fromString("2017-06-01T08:00:00Z", Qt::ISODate);
+    for(int i = 0; i < 5000; i++)
+    {
+        data += QString("  <trkpt lat=\"%1\" lon=\"%2\"><ele>%3</ele><time>%4</time></trkpt>\n")
+                .arg(49 + i * 1e-5, 0, 'f', 8).arg(11 + i * 1e-5, 0, 'f', 8).arg(500 + i % 100)
+                .arg(start.addSecs(i).toString(Qt::ISODate)).toUtf8();
+    }
+    data += " </trkseg></trk>\n</gpx>\n";
+
+    const QString& tmpFile = TestHelper::getTempFileName("gpx");
+    QFile file(tmpFile);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+
+    CGpxProject *proj = new CGpxProject("a very random string to prevent loading via constructor", (CGisListWks*) nullptr);
+    CGpxProject::loadGpx(tmpFile, proj);
+    QFile(tmpFile).remove();
+
+    SUBVERIFY(proj->childCount() == 1, "Expected exactly one track");
+    CGisItemTrk *trk = dynamic_cast<CGisItemTrk*>(proj->child(0));
+    SUBVERIFY(nullptr != trk, "Expected a track");
+
+    // small edits, each one a new history entry
+    QStringList names;
+    for(int i = 0; i < 10; i++)
+    {
+        names << QString("step %1").arg(i);
+        trk->setName(names.last());
+        if(i % 3 == 0)
+        {
+            trk->filterOffsetElevation(1);
+        }
+    }
+
+    // the deltas are calculated in the background and applied by the next change
+    QThreadPool::globalInstance()->waitForDone();
+    names << "last step";
+    trk->setName(names.last());
+
+    const IGisItem::history_t& history = trk->getHistory();
+    const int N = history.events.size();
+    SUBVERIFY(N > names.size(), "Expected a history entry per change");
+
+    int sizeStored = 0;
+    int sizeFull   = 0;
+    int cntDelta   = 0;
+    for(int i = 0; i < N; i++)
+    {
+        const IGisItem::history_event_t& event = history.events[i];
+        const QByteArray& full = history.getData(i);
+        SUBVERIFY(historyHash(full) == event.hash, QString("History entry %1 does not match its hash").arg(i));
+
+        sizeStored += event.data.size();
+        sizeFull   += full.size();
+        cntDelta   += event.isDelta ? 1 : 0;
+        qDebug() << "history entry" << i << (event.isDelta ? "delta" : "full") << event.data.size() << "of" << full.size() << "bytes";
+    }
+    qDebug() << "history:" << sizeStored << "bytes stored instead of" << sizeFull << "bytes";
+    SUBVERIFY(cntDelta > 0, "Expected at least one history entry to be stored as delta");
+    SUBVERIFY(sizeStored < sizeFull, "Expected the deltas to save memory");
+
+    // the history written to a stream has the complete data of each entry
+    QByteArray buffer;
+    {
+        QDataStream out(&buffer, QIODevice::WriteOnly);
+        out.setByteOrder(QDataStream::LittleEndian);
+        out.setVersion(QDataStream::Qt_5_2);
+        out << history;
+    }
+
+    IGisItem::history_t restored;
+    {
+        QDataStream in(&buffer, QIODevice::ReadOnly);
+        in.setByteOrder(QDataStream::LittleEndian);
+        in.setVersion(QDataStream::Qt_5_2);
+        in >> restored;
+    }
+
+    VERIFY_EQUAL(history.histIdxCurrent, restored.histIdxCurrent);
+    VERIFY_EQUAL(N, restored.events.size());
+    for(int i = 0; i < N; i++)
+    {
+        SUBVERIFY(!restored.events[i].isDelta, "Expected restored history entries to be complete");
+        SUBVERIFY(restored.events[i].data == history.getData(i), QString("Restored history entry %1 differs").arg(i));
+        VERIFY_EQUAL(history.events[i].hash, restored.events[i].hash);
+    }
+
+    // each name change can be restored from the history
+    for(int i = N - 1; i >= 0; i--)
+    {
+        trk->loadHistory(i);
+        const QString& name = trk->getName();
+        SUBVERIFY(name == "History" || names.contains(name), QString("Unexpected name '%1' in history entry %2").arg(name).arg(i));
+    }
+    trk->loadHistory(N - 1);
+    VERIFY_EQUAL(names.last(), trk->getName());
+
+    delete proj;
+}
+
+
+/// a track with gaps in the elevation and an irregular time step, elevations from the map override the default ones
+static QByteArray createTrackGpx(int N, const QMap<int, qint32>& eleOverride)
+{
+    QByteArray data;
+    data += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<gpx xmlns=\"http://www.topografix.com/GPX/1/1\" version=\"1.1\">\n"
+            " <trk><name>Elevation</name><trkseg>\n";
+    QDateTime time = QDateTime::fromString("2017-06-01T08:00:00Z", Qt::ISODate);
+    for(int i = 0; i < N; i++)
+    {
+        qint32 ele = (i % 7 == 3) ? NOINT : qRound(500 + 40 * qSin(i / 50.0));
+        ele = eleOverride.value(i, ele);
+
+        const QString& strEle = (ele == NOINT) ? QString() : QString("<ele>%1</ele>").arg(ele);
+        data += QString("  <trkpt lat=\"%1\" lon=\"%2\">%3<time>%4</time></trkpt>\n")
+                .arg(49 + i * 1e-5, 0, 'f', 8).arg(11 + i * 1e-5, 0, 'f', 8).arg(strEle)
+                .arg(time.toString(Qt::ISODate)).toUtf8();
+        time = time.addSecs(1 + i % 4);
+    }
+    data += " </trkseg></trk>\n</gpx>\n";
+    return data;
+}
+
+static CGpxProject * loadTrackGpx(const QByteArray& data)
+{
+    const QString& tmpFile = TestHelper::getTempFileName("gpx");
+    QFile file(tmpFile);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+
+    CGpxProject *proj = new CGpxProject("a very random string to prevent loading via constructor", (CGisListWks*) nullptr);
+    CGpxProject::loadGpx(tmpFile, proj);
+    QFile(tmpFile).remove();
+    return proj;
+}
+
+void test_QMapShack::_deriveElevationData()
+{
+    const int N = 3000;
+
+    // single points, points without elevation before and the first and last point
+    QMap<int, qint32> edits;
+    edits[0]    = 480;
+    edits[10]   = 600;
+    edits[1000] = 900;
+    edits[1001] = NOINT;
+    edits[1403] = 505;
+    edits[N - 1] = 400;
+
+    CGpxProject * projEdit = loadTrackGpx(createTrackGpx(N, QMap<int, qint32>()));
+    CGpxProject * projFull = loadTrackGpx(createTrackGpx(N, edits));
+    SUBVERIFY(projEdit->childCount() == 1 && projFull->childCount() == 1, "Expected exactly one track");
+
+    CGisItemTrk * trkEdit = dynamic_cast<CGisItemTrk*>(projEdit->child(0));
+    CGisItemTrk * trkFull = dynamic_cast<CGisItemTrk*>(projFull->child(0));
+    SUBVERIFY(nullptr != trkEdit && nullptr != trkFull, "Expected a track");
+
+    // each edit derives the points close to it only, the result must match a track derived as a whole
+    for(auto it = edits.constBegin(); it != edits.constEnd(); ++it)
+    {
+        trkEdit->setElevation(it.key(), it.value());
+    }
+
+    const CTrackData& dataEdit = trkEdit->getTrackData();
+    const CTrackData& dataFull = trkFull->getTrackData();
+    for(int i = 0; i < N; i++)
+    {
+        const CTrackData::trkpt_t * ptEdit = dataEdit.getTrkPtByTotalIndex(i);
+        const CTrackData::trkpt_t * ptFull = dataFull.getTrkPtByTotalIndex(i);
+        SUBVERIFY(nullptr != ptEdit && nullptr != ptFull, QString("Missing point %1").arg(i));
+
+        const QString& msg = QString("Point %1 differs").arg(i);
+        SUBVERIFY(ptEdit->ele     == ptFull->ele,     msg);
+        SUBVERIFY(ptEdit->ascent  == ptFull->ascent,  msg);
+        SUBVERIFY(ptEdit->descent == ptFull->descent, msg);
+        SUBVERIFY(ptEdit->slope1  == ptFull->slope1,  msg);
+        SUBVERIFY(ptEdit->slope2  == ptFull->slope2,  msg);
+        SUBVERIFY(ptEdit->speed   == ptFull->speed,   msg);
+        SUBVERIFY(ptEdit->valid   == ptFull->valid,   msg);
+    }
+
+    for(const QString& source : {CKnownExtension::internalEle, CKnownExtension::internalSlope, CKnownExtension::internalSpeedDist, CKnownExtension::internalSpeedTime})
+    {
+        VERIFY_EQUAL(trkFull->getMin(source), trkEdit->getMin(source));
+        VERIFY_EQUAL(trkFull->getMax(source), trkEdit->getMax(source));
+    }
+
+    delete projEdit;
+    delete projFull;
+}
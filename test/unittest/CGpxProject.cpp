@@ -20,6 +20,9 @@
 #include "test_QMapShack.h"
 
 #include "gis/gpx/CGpxProject.h"
+#include "gis/trk/CGisItemTrk.h"
+
+#include <QtXml>
 
 void test_QMapShack::writeReadGpxFile(const QString &file)
 {
@@ -47,3 +50,246 @@ void test_QMapShack::_writeReadGpxFile()
     writeReadGpxFile("V1.6.0_file2.qms");
 }
 
+
+/// a track with the odd corners of XML the stream based track point reader has to handle like the DOM
+static const char * trickyGpx =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<gpx xmlns=\"http://www.topografix.com/GPX/1/1\" version=\"1.1\" xmlns:gpxtpx=\"http://www.garmin.com/xmlschemas/TrackPointExtension/v1\">\n"
+    " <trk>\n"
+    "  <name>Tricky</name>\n"
+    "  <trkseg>\n"
+    "   <trkpt lat=\"49.1\" lon=\"11.1\">\n"
+    "    <ele> 525.6 </ele>\n"
+    "    <time>2015-10-02T13:56:08Z</time>\n"
+    "    <name>A &amp; B <!-- comment --> C</name>\n"
+    "    <name>ignored</name>\n"
+    "    <cmt><![CDATA[<b>bold</b>]]></cmt>\n"
+    "    <desc>   </desc>\n"
+    "    <link href=\"http://www.example.com/1\"><text>one</text><type>text/html</type><text>ignored</text></link>\n"
+    "    <link href=\"http://www.example.com/2\"/>\n"
+    "    <url>http://www.example.com/3</url>\n"
+    "    <urlname>three</urlname>\n"
+    "    <sat>7.6</sat>\n"
+    "    <hdop>x</hdop>\n"
+    "    <extensions>\n"
+    "     <ql:flags>4</ql:flags>\n"
+    "     <ql:activity>3</ql:activity>\n"
+    "     <ql:flagsOld>1</ql:flagsOld>\n"
+    "     <gpxtpx:TrackPointExtension>\n"
+    "      <gpxtpx:hr>90</gpxtpx:hr>\n"
+    "      <gpxtpx:cad> 60 </gpxtpx:cad>\n"
+    "      <gpxtpx:cad>61</gpxtpx:cad>\n"
+    "      <!-- comment -->\n"
+    "      <gpxtpx:empty/>\n"
+    "     </gpxtpx:TrackPointExtension>\n"
+    "     <mixed>text<b>bold</b>tail</mixed>\n"
+    "     <commentFirst><!-- comment -->text<c>child</c></commentFirst>\n"
+    "    </extensions>\n"
+    "    <extensions><ignored>1</ignored></extensions>\n"
+    "   </trkpt>\n"
+    "   <trkpt lat=\"49.2\" lon=\"11.2\"/>\n"
+    "  </trkseg>\n"
+    "  <trkseg>\n"
+    "   <trkpt lat=\"49.3\" lon=\"11.3\"><ele>527</ele></trkpt>\n"
+    "  </trkseg>\n"
+    " </trk>\n"
+    "</gpx>\n";
+
+static QString writeTempGpx(const QByteArray& data)
+{
+    const QString& filename = TestHelper::getTempFileName("gpx");
+    QFile file(filename);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    return filename;
+}
+
+static void compareTracks(const CTrackData& exp, const CTrackData& act)
+{
+    VERIFY_EQUAL(exp.segs.size(), act.segs.size());
+    for(int s = 0; s < exp.segs.size(); s++)
+    {
+        const QVector<CTrackData::trkpt_t>& expPts = exp.segs[s].pts;
+        const QVector<CTrackData::trkpt_t>& actPts = act.segs[s].pts;
+        VERIFY_EQUAL(expPts.size(), actPts.size());
+
+        for(int n = 0; n < expPts.size(); n++)
+        {
+            const CTrackData::trkpt_t& e = expPts[n];
+            const CTrackData::trkpt_t& a = actPts[n];
+            SUBVERIFY(e.lat == a.lat && e.lon == a.lon, "Position differs");
+            VERIFY_EQUAL(e.ele, a.ele);
+            SUBVERIFY(e.time == a.time, "Time differs");
+            VERIFY_EQUAL(e.magvar, a.magvar);
+            VERIFY_EQUAL(e.geoidheight, a.geoidheight);
+            VERIFY_EQUAL(e.name, a.name);
+            VERIFY_EQUAL(e.cmt, a.cmt);
+            VERIFY_EQUAL(e.desc, a.desc);
+            VERIFY_EQUAL(e.src, a.src);
+            VERIFY_EQUAL(e.sym, a.sym);
+            VERIFY_EQUAL(e.type, a.type);
+            VERIFY_EQUAL(e.fix, a.fix);
+            VERIFY_EQUAL(e.sat, a.sat);
+            VERIFY_EQUAL(e.hdop, a.hdop);
+            VERIFY_EQUAL(e.vdop, a.vdop);
+            VERIFY_EQUAL(e.pdop, a.pdop);
+            VERIFY_EQUAL(e.ageofdgpsdata, a.ageofdgpsdata);
+            VERIFY_EQUAL(e.dgpsid, a.dgpsid);
+            VERIFY_EQUAL(e.flags, a.flags);
+            VERIFY_EQUAL(int(e.getAct()), int(a.getAct()));
+
+            VERIFY_EQUAL(e.links.size(), a.links.size());
+            for(int l = 0; l < e.links.size(); l++)
+            {
+                SUBVERIFY(e.links[l].uri == a.links[l].uri, "Link differs");
+                VERIFY_EQUAL(e.links[l].text, a.links[l].text);
+                VERIFY_EQUAL(e.links[l].type, a.links[l].type);
+            }
+
+            SUBVERIFY(e.extensions == a.extensions, QString("Extensions differ: %1 vs. %2")
+                      .arg(QStringList(e.extensions.keys()).join(",")).arg(QStringList(a.extensions.keys()).join(",")));
+        }
+    }
+}
+
+void test_QMapShack::readGpxStreamVsDom(const QString &file)
+{
+    const QString& path = fileToPath(file);
+
+    // the file as read by the DOM based reader
+    QFile gpxFile(path);
+    SUBVERIFY(gpxFile.open(QIODevice::ReadOnly), "Failed to open " + file);
+    QDomDocument xml;
+    SUBVERIFY(xml.setContent(&gpxFile), "Failed to parse " + file);
+    gpxFile.close();
+
+    CGpxProject *domProj = new CGpxProject("a very random string to prevent loading via constructor", (CGisListWks*) nullptr);
+    const QDomNodeList& xmlTrks = xml.documentElement().elementsByTagName("trk");
+    for(int n = 0; n < xmlTrks.count(); n++)
+    {
+        new CGisItemTrk(xmlTrks.item(n), domProj);
+    }
+
+    // the file as streamed
+    CGpxProject *proj = new CGpxProject("a very random string to prevent loading via constructor", (CGisListWks*) nullptr);
+    CGpxProject::loadGpx(path, proj);
+
+    QList<CGisItemTrk*> domTrks;
+    QList<CGisItemTrk*> trks;
+    for(int i = 0; i < domProj->childCount(); i++)
+    {
+        CGisItemTrk * trk = dynamic_cast<CGisItemTrk*>(domProj->child(i));
+        if(trk != nullptr)
+        {
+            domTrks << trk;
+        }
+    }
+    for(int i = 0; i < proj->childCount(); i++)
+    {
+        CGisItemTrk * trk = dynamic_cast<CGisItemTrk*>(proj->child(i));
+        if(trk != nullptr)
+        {
+            trks << trk;
+        }
+    }
+
+    VERIFY_EQUAL(domTrks.size(), trks.size());
+    for(int i = 0; i < trks.size(); i++)
+    {
+        VERIFY_EQUAL(domTrks[i]->getName(), trks[i]->getName());
+        compareTracks(domTrks[i]->getTrackData(), trks[i]->getTrackData());
+    }
+
+    delete domProj;
+    delete proj;
+}
+
+void test_QMapShack::_readGpxStreamVsDom()
+{
+    readGpxStreamVsDom("qtt_gpx_file0.gpx");
+    readGpxStreamVsDom("gpx_ext_GarminTPX1_gpxtpx.gpx");
+    readGpxStreamVsDom("gpx_ext_GarminTPX1_tp1.gpx");
+    readGpxStreamVsDom("gpx_ext_GarminTPX1_cns.gpx");
+
+    const QString& tmpFile = writeTempGpx(trickyGpx);
+    readGpxStreamVsDom(tmpFile);
+    QFile(tmpFile).remove();
+}
+
+void test_QMapShack::_readTruncatedGpxFile()
+{
+    QFile file(fileToPath("qtt_gpx_file0.gpx"));
+    SUBVERIFY(file.open(QIODevice::ReadOnly), "Failed to open qtt_gpx_file0.gpx");
+    const QByteArray& data = file.readAll();
+    file.close();
+
+    const QString& tmpFile = writeTempGpx(data.left(data.size() / 2));
+    bool failed = false;
+    CGpxProject *proj = new CGpxProject("a very random string to prevent loading via constructor", (CGisListWks*) nullptr);
+    try
+    {
+        CGpxProject::loadGpx(tmpFile, proj);
+    }
+    catch(QString&)
+    {
+        failed = true;
+    }
+    delete proj;
+    QFile(tmpFile).remove();
+
+    SUBVERIFY(failed, "Loading a truncated file did not fail");
+}
+
+void test_QMapShack::_gpxBenchmark_data()
+{
+    QTest::addColumn<bool>("save");
+    QTest::newRow("load") << false;
+    QTest::newRow("save") << true;
+}
+
+void test_QMapShack::_gpxBenchmark()
+{
+    QFETCH(bool, save);
+
+    // a synthetic track of 50000 points with time and heart rate, like a long recording
+    QByteArray data;
+    data += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<gpx xmlns=\"http://www.topografix.com/GPX/1/1\" version=\"1.1\" xmlns:gpxtpx=\"http://www.garmin.com/xmlschemas/TrackPointExtension/v1\">\n"
+            " <trk><name>Benchmark</name><trkseg>\n";
+    const QDateTime start = QDateTime::fromString("2017-06-01T08:00:00Z", Qt::ISODate);
+    for(int i = 0; i < 50000; i++)
+    {
+        data += QString("  <trkpt lat=\"%1\" lon=\"%2\"><ele>%3</ele><time>%4</time>"
+                        "<extensions><gpxtpx:TrackPointExtension><gpxtpx:hr>%5</gpxtpx:hr></gpxtpx:TrackPointExtension></extensions></trkpt>\n")
+                .arg(49 + i * 1e-5, 0, 'f', 8).arg(11 + i * 1e-5, 0, 'f', 8).arg(500 + i % 100)
+                .arg(start.addSecs(i).toString(Qt::ISODate)).arg(90 + i % 50).toUtf8();
+    }
+    data += " </trkseg></trk>\n</gpx>\n";
+
+    const QString& tmpFile = writeTempGpx(data);
+    const QString& outFile = TestHelper::getTempFileName("gpx");
+
+    if(save)
+    {
+        CGpxProject *proj = new CGpxProject("a very random string to prevent loading via constructor", (CGisListWks*) nullptr);
+        CGpxProject::loadGpx(tmpFile, proj);
+        QBENCHMARK
+        {
+            CGpxProject::saveAs(outFile, *proj, false);
+        }
+        delete proj;
+    }
+    else
+    {
+        QBENCHMARK
+        {
+            CGpxProject *proj = new CGpxProject("a very random string to prevent loading via constructor", (CGisListWks*) nullptr);
+            CGpxProject::loadGpx(tmpFile, proj);
+            delete proj;
+        }
+    }
+
+    QFile(tmpFile).remove();
+    QFile(outFile).remove();
+}
@@ -0,0 +1,136 @@
+/**********************************************************************************************
+    Copyright (C) 2014 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "TestHelper.h"
+#include "test_QMapShack.h"
+
+#include "map/CMapVRT.h"
+
+#include <gdal_priv.h>
+#include <ogr_spatialref.h>
+#include <QtCore>
+#include <QtGui>
+
+#define FILE_SIZE   4096
+#define BLOCK_SIZE  256
+#define BUFFER_SIZE 1024
+
+/**
+   @brief Access to the tile cache of CMapVRT
+ */
+class CMapVRTTiles : public CMapVRT
+{
+public:
+    CMapVRTTiles(const QString& filename) : CMapVRT(filename, nullptr)
+    {
+    }
+
+    using CMapVRT::getTile;
+    using CMapVRT::tiles;
+    using CMapVRT::tileSizeX;
+    using CMapVRT::tileSizeY;
+    using CMapVRT::overviewFactors;
+};
+
+/// a tiled RGB GeoTIFF in web mercator with overviews 2, 4 and 8
+static QString createGeoTiff()
+{
+    const QString& filename = TestHelper::getTempFileName("tif");
+
+    char ** options = nullptr;
+    options = CSLSetNameValue(options, "TILED", "YES");
+    options = CSLSetNameValue(options, "BLOCKXSIZE", QByteArray::number(BLOCK_SIZE));
+    options = CSLSetNameValue(options, "BLOCKYSIZE", QByteArray::number(BLOCK_SIZE));
+    options = CSLSetNameValue(options, "PHOTOMETRIC", "RGB");
+    options = CSLSetNameValue(options, "COMPRESS", "DEFLATE");
+
+    GDALDriver * driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+    GDALDataset * dataset = driver->Create(filename.toUtf8(), FILE_SIZE, FILE_SIZE, 3, GDT_Byte, options);
+    CSLDestroy(options);
+    SUBVERIFY(nullptr != dataset, "Failed to create GeoTIFF");
+
+    OGRSpatialReference oSRS;
+    oSRS.importFromEPSG(3857);
+    char * wkt = nullptr;
+    oSRS.exportToWkt(&wkt);
+    dataset->SetProjection(wkt);
+    CPLFree(wkt);
+
+    double adfGeoTransform[6] = {1000000, 10, 0, 6000000, 0, -10};
+    dataset->SetGeoTransform(adfGeoTransform);
+
+    QByteArray line(FILE_SIZE * 3, 0);
+    for(int y = 0; y < FILE_SIZE; y++)
+    {
+        for(int x = 0; x < FILE_SIZE; x++)
+        {
+            line[x * 3]     = char(x);
+            line[x * 3 + 1] = char(y);
+            line[x * 3 + 2] = char(x ^ y);
+        }
+        dataset->RasterIO(GF_Write, 0, y, FILE_SIZE, 1, line.data(), FILE_SIZE, 1, GDT_Byte, 3, nullptr, 3, FILE_SIZE * 3, 1);
+    }
+
+    int overviews[] = {2, 4, 8};
+    dataset->BuildOverviews("AVERAGE", 3, overviews, 0, nullptr, nullptr, nullptr);
+    GDALClose(dataset);
+
+    return filename;
+}
+
+void test_QMapShack::_mapVRTBenchmark_data()
+{
+    QTest::addColumn<qreal>("factor");
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("full")     << 1.0 << false;
+    QTest::newRow("overview") << 4.0 << false;
+    QTest::newRow("cached")   << 1.0 << true;
+}
+
+void test_QMapShack::_mapVRTBenchmark()
+{
+    QFETCH(qreal, factor);
+    QFETCH(bool, cached);
+
+    const QString& filename = createGeoTiff();
+    {
+        CMapVRTTiles map(filename);
+        SUBVERIFY(map.tileSizeX == BLOCK_SIZE && map.tileSizeY == BLOCK_SIZE, "Tiles are not aligned to the file's blocks");
+        SUBVERIFY(map.overviewFactors == QVector<qreal>({1, 2, 4, 8}), "Overviews of the file are not detected");
+
+        // the tiles covering a buffer of BUFFER_SIZE x BUFFER_SIZE pixel
+        const int N = BUFFER_SIZE / BLOCK_SIZE;
+        QImage img;
+
+        QBENCHMARK
+        {
+            if(!cached)
+            {
+                map.tiles.clear();
+            }
+            for(int row = 0; row < N; row++)
+            {
+                for(int col = 0; col < N; col++)
+                {
+                    SUBVERIFY(map.getTile(factor, col, row, img), QString("Failed to read tile %1/%2").arg(col).arg(row));
+                }
+            }
+        }
+    }
+    QFile::remove(filename);
+}
@@ -0,0 +1,118 @@
+/**********************************************************************************************
+    Copyright (C) 2014 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "TestHelper.h"
+#include "test_QMapShack.h"
+
+#include "helpers/CPackedRTree.h"
+
+#include <algorithm>
+#include <proj_api.h>
+#include <QtCore>
+
+/// random boxes in [rad] as used by the maps, with negative height
+static QVector<CPackedRTree::item_t> createItems(qint32 N, quint32 seed)
+{
+    qsrand(seed);
+
+    QVector<CPackedRTree::item_t> items(N);
+    for(qint32 i = 0; i < N; i++)
+    {
+        const qreal x = (qrand() % 36000 - 18000) / 100.0 * DEG_TO_RAD;
+        const qreal y = (qrand() % 17000 - 8500) / 100.0 * DEG_TO_RAD;
+        const qreal w = (qrand() % 100) / 100.0 * DEG_TO_RAD;
+        const qreal h = (qrand() % 100) / 100.0 * DEG_TO_RAD;
+
+        items[i].box = QRectF(x, y, w, -h);
+        items[i].id  = i;
+    }
+    return items;
+}
+
+static QVector<qint32> queryBruteForce(const QVector<CPackedRTree::item_t>& items, const QRectF& area)
+{
+    const QRectF& rect = area.normalized();
+
+    QVector<qint32> ids;
+    for(const CPackedRTree::item_t &item : items)
+    {
+        const QRectF& box = item.box.normalized();
+        if(box.left() <= rect.right() && rect.left() <= box.right() && box.top() <= rect.bottom() && rect.top() <= box.bottom())
+        {
+            ids << item.id;
+        }
+    }
+    return ids;
+}
+
+void test_QMapShack::_packedRTreeQuery()
+{
+    CPackedRTree tree;
+    SUBVERIFY(tree.isEmpty(), "New tree is not empty");
+
+    QVector<qint32> ids;
+    tree.query(QRectF(-1, 1, 2, -2), ids);
+    SUBVERIFY(ids.isEmpty(), "Empty tree reports items");
+
+    // sizes around the node capacity and with several levels
+    for(qint32 N : {1, 15, 16, 17, 300, 5000})
+    {
+        const QVector<CPackedRTree::item_t>& items = createItems(N, N);
+        tree.build(items);
+
+        for(qint32 q = 0; q < 50; q++)
+        {
+            const QRectF area = createItems(1, 1000 * N + q).first().box.adjusted(-0.05, 0.05, 0.05, -0.05);
+
+            QVector<qint32> expected = queryBruteForce(items, area);
+            ids.clear();
+            tree.query(area, ids);
+
+            std::sort(expected.begin(), expected.end());
+            std::sort(ids.begin(), ids.end());
+            SUBVERIFY(ids == expected, QString("Query result differs for %1 items").arg(N));
+        }
+
+        // the whole world reports all items
+        ids.clear();
+        tree.query(QRectF(-M_PI, M_PI_2, 2 * M_PI, -M_PI), ids);
+        VERIFY_EQUAL(N, ids.size());
+    }
+
+    tree.clear();
+    SUBVERIFY(tree.isEmpty(), "Cleared tree is not empty");
+}
+
+void test_QMapShack::_packedRTreePan()
+{
+    // a viewport of 1 x 0.5 deg panned over 100000 subdivisions
+    const QVector<CPackedRTree::item_t>& items = createItems(100000, 42);
+    CPackedRTree tree;
+    tree.build(items);
+
+    QVector<qint32> ids;
+    QBENCHMARK
+    {
+        for(qint32 i = 0; i < 100; i++)
+        {
+            const qreal x = (-10 + i * 0.2) * DEG_TO_RAD;
+            ids.clear();
+            tree.query(QRectF(x, 45 * DEG_TO_RAD, 1 * DEG_TO_RAD, -0.5 * DEG_TO_RAD), ids);
+        }
+    }
+}
@@ -53,6 +53,11 @@ class test_QMapShack : public QObject
     // CGpxProject
     void writeReadGpxFile(const QString &file);
     void _writeReadGpxFile();
+    void readGpxStreamVsDom(const QString &file);
+    void _readGpxStreamVsDom();
+    void _readTruncatedGpxFile();
+    void _gpxBenchmark_data();
+    void _gpxBenchmark();
 
     // CKnownExtension
     void _readExtGarminTPX1_tp1();
@@ -66,9 +71,35 @@ class test_QMapShack : public QObject
 
     // CFitProject
     void _readValidFitFiles();
+    void _fitDecoderBenchmark_data();
+    void _fitDecoderBenchmark();
 
     // CGisItemTrk
     void _filterDeleteExtension();
+    void _historyDeltaRoundTrip();
+    void _deriveElevationData();
+
+    // CDiskCache
+    void _diskCacheStoreRestore();
+    void _diskCacheJournal();
+
+    // CPackedRTree
+    void _packedRTreeQuery();
+    void _packedRTreePan();
+
+    // IDem
+    void _demKernels();
+    void _demKernelsBenchmark_data();
+    void _demKernelsBenchmark();
+
+    // IDrawContext
+    void _drawContextConvert();
+    void _drawContextBenchmark_data();
+    void _drawContextBenchmark();
+
+    // CMapVRT
+    void _mapVRTBenchmark_data();
+    void _mapVRTBenchmark();
 
 private slots:
     void initTestCase();
@@ -76,10 +107,30 @@ private slots:
     void testreadValidSLFFile()         { TCWRAPPER( _readValidSLFFile()         ) }
     void testreadNonExistingSLFFile()   { TCWRAPPER( _readNonExistingSLFFile()   ) }
     void testwriteReadGpxFile()         { TCWRAPPER( _writeReadGpxFile()         ) }
+    void testreadGpxStreamVsDom()       { TCWRAPPER( _readGpxStreamVsDom()       ) }
+    void testreadTruncatedGpxFile()     { TCWRAPPER( _readTruncatedGpxFile()     ) }
+    void benchgpx_data()                { _gpxBenchmark_data(); }
+    void benchgpx()                     { TCWRAPPER( _gpxBenchmark()             ) }
     void testreadQmsFile_1_6_0()        { TCWRAPPER( _readQmsFile_1_6_0()        ) }
     void testwriteReadQmsFile()         { TCWRAPPER( _writeReadQmsFile()         ) }
     void testreadExtGarminTPX1_gpxtpx() { TCWRAPPER( _readExtGarminTPX1_gpxtpx() ) }
     void testreadExtGarminTPX1_tp1()    { TCWRAPPER( _readExtGarminTPX1_tp1()    ) }
     void testreadValidFitFiles()        { TCWRAPPER( _readValidFitFiles()        ) }
+    void benchfitDecoder_data()         { _fitDecoderBenchmark_data(); }
+    void benchfitDecoder()              { TCWRAPPER( _fitDecoderBenchmark()      ) }
     void testfilterDeleteExtension()    { TCWRAPPER( _filterDeleteExtension()    ) }
+    void testhistoryDeltaRoundTrip()    { TCWRAPPER( _historyDeltaRoundTrip()    ) }
+    void testderiveElevationData()      { TCWRAPPER( _deriveElevationData()      ) }
+    void testdiskCacheStoreRestore()    { TCWRAPPER( _diskCacheStoreRestore()    ) }
+    void testdiskCacheJournal()         { TCWRAPPER( _diskCacheJournal()         ) }
+    void testpackedRTreeQuery()         { TCWRAPPER( _packedRTreeQuery()         ) }
+    void benchpackedRTreePan()          { TCWRAPPER( _packedRTreePan()           ) }
+    void testdemKernels()               { TCWRAPPER( _demKernels()               ) }
+    void benchdemKernels_data()         { _demKernelsBenchmark_data(); }
+    void benchdemKernels()              { TCWRAPPER( _demKernelsBenchmark()      ) }
+    void testdrawContextConvert()       { TCWRAPPER( _drawContextConvert()       ) }
+    void benchdrawContext_data()        { _drawContextBenchmark_data(); }
+    void benchdrawContext()             { TCWRAPPER( _drawContextBenchmark()     ) }
+    void benchmapVRT_data()             { _mapVRTBenchmark_data(); }
+    void benchmapVRT()                  { TCWRAPPER( _mapVRTBenchmark()          ) }
 };